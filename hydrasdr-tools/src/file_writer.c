@@ -0,0 +1,1008 @@
+/*
+ * Copyright 2025 Benjamin Vernoux <bvernoux@hydrasdr.com>
+ *
+ * This file is part of HydraSDR.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#if defined(__linux__)
+#define _GNU_SOURCE /* O_DIRECT and fallocate() */
+#endif
+
+#include "file_writer.h"
+#include "iq_codec.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Room for "_" + 20 digits sample index */
+#define SEGMENT_SUFFIX_MAX_LEN (24)
+
+typedef struct
+{
+	char* prefix;             /* Path without extension */
+	const char* extension;    /* Extension of the path given to file_writer_open_segmented() */
+	uint64_t bytes;           /* Segment size, 0 when not segmented */
+	uint32_t sample_bits;
+	char* name;               /* Path of the last segment opened */
+} segment_naming_t;
+
+static int segment_naming_init(segment_naming_t* seg, const char* path, uint64_t segment_bytes, uint32_t sample_bits)
+{
+	const char* dot;
+	const char* sep;
+	size_t prefix_len;
+
+	/* Whole bytes of 8 samples so each file starts on a sample (and a 12bits pair) boundary */
+	seg->bytes = segment_bytes - (segment_bytes % sample_bits);
+	seg->sample_bits = sample_bits;
+	if (seg->bytes == 0)
+	{
+		return -1;
+	}
+
+	dot = strrchr(path, '.');
+	sep = strrchr(path, '/');
+	if (sep == NULL || (strrchr(path, '\\') != NULL && strrchr(path, '\\') > sep))
+	{
+		sep = strrchr(path, '\\');
+	}
+	if (dot == NULL || (sep != NULL && dot < sep) || dot == path || (sep != NULL && dot == sep + 1))
+	{
+		dot = path + strlen(path);
+	}
+
+	prefix_len = (size_t) (dot - path);
+	seg->prefix = (char*) malloc(prefix_len + 1);
+	seg->name = (char*) malloc(strlen(path) + SEGMENT_SUFFIX_MAX_LEN);
+	if (seg->prefix == NULL || seg->name == NULL)
+	{
+		free(seg->prefix);
+		free(seg->name);
+		return -1;
+	}
+	memcpy(seg->prefix, path, prefix_len);
+	seg->prefix[prefix_len] = '\0';
+	seg->extension = path + prefix_len;
+
+	return 0;
+}
+
+/* Segment files are named after the index of their first sample */
+static const char* segment_name(segment_naming_t* seg, uint32_t segment)
+{
+	uint64_t first_sample;
+
+	first_sample = (uint64_t) segment * (seg->bytes / seg->sample_bits) * 8;
+	sprintf(seg->name, "%s_%012llu%s", seg->prefix, (unsigned long long) first_sample, seg->extension);
+
+	return seg->name;
+}
+
+static void segment_naming_free(segment_naming_t* seg)
+{
+	free(seg->prefix);
+	free(seg->name);
+}
+
+/* Channels of the compressed stream, 0 when not compressing */
+static uint16_t codec_channels(uint32_t flags)
+{
+	if (flags & FILE_WRITER_COMPRESS_IQ)
+	{
+		return 2;
+	}
+	if (flags & FILE_WRITER_COMPRESS_REAL)
+	{
+		return 1;
+	}
+	return 0;
+}
+
+#ifdef _WIN32
+
+struct file_writer
+{
+	FILE* fd;
+	uint64_t total;
+	int error;
+	segment_naming_t seg;
+	uint32_t segment;
+	uint64_t segment_fill;    /* Bytes written in the current segment */
+	uint16_t channels;        /* Compressed stream channels, 0 when not compressing */
+	uint8_t* block;           /* Samples waiting to be compressed */
+	size_t block_len;
+	uint8_t* codec_buffer;
+};
+
+static FILE* open_file(file_writer_t* fw, const char* path)
+{
+	FILE* fd;
+	iq_codec_stream_hdr_t hdr;
+
+	fd = strcmp(path, "-") ? fopen(path, "wb") : stdout;
+	if (fd != NULL)
+	{
+		setvbuf(fd, NULL, _IOFBF, FILE_WRITER_BUFFER_SIZE);
+		if (fw->channels > 0)
+		{
+			iq_codec_stream_hdr_init(&hdr, fw->channels);
+			if (fwrite(&hdr, 1, sizeof(hdr), fd) != sizeof(hdr))
+			{
+				fw->error = 1;
+			}
+		}
+	}
+
+	return fd;
+}
+
+static int flush_block(file_writer_t* fw)
+{
+	size_t len;
+
+	if (fw->block_len == 0)
+	{
+		return 0;
+	}
+
+	len = iq_codec_encode_block((const uint16_t*) fw->block, (uint32_t) (fw->block_len / 2), fw->channels, fw->codec_buffer);
+	fw->block_len = 0;
+	if (fwrite(fw->codec_buffer, 1, len, fw->fd) != len)
+	{
+		fw->error = 1;
+		return -1;
+	}
+
+	return 0;
+}
+
+/* Sends len bytes to the file, through the compressor when enabled */
+static int put_data(file_writer_t* fw, const uint8_t* src, size_t len)
+{
+	size_t chunk;
+
+	if (fw->channels == 0)
+	{
+		return (fwrite(src, 1, len, fw->fd) == len) ? 0 : -1;
+	}
+
+	while (len > 0)
+	{
+		chunk = FILE_WRITER_BUFFER_SIZE - fw->block_len;
+		if (chunk > len)
+		{
+			chunk = len;
+		}
+		memcpy(fw->block + fw->block_len, src, chunk);
+		fw->block_len += chunk;
+		src += chunk;
+		len -= chunk;
+		if (fw->block_len == FILE_WRITER_BUFFER_SIZE && flush_block(fw) != 0)
+		{
+			return -1;
+		}
+	}
+
+	return 0;
+}
+
+static file_writer_t* writer_alloc(uint32_t flags)
+{
+	file_writer_t* fw;
+
+	fw = (file_writer_t*) calloc(1, sizeof(file_writer_t));
+	if (fw == NULL)
+	{
+		return NULL;
+	}
+
+	fw->channels = codec_channels(flags);
+	if (fw->channels > 0)
+	{
+		fw->block = (uint8_t*) malloc(FILE_WRITER_BUFFER_SIZE);
+		fw->codec_buffer = (uint8_t*) malloc(iq_codec_block_bound(FILE_WRITER_BUFFER_SIZE / 2));
+		if (fw->block == NULL || fw->codec_buffer == NULL)
+		{
+			free(fw->block);
+			free(fw->codec_buffer);
+			free(fw);
+			return NULL;
+		}
+	}
+
+	return fw;
+}
+
+static void writer_free(file_writer_t* fw)
+{
+	if (fw->seg.bytes > 0)
+	{
+		segment_naming_free(&fw->seg);
+	}
+	free(fw->block);
+	free(fw->codec_buffer);
+	free(fw);
+}
+
+file_writer_t* file_writer_open(const char* path, uint32_t flags, uint64_t size_hint)
+{
+	file_writer_t* fw;
+
+	(void) size_hint;
+
+	fw = writer_alloc(flags);
+	if (fw == NULL)
+	{
+		return NULL;
+	}
+
+	fw->fd = open_file(fw, path);
+	if (fw->fd == NULL)
+	{
+		writer_free(fw);
+		return NULL;
+	}
+
+	return fw;
+}
+
+file_writer_t* file_writer_open_segmented(const char* path, uint32_t flags, uint64_t segment_bytes, uint32_t sample_bits)
+{
+	file_writer_t* fw;
+
+	if (!strcmp(path, "-"))
+	{
+		return NULL;
+	}
+
+	fw = writer_alloc(flags);
+	if (fw == NULL)
+	{
+		return NULL;
+	}
+
+	if (segment_naming_init(&fw->seg, path, segment_bytes, sample_bits) != 0)
+	{
+		writer_free(fw);
+		return NULL;
+	}
+
+	fw->fd = open_file(fw, segment_name(&fw->seg, 0));
+	if (fw->fd == NULL)
+	{
+		writer_free(fw);
+		return NULL;
+	}
+
+	return fw;
+}
+
+int file_writer_write(file_writer_t* fw, const void* data, size_t len)
+{
+	size_t chunk;
+	const uint8_t* src = (const uint8_t*) data;
+
+	if (fw->error)
+	{
+		return -1;
+	}
+
+	while (len > 0)
+	{
+		chunk = len;
+		if (fw->seg.bytes > 0 && chunk > fw->seg.bytes - fw->segment_fill)
+		{
+			chunk = (size_t) (fw->seg.bytes - fw->segment_fill);
+		}
+
+		if (put_data(fw, src, chunk) != 0)
+		{
+			fw->error = 1;
+			return -1;
+		}
+		fw->total += chunk;
+		fw->segment_fill += chunk;
+		src += chunk;
+		len -= chunk;
+
+		if (fw->seg.bytes > 0 && fw->segment_fill == fw->seg.bytes && len > 0)
+		{
+			fw->segment++;
+			fw->segment_fill = 0;
+			if (flush_block(fw) != 0 || fclose(fw->fd) != 0 ||
+				(fw->fd = open_file(fw, segment_name(&fw->seg, fw->segment))) == NULL)
+			{
+				fw->fd = NULL;
+				fw->error = 1;
+				return -1;
+			}
+		}
+	}
+
+	return 0;
+}
+
+uint64_t file_writer_tell(file_writer_t* fw)
+{
+	return fw->total;
+}
+
+uint32_t file_writer_stalls(file_writer_t* fw)
+{
+	(void) fw;
+	return 0;
+}
+
+int file_writer_close(file_writer_t* fw)
+{
+	int result;
+
+	if (fw->fd != NULL)
+	{
+		flush_block(fw);
+	}
+	result = fw->error ? -1 : 0;
+
+	if (fw->fd == NULL)
+	{
+		result = -1;
+	}
+	else if (fw->fd != stdout)
+	{
+		if (fclose(fw->fd) != 0)
+		{
+			result = -1;
+		}
+	}
+	else
+	{
+		fflush(fw->fd);
+	}
+	writer_free(fw);
+
+	return result;
+}
+
+#else
+
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+#ifdef HAVE_LIBURING
+#include <liburing.h>
+#define URING_QUEUE_DEPTH (8)
+#endif
+
+#ifndef O_DIRECT
+#define O_DIRECT 0
+#endif
+
+/* O_DIRECT requires the offset, length and memory to be aligned on the logical block size */
+#define DIRECT_ALIGNMENT (4096)
+/* Preallocation step when the final size is not known */
+#define PREALLOC_CHUNK (256ull * 1024 * 1024)
+
+struct file_writer
+{
+	int fd;
+	int direct;
+	int regular;              /* Regular file: written with pwrite() and truncated on close */
+	int prealloc;             /* fallocate() is supported */
+	volatile int error;
+	int closing;
+	int thread_running;
+	uint32_t direct_flags;    /* Flags given to file_writer_open(), reused for each segment */
+	uint8_t* buffers[FILE_WRITER_BUFFER_COUNT];
+	size_t lengths[FILE_WRITER_BUFFER_COUNT];
+	uint64_t offsets[FILE_WRITER_BUFFER_COUNT]; /* Offset in the buffer's file */
+	uint32_t segments[FILE_WRITER_BUFFER_COUNT];
+	int fill_index;           /* Buffer being filled by file_writer_write() */
+	size_t fill_len;
+	int write_index;          /* Oldest buffer queued for the writer thread */
+	int queued;               /* Buffers queued or being written */
+	uint64_t total;           /* Bytes accepted */
+	uint64_t queued_bytes;    /* Bytes of the current file handed to the writer thread */
+	uint64_t allocated;       /* Bytes preallocated on disk */
+	uint64_t file_end;        /* Bytes of data written to the open file */
+	segment_naming_t seg;
+	uint32_t fill_segment;    /* Segment of the buffer being filled */
+	uint64_t segment_fill;    /* Bytes accepted in fill_segment */
+	uint32_t open_segment;    /* Segment open on the writer thread */
+	uint16_t channels;        /* Compressed stream channels, 0 when not compressing */
+	uint8_t* codec_buffer;    /* Compressed block, used by the writer thread */
+	uint32_t stalls;
+	pthread_t thread;
+	pthread_mutex_t lock;
+	pthread_cond_t data_cv;   /* Signaled when a buffer is queued or on close */
+	pthread_cond_t free_cv;   /* Signaled when a buffer has been written */
+#ifdef HAVE_LIBURING
+	int use_uring;
+	struct io_uring ring;
+#endif
+};
+
+static void preallocate(file_writer_t* fw, uint64_t end)
+{
+#if defined(__linux__)
+	uint64_t len;
+
+	if (fw->seg.bytes > 0 && end > fw->seg.bytes)
+	{
+		end = fw->seg.bytes;
+	}
+	if (!fw->prealloc || end <= fw->allocated)
+	{
+		return;
+	}
+
+	len = end - fw->allocated;
+	if (len < PREALLOC_CHUNK)
+	{
+		len = PREALLOC_CHUNK;
+	}
+
+	/* Keep the visible size so an interrupted capture does not end with garbage, errors are not fatal */
+	if (fallocate(fw->fd, FALLOC_FL_KEEP_SIZE, (off_t) fw->allocated, (off_t) len) == 0)
+	{
+		fw->allocated += len;
+	}
+	else
+	{
+		fw->prealloc = 0;
+	}
+#else
+	(void) fw;
+	(void) end;
+#endif
+}
+
+static size_t write_length(file_writer_t* fw, int index)
+{
+	size_t len = fw->lengths[index];
+
+	if (fw->direct)
+	{
+		/* Only the last buffer can be partial, padding is truncated on close */
+		len = (len + DIRECT_ALIGNMENT - 1) & ~((size_t) DIRECT_ALIGNMENT - 1);
+		memset(fw->buffers[index] + fw->lengths[index], 0, len - fw->lengths[index]);
+	}
+
+	return len;
+}
+
+static int write_data(file_writer_t* fw, const uint8_t* data, size_t len, uint64_t offset)
+{
+	size_t done = 0;
+	ssize_t result;
+
+	while (done < len)
+	{
+		if (fw->regular)
+		{
+			result = pwrite(fw->fd, data + done, len - done, (off_t) (offset + done));
+		}
+		else
+		{
+			result = write(fw->fd, data + done, len - done);
+		}
+
+		if (result < 0)
+		{
+			if (errno == EINTR)
+			{
+				continue;
+			}
+			return -1;
+		}
+		done += (size_t) result;
+	}
+
+	return 0;
+}
+
+static int write_buffer(file_writer_t* fw, int index)
+{
+	int result;
+
+	result = write_data(fw, fw->buffers[index], write_length(fw, index), fw->offsets[index]);
+	fw->file_end = fw->offsets[index] + fw->lengths[index];
+
+	return result;
+}
+
+/* Compressed blocks are appended, their size is only known once encoded */
+static int write_compressed(file_writer_t* fw, int index)
+{
+	size_t len;
+	int result;
+
+	len = iq_codec_encode_block((const uint16_t*) fw->buffers[index], (uint32_t) (fw->lengths[index] / 2),
+		fw->channels, fw->codec_buffer);
+	result = write_data(fw, fw->codec_buffer, len, fw->file_end);
+	fw->file_end += len;
+
+	return result;
+}
+
+#ifdef HAVE_LIBURING
+/* Submits count consecutive buffers starting at first and waits for all of them */
+static int write_buffers_uring(file_writer_t* fw, int first, int count)
+{
+	int i, index, result = 0;
+	size_t len;
+	struct io_uring_sqe* sqe;
+	struct io_uring_cqe* cqe;
+
+	for (i = 0; i < count; i++)
+	{
+		index = (first + i) % FILE_WRITER_BUFFER_COUNT;
+		sqe = io_uring_get_sqe(&fw->ring);
+		len = write_length(fw, index);
+		io_uring_prep_write(sqe, fw->fd, fw->buffers[index], (unsigned) len, fw->offsets[index]);
+		io_uring_sqe_set_data(sqe, (void*) (intptr_t) index);
+	}
+
+	if (io_uring_submit(&fw->ring) < 0)
+	{
+		return -1;
+	}
+
+	for (i = 0; i < count; i++)
+	{
+		if (io_uring_wait_cqe(&fw->ring, &cqe) < 0)
+		{
+			return -1;
+		}
+
+		index = (int) (intptr_t) io_uring_cqe_get_data(cqe);
+		if (cqe->res < 0)
+		{
+			result = -1;
+		}
+		else if ((size_t) cqe->res != write_length(fw, index))
+		{
+			/* Short write, finish it synchronously */
+			len = (size_t) cqe->res;
+			if (pwrite(fw->fd, fw->buffers[index] + len, write_length(fw, index) - len, (off_t) (fw->offsets[index] + len)) < 0)
+			{
+				result = -1;
+			}
+		}
+		io_uring_cqe_seen(&fw->ring, cqe);
+	}
+
+	return result;
+}
+#endif
+
+static int open_file(file_writer_t* fw, const char* path, uint32_t flags)
+{
+	struct stat st;
+	iq_codec_stream_hdr_t hdr;
+
+	fw->direct = 0;
+	fw->allocated = 0;
+	fw->file_end = 0;
+
+	if (!strcmp(path, "-"))
+	{
+		fw->fd = STDOUT_FILENO;
+	}
+	else
+	{
+		fw->fd = -1;
+		/* Compressed blocks have any size, they are not written with O_DIRECT */
+		if ((flags & FILE_WRITER_DIRECT) && O_DIRECT != 0 && fw->channels == 0)
+		{
+			fw->fd = open(path, O_WRONLY | O_CREAT | O_TRUNC | O_DIRECT, 0666);
+			fw->direct = (fw->fd >= 0);
+		}
+		if (fw->fd < 0)
+		{
+			fw->fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0666);
+		}
+		if (fw->fd < 0)
+		{
+			return -1;
+		}
+	}
+
+	fw->regular = (fstat(fw->fd, &st) == 0 && S_ISREG(st.st_mode));
+	fw->prealloc = fw->regular;
+	if (!fw->regular)
+	{
+		fw->direct = 0;
+	}
+
+	if (fw->channels > 0)
+	{
+		iq_codec_stream_hdr_init(&hdr, fw->channels);
+		if (write_data(fw, (const uint8_t*) &hdr, sizeof(hdr), 0) != 0)
+		{
+			return -1;
+		}
+		fw->file_end = sizeof(hdr);
+	}
+
+	return 0;
+}
+
+static int close_file(file_writer_t* fw)
+{
+	int result = 0;
+
+	if (fw->fd < 0)
+	{
+		return -1;
+	}
+
+	if (fw->fd != STDOUT_FILENO)
+	{
+		/* Drops the O_DIRECT padding and any preallocated space past the data */
+		if (fw->direct || fw->allocated > 0)
+		{
+			if (ftruncate(fw->fd, (off_t) fw->file_end) != 0)
+			{
+				result = -1;
+			}
+		}
+		if (close(fw->fd) != 0)
+		{
+			result = -1;
+		}
+	}
+	fw->fd = -1;
+
+	return result;
+}
+
+/* Runs on the writer thread so the sample callback never waits for open()/close() */
+static int next_segment(file_writer_t* fw, uint32_t segment)
+{
+	int result;
+
+	result = close_file(fw);
+	fw->open_segment = segment;
+	if (open_file(fw, segment_name(&fw->seg, segment), fw->direct_flags) != 0)
+	{
+		result = -1;
+	}
+
+	return result;
+}
+
+static void* writer_threadproc(void* arg)
+{
+	file_writer_t* fw = (file_writer_t*) arg;
+	int first, count, result, i;
+#ifdef HAVE_LIBURING
+	int last;
+#endif
+
+	pthread_mutex_lock(&fw->lock);
+
+	for (;;)
+	{
+		while (fw->queued == 0 && !fw->closing)
+		{
+			pthread_cond_wait(&fw->data_cv, &fw->lock);
+		}
+		if (fw->queued == 0)
+		{
+			break;
+		}
+
+		first = fw->write_index;
+		count = fw->queued;
+		pthread_mutex_unlock(&fw->lock);
+
+		/* A batch never spans two files */
+		for (i = 1; i < count; i++)
+		{
+			if (fw->segments[(first + i) % FILE_WRITER_BUFFER_COUNT] != fw->segments[first])
+			{
+				break;
+			}
+		}
+		count = i;
+
+		result = 0;
+		if (fw->segments[first] != fw->open_segment)
+		{
+			result = next_segment(fw, fw->segments[first]);
+		}
+
+		preallocate(fw, fw->offsets[(first + count - 1) % FILE_WRITER_BUFFER_COUNT] + FILE_WRITER_BUFFER_SIZE);
+
+#ifdef HAVE_LIBURING
+		if (fw->use_uring)
+		{
+			if (count > URING_QUEUE_DEPTH)
+			{
+				count = URING_QUEUE_DEPTH;
+			}
+			result |= write_buffers_uring(fw, first, count);
+			last = (first + count - 1) % FILE_WRITER_BUFFER_COUNT;
+			fw->file_end = fw->offsets[last] + fw->lengths[last];
+		}
+		else
+#endif
+		{
+			count = 1;
+			result |= (fw->channels > 0) ? write_compressed(fw, first) : write_buffer(fw, first);
+		}
+
+		if (result != 0)
+		{
+			fw->error = 1;
+		}
+
+		pthread_mutex_lock(&fw->lock);
+		fw->write_index = (first + count) % FILE_WRITER_BUFFER_COUNT;
+		fw->queued -= count;
+		pthread_cond_signal(&fw->free_cv);
+	}
+
+	pthread_mutex_unlock(&fw->lock);
+
+	return NULL;
+}
+
+/* Hands the buffer being filled to the writer thread */
+static void queue_fill_buffer(file_writer_t* fw)
+{
+	pthread_mutex_lock(&fw->lock);
+
+	fw->lengths[fw->fill_index] = fw->fill_len;
+	fw->offsets[fw->fill_index] = fw->queued_bytes;
+	fw->segments[fw->fill_index] = fw->fill_segment;
+	fw->queued_bytes += fw->fill_len;
+	if (fw->seg.bytes > 0 && fw->segment_fill == fw->seg.bytes)
+	{
+		/* Next buffer starts the next file */
+		fw->fill_segment++;
+		fw->segment_fill = 0;
+		fw->queued_bytes = 0;
+	}
+	fw->queued++;
+	fw->fill_index = (fw->fill_index + 1) % FILE_WRITER_BUFFER_COUNT;
+	fw->fill_len = 0;
+	pthread_cond_signal(&fw->data_cv);
+
+	/* The next buffer is still owned by the writer thread: the disk is behind */
+	if (fw->queued == FILE_WRITER_BUFFER_COUNT)
+	{
+		fw->stalls++;
+		while (fw->queued == FILE_WRITER_BUFFER_COUNT)
+		{
+			pthread_cond_wait(&fw->free_cv, &fw->lock);
+		}
+	}
+
+	pthread_mutex_unlock(&fw->lock);
+}
+
+static void free_writer(file_writer_t* fw)
+{
+	int i;
+
+	for (i = 0; i < FILE_WRITER_BUFFER_COUNT; i++)
+	{
+		free(fw->buffers[i]);
+	}
+	free(fw->codec_buffer);
+	pthread_cond_destroy(&fw->free_cv);
+	pthread_cond_destroy(&fw->data_cv);
+	pthread_mutex_destroy(&fw->lock);
+	if (fw->seg.bytes > 0)
+	{
+		segment_naming_free(&fw->seg);
+	}
+	free(fw);
+}
+
+static file_writer_t* writer_open(const char* path, uint32_t flags, uint64_t size_hint,
+	uint64_t segment_bytes, uint32_t sample_bits)
+{
+	int i;
+	file_writer_t* fw;
+
+	fw = (file_writer_t*) calloc(1, sizeof(file_writer_t));
+	if (fw == NULL)
+	{
+		return NULL;
+	}
+
+	pthread_mutex_init(&fw->lock, NULL);
+	pthread_cond_init(&fw->data_cv, NULL);
+	pthread_cond_init(&fw->free_cv, NULL);
+	fw->direct_flags = flags;
+	fw->channels = codec_channels(flags);
+	if (fw->channels > 0)
+	{
+		fw->codec_buffer = (uint8_t*) malloc(iq_codec_block_bound(FILE_WRITER_BUFFER_SIZE / 2));
+		if (fw->codec_buffer == NULL)
+		{
+			free_writer(fw);
+			return NULL;
+		}
+	}
+
+	for (i = 0; i < FILE_WRITER_BUFFER_COUNT; i++)
+	{
+		if (posix_memalign((void**) &fw->buffers[i], DIRECT_ALIGNMENT, FILE_WRITER_BUFFER_SIZE) != 0)
+		{
+			fw->buffers[i] = NULL;
+			free_writer(fw);
+			return NULL;
+		}
+	}
+
+	if (segment_bytes > 0)
+	{
+		if (segment_naming_init(&fw->seg, path, segment_bytes, sample_bits) != 0)
+		{
+			free_writer(fw);
+			return NULL;
+		}
+		path = segment_name(&fw->seg, 0);
+	}
+
+	if (open_file(fw, path, flags) != 0)
+	{
+		free_writer(fw);
+		return NULL;
+	}
+
+	if (size_hint > 0)
+	{
+		preallocate(fw, size_hint);
+	}
+
+#ifdef HAVE_LIBURING
+	fw->use_uring = fw->regular && fw->channels == 0 && (io_uring_queue_init(URING_QUEUE_DEPTH, &fw->ring, 0) == 0);
+#endif
+
+	if (pthread_create(&fw->thread, NULL, writer_threadproc, fw) != 0)
+	{
+#ifdef HAVE_LIBURING
+		if (fw->use_uring)
+		{
+			io_uring_queue_exit(&fw->ring);
+		}
+#endif
+		if (fw->fd != STDOUT_FILENO)
+		{
+			close(fw->fd);
+		}
+		free_writer(fw);
+		return NULL;
+	}
+	fw->thread_running = 1;
+
+	return fw;
+}
+
+file_writer_t* file_writer_open(const char* path, uint32_t flags, uint64_t size_hint)
+{
+	return writer_open(path, flags, size_hint, 0, 0);
+}
+
+file_writer_t* file_writer_open_segmented(const char* path, uint32_t flags, uint64_t segment_bytes, uint32_t sample_bits)
+{
+	if (!strcmp(path, "-") || segment_bytes == 0 || sample_bits == 0)
+	{
+		return NULL;
+	}
+
+	return writer_open(path, flags, 0, segment_bytes, sample_bits);
+}
+
+int file_writer_write(file_writer_t* fw, const void* data, size_t len)
+{
+	size_t chunk;
+	const uint8_t* src = (const uint8_t*) data;
+
+	if (fw->error)
+	{
+		return -1;
+	}
+
+	while (len > 0)
+	{
+		chunk = FILE_WRITER_BUFFER_SIZE - fw->fill_len;
+		if (fw->seg.bytes > 0 && chunk > fw->seg.bytes - fw->segment_fill)
+		{
+			chunk = (size_t) (fw->seg.bytes - fw->segment_fill);
+		}
+		if (chunk > len)
+		{
+			chunk = len;
+		}
+
+		memcpy(fw->buffers[fw->fill_index] + fw->fill_len, src, chunk);
+		fw->fill_len += chunk;
+		fw->total += chunk;
+		fw->segment_fill += chunk;
+		src += chunk;
+		len -= chunk;
+
+		/* The last buffer of a segment is queued partial so the next file starts with a fresh buffer */
+		if (fw->fill_len == FILE_WRITER_BUFFER_SIZE || (fw->seg.bytes > 0 && fw->segment_fill == fw->seg.bytes))
+		{
+			queue_fill_buffer(fw);
+		}
+	}
+
+	return 0;
+}
+
+uint64_t file_writer_tell(file_writer_t* fw)
+{
+	return fw->total;
+}
+
+uint32_t file_writer_stalls(file_writer_t* fw)
+{
+	return fw->stalls;
+}
+
+int file_writer_close(file_writer_t* fw)
+{
+	int result;
+
+	if (fw->fill_len > 0)
+	{
+		queue_fill_buffer(fw);
+	}
+
+	pthread_mutex_lock(&fw->lock);
+	fw->closing = 1;
+	pthread_cond_signal(&fw->data_cv);
+	pthread_mutex_unlock(&fw->lock);
+
+	if (fw->thread_running)
+	{
+		pthread_join(fw->thread, NULL);
+	}
+
+#ifdef HAVE_LIBURING
+	if (fw->use_uring)
+	{
+		io_uring_queue_exit(&fw->ring);
+	}
+#endif
+
+	result = fw->error ? -1 : 0;
+
+	if (close_file(fw) != 0)
+	{
+		result = -1;
+	}
+
+	free_writer(fw);
+
+	return result;
+}
+
+#endif /* _WIN32 */
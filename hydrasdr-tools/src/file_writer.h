@@ -0,0 +1,65 @@
+/*
+ * Copyright 2025 Benjamin Vernoux <bvernoux@hydrasdr.com>
+ *
+ * This file is part of HydraSDR.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef FILE_WRITER_H
+#define FILE_WRITER_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+/*
+ * Asynchronous recording backend.
+ * file_writer_write() only copies into a ring of preallocated aligned buffers,
+ * a dedicated thread writes full buffers to disk (io_uring when built with liburing, pwrite otherwise).
+ * The file is preallocated ahead of the writes with fallocate() where supported.
+ * On Windows the writes are done synchronously with stdio.
+ */
+
+#define FILE_WRITER_DIRECT (1 << 0) /* Bypass the page cache with O_DIRECT (falls back to buffered I/O if refused) */
+/* Lossless compression (see iq_codec.h) of 16bits words on the writer thread, each buffer is one block, no O_DIRECT */
+#define FILE_WRITER_COMPRESS_REAL (1 << 1) /* One channel (INT16_REAL, UINT16_REAL, unpacked RAW) */
+#define FILE_WRITER_COMPRESS_IQ (1 << 2) /* Interleaved IQ (INT16_IQ) */
+
+#define FILE_WRITER_BUFFER_SIZE (4 * 1024 * 1024)
+#define FILE_WRITER_BUFFER_COUNT (16)
+
+typedef struct file_writer file_writer_t;
+
+/* path "-" writes to stdout, size_hint (0 if unknown) is the expected file size used for preallocation */
+file_writer_t* file_writer_open(const char* path, uint32_t flags, uint64_t size_hint);
+/*
+ * Same as file_writer_open() but splits the recording in consecutive files of segment_bytes,
+ * named <path without extension>_<index of their first sample, 12 digits><extension>.
+ * sample_bits is the size of one sample (all channels included), segment_bytes is rounded
+ * down to a multiple of 8 samples. Files after the first one are opened and closed by the
+ * writer thread. Not available for stdout.
+ */
+file_writer_t* file_writer_open_segmented(const char* path, uint32_t flags, uint64_t segment_bytes, uint32_t sample_bits);
+/* Returns 0 on success, -1 once a write error occurred */
+int file_writer_write(file_writer_t* fw, const void* data, size_t len);
+/* Number of bytes accepted so far (before compression) */
+uint64_t file_writer_tell(file_writer_t* fw);
+/* Number of times file_writer_write() had to wait for the disk (ring full) */
+uint32_t file_writer_stalls(file_writer_t* fw);
+/* Flushes everything and closes the file, returns 0 on success, -1 if any write failed */
+int file_writer_close(file_writer_t* fw);
+
+#endif /* FILE_WRITER_H */
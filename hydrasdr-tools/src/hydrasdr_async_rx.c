@@ -119,6 +119,9 @@ static inline size_t bytes_per_sample(enum hydrasdr_sample_type type)
 		case HYDRASDR_SAMPLE_INT16_REAL:   return 2;
 		case HYDRASDR_SAMPLE_UINT16_REAL:  return 2;
 		case HYDRASDR_SAMPLE_RAW:          return 2; /* Raw device stream */
+		case HYDRASDR_SAMPLE_INT8_IQ:      return 2; /* 1 byte I + 1 byte Q */
+		case HYDRASDR_SAMPLE_PACKED12_IQ:  return 3; /* 12 bits I + 12 bits Q */
+		case HYDRASDR_SAMPLE_FLOAT16_IQ:   return 4; /* 2 bytes I + 2 bytes Q */
 		default:                           return 2;
 	}
 }
@@ -130,7 +133,8 @@ static void print_usage(const char *prog)
 	printf(" -f <Hz>   Set RF frequency (default: %llu Hz)\n", DEFAULT_FREQ_HZ);
 	printf(" -s <SPS>  Set sample rate  (default: %u)\n", DEFAULT_SAMPLERATE);
 	printf(" -t <type> Set sample type  (default: %d = Int16 IQ)\n", DEFAULT_SAMPLETYPE);
-	printf("           0=FloatIQ, 1=FloatReal, 2=Int16IQ, 3=Int16Real, 5=Raw\n");
+	printf("           0=FloatIQ, 1=FloatReal, 2=Int16IQ, 3=Int16Real, 5=Raw,\n");
+	printf("           6=Int8IQ, 7=Packed12IQ, 8=Float16IQ\n");
 	printf(" -g <0-21> Linearity gain (default: %d)\n", DEFAULT_GAIN);
 	printf(" -b <0/1>  Bias-T off/on (default: 0)\n");
 	printf(" -o <file> Output file (default: %s)\n", DEFAULT_FILENAME);
@@ -0,0 +1,905 @@
+/*
+ * Copyright 2025 Benjamin Vernoux <bvernoux@hydrasdr.com>
+ *
+ * This file is part of HydraSDR.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include <hydrasdr.h>
+
+/* Internal stages of libhydrasdr, linked from the static library */
+#include "sample_convert.h"
+#include "iqconverter_float.h"
+#include "iqconverter_int16.h"
+#include "nco.h"
+#include "decimator_int16.h"
+#include "sample_pack.h"
+#include "float16.h"
+#include "filters.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <getopt.h>
+#include <math.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <unistd.h>
+#include <sched.h>
+#endif
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#ifdef _MSC_VER
+#include <intrin.h>
+#else
+#include <x86intrin.h>
+#endif
+#define HAVE_TSC (1)
+#else
+#define HAVE_TSC (0)
+#endif
+
+#define HYDRASDR_BENCH_VERSION "1.0.0"
+
+/* ADC samples per buffer received from the device, see BUFFER_SIZE_PACKED/UNPACKED in hydrasdr.c */
+#define PACKED_BUFFER_SAMPLES ((6144 * 24 / 2) * 4 / 3)
+#define UNPACKED_BUFFER_SAMPLES (262144 / 2)
+#define MAX_BUFFER_SAMPLES UNPACKED_BUFFER_SAMPLES
+
+#define DEFAULT_MIN_TIME (0.2)
+#define DEFAULT_CHAIN_BUFFERS (128)
+#define MIN_ITERATIONS (8)
+#define MAX_ITERATIONS (100000)
+#define CHAIN_RUNS (5)
+#define CHAIN_SAMPLERATE (10000000)
+#define NCO_FREQ_HZ (1234567)
+#define DECIMATION (8)
+/* Long custom conversion filter, compared with the direct and the FFT FIR */
+#define LONG_KERNEL_LEN (255)
+#define DEFAULT_LATENCY_CYCLES (100)
+/* Looped replay capture of the latency benchmark, in packed buffers */
+#define LATENCY_BUFFERS (4)
+#define LATENCY_TIMEOUT_S (2.0)
+
+typedef struct {
+	int count;            /* ADC samples per buffer */
+	uint32_t *packed;     /* Input as received with packing */
+	uint16_t *raw;        /* Input as received without packing */
+	uint16_t *unpacked;
+	float *f32_ref;       /* Converted input, copied into f32 before the in-place stages */
+	int16_t *i16_ref;
+	float *f32;
+	int16_t *i16;
+	uint8_t *out;
+	iqconverter_float_t *cnv_f;
+	iqconverter_float_t *cnv_f_direct; /* LONG_KERNEL_LEN */
+	iqconverter_float_t *cnv_f_fft;
+	iqconverter_int16_t *cnv_i;
+	nco_t *nco;
+	decimator_int16_t *decimator;
+} bench_ctx_t;
+
+typedef struct {
+	const char *name;
+	int packed_only;
+	void (*prepare)(bench_ctx_t *ctx); /* Not timed, may be NULL */
+	void (*run)(bench_ctx_t *ctx);
+} bench_stage_t;
+
+typedef struct {
+	char name[64];
+	const char *mode;
+	int buffer_samples;
+	int iterations;
+	double ns_per_sample;     /* Median over the iterations */
+	double ns_per_sample_min;
+	double cycles_per_sample; /* Median, < 0 without a cycle counter */
+} bench_result_t;
+
+typedef struct {
+	int cycles;
+	const char *source;    /* "replay" or "device" */
+	double first_sample_us[3]; /* Median, p99 and max from hydrasdr_start_rx() to the first callback */
+	double start_us[3];    /* Duration of hydrasdr_start_rx() */
+	double stop_us[3];     /* Duration of hydrasdr_stop_rx() */
+} latency_result_t;
+
+static double min_time = DEFAULT_MIN_TIME;
+
+static void usage(void)
+{
+	fprintf(stderr, "hydrasdr_bench v%s\n", HYDRASDR_BENCH_VERSION);
+	fprintf(stderr, "Measures the libhydrasdr DSP stages and the whole conversion chain on synthetic samples, without hardware.\n");
+	fprintf(stderr, "Usage:\n");
+	fprintf(stderr, "[-o <filename>]: Write the results as JSON ('-' for stdout)\n");
+	fprintf(stderr, "[-f name]: Only run the benchmarks whose name contains this string\n");
+	fprintf(stderr, "[-t seconds]: Minimum measured time per benchmark (default %.1f)\n", DEFAULT_MIN_TIME);
+	fprintf(stderr, "[-c buffers]: Buffers replayed per run of the chain benchmarks (default %d, 0 skips them)\n", DEFAULT_CHAIN_BUFFERS);
+	fprintf(stderr, "[-l cycles]: Start/stop cycles of the latency benchmark (default %d, 0 skips it)\n", DEFAULT_LATENCY_CYCLES);
+	fprintf(stderr, "[-d]: Run the latency benchmark on the first HydraSDR device instead of a replay capture\n");
+	fprintf(stderr, "[-w <filename>]: Temporary capture used by the chain benchmarks (default hydrasdr_bench.raw)\n");
+	fprintf(stderr, "Rates are ADC samples (2 per IQ output sample) on one core, cycles are TSC reference cycles on x86.\n");
+}
+
+static double bench_clock(void)
+{
+#ifdef _WIN32
+	LARGE_INTEGER count;
+	LARGE_INTEGER frequency;
+
+	QueryPerformanceCounter(&count);
+	QueryPerformanceFrequency(&frequency);
+	return (double) count.QuadPart / (double) frequency.QuadPart;
+#else
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (double) ts.tv_sec + (double) ts.tv_nsec * 1e-9;
+#endif
+}
+
+static uint64_t bench_cycles(void)
+{
+#if HAVE_TSC
+	return __rdtsc();
+#else
+	return 0;
+#endif
+}
+
+static void sleep_ms(void)
+{
+#ifdef _WIN32
+	Sleep(1);
+#else
+	usleep(1000);
+#endif
+}
+
+/* Lets the library threads run while polling, without the 1 ms granularity of sleep_ms() */
+static void yield_cpu(void)
+{
+#ifdef _WIN32
+	SwitchToThread();
+#else
+	sched_yield();
+#endif
+}
+
+/* Noise around mid scale, 12bit offset binary like the ADC */
+static void generate_samples(uint16_t *samples, int count)
+{
+	uint32_t state = 0x12345678;
+	int i;
+
+	for (i = 0; i < count; i++)
+	{
+		state ^= state << 13;
+		state ^= state >> 17;
+		state ^= state << 5;
+		samples[i] = (uint16_t) (1024 + (state & 0x7ff));
+	}
+}
+
+/* Inverse of unpack_samples(), 8 samples in 3 words */
+static void pack_samples(const uint16_t *samples, uint32_t *packed, int count)
+{
+	int i, j;
+
+	for (i = 0, j = 0; j < count; i += 3, j += 8)
+	{
+		packed[i + 0] = ((uint32_t) samples[j + 0] << 20) | ((uint32_t) samples[j + 1] << 8) | (samples[j + 2] >> 4);
+		packed[i + 1] = ((uint32_t) (samples[j + 2] & 0xf) << 28) | ((uint32_t) samples[j + 3] << 16) |
+			((uint32_t) samples[j + 4] << 4) | (samples[j + 5] >> 8);
+		packed[i + 2] = ((uint32_t) (samples[j + 5] & 0xff) << 24) | ((uint32_t) samples[j + 6] << 12) | samples[j + 7];
+	}
+}
+
+static void run_unpack(bench_ctx_t *ctx)
+{
+	unpack_samples(ctx->packed, ctx->unpacked, ctx->count);
+}
+
+static void run_convert_float(bench_ctx_t *ctx)
+{
+	convert_samples_float(ctx->raw, ctx->f32, ctx->count);
+}
+
+static void run_convert_int16(bench_ctx_t *ctx)
+{
+	convert_samples_int16(ctx->raw, ctx->i16, ctx->count);
+}
+
+static void prepare_float(bench_ctx_t *ctx)
+{
+	memcpy(ctx->f32, ctx->f32_ref, ctx->count * sizeof(float));
+}
+
+static void prepare_int16(bench_ctx_t *ctx)
+{
+	memcpy(ctx->i16, ctx->i16_ref, ctx->count * sizeof(int16_t));
+}
+
+static void run_iqconverter_float(bench_ctx_t *ctx)
+{
+	iqconverter_float_process(ctx->cnv_f, ctx->f32, ctx->count);
+}
+
+static void run_iqconverter_float_direct(bench_ctx_t *ctx)
+{
+	iqconverter_float_process(ctx->cnv_f_direct, ctx->f32, ctx->count);
+}
+
+static void run_iqconverter_float_fft(bench_ctx_t *ctx)
+{
+	iqconverter_float_process(ctx->cnv_f_fft, ctx->f32, ctx->count);
+}
+
+static void run_iqconverter_int16(bench_ctx_t *ctx)
+{
+	iqconverter_int16_process(ctx->cnv_i, ctx->i16, ctx->count);
+}
+
+static void run_nco_float(bench_ctx_t *ctx)
+{
+	nco_process_float(ctx->nco, ctx->f32, ctx->count);
+}
+
+static void run_nco_int16(bench_ctx_t *ctx)
+{
+	nco_process_int16(ctx->nco, ctx->i16, ctx->count);
+}
+
+static void run_decimator_int16(bench_ctx_t *ctx)
+{
+	decimator_int16_process(ctx->decimator, ctx->i16, ctx->count);
+}
+
+static void run_pack_int8(bench_ctx_t *ctx)
+{
+	sample_pack_int8(ctx->i16_ref, (int8_t *) ctx->out, ctx->count, NULL);
+}
+
+static void run_pack_packed12(bench_ctx_t *ctx)
+{
+	sample_pack_packed12(ctx->i16_ref, ctx->out, ctx->count, NULL);
+}
+
+static void run_float16(bench_ctx_t *ctx)
+{
+	float16_convert(ctx->f32_ref, (uint16_t *) ctx->out, ctx->count);
+}
+
+/* In the order of the conversion chain (consumer_threadproc) */
+static const bench_stage_t stages[] = {
+	{ "unpack", 1, NULL, run_unpack },
+	{ "convert_float", 0, NULL, run_convert_float },
+	{ "convert_int16", 0, NULL, run_convert_int16 },
+	{ "iqconverter_float", 0, prepare_float, run_iqconverter_float },
+	{ "iqconverter_float_255_direct", 0, prepare_float, run_iqconverter_float_direct },
+	{ "iqconverter_float_255_fft", 0, prepare_float, run_iqconverter_float_fft },
+	{ "iqconverter_int16", 0, prepare_int16, run_iqconverter_int16 },
+	{ "nco_float", 0, prepare_float, run_nco_float },
+	{ "nco_int16", 0, prepare_int16, run_nco_int16 },
+	{ "decimator_int16_x8", 0, prepare_int16, run_decimator_int16 },
+	{ "pack_int8", 0, NULL, run_pack_int8 },
+	{ "pack_packed12", 0, NULL, run_pack_packed12 },
+	{ "float16", 0, NULL, run_float16 },
+};
+
+#define STAGE_COUNT (sizeof(stages) / sizeof(stages[0]))
+
+static const struct {
+	const char *name;
+	enum hydrasdr_sample_type sample_type;
+} chains[] = {
+	{ "chain_float32_iq", HYDRASDR_SAMPLE_FLOAT32_IQ },
+	{ "chain_float32_real", HYDRASDR_SAMPLE_FLOAT32_REAL },
+	{ "chain_int16_iq", HYDRASDR_SAMPLE_INT16_IQ },
+	{ "chain_int16_real", HYDRASDR_SAMPLE_INT16_REAL },
+	{ "chain_int8_iq", HYDRASDR_SAMPLE_INT8_IQ },
+	{ "chain_packed12_iq", HYDRASDR_SAMPLE_PACKED12_IQ },
+	{ "chain_float16_iq", HYDRASDR_SAMPLE_FLOAT16_IQ },
+};
+
+#define CHAIN_COUNT (sizeof(chains) / sizeof(chains[0]))
+
+static int compare_double(const void *a, const void *b)
+{
+	double x = *(const double *) a;
+	double y = *(const double *) b;
+
+	return (x > y) - (x < y);
+}
+
+static double median(double *values, int count)
+{
+	qsort(values, count, sizeof(double), compare_double);
+	return (count & 1) ? values[count / 2] : 0.5 * (values[count / 2 - 1] + values[count / 2]);
+}
+
+/* Hann windowed half band, same layout as HB_KERNEL_FLOAT */
+static void long_kernel(float *kernel, int len)
+{
+	int i;
+	int center = len / 2;
+	double n;
+
+	for (i = 0; i < len; i++)
+	{
+		n = i - center;
+		if (i == center)
+			kernel[i] = 0.5f;
+		else if ((i - center) % 2 == 0)
+			kernel[i] = 0.0f;
+		else
+			kernel[i] = (float) ((0.5 + 0.5 * cos(M_PI * n / (center + 1))) * sin(M_PI * n / 2.0) / (M_PI * n));
+	}
+}
+
+static int ctx_init(bench_ctx_t *ctx)
+{
+	float kernel[LONG_KERNEL_LEN];
+
+	memset(ctx, 0, sizeof(*ctx));
+	ctx->packed = (uint32_t *) malloc(MAX_BUFFER_SAMPLES * 3 / 2);
+	ctx->raw = (uint16_t *) malloc(MAX_BUFFER_SAMPLES * sizeof(uint16_t));
+	ctx->unpacked = (uint16_t *) malloc(MAX_BUFFER_SAMPLES * sizeof(uint16_t));
+	ctx->f32_ref = (float *) malloc(MAX_BUFFER_SAMPLES * sizeof(float));
+	ctx->i16_ref = (int16_t *) malloc(MAX_BUFFER_SAMPLES * sizeof(int16_t));
+	ctx->f32 = (float *) malloc(MAX_BUFFER_SAMPLES * sizeof(float));
+	ctx->i16 = (int16_t *) malloc(MAX_BUFFER_SAMPLES * sizeof(int16_t));
+	ctx->out = (uint8_t *) malloc(MAX_BUFFER_SAMPLES * sizeof(uint16_t));
+	ctx->cnv_f = iqconverter_float_create(HB_KERNEL_FLOAT, HB_KERNEL_FLOAT_LEN);
+	long_kernel(kernel, LONG_KERNEL_LEN);
+	ctx->cnv_f_direct = iqconverter_float_create_fir(kernel, LONG_KERNEL_LEN, IQCONVERTER_FIR_DIRECT);
+	ctx->cnv_f_fft = iqconverter_float_create_fir(kernel, LONG_KERNEL_LEN, IQCONVERTER_FIR_FFT);
+	ctx->cnv_i = iqconverter_int16_create(HB_KERNEL_INT16, HB_KERNEL_INT16_LEN);
+	ctx->nco = nco_create();
+	ctx->decimator = decimator_int16_create(HB_KERNEL_INT16, HB_KERNEL_INT16_LEN, DECIMATION);
+
+	if (ctx->packed == NULL || ctx->raw == NULL || ctx->unpacked == NULL || ctx->f32_ref == NULL ||
+		ctx->i16_ref == NULL || ctx->f32 == NULL || ctx->i16 == NULL || ctx->out == NULL ||
+		ctx->cnv_f == NULL || ctx->cnv_f_direct == NULL || ctx->cnv_f_fft == NULL || ctx->cnv_i == NULL || ctx->nco == NULL || ctx->decimator == NULL)
+	{
+		return -1;
+	}
+
+	generate_samples(ctx->raw, MAX_BUFFER_SAMPLES);
+	pack_samples(ctx->raw, ctx->packed, PACKED_BUFFER_SAMPLES);
+	convert_samples_float(ctx->raw, ctx->f32_ref, MAX_BUFFER_SAMPLES);
+	convert_samples_int16(ctx->raw, ctx->i16_ref, MAX_BUFFER_SAMPLES);
+	nco_set_phase_inc(ctx->nco, nco_freq_to_phase_inc(NCO_FREQ_HZ, CHAIN_SAMPLERATE));
+
+	return 0;
+}
+
+static void ctx_free(bench_ctx_t *ctx)
+{
+	free(ctx->packed);
+	free(ctx->raw);
+	free(ctx->unpacked);
+	free(ctx->f32_ref);
+	free(ctx->i16_ref);
+	free(ctx->f32);
+	free(ctx->i16);
+	free(ctx->out);
+	iqconverter_float_free(ctx->cnv_f);
+	iqconverter_float_free(ctx->cnv_f_direct);
+	iqconverter_float_free(ctx->cnv_f_fft);
+	iqconverter_int16_free(ctx->cnv_i);
+	nco_free(ctx->nco);
+	decimator_int16_free(ctx->decimator);
+}
+
+/* Times each call separately so that the untimed prepare step can restore the input */
+static int bench_stage(bench_ctx_t *ctx, const bench_stage_t *stage, double *ns, double *cycles, bench_result_t *result)
+{
+	int i;
+	double t0, elapsed, total = 0.0;
+	uint64_t c0;
+
+	/* Warm up caches and filter states */
+	if (stage->prepare != NULL)
+	{
+		stage->prepare(ctx);
+	}
+	stage->run(ctx);
+
+	for (i = 0; i < MAX_ITERATIONS && (i < MIN_ITERATIONS || total < min_time); i++)
+	{
+		if (stage->prepare != NULL)
+		{
+			stage->prepare(ctx);
+		}
+		c0 = bench_cycles();
+		t0 = bench_clock();
+		stage->run(ctx);
+		elapsed = bench_clock() - t0;
+		cycles[i] = (double) (bench_cycles() - c0) / ctx->count;
+		ns[i] = elapsed * 1e9 / ctx->count;
+		total += elapsed;
+	}
+
+	result->iterations = i;
+	result->ns_per_sample = median(ns, i);
+	result->ns_per_sample_min = ns[0]; /* Sorted by median() */
+	result->cycles_per_sample = HAVE_TSC ? median(cycles, i) : -1.0;
+
+	return 0;
+}
+
+typedef struct {
+	uint64_t buffers;
+	double last;
+} chain_state_t;
+
+static int chain_callback(hydrasdr_transfer_t *transfer)
+{
+	chain_state_t *state = (chain_state_t *) transfer->ctx;
+
+	state->buffers++;
+	state->last = bench_clock();
+	return 0;
+}
+
+static int write_chain_file(const char *path, const bench_ctx_t *ctx, int packed, int buffers)
+{
+	FILE *file;
+	const void *buffer = packed ? (const void *) ctx->packed : (const void *) ctx->raw;
+	size_t size = packed ? (size_t) PACKED_BUFFER_SAMPLES * 3 / 2 : (size_t) UNPACKED_BUFFER_SAMPLES * 2;
+	int i;
+
+	file = fopen(path, "wb");
+	if (file == NULL)
+	{
+		return -1;
+	}
+	for (i = 0; i < buffers; i++)
+	{
+		if (fwrite(buffer, 1, size, file) != size)
+		{
+			fclose(file);
+			return -1;
+		}
+	}
+	return fclose(file) == 0 ? 0 : -1;
+}
+
+/* Replays the capture through the library at maximum speed, the consumer thread runs the whole chain */
+static int bench_chain(const char *path, int packed, int buffers, enum hydrasdr_sample_type sample_type,
+	double *ns, double *cycles, bench_result_t *result)
+{
+	struct hydrasdr_device *device;
+	chain_state_t state;
+	double t0;
+	uint64_t c0;
+	uint64_t samples;
+	int run;
+	int ret;
+
+	ret = hydrasdr_open_file(&device, path, CHAIN_SAMPLERATE, 0);
+	if (ret != HYDRASDR_SUCCESS)
+	{
+		return ret;
+	}
+	hydrasdr_set_packing(device, (uint8_t) packed);
+	hydrasdr_set_sample_type(device, sample_type);
+
+	samples = (uint64_t) buffers * (packed ? PACKED_BUFFER_SAMPLES : UNPACKED_BUFFER_SAMPLES);
+
+	/* The first run only warms up the page cache and the allocations */
+	for (run = 0; run <= CHAIN_RUNS; run++)
+	{
+		state.buffers = 0;
+		c0 = bench_cycles();
+		t0 = bench_clock();
+		state.last = t0;
+		ret = hydrasdr_start_rx(device, chain_callback, &state);
+		if (ret != HYDRASDR_SUCCESS)
+		{
+			hydrasdr_close(device);
+			return ret;
+		}
+		while (hydrasdr_is_streaming(device) == HYDRASDR_TRUE)
+		{
+			sleep_ms();
+		}
+		hydrasdr_stop_rx(device);
+
+		if (state.buffers != (uint64_t) buffers)
+		{
+			hydrasdr_close(device);
+			return HYDRASDR_ERROR_OTHER;
+		}
+		if (run > 0)
+		{
+			ns[run - 1] = (state.last - t0) * 1e9 / samples;
+			/* The TSC runs at a constant rate, scale the elapsed cycles to the end of the last callback */
+			cycles[run - 1] = (double) (bench_cycles() - c0) * ((state.last - t0) / (bench_clock() - t0)) / samples;
+		}
+	}
+	hydrasdr_close(device);
+
+	result->iterations = CHAIN_RUNS;
+	result->ns_per_sample = median(ns, CHAIN_RUNS);
+	result->ns_per_sample_min = ns[0]; /* Sorted by median() */
+	result->cycles_per_sample = HAVE_TSC ? median(cycles, CHAIN_RUNS) : -1.0;
+
+	return HYDRASDR_SUCCESS;
+}
+
+typedef struct {
+	volatile double first; /* Time of the first callback of the session, 0 before */
+} latency_state_t;
+
+static int latency_callback(hydrasdr_transfer_t *transfer)
+{
+	latency_state_t *state = (latency_state_t *) transfer->ctx;
+
+	if (state->first == 0)
+	{
+		state->first = bench_clock();
+	}
+	return 0;
+}
+
+/* Stores the median, p99 and max of the values in microseconds */
+static void latency_stats(double *values, int count, double *stats)
+{
+	stats[0] = median(values, count) * 1e6;
+	stats[1] = values[(int) (0.99 * (count - 1))] * 1e6; /* Sorted by median() */
+	stats[2] = values[count - 1] * 1e6;
+}
+
+/*
+ * Starts and stops the stream repeatedly, from a looped replay capture (path) or from the first device (path NULL).
+ * first, start and stop receive the per-cycle durations in seconds, sorted on return.
+ */
+static int bench_latency(const char *path, int count, double *first, double *start, double *stop, latency_result_t *result)
+{
+	struct hydrasdr_device *device;
+	latency_state_t state;
+	double t0;
+	double t1;
+	int cycle;
+	int ret;
+
+	if (path != NULL)
+	{
+		ret = hydrasdr_open_file(&device, path, CHAIN_SAMPLERATE, HYDRASDR_REPLAY_LOOP);
+	}
+	else
+	{
+		ret = hydrasdr_open(&device);
+	}
+	if (ret != HYDRASDR_SUCCESS)
+	{
+		return ret;
+	}
+	hydrasdr_set_sample_type(device, HYDRASDR_SAMPLE_FLOAT32_IQ);
+
+	/* The first cycle only warms up the threads and the allocations */
+	for (cycle = 0; cycle <= count; cycle++)
+	{
+		state.first = 0;
+		t0 = bench_clock();
+		ret = hydrasdr_start_rx(device, latency_callback, &state);
+		t1 = bench_clock();
+		if (ret != HYDRASDR_SUCCESS)
+		{
+			hydrasdr_close(device);
+			return ret;
+		}
+		while (state.first == 0 && bench_clock() - t0 < LATENCY_TIMEOUT_S)
+		{
+			yield_cpu();
+		}
+		if (state.first == 0)
+		{
+			hydrasdr_stop_rx(device);
+			hydrasdr_close(device);
+			return HYDRASDR_ERROR_STREAMING_STOPPED;
+		}
+		if (cycle > 0)
+		{
+			first[cycle - 1] = state.first - t0;
+			start[cycle - 1] = t1 - t0;
+		}
+		t0 = bench_clock();
+		hydrasdr_stop_rx(device);
+		if (cycle > 0)
+		{
+			stop[cycle - 1] = bench_clock() - t0;
+		}
+	}
+	hydrasdr_close(device);
+
+	result->cycles = count;
+	result->source = (path != NULL) ? "replay" : "device";
+	latency_stats(first, count, result->first_sample_us);
+	latency_stats(start, count, result->start_us);
+	latency_stats(stop, count, result->stop_us);
+
+	return HYDRASDR_SUCCESS;
+}
+
+static void print_latency(const latency_result_t *latency)
+{
+	fprintf(stderr, "\n%-28s %10s %10s %10s  (%s, %d cycles)\n", "latency_us", "median", "p99", "max",
+		latency->source, latency->cycles);
+	fprintf(stderr, "%-28s %10.1f %10.1f %10.1f\n", "start_to_first_sample", latency->first_sample_us[0],
+		latency->first_sample_us[1], latency->first_sample_us[2]);
+	fprintf(stderr, "%-28s %10.1f %10.1f %10.1f\n", "start_rx", latency->start_us[0], latency->start_us[1],
+		latency->start_us[2]);
+	fprintf(stderr, "%-28s %10.1f %10.1f %10.1f\n", "stop_rx", latency->stop_us[0], latency->stop_us[1],
+		latency->stop_us[2]);
+}
+
+static void print_result(const bench_result_t *result)
+{
+	fprintf(stderr, "%-28s %-8s %7d %10.1f %10.3f", result->name, result->mode, result->buffer_samples,
+		1e3 / result->ns_per_sample, result->ns_per_sample);
+	if (result->cycles_per_sample >= 0)
+	{
+		fprintf(stderr, " %10.2f\n", result->cycles_per_sample);
+	}
+	else
+	{
+		fprintf(stderr, " %10s\n", "-");
+	}
+}
+
+static void write_json_latency(FILE *file, const char *name, const double *stats, const char *separator)
+{
+	fprintf(file, "    \"%s\": { \"median_us\": %.2f, \"p99_us\": %.2f, \"max_us\": %.2f }%s\n",
+		name, stats[0], stats[1], stats[2], separator);
+}
+
+/* latency is NULL when the latency benchmark did not run */
+static int write_json(const char *path, const bench_result_t *results, int count, const latency_result_t *latency)
+{
+	FILE *file;
+	hydrasdr_lib_version_t version;
+	int i;
+
+	file = (strcmp(path, "-") == 0) ? stdout : fopen(path, "w");
+	if (file == NULL)
+	{
+		return -1;
+	}
+
+	hydrasdr_lib_version(&version);
+	fprintf(file, "{\n");
+	fprintf(file, "  \"tool\": \"hydrasdr_bench\",\n");
+	fprintf(file, "  \"version\": \"%s\",\n", HYDRASDR_BENCH_VERSION);
+	fprintf(file, "  \"library_version\": \"%u.%u.%u\",\n", version.major_version, version.minor_version, version.revision);
+	fprintf(file, "  \"cycle_counter\": %s,\n", HAVE_TSC ? "\"tsc\"" : "null");
+	fprintf(file, "  \"min_time_s\": %g,\n", min_time);
+	fprintf(file, "  \"fft_crossover_taps\": %d,\n", iqconverter_float_fft_crossover());
+	fprintf(file, "  \"results\": [\n");
+	for (i = 0; i < count; i++)
+	{
+		fprintf(file, "    { \"name\": \"%s\", \"mode\": \"%s\", \"buffer_samples\": %d, \"iterations\": %d, "
+			"\"msps\": %.3f, \"ns_per_sample\": %.4f, \"ns_per_sample_min\": %.4f, \"cycles_per_sample\": ",
+			results[i].name, results[i].mode, results[i].buffer_samples, results[i].iterations,
+			1e3 / results[i].ns_per_sample, results[i].ns_per_sample, results[i].ns_per_sample_min);
+		if (results[i].cycles_per_sample >= 0)
+		{
+			fprintf(file, "%.3f }", results[i].cycles_per_sample);
+		}
+		else
+		{
+			fprintf(file, "null }");
+		}
+		fprintf(file, "%s\n", (i + 1 < count) ? "," : "");
+	}
+	fprintf(file, "  ],\n");
+	if (latency != NULL)
+	{
+		fprintf(file, "  \"latency\": {\n");
+		fprintf(file, "    \"source\": \"%s\",\n", latency->source);
+		fprintf(file, "    \"cycles\": %d,\n", latency->cycles);
+		write_json_latency(file, "start_to_first_sample", latency->first_sample_us, ",");
+		write_json_latency(file, "start_rx", latency->start_us, ",");
+		write_json_latency(file, "stop_rx", latency->stop_us, "");
+		fprintf(file, "  }\n");
+	}
+	else
+	{
+		fprintf(file, "  \"latency\": null\n");
+	}
+	fprintf(file, "}\n");
+
+	if (file == stdout)
+	{
+		return fflush(file) == 0 ? 0 : -1;
+	}
+	return fclose(file) == 0 ? 0 : -1;
+}
+
+int main(int argc, char **argv)
+{
+	int opt;
+	const char *json_path = NULL;
+	const char *filter = NULL;
+	const char *work_path = "hydrasdr_bench.raw";
+	int chain_buffers = DEFAULT_CHAIN_BUFFERS;
+	int latency_cycles = DEFAULT_LATENCY_CYCLES;
+	int latency_device = 0;
+	latency_result_t latency;
+	int latency_done = 0;
+	double *stop;
+	bench_ctx_t ctx;
+	bench_result_t *results;
+	bench_result_t *result;
+	double *ns;
+	double *cycles;
+	int result_count = 0;
+	int packed;
+	unsigned int i;
+	int ret;
+	int status = EXIT_SUCCESS;
+
+	while( (opt = getopt(argc, argv, "o:f:t:c:l:dw:")) != EOF )
+	{
+		switch( opt )
+		{
+			case 'o':
+				json_path = optarg;
+			break;
+
+			case 'f':
+				filter = optarg;
+			break;
+
+			case 't':
+				min_time = strtod(optarg, NULL);
+			break;
+
+			case 'c':
+				chain_buffers = atoi(optarg);
+			break;
+
+			case 'l':
+				latency_cycles = atoi(optarg);
+			break;
+
+			case 'd':
+				latency_device = 1;
+			break;
+
+			case 'w':
+				work_path = optarg;
+			break;
+
+			default:
+				usage();
+				return EXIT_FAILURE;
+		}
+	}
+
+	if( min_time <= 0 || chain_buffers < 0 || latency_cycles < 0 ) {
+		fprintf(stderr, "argument error: -t, -c and -l shall be positive\n");
+		usage();
+		return EXIT_FAILURE;
+	}
+
+	if( latency_cycles > MAX_ITERATIONS ) {
+		latency_cycles = MAX_ITERATIONS;
+	}
+
+	results = (bench_result_t *) calloc(2 * (STAGE_COUNT + CHAIN_COUNT), sizeof(bench_result_t));
+	ns = (double *) malloc(MAX_ITERATIONS * sizeof(double));
+	cycles = (double *) malloc(MAX_ITERATIONS * sizeof(double));
+	stop = (double *) malloc((latency_cycles + 1) * sizeof(double));
+	if( results == NULL || ns == NULL || cycles == NULL || stop == NULL || ctx_init(&ctx) != 0 ) {
+		fprintf(stderr, "Failed to allocate the benchmark buffers\n");
+		return EXIT_FAILURE;
+	}
+
+	fprintf(stderr, "%-28s %-8s %7s %10s %10s %10s\n", "name", "mode", "samples", "MSPS/core", "ns/sample", "cyc/sample");
+
+	for( packed = 1; packed >= 0; packed-- )
+	{
+		ctx.count = packed ? PACKED_BUFFER_SAMPLES : UNPACKED_BUFFER_SAMPLES;
+
+		for( i = 0; i < STAGE_COUNT; i++ )
+		{
+			if( (stages[i].packed_only && !packed) || (filter != NULL && strstr(stages[i].name, filter) == NULL) ) {
+				continue;
+			}
+			result = &results[result_count++];
+			snprintf(result->name, sizeof(result->name), "%s", stages[i].name);
+			result->mode = packed ? "packed" : "unpacked";
+			result->buffer_samples = ctx.count;
+			bench_stage(&ctx, &stages[i], ns, cycles, result);
+			print_result(result);
+		}
+
+		if( chain_buffers == 0 ) {
+			continue;
+		}
+		if( write_chain_file(work_path, &ctx, packed, chain_buffers) != 0 ) {
+			fprintf(stderr, "Failed to write file: %s\n", work_path);
+			status = EXIT_FAILURE;
+			break;
+		}
+		for( i = 0; i < CHAIN_COUNT; i++ )
+		{
+			if( filter != NULL && strstr(chains[i].name, filter) == NULL ) {
+				continue;
+			}
+			result = &results[result_count];
+			snprintf(result->name, sizeof(result->name), "%s", chains[i].name);
+			result->mode = packed ? "packed" : "unpacked";
+			result->buffer_samples = ctx.count;
+			ret = bench_chain(work_path, packed, chain_buffers, chains[i].sample_type, ns, cycles, result);
+			if( ret != HYDRASDR_SUCCESS ) {
+				fprintf(stderr, "%s failed: %s (%d)\n", chains[i].name, hydrasdr_error_name(ret), ret);
+				status = EXIT_FAILURE;
+				continue;
+			}
+			result_count++;
+			print_result(result);
+		}
+		remove(work_path);
+	}
+
+	if( latency_cycles > 0 && (filter == NULL || strstr("latency", filter) != NULL) ) {
+		ret = HYDRASDR_SUCCESS;
+		if( !latency_device && write_chain_file(work_path, &ctx, 1, LATENCY_BUFFERS) != 0 ) {
+			fprintf(stderr, "Failed to write file: %s\n", work_path);
+			ret = HYDRASDR_ERROR_OTHER;
+		}
+		if( ret == HYDRASDR_SUCCESS ) {
+			ret = bench_latency(latency_device ? NULL : work_path, latency_cycles, ns, cycles, stop, &latency);
+			if( ret == HYDRASDR_SUCCESS ) {
+				latency_done = 1;
+				print_latency(&latency);
+			} else {
+				fprintf(stderr, "latency failed: %s (%d)\n", hydrasdr_error_name(ret), ret);
+			}
+		}
+		if( !latency_device ) {
+			remove(work_path);
+		}
+		if( ret != HYDRASDR_SUCCESS ) {
+			status = EXIT_FAILURE;
+		}
+	}
+
+	if( json_path != NULL && write_json(json_path, results, result_count, latency_done ? &latency : NULL) != 0 ) {
+		fprintf(stderr, "Failed to write file: %s\n", json_path);
+		status = EXIT_FAILURE;
+	}
+
+	ctx_free(&ctx);
+	free(results);
+	free(ns);
+	free(cycles);
+	free(stop);
+
+	return status;
+}
@@ -0,0 +1,382 @@
+/*
+ * Copyright 2025 Benjamin Vernoux <bvernoux@hydrasdr.com>
+ *
+ * This file is part of HydraSDR.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include <hydrasdr.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <getopt.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <unistd.h>
+#include <sys/types.h>
+#endif
+
+#define HYDRASDR_CONVERT_VERSION "1.0.0"
+
+#define DEFAULT_CHUNK_MIB (64)
+#define MAX_JOBS (64)
+/*
+ * Buffers replayed ahead of each chunk and discarded so that the DC filter, the
+ * half band filter and the decimator stages reach the state of a continuous run.
+ * One buffer is at least 49152 IQ samples, far longer than any of them.
+ */
+#define WARMUP_BUFFERS (1)
+/* Only used to pace real-time replay, conversion runs at maximum speed */
+#define REPLAY_SAMPLERATE (10000000)
+
+/* Output bytes per sample, indexed by enum hydrasdr_sample_type */
+static const uint32_t sample_size[HYDRASDR_SAMPLE_END] = { 8, 4, 4, 2, 2, 0, 2, 3, 4 };
+
+typedef struct {
+	struct hydrasdr_device* device;
+	FILE* out;
+	uint64_t buffer_index; /* Output position of the next delivered buffer, in buffers */
+	uint32_t skip;         /* Warm-up buffers left to discard */
+	int busy;
+	int error;
+} convert_job_t;
+
+static void usage(void)
+{
+	fprintf(stderr, "hydrasdr_convert v%s\n", HYDRASDR_CONVERT_VERSION);
+	fprintf(stderr, "Usage:\n");
+	fprintf(stderr, "-i <filename>: RAW capture (hydrasdr_rx -t 5)\n");
+	fprintf(stderr, "-o <filename>: Converted output file\n");
+	fprintf(stderr, "[-p packing]: Packing of the capture, 1=enabled(12bits packed), 0=disabled(default)\n");
+	fprintf(stderr, "[-t sample_type]: Output sample type, \n");
+	fprintf(stderr, " 0=FLOAT32_IQ, 1=FLOAT32_REAL, 2=INT16_IQ(default), 3=INT16_REAL, 4=U16_REAL,\n");
+	fprintf(stderr, " 6=INT8_IQ, 7=PACKED12_IQ(2*12bits in 3 bytes), 8=FLOAT16_IQ\n");
+	fprintf(stderr, "[-D decimation]: Decimate INT16_IQ, INT8_IQ and PACKED12_IQ by a power of 2 up to 256\n");
+	fprintf(stderr, "[-j jobs]: Chunks converted in parallel (default number of CPUs)\n");
+	fprintf(stderr, "[-k chunk_MiB]: Size of the chunks (default %d)\n", DEFAULT_CHUNK_MIB);
+}
+
+static int file_seek(FILE* file, uint64_t offset, int whence)
+{
+#ifdef _WIN32
+	return _fseeki64(file, (__int64) offset, whence);
+#else
+	return fseeko(file, (off_t) offset, whence);
+#endif
+}
+
+static uint64_t file_size(const char* path)
+{
+	FILE* file;
+	uint64_t size = 0;
+
+	file = fopen(path, "rb");
+	if (file != NULL)
+	{
+		if (file_seek(file, 0, SEEK_END) == 0)
+		{
+#ifdef _WIN32
+			size = (uint64_t) _ftelli64(file);
+#else
+			size = (uint64_t) ftello(file);
+#endif
+		}
+		fclose(file);
+	}
+	return size;
+}
+
+static uint32_t cpu_count(void)
+{
+#ifdef _WIN32
+	SYSTEM_INFO info;
+
+	GetSystemInfo(&info);
+	return info.dwNumberOfProcessors;
+#else
+	long n = sysconf(_SC_NPROCESSORS_ONLN);
+
+	return (n > 0) ? (uint32_t) n : 1;
+#endif
+}
+
+static double wall_clock(void)
+{
+#ifdef _WIN32
+	return (double) GetTickCount64() * 1e-3;
+#else
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (double) ts.tv_sec + (double) ts.tv_nsec * 1e-9;
+#endif
+}
+
+static void sleep_ms(void)
+{
+#ifdef _WIN32
+	Sleep(1);
+#else
+	usleep(1000);
+#endif
+}
+
+/* Runs in the consumer thread of the job's replay device */
+static int convert_callback(hydrasdr_transfer_t* transfer)
+{
+	convert_job_t* job = (convert_job_t*) transfer->ctx;
+	size_t bytes = (size_t) transfer->sample_count * sample_size[transfer->sample_type];
+
+	if (job->skip > 0)
+	{
+		job->skip--;
+		return 0;
+	}
+
+	/* Every buffer converts to the same number of samples, so the output offset follows from its index */
+	if (file_seek(job->out, job->buffer_index * bytes, SEEK_SET) != 0 ||
+		fwrite(transfer->samples, 1, bytes, job->out) != bytes)
+	{
+		job->error = 1;
+		return -1;
+	}
+	job->buffer_index++;
+
+	return 0;
+}
+
+static int start_chunk(convert_job_t* job, uint64_t first, uint64_t count, uint32_t buffer_size)
+{
+	uint32_t warmup;
+	int result;
+
+	warmup = (first >= WARMUP_BUFFERS) ? WARMUP_BUFFERS : (uint32_t) first;
+
+	job->buffer_index = first;
+	job->skip = warmup;
+
+	result = hydrasdr_set_replay_range(job->device, (first - warmup) * buffer_size, (count + warmup) * buffer_size);
+	if (result == HYDRASDR_SUCCESS)
+	{
+		result = hydrasdr_start_rx(job->device, convert_callback, job);
+	}
+	if (result != HYDRASDR_SUCCESS)
+	{
+		fprintf(stderr, "hydrasdr_start_rx() failed: %s (%d)\n", hydrasdr_error_name(result), result);
+		return -1;
+	}
+	job->busy = 1;
+
+	return 0;
+}
+
+int main(int argc, char** argv)
+{
+	int opt;
+	const char* in_path = NULL;
+	const char* out_path = NULL;
+	long packing = 0;
+	long sample_type = HYDRASDR_SAMPLE_INT16_IQ;
+	long decimation = 1;
+	long job_count = 0;
+	long chunk_mib = DEFAULT_CHUNK_MIB;
+	convert_job_t jobs[MAX_JOBS];
+	uint32_t buffer_size = 0;
+	uint64_t input_size, total_buffers, chunk_buffers, chunk_count, next_chunk;
+	uint32_t active;
+	FILE* out;
+	double start, elapsed;
+	long i;
+	int result;
+
+	while( (opt = getopt(argc, argv, "i:o:p:t:D:j:k:")) != EOF )
+	{
+		switch( opt )
+		{
+			case 'i':
+				in_path = optarg;
+			break;
+
+			case 'o':
+				out_path = optarg;
+			break;
+
+			case 'p':
+				packing = strtol(optarg, NULL, 10);
+			break;
+
+			case 't':
+				sample_type = strtol(optarg, NULL, 10);
+			break;
+
+			case 'D':
+				decimation = strtol(optarg, NULL, 10);
+			break;
+
+			case 'j':
+				job_count = strtol(optarg, NULL, 10);
+			break;
+
+			case 'k':
+				chunk_mib = strtol(optarg, NULL, 10);
+			break;
+
+			default:
+				usage();
+				return EXIT_FAILURE;
+		}
+	}
+
+	if( in_path == NULL || out_path == NULL ) {
+		fprintf(stderr, "error: you shall specify -i <filename> and -o <filename>\n");
+		usage();
+		return EXIT_FAILURE;
+	}
+	if( packing != 0 && packing != 1 ) {
+		fprintf(stderr, "argument error: packing shall be 0 or 1\n");
+		usage();
+		return EXIT_FAILURE;
+	}
+	if( sample_type < 0 || sample_type >= HYDRASDR_SAMPLE_END || sample_type == HYDRASDR_SAMPLE_RAW ) {
+		fprintf(stderr, "argument error: unsupported sample type\n");
+		usage();
+		return EXIT_FAILURE;
+	}
+	if( decimation != 1 && sample_type != HYDRASDR_SAMPLE_INT16_IQ &&
+		sample_type != HYDRASDR_SAMPLE_INT8_IQ && sample_type != HYDRASDR_SAMPLE_PACKED12_IQ ) {
+		fprintf(stderr, "argument error: decimation needs INT16_IQ, INT8_IQ or PACKED12_IQ\n");
+		usage();
+		return EXIT_FAILURE;
+	}
+	if( job_count <= 0 ) {
+		job_count = cpu_count();
+	}
+	if( job_count > MAX_JOBS ) {
+		job_count = MAX_JOBS;
+	}
+	if( chunk_mib <= 0 ) {
+		fprintf(stderr, "argument error: chunk size shall be at least 1 MiB\n");
+		usage();
+		return EXIT_FAILURE;
+	}
+
+	input_size = file_size(in_path);
+
+	out = fopen(out_path, "wb");
+	if( out == NULL ) {
+		fprintf(stderr, "Failed to open file: %s\n", out_path);
+		return EXIT_FAILURE;
+	}
+	fclose(out);
+
+	/* One replay device per job, each one has its own reader and conversion threads */
+	memset(jobs, 0, sizeof(jobs));
+	result = 0;
+	for( i = 0; i < job_count && result == 0; i++ )
+	{
+		result = hydrasdr_open_file(&jobs[i].device, in_path, REPLAY_SAMPLERATE, 0);
+		if( result != HYDRASDR_SUCCESS ) {
+			fprintf(stderr, "hydrasdr_open_file() failed: %s (%d)\n", hydrasdr_error_name(result), result);
+			break;
+		}
+		result = hydrasdr_set_sample_type(jobs[i].device, (enum hydrasdr_sample_type) sample_type);
+		if( result == HYDRASDR_SUCCESS ) {
+			result = hydrasdr_set_packing(jobs[i].device, (uint8_t) packing);
+		}
+		if( result == HYDRASDR_SUCCESS ) {
+			result = hydrasdr_set_decimation(jobs[i].device, (uint32_t) decimation);
+		}
+		if( result != HYDRASDR_SUCCESS ) {
+			fprintf(stderr, "argument error: %s (%d)\n", hydrasdr_error_name(result), result);
+			break;
+		}
+		hydrasdr_get_buffer_size(jobs[i].device, &buffer_size);
+
+		jobs[i].out = fopen(out_path, "r+b");
+		if( jobs[i].out == NULL ) {
+			fprintf(stderr, "Failed to open file: %s\n", out_path);
+			result = -1;
+		}
+	}
+
+	total_buffers = (buffer_size != 0) ? input_size / buffer_size : 0;
+	chunk_buffers = ((uint64_t) chunk_mib << 20) / buffer_size;
+	if( chunk_buffers == 0 ) {
+		chunk_buffers = 1;
+	}
+	chunk_count = (total_buffers + chunk_buffers - 1) / chunk_buffers;
+
+	if( result == 0 && total_buffers == 0 ) {
+		fprintf(stderr, "error: %s holds less than one buffer (%u bytes)\n", in_path, buffer_size);
+		result = -1;
+	}
+
+	start = wall_clock();
+	next_chunk = 0;
+	active = 0;
+	while( result == 0 && (next_chunk < chunk_count || active > 0) )
+	{
+		for( i = 0; i < job_count && result == 0; i++ )
+		{
+			if( jobs[i].busy && hydrasdr_is_streaming(jobs[i].device) != HYDRASDR_TRUE ) {
+				hydrasdr_stop_rx(jobs[i].device);
+				jobs[i].busy = 0;
+				active--;
+				if( jobs[i].error ) {
+					fprintf(stderr, "Failed to write file: %s\n", out_path);
+					result = -1;
+				}
+			}
+			if( !jobs[i].busy && next_chunk < chunk_count && result == 0 ) {
+				result = start_chunk(&jobs[i], next_chunk * chunk_buffers,
+					(next_chunk + 1 < chunk_count) ? chunk_buffers : total_buffers - next_chunk * chunk_buffers,
+					buffer_size);
+				next_chunk++;
+				active += (result == 0);
+			}
+		}
+		sleep_ms();
+	}
+	elapsed = wall_clock() - start;
+
+	for( i = 0; i < job_count; i++ )
+	{
+		if( jobs[i].device != NULL ) {
+			hydrasdr_close(jobs[i].device);
+		}
+		if( jobs[i].out != NULL && fclose(jobs[i].out) != 0 && result == 0 ) {
+			fprintf(stderr, "Failed to write file: %s\n", out_path);
+			result = -1;
+		}
+	}
+
+	if( result == 0 ) {
+		fprintf(stderr, "%llu bytes converted in %.2f s (%.1f MB/s) with %ld jobs\n",
+			(unsigned long long) (total_buffers * buffer_size), elapsed,
+			(double) (total_buffers * buffer_size) / 1e6 / (elapsed > 0.0 ? elapsed : 1e-9), job_count);
+		if( input_size > total_buffers * buffer_size ) {
+			fprintf(stderr, "%llu trailing bytes (less than one buffer) ignored\n",
+				(unsigned long long) (input_size - total_buffers * buffer_size));
+		}
+	}
+
+	return (result == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
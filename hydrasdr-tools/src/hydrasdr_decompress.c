@@ -0,0 +1,492 @@
+/*
+ * Copyright 2025 Benjamin Vernoux <bvernoux@hydrasdr.com>
+ *
+ * This file is part of HydraSDR.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include "iq_codec.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <getopt.h>
+
+#ifdef _WIN32
+#include <io.h>
+#include <fcntl.h>
+#endif
+
+#define HYDRASDR_DECOMPRESS_VERSION "1.0.0"
+
+/* Benchmark blocks have the size used by hydrasdr_rx (one file writer buffer) */
+#define BENCH_BLOCK_WORDS (2 * 1024 * 1024)
+#define BENCH_BLOCKS (8)
+#define BENCH_MIN_SECONDS (0.5)
+/* Stream rate of 10 MSPS INT16_IQ */
+#define BENCH_REFERENCE_MBPS (40.0)
+/* Self test blocks: a few Rice groups of IQ words, one input per seed */
+#define SELF_TEST_WORDS (4096)
+#define SELF_TEST_SEEDS (64)
+/* Written after the block bound, any change is an overflow (a Rice group costs at most 5 bytes per word) */
+#define SELF_TEST_GUARD (IQ_CODEC_GROUP * 5)
+#define SELF_TEST_GUARD_BYTE (0xA5)
+
+static void usage(void)
+{
+	fprintf(stderr, "hydrasdr_decompress v%s\n", HYDRASDR_DECOMPRESS_VERSION);
+	fprintf(stderr, "Usage:\n");
+	fprintf(stderr, "-i <filename>: Compressed file written by hydrasdr_rx -Y ('-' for stdin)\n");
+	fprintf(stderr, "-o <filename>: Decompressed output file ('-' for stdout)\n");
+	fprintf(stderr, "[-b]: Benchmark compression ratio and MB/s per core instead of decompressing,\n");
+	fprintf(stderr, " on the raw 16bits samples of -i <filename>, or on synthetic noise without -i\n");
+	fprintf(stderr, "[-c channels]: Channels of the benchmark samples, 1=real, 2=IQ(default)\n");
+	fprintf(stderr, "[-t]: Self test, lossless round trip of edge case blocks (sparse outliers, escaped codes)\n");
+}
+
+static int decompress(FILE* in, FILE* out)
+{
+	iq_codec_stream_hdr_t hdr;
+	uint8_t block_hdr[IQ_CODEC_BLOCK_HDR_SIZE];
+	uint8_t* block = NULL;
+	uint16_t* samples = NULL;
+	size_t block_size = 0;
+	uint32_t words, payload;
+	uint64_t total = 0;
+	uint16_t channels;
+	size_t n;
+	int result = -1;
+
+	if (fread(&hdr, 1, sizeof(hdr), in) != sizeof(hdr) || (channels = iq_codec_stream_hdr_check(&hdr)) == 0)
+	{
+		fprintf(stderr, "error: not a compressed HydraSDR recording\n");
+		return -1;
+	}
+
+	for (;;)
+	{
+		n = fread(block_hdr, 1, sizeof(block_hdr), in);
+		if (n == 0)
+		{
+			result = 0;
+			break;
+		}
+		if (n != sizeof(block_hdr) || iq_codec_block_info(block_hdr, &words, &payload) != 0)
+		{
+			fprintf(stderr, "error: corrupted block header at sample word %llu\n", (unsigned long long) total);
+			break;
+		}
+
+		if (iq_codec_block_bound(words) > block_size)
+		{
+			block_size = iq_codec_block_bound(words);
+			free(block);
+			free(samples);
+			block = (uint8_t*) malloc(block_size);
+			samples = (uint16_t*) malloc((size_t) words * 2);
+			if (block == NULL || samples == NULL)
+			{
+				fprintf(stderr, "error: out of memory\n");
+				break;
+			}
+		}
+
+		memcpy(block, block_hdr, sizeof(block_hdr));
+		if (fread(block + sizeof(block_hdr), 1, payload, in) != payload)
+		{
+			fprintf(stderr, "error: truncated block at sample word %llu\n", (unsigned long long) total);
+			break;
+		}
+		if (iq_codec_decode_block(block, sizeof(block_hdr) + payload, channels, samples) != 0)
+		{
+			fprintf(stderr, "error: corrupted block at sample word %llu\n", (unsigned long long) total);
+			break;
+		}
+		if (fwrite(samples, 2, words, out) != words)
+		{
+			fprintf(stderr, "error: write failed\n");
+			break;
+		}
+		total += words;
+	}
+
+	free(block);
+	free(samples);
+
+	if (result == 0)
+	{
+		fprintf(stderr, "%llu bytes decompressed (%u channel(s))\n", (unsigned long long) total * 2, channels);
+	}
+
+	return result;
+}
+
+/* Gaussian noise of sigma LSB on a left aligned 12bits ADC scale */
+static void synthetic_noise(uint16_t* samples, uint32_t words, double sigma)
+{
+	uint32_t i;
+	double u, v;
+	long x;
+
+	srand(1);
+	for (i = 0; i < words; i++)
+	{
+		u = (rand() + 1.0) / (RAND_MAX + 2.0);
+		v = (rand() + 1.0) / (RAND_MAX + 2.0);
+		x = lround(sqrt(-2.0 * log(u)) * cos(2.0 * 3.14159265358979 * v) * sigma);
+		x = (x > 2047) ? 2047 : ((x < -2048) ? -2048 : x);
+		samples[i] = (uint16_t) (int16_t) (x * 16);
+	}
+}
+
+static double seconds_since(clock_t start)
+{
+	return (double) (clock() - start) / CLOCKS_PER_SEC;
+}
+
+static int bench(const char* label, const uint16_t* samples, uint32_t words, uint16_t channels)
+{
+	uint8_t* encoded;
+	uint16_t* decoded;
+	size_t encoded_bytes, offset;
+	uint32_t block_words, i, w, payload;
+	uint32_t runs;
+	clock_t start;
+	double encode_s, decode_s;
+
+	/* Whole samples per block */
+	block_words = BENCH_BLOCK_WORDS - (BENCH_BLOCK_WORDS % channels);
+
+	encoded = (uint8_t*) malloc(iq_codec_block_bound(block_words) * ((words + block_words - 1) / block_words));
+	decoded = (uint16_t*) malloc((size_t) words * 2);
+	if (encoded == NULL || decoded == NULL)
+	{
+		free(encoded);
+		free(decoded);
+		fprintf(stderr, "error: out of memory\n");
+		return -1;
+	}
+
+	/* Repeated until the CPU time is measurable, clock() counts the time of this core only */
+	encoded_bytes = 0;
+	start = clock();
+	for (runs = 0; runs == 0 || seconds_since(start) < BENCH_MIN_SECONDS; runs++)
+	{
+		encoded_bytes = 0;
+		for (i = 0; i < words; i += block_words)
+		{
+			w = (words - i < block_words) ? words - i : block_words;
+			encoded_bytes += iq_codec_encode_block(samples + i, w, channels, encoded + encoded_bytes);
+		}
+	}
+	encode_s = seconds_since(start) / runs;
+
+	start = clock();
+	for (runs = 0; runs == 0 || seconds_since(start) < BENCH_MIN_SECONDS; runs++)
+	{
+		offset = 0;
+		for (i = 0; i < words; i += w)
+		{
+			iq_codec_block_info(encoded + offset, &w, &payload);
+			if (iq_codec_decode_block(encoded + offset, IQ_CODEC_BLOCK_HDR_SIZE + payload, channels, decoded + i) != 0)
+			{
+				break;
+			}
+			offset += IQ_CODEC_BLOCK_HDR_SIZE + payload;
+		}
+	}
+	decode_s = seconds_since(start) / runs;
+
+	if (memcmp(samples, decoded, (size_t) words * 2) != 0)
+	{
+		fprintf(stderr, "error: %s: decoded samples differ\n", label);
+		free(encoded);
+		free(decoded);
+		return -1;
+	}
+
+	printf("%-24s %7.3f %9.1f %9.1f %8.2f\n", label,
+		(double) words * 2 / encoded_bytes,
+		(double) words * 2 / 1e6 / encode_s,
+		(double) words * 2 / 1e6 / decode_s,
+		BENCH_REFERENCE_MBPS * encode_s / ((double) words * 2 / 1e6));
+
+	free(encoded);
+	free(decoded);
+
+	return 0;
+}
+
+/* Encodes and decodes a single block, returns 0 if the decoded samples are identical */
+static int round_trip(const char* label, const uint16_t* samples, uint32_t words, uint16_t channels,
+	uint8_t* encoded, uint16_t* decoded)
+{
+	size_t encoded_bytes;
+	size_t bound = iq_codec_block_bound(words);
+	size_t i;
+
+	memset(encoded + bound, SELF_TEST_GUARD_BYTE, SELF_TEST_GUARD);
+	encoded_bytes = iq_codec_encode_block(samples, words, channels, encoded);
+	for (i = 0; i < SELF_TEST_GUARD; i++)
+	{
+		if (encoded[bound + i] != SELF_TEST_GUARD_BYTE)
+		{
+			fprintf(stderr, "error: %s: written past the block bound (%u words, %u channel(s))\n", label, words, channels);
+			return -1;
+		}
+	}
+	if (encoded_bytes > bound ||
+		iq_codec_decode_block(encoded, encoded_bytes, channels, decoded) != 0 ||
+		memcmp(samples, decoded, (size_t) words * 2) != 0)
+	{
+		fprintf(stderr, "error: %s: round trip failed (%u words, %u channel(s))\n", label, words, channels);
+		return -1;
+	}
+
+	return 0;
+}
+
+/*
+ * Small noise with rare large outliers keeps k small and escapes the outliers,
+ * the escapes and the longest codes (k = 10, quotient 23) land at any bit position.
+ * Random words are not compressible and must fall back to raw within the block bound.
+ */
+static int self_test(void)
+{
+	static const uint16_t extremes[] = { 0x8000, 0x7FFF, 0xFFFF, 0xFFF0, 0x0001 };
+	uint16_t samples[SELF_TEST_WORDS];
+	uint16_t decoded[SELF_TEST_WORDS];
+	uint8_t encoded[IQ_CODEC_BLOCK_HDR_SIZE + SELF_TEST_WORDS * 2 + SELF_TEST_GUARD];
+	char label[48];
+	uint16_t channels;
+	uint32_t i, words;
+	int seed, spike_rate;
+
+	for (channels = 1; channels <= 2; channels++)
+	{
+		for (seed = 0; seed < SELF_TEST_SEEDS; seed++)
+		{
+			srand((unsigned) seed + 1);
+			/* From one outlier per 4 words up to one per 1024 */
+			spike_rate = 4 << (seed % 9);
+			for (i = 0; i < SELF_TEST_WORDS; i++)
+			{
+				samples[i] = (uint16_t) (int16_t) ((rand() % 7 - 3) * 16);
+				if (rand() % spike_rate == 0)
+				{
+					samples[i] = (uint16_t) (rand() & 0xFFF0);
+				}
+			}
+			/* Odd sizes end on a partial Rice group */
+			words = SELF_TEST_WORDS - (uint32_t) (seed % 4) * 37 * channels;
+			snprintf(label, sizeof(label), "sparse outliers seed %d", seed);
+			if (round_trip(label, samples, words, channels, encoded, decoded) != 0)
+			{
+				return -1;
+			}
+
+			/* Maximum escape values (zigzag 0xFFFF) after zeros, no common zero low bits */
+			for (i = 0; i < SELF_TEST_WORDS; i++)
+			{
+				samples[i] = (rand() % spike_rate == 0) ? extremes[rand() % 5] : 0;
+			}
+			samples[SELF_TEST_WORDS - 1] = 0x0001;
+			snprintf(label, sizeof(label), "escape values seed %d", seed);
+			if (round_trip(label, samples, SELF_TEST_WORDS, channels, encoded, decoded) != 0)
+			{
+				return -1;
+			}
+
+			/* Large k with quotients up to the escape threshold */
+			for (i = 0; i < SELF_TEST_WORDS; i++)
+			{
+				samples[i] = (uint16_t) (int16_t) (rand() % 4096 - 2048);
+				if (rand() % spike_rate == 0)
+				{
+					/* Zigzag 22 to 24 * 1024 for the k = 10 of the noise */
+					samples[i] = (uint16_t) (int16_t) ((rand() & 1) ? 11 * 1024 + rand() % 1024 : -11 * 1024 - rand() % 1024);
+				}
+			}
+			snprintf(label, sizeof(label), "long codes seed %d", seed);
+			if (round_trip(label, samples, SELF_TEST_WORDS, channels, encoded, decoded) != 0)
+			{
+				return -1;
+			}
+
+			/* Full entropy, stored raw without writing past the bound, from 2 Rice groups up */
+			for (i = 0; i < SELF_TEST_WORDS; i++)
+			{
+				samples[i] = (uint16_t) ((rand() & 0xFF) | (rand() & 0xFF) << 8);
+			}
+			words = (uint32_t) IQ_CODEC_GROUP * 2 << (seed % 4);
+			snprintf(label, sizeof(label), "full entropy seed %d", seed);
+			if (round_trip(label, samples, words, channels, encoded, decoded) != 0)
+			{
+				return -1;
+			}
+		}
+	}
+
+	printf("self test passed\n");
+
+	return 0;
+}
+
+int main(int argc, char** argv)
+{
+	int opt;
+	const char* in_path = NULL;
+	const char* out_path = NULL;
+	int benchmark = 0;
+	int test = 0;
+	long channels = 2;
+	FILE* in;
+	FILE* out;
+	uint16_t* samples;
+	uint32_t words;
+	char label[32];
+	double sigma;
+	int result;
+
+	while( (opt = getopt(argc, argv, "i:o:bc:t")) != EOF )
+	{
+		switch( opt )
+		{
+			case 'i':
+				in_path = optarg;
+			break;
+
+			case 'o':
+				out_path = optarg;
+			break;
+
+			case 'b':
+				benchmark = 1;
+			break;
+
+			case 'c':
+				channels = strtol(optarg, NULL, 10);
+			break;
+
+			case 't':
+				test = 1;
+			break;
+
+			default:
+				usage();
+				return EXIT_FAILURE;
+		}
+	}
+
+	if( test )
+	{
+		return (self_test() == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+	}
+
+	if( benchmark )
+	{
+		if( channels < 1 || channels > IQ_CODEC_MAX_CHANNELS ) {
+			fprintf(stderr, "argument error: channels out of range\n");
+			usage();
+			return EXIT_FAILURE;
+		}
+
+		printf("%-24s %7s %9s %9s %8s\n", "input", "ratio", "enc MB/s", "dec MB/s", "cores");
+		result = 0;
+		if( in_path != NULL )
+		{
+			in = fopen(in_path, "rb");
+			if( in == NULL ) {
+				fprintf(stderr, "Failed to open file: %s\n", in_path);
+				return EXIT_FAILURE;
+			}
+			words = BENCH_BLOCK_WORDS * BENCH_BLOCKS;
+			samples = (uint16_t*) malloc((size_t) words * 2);
+			if( samples == NULL ) {
+				fclose(in);
+				return EXIT_FAILURE;
+			}
+			words = (uint32_t) fread(samples, 2, words, in);
+			fclose(in);
+			words -= words % channels;
+			if( words > 0 ) {
+				result = bench(in_path, samples, words, (uint16_t) channels);
+			}
+			free(samples);
+		}
+		else
+		{
+			words = BENCH_BLOCK_WORDS * 2;
+			samples = (uint16_t*) malloc((size_t) words * 2);
+			if( samples == NULL ) {
+				return EXIT_FAILURE;
+			}
+			for( sigma = 1.0; sigma <= 1024.0 && result == 0; sigma *= 4.0 )
+			{
+				synthetic_noise(samples, words, sigma);
+				snprintf(label, sizeof(label), "noise sigma %.0f LSB", sigma);
+				result = bench(label, samples, words, (uint16_t) channels);
+			}
+			free(samples);
+		}
+		printf("cores: cores needed to compress %.0f MB/s (10 MSPS INT16_IQ)\n", BENCH_REFERENCE_MBPS);
+
+		return (result == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+	}
+
+	if( in_path == NULL || out_path == NULL ) {
+		fprintf(stderr, "error: you shall specify -i <filename> and -o <filename>\n");
+		usage();
+		return EXIT_FAILURE;
+	}
+
+	in = strcmp(in_path, "-") ? fopen(in_path, "rb") : stdin;
+	if( in == NULL ) {
+		fprintf(stderr, "Failed to open file: %s\n", in_path);
+		return EXIT_FAILURE;
+	}
+	out = strcmp(out_path, "-") ? fopen(out_path, "wb") : stdout;
+	if( out == NULL ) {
+		fprintf(stderr, "Failed to open file: %s\n", out_path);
+		if( in != stdin ) {
+			fclose(in);
+		}
+		return EXIT_FAILURE;
+	}
+#ifdef _WIN32
+	if( in == stdin ) {
+		_setmode(_fileno(stdin), _O_BINARY);
+	}
+	if( out == stdout ) {
+		_setmode(_fileno(stdout), _O_BINARY);
+	}
+#endif
+
+	result = decompress(in, out);
+
+	if( in != stdin ) {
+		fclose(in);
+	}
+	if( out != stdout && fclose(out) != 0 ) {
+		fprintf(stderr, "Failed to write file: %s\n", out_path);
+		result = -1;
+	}
+
+	return (result == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -21,6 +21,9 @@
  */
 
 #include <hydrasdr.h>
+#include "file_writer.h"
+#include "ring_capture.h"
+#include "sigmf.h"
 
 #include <stdio.h>
 #include <stdlib.h>
@@ -33,6 +36,7 @@
 #include <fcntl.h>
 #include <errno.h>
 #include <limits.h>
+#include <math.h>
 
 #define HYDRASDR_RX_VERSION "1.0.0 2025"
 
@@ -95,8 +99,7 @@ int gettimeofday(struct timeval *tv, void* ignored)
 #define INT16_EL_SIZE_BYTE (2)   /* 2bytes = 16bit int */
 #define INT12_EL_SIZE_BITS (12)
 #define INT8_EL_SIZE_BITS (8)
-
-#define FD_BUFFER_SIZE (16*1024)
+#define INT8_EL_SIZE_BYTE (1)
 
 #define FREQ_ONE_MHZ (1000000ull)
 
@@ -112,6 +115,8 @@ int gettimeofday(struct timeval *tv, void* ignored)
 #define FREQ_HZ_MAX (1850000000ull) /* 1850MHz (officially 1800MHz) */
 #define SAMPLE_TYPE_MAX (HYDRASDR_SAMPLE_END-1)
 #define BIAST_MAX (1)
+#define RF_PORT_MAX (2)
+#define DITHERING_MAX (1)
 #define VGA_GAIN_MAX (15)
 #define MIXER_GAIN_MAX (15)
 #define LNA_GAIN_MAX (14)
@@ -124,11 +129,33 @@ int gettimeofday(struct timeval *tv, void* ignored)
 /* WAVE or RIFF WAVE file format containing data for HydraSDR compatible with SDR++ Wav IQ file */
 typedef struct 
 {
-		char groupID[4]; /* 'RIFF' */
-		uint32_t size; /* File size + 8bytes */
+		char groupID[4]; /* 'RIFF' or 'RF64' */
+		uint32_t size; /* File size - 8bytes, 0xFFFFFFFF for RF64 */
 		char riffType[4]; /* 'WAVE'*/
 } t_WAVRIFF_hdr;
 
+/*
+ * RF64 (EBU Tech 3306) 64bits sizes chunk, only with -W or a -n limit above 4GB:
+ * the plain 44 bytes RIFF/WAVE/fmt /data layout is kept otherwise (SDR++ reads it as is).
+ * Reserved as a 'JUNK' chunk when the capture starts and turned into 'ds64'
+ * only if the file ends up larger than 4GB, so short captures stay valid WAV.
+ * 64bits values are split in two 32bits words to keep the header unpadded.
+ */
+#define WAV_SIZE_MAX_U32 (0xFFFFFFFFull)
+
+typedef struct
+{
+		char chunkID[4]; /* 'JUNK' or 'ds64' */
+		uint32_t chunkSize; /* 28 fixed */
+		uint32_t riffSizeLow; /* File size - 8bytes */
+		uint32_t riffSizeHigh;
+		uint32_t dataSizeLow; /* Size of data in bytes */
+		uint32_t dataSizeHigh;
+		uint32_t sampleCountLow; /* Number of sample frames */
+		uint32_t sampleCountHigh;
+		uint32_t tableLength; /* 0 no other chunk larger than 4GB */
+} t_DS64Chunk;
+
 #define FormatID "fmt "   /* chunkID for Format Chunk. NOTE: There is a space at the end of this ID. */
 
 typedef struct {
@@ -153,10 +180,16 @@ typedef struct
 typedef struct
 {
 	t_WAVRIFF_hdr hdr;
+	t_DS64Chunk ds64_chunk;
 	t_FormatChunk fmt_chunk;
 	t_DataChunk data_chunk;
 } t_wav_file_hdr;
 
+/* Header as written to the file, the ds64 chunk left out unless wav_rf64 */
+uint8_t wav_header[sizeof(t_wav_file_hdr)];
+size_t wav_header_size = sizeof(t_wav_file_hdr) - sizeof(t_DS64Chunk);
+bool wav_rf64 = false;
+
 t_wav_file_hdr wave_file_hdr = 
 {
 	/* t_WAVRIFF_hdr */
@@ -165,6 +198,15 @@ t_wav_file_hdr wave_file_hdr =
 		0, /* size to update later */
 		{ 'W', 'A', 'V', 'E' }
 	},
+	/* t_DS64Chunk */
+	{
+		{ 'J', 'U', 'N', 'K' }, /* char chunkID[4]; 'ds64' if RF64 */
+		28, /* uint32_t chunkSize; */
+		0, 0, /* riffSize; to update later */
+		0, 0, /* dataSize; to update later */
+		0, 0, /* sampleCount; to update later */
+		0 /* tableLength */
+	},
 	/* t_FormatChunk */
 	{
 		{ 'f', 'm', 't', ' ' }, /* char		chunkID[4];  */
@@ -209,14 +251,34 @@ bool sensitivity_gain = false;
 uint16_t wav_format_tag=1; /* PCM8 or PCM16 */
 uint16_t wav_nb_channels=2;
 uint32_t wav_sample_per_sec;
-uint16_t wav_nb_byte_per_sample=2;
 uint16_t wav_nb_bits_per_sample=16;
 
 hydrasdr_read_partid_serialno_t read_partid_serialno;
 
 volatile bool do_exit = false;
 
-FILE* fd = NULL;
+file_writer_t* writer = NULL;
+bool direct_io = false;
+bool compress = false;
+
+/* Segmented recording, a new file every segment_seconds or segment_mib */
+double segment_seconds = 0.0;
+uint32_t segment_mib = 0;
+
+/* Pre-trigger capture mode */
+ring_capture_t* ring = NULL;
+bool ring_mode = false;
+double ring_pre_seconds = 0.0;
+double ring_post_seconds = 1.0;
+bool power_trigger = false;
+float power_threshold_dbfs = 0.0f;
+char* control_socket_path = NULL;
+
+/* SigMF recording (.sigmf-data + .sigmf-meta) */
+bool sigmf_mode = false;
+sigmf_meta_t* sigmf_meta = NULL;
+uint64_t sigmf_sample_index = 0;
+uint32_t sigmf_bytes_per_sample;
 
 bool verbose = false;
 bool receive = false;
@@ -251,9 +313,19 @@ enum hydrasdr_sample_type sample_type_val;
 bool biast = false;
 uint32_t biast_val;
 
+bool rf_port = false;
+uint32_t rf_port_val;
+
+uint32_t dithering_val = 0;
+
 bool serial_number = false;
 uint64_t serial_number_val;
 
+char* replay_path = NULL;
+bool replay_realtime = false;
+
+char* shm_name = NULL;
+
 static float
 TimevalDiff(const struct timeval *a, const struct timeval *b)
 {
@@ -362,6 +434,52 @@ char* u64toa(uint64_t val, t_u64toa* str)
 	return res;
 }
 
+/* Mean power of a transfer relative to full scale */
+static float transfer_power_dbfs(hydrasdr_transfer_t* transfer)
+{
+	uint32_t i;
+	uint32_t count = transfer->sample_count * wav_nb_channels;
+	double sum = 0.0;
+	double full_scale;
+	const float* f32;
+	const int16_t* i16;
+	const int8_t* i8;
+
+	switch (transfer->sample_type)
+	{
+		case HYDRASDR_SAMPLE_FLOAT32_IQ:
+		case HYDRASDR_SAMPLE_FLOAT32_REAL:
+			f32 = (const float*) transfer->samples;
+			for (i = 0; i < count; i++)
+				sum += (double) f32[i] * f32[i];
+			full_scale = 1.0;
+			break;
+
+		case HYDRASDR_SAMPLE_INT16_IQ:
+		case HYDRASDR_SAMPLE_INT16_REAL:
+			i16 = (const int16_t*) transfer->samples;
+			for (i = 0; i < count; i++)
+				sum += (double) i16[i] * i16[i];
+			full_scale = 32768.0;
+			break;
+
+		case HYDRASDR_SAMPLE_INT8_IQ:
+			i8 = (const int8_t*) transfer->samples;
+			for (i = 0; i < count; i++)
+				sum += (double) i8[i] * i8[i];
+			full_scale = 128.0;
+			break;
+
+		default:
+			return -1000.0f;
+	}
+
+	if (count == 0 || sum == 0.0)
+		return -1000.0f;
+
+	return (float) (10.0 * log10(sum / (count / wav_nb_channels) / (full_scale * full_scale)));
+}
+
 int rx_callback(hydrasdr_transfer_t* transfer)
 {
 	uint32_t bytes_to_write;
@@ -370,7 +488,7 @@ int rx_callback(hydrasdr_transfer_t* transfer)
 	struct timeval time_now;
 	float time_difference, rate;
 
-	if( fd != NULL ) 
+	if( (writer != NULL) || (ring != NULL) ) 
 	{
 		switch(sample_type_val)
 		{
@@ -399,8 +517,23 @@ int rx_callback(hydrasdr_transfer_t* transfer)
 				pt_rx_buffer = transfer->samples;
 				break;
 
+			case HYDRASDR_SAMPLE_INT8_IQ:
+				bytes_to_write = transfer->sample_count * INT8_EL_SIZE_BYTE * 2;
+				pt_rx_buffer = transfer->samples;
+				break;
+
+			case HYDRASDR_SAMPLE_FLOAT16_IQ:
+				bytes_to_write = transfer->sample_count * INT16_EL_SIZE_BYTE * 2;
+				pt_rx_buffer = transfer->samples;
+				break;
+
+			case HYDRASDR_SAMPLE_PACKED12_IQ:
+				bytes_to_write = transfer->sample_count * INT12_EL_SIZE_BITS * 2 / INT8_EL_SIZE_BITS;
+				pt_rx_buffer = transfer->samples;
+				break;
+
 			case HYDRASDR_SAMPLE_RAW:
-				if (packing_val)
+				if (packing_val == PACKING_ON)
 				{
 					bytes_to_write = transfer->sample_count * INT12_EL_SIZE_BITS / INT8_EL_SIZE_BITS;
 				}
@@ -449,13 +582,26 @@ int rx_callback(hydrasdr_transfer_t* transfer)
 			bytes_to_xfer -= bytes_to_write;
 		}
 
-		if(pt_rx_buffer != NULL)
+		if(pt_rx_buffer != NULL && ring != NULL)
 		{
-			bytes_written = fwrite(pt_rx_buffer, 1, bytes_to_write, fd);
+			if (power_trigger && transfer_power_dbfs(transfer) >= power_threshold_dbfs)
+			{
+				ring_capture_trigger(ring);
+			}
+			bytes_written = (ring_capture_write(ring, pt_rx_buffer, bytes_to_write) == 0) ? bytes_to_write : 0;
+		}else if(pt_rx_buffer != NULL)
+		{
+			if (sigmf_meta != NULL && transfer->dropped_samples > 0)
+			{
+				/* The lost samples are missing from the data file just before this position */
+				sigmf_meta_add_drop(sigmf_meta, sigmf_sample_index, transfer->dropped_samples);
+			}
+			bytes_written = (file_writer_write(writer, pt_rx_buffer, bytes_to_write) == 0) ? bytes_to_write : 0;
 		}else
 		{
 			bytes_written = 0;
 		}
+		sigmf_sample_index += bytes_written / sigmf_bytes_per_sample;
 		if ( (bytes_written != bytes_to_write) || 
 				 ((limit_num_samples == true) && (bytes_to_xfer == 0)) 
 				)
@@ -468,6 +614,57 @@ int rx_callback(hydrasdr_transfer_t* transfer)
 	}
 }
 
+/*
+ * Fill wav_header for a file of file_size bytes, switching to RF64 above 4GB when the ds64 chunk is reserved.
+ * Without it the 32bits sizes saturate.
+ */
+static void wav_header_update(uint64_t file_size)
+{
+	uint64_t riff_size;
+	uint64_t data_size;
+	uint64_t sample_count;
+	uint8_t* p;
+	bool rf64;
+
+	riff_size = file_size - 8;
+	data_size = file_size - wav_header_size;
+	rf64 = wav_rf64 && (riff_size > WAV_SIZE_MAX_U32);
+
+	/* Wav Header */
+	memcpy(wave_file_hdr.hdr.groupID, rf64 ? "RF64" : "RIFF", 4);
+	wave_file_hdr.hdr.size = (riff_size > WAV_SIZE_MAX_U32) ? (uint32_t) WAV_SIZE_MAX_U32 : (uint32_t) riff_size;
+	/* Wav Format Chunk */
+	wave_file_hdr.fmt_chunk.wFormatTag = wav_format_tag;
+	wave_file_hdr.fmt_chunk.wChannels = wav_nb_channels;
+	wave_file_hdr.fmt_chunk.dwSamplesPerSec = wav_sample_per_sec;
+	wave_file_hdr.fmt_chunk.wBlockAlign = wav_nb_channels * (wav_nb_bits_per_sample / 8);
+	wave_file_hdr.fmt_chunk.dwAvgBytesPerSec = wave_file_hdr.fmt_chunk.dwSamplesPerSec * wave_file_hdr.fmt_chunk.wBlockAlign;
+	wave_file_hdr.fmt_chunk.wBitsPerSample = wav_nb_bits_per_sample;
+	/* Wav ds64 Chunk (JUNK padding for plain WAV) */
+	sample_count = data_size / wave_file_hdr.fmt_chunk.wBlockAlign;
+	memcpy(wave_file_hdr.ds64_chunk.chunkID, rf64 ? "ds64" : "JUNK", 4);
+	wave_file_hdr.ds64_chunk.riffSizeLow = (uint32_t) riff_size;
+	wave_file_hdr.ds64_chunk.riffSizeHigh = (uint32_t) (riff_size >> 32);
+	wave_file_hdr.ds64_chunk.dataSizeLow = (uint32_t) data_size;
+	wave_file_hdr.ds64_chunk.dataSizeHigh = (uint32_t) (data_size >> 32);
+	wave_file_hdr.ds64_chunk.sampleCountLow = (uint32_t) sample_count;
+	wave_file_hdr.ds64_chunk.sampleCountHigh = (uint32_t) (sample_count >> 32);
+	/* Wav Data Chunk */
+	wave_file_hdr.data_chunk.chunkSize = (data_size > WAV_SIZE_MAX_U32) ? (uint32_t) WAV_SIZE_MAX_U32 : (uint32_t) data_size;
+
+	p = wav_header;
+	memcpy(p, &wave_file_hdr.hdr, sizeof(t_WAVRIFF_hdr));
+	p += sizeof(t_WAVRIFF_hdr);
+	if (wav_rf64)
+	{
+		memcpy(p, &wave_file_hdr.ds64_chunk, sizeof(t_DS64Chunk));
+		p += sizeof(t_DS64Chunk);
+	}
+	memcpy(p, &wave_file_hdr.fmt_chunk, sizeof(t_FormatChunk));
+	p += sizeof(t_FormatChunk);
+	memcpy(p, &wave_file_hdr.data_chunk, sizeof(t_DataChunk));
+}
+
 static void usage(void)
 {
 	fprintf(stderr, "hydrasdr_rx v%s\n", HYDRASDR_RX_VERSION);
@@ -475,17 +672,41 @@ static void usage(void)
 	fprintf(stderr, "-r <filename>: Receive data into file\n");
 	fprintf(stderr, "-w Receive data into file with WAV header and automatic name\n");
 	fprintf(stderr, " This is for SDR++ compatibility and may not work with other software\n");
+	fprintf(stderr, "[-W]: As -w with an RF64 header for captures larger than 4GB (not read by SDR++),\n");
+	fprintf(stderr, " used as well when -n asks for more than 4GB\n");
+	fprintf(stderr, "[-M]: Record in SigMF format, <filename>.sigmf-data with a <filename>.sigmf-meta sidecar\n");
+	fprintf(stderr, " (FLOAT32, INT16, UINT16_REAL and INT8_IQ sample types)\n");
+	fprintf(stderr, "[-D]: Record with O_DIRECT (and io_uring when available) to bypass the page cache\n");
+	fprintf(stderr, "[-Y]: Compress the recording losslessly (INT16_IQ, INT16_REAL, U16_REAL, RAW not packed),\n");
+	fprintf(stderr, " read it back with hydrasdr_decompress\n");
+	fprintf(stderr, "[-z seconds]: Split the recording in files of this duration named <filename>_<first sample index>\n");
+	fprintf(stderr, "[-Z size_MiB]: Split the recording in files of this size named <filename>_<first sample index>\n");
+	fprintf(stderr, "[-B seconds]: Pre-trigger capture, keep the last seconds in the memory-mapped ring <filename>.ring\n");
+	fprintf(stderr, " and save <filename>_eventNNNN.bin on each trigger (SIGUSR1, -T or -S), not available on Windows\n");
+	fprintf(stderr, "[-A seconds]: Post-trigger duration saved with each event (default 1.0)\n");
+	fprintf(stderr, "[-T dBFS]: Trigger an event when the mean power of a buffer reaches this level\n");
+	fprintf(stderr, " (FLOAT32, INT16 and INT8 sample types)\n");
+	fprintf(stderr, "[-S socket_path]: Trigger an event when \"trigger\" is received on this UNIX socket\n");
+	fprintf(stderr, "[-F raw_file]: Replay a RAW capture (-t 5) instead of opening a device,\n");
+	fprintf(stderr, " -a gives its sample rate by value and -p 1 is required for packed captures\n");
+	fprintf(stderr, "[-R]: Replay at the capture sample rate instead of maximum speed\n");
+	fprintf(stderr, "[-H shm_name]: Also publish the samples in this shared memory ring (e.g. /hydrasdr0)\n");
+	fprintf(stderr, " for hydrasdr_shm_reader and other local readers, not available on Windows\n");
 	fprintf(stderr, "[-s serial_number_64bits]: Open device with specified 64bits serial number\n");
 	fprintf(stderr, "[-p packing]: Set packing for samples, \n");
-	fprintf(stderr, " 1=enabled(12bits packed), 0=disabled(default 16bits not packed)\n");
+	fprintf(stderr, " 1=enabled(12bits packed), 0=disabled(default 16bits not packed),\n");
+	fprintf(stderr, " 2=disabled with buffer headers (exact drop positions, buffers without one are plain samples)\n");
 	fprintf(stderr, "[-f frequency_MHz]: Set frequency in MHz between [%s, %s] (default %sMHz)\n",
 		u64toa((FREQ_HZ_MIN / FREQ_ONE_MHZ), &ascii_u64_data1),
 		u64toa((FREQ_HZ_MAX / FREQ_ONE_MHZ), &ascii_u64_data2),
 		u64toa((DEFAULT_FREQ_HZ / FREQ_ONE_MHZ), &ascii_u64_data3));
 	fprintf(stderr, "[-a sample_rate]: Set sample rate\n");
 	fprintf(stderr, "[-t sample_type]: Set sample type, \n");
-	fprintf(stderr, " 0=FLOAT32_IQ, 1=FLOAT32_REAL, 2=INT16_IQ(default), 3=INT16_REAL, 4=U16_REAL, 5=RAW\n");
+	fprintf(stderr, " 0=FLOAT32_IQ, 1=FLOAT32_REAL, 2=INT16_IQ(default), 3=INT16_REAL, 4=U16_REAL, 5=RAW,\n");
+	fprintf(stderr, " 6=INT8_IQ, 7=PACKED12_IQ(2*12bits in 3 bytes), 8=FLOAT16_IQ\n");
+	fprintf(stderr, "[-e dithering]: Set TPDF dithering for INT8_IQ/PACKED12_IQ, 1=enabled, 0=disabled(default)\n");
 	fprintf(stderr, "[-b biast]: Set Bias Tee, 1=enabled, 0=disabled(default)\n");
+	fprintf(stderr, "[-o rf_port]: Set RF port, 0-%d (default unchanged)\n", RF_PORT_MAX);
 	fprintf(stderr, "[-v vga_gain]: Set VGA/IF gain, 0-%d (default %d)\n", VGA_GAIN_MAX, vga_gain);
 	fprintf(stderr, "[-m mixer_gain]: Set Mixer gain, 0-%d (default %d)\n", MIXER_GAIN_MAX, mixer_gain);
 	fprintf(stderr, "[-l lna_gain]: Set LNA gain, 0-%d (default %d)\n", LNA_GAIN_MAX, lna_gain);
@@ -514,6 +735,15 @@ void sigint_callback_handler(int signum)
 	fprintf(stderr, "Caught signal %d\n", signum);
 	do_exit = true;
 }
+
+void sigusr1_callback_handler(int signum)
+{
+	(void) signum;
+	if (ring != NULL)
+	{
+		ring_capture_trigger(ring);
+	}
+}
 #endif
 
 #define PATH_FILE_MAX_LEN (FILENAME_MAX)
@@ -526,13 +756,25 @@ int main(int argc, char** argv)
 	char date_time[DATE_TIME_MAX_LEN];
 	char sample_type_str[16];
 	char channels_str[8];
+	char sigmf_data_file[PATH_FILE_MAX_LEN];
+	char sigmf_meta_file[PATH_FILE_MAX_LEN];
+	char sigmf_str[64];
+	const char* sigmf_type;
+	size_t path_len;
 	const char* path = NULL;
 	int result;
 	time_t rawtime;
 	struct tm * timeinfo;
 	struct timeval t_end;
 	float time_diff;
-	uint32_t file_pos;
+	uint64_t file_pos;
+	uint64_t size_hint;
+	uint32_t bits_per_sample;
+	uint64_t segment_bytes;
+	uint32_t writer_flags;
+	uint64_t ring_pre_bytes;
+	uint64_t ring_post_bytes;
+	FILE* fd;
 	int exit_code = EXIT_SUCCESS;
 
 	uint32_t count;
@@ -548,7 +790,7 @@ int main(int argc, char** argv)
 	strcpy(sample_type_str, "int16");
 	strcpy(channels_str, "IQ");
 
-	while( (opt = getopt(argc, argv, "r:ws:p:f:a:t:b:v:m:l:g:h:n:d")) != EOF )
+	while( (opt = getopt(argc, argv, "r:wWMDYz:Z:B:A:T:S:F:RH:s:p:f:a:t:e:b:o:v:m:l:g:h:n:d")) != EOF )
 	{
 		result = HYDRASDR_SUCCESS;
 		switch( opt ) 
@@ -562,6 +804,67 @@ int main(int argc, char** argv)
 				receive_wav = true;
 			 break;
 
+			case 'W':
+				receive_wav = true;
+				wav_rf64 = true;
+			 break;
+
+			case 'M':
+				sigmf_mode = true;
+			 break;
+
+			case 'D':
+				direct_io = true;
+			 break;
+
+			case 'Y':
+				compress = true;
+			 break;
+
+			case 'z':
+				segment_seconds = strtod(optarg, NULL);
+				if( segment_seconds <= 0.0 ) {
+					result = HYDRASDR_ERROR_INVALID_PARAM;
+				}
+			break;
+
+			case 'Z':
+				result = parse_u32(optarg, &segment_mib);
+				if( segment_mib == 0 ) {
+					result = HYDRASDR_ERROR_INVALID_PARAM;
+				}
+			break;
+
+			case 'B':
+				ring_mode = true;
+				ring_pre_seconds = strtod(optarg, NULL);
+			break;
+
+			case 'A':
+				ring_post_seconds = strtod(optarg, NULL);
+			break;
+
+			case 'T':
+				power_trigger = true;
+				power_threshold_dbfs = (float) strtod(optarg, NULL);
+			break;
+
+			case 'S':
+				control_socket_path = optarg;
+			break;
+
+			case 'F':
+				replay_path = optarg;
+			break;
+
+			case 'R':
+				replay_realtime = true;
+			break;
+
+			case 'H':
+				shm_name = optarg;
+			break;
+
 			case 's':
 				serial_number = true;
 				result = parse_u64(optarg, &serial_number_val);
@@ -571,8 +874,9 @@ int main(int argc, char** argv)
 				result = parse_u32(optarg, &packing_val_u32);
 				switch (packing_val_u32)
 				{
-					case 0:
-					case 1:
+					case PACKING_OFF:
+					case PACKING_ON:
+					case PACKING_OFF_HEADER:
 						packing_val = packing_val_u32;
 						call_set_packing = true;
 					break;
@@ -605,7 +909,6 @@ int main(int argc, char** argv)
 						wav_format_tag = 3; /* Float32 */
 						wav_nb_channels = 2;
 						wav_nb_bits_per_sample = 32;
-						wav_nb_byte_per_sample = (wav_nb_bits_per_sample / 8);
 						strcpy(sample_type_str, "float32");
 						strcpy(channels_str, "IQ");
 					break;
@@ -615,7 +918,6 @@ int main(int argc, char** argv)
 						wav_format_tag = 3; /* Float32 */
 						wav_nb_channels = 1;
 						wav_nb_bits_per_sample = 32;
-						wav_nb_byte_per_sample = (wav_nb_bits_per_sample / 8);
 						strcpy(sample_type_str, "float32");
 						strcpy(channels_str, "REAL");
 					break;
@@ -625,7 +927,6 @@ int main(int argc, char** argv)
 						wav_format_tag = 1; /* PCM8 or PCM16 */
 						wav_nb_channels = 2;
 						wav_nb_bits_per_sample = 16;
-						wav_nb_byte_per_sample = (wav_nb_bits_per_sample / 8);
 						strcpy(sample_type_str, "int16");
 						strcpy(channels_str, "IQ");
 					break;
@@ -635,7 +936,6 @@ int main(int argc, char** argv)
 						wav_format_tag = 1; /* PCM8 or PCM16 */
 						wav_nb_channels = 1;
 						wav_nb_bits_per_sample = 16;
-						wav_nb_byte_per_sample = (wav_nb_bits_per_sample / 8);
 						strcpy(sample_type_str, "int16");
 						strcpy(channels_str, "REAL");
 					break;
@@ -645,7 +945,6 @@ int main(int argc, char** argv)
 						wav_format_tag = 1; /* PCM8 or PCM16 */
 						wav_nb_channels = 1;
 						wav_nb_bits_per_sample = 16;
-						wav_nb_byte_per_sample = (wav_nb_bits_per_sample / 8);
 						strcpy(sample_type_str, "uint16");
 						strcpy(channels_str, "REAL");
 					break;
@@ -658,6 +957,30 @@ int main(int argc, char** argv)
 						strcpy(channels_str, "RAW");
 						break;
 
+					case 6:
+						sample_type_val = HYDRASDR_SAMPLE_INT8_IQ;
+						wav_nb_bits_per_sample = 8;
+						wav_nb_channels = 2;
+						strcpy(sample_type_str, "int8");
+						strcpy(channels_str, "IQ");
+						break;
+
+					case 7:
+						sample_type_val = HYDRASDR_SAMPLE_PACKED12_IQ;
+						wav_nb_bits_per_sample = 12;
+						wav_nb_channels = 2;
+						strcpy(sample_type_str, "packed12");
+						strcpy(channels_str, "IQ");
+						break;
+
+					case 8:
+						sample_type_val = HYDRASDR_SAMPLE_FLOAT16_IQ;
+						wav_nb_bits_per_sample = 16;
+						wav_nb_channels = 2;
+						strcpy(sample_type_str, "float16");
+						strcpy(channels_str, "IQ");
+						break;
+
 					default:
 						/* Invalid value will display error */
 						sample_type_val = SAMPLE_TYPE_MAX+1;
@@ -665,11 +988,20 @@ int main(int argc, char** argv)
 				}
 			break;
 
+			case 'e':
+				result = parse_u32(optarg, &dithering_val);
+			break;
+
 			case 'b':
 				serial_number = true;
 				result = parse_u32(optarg, &biast_val);
 			break;
 
+			case 'o':
+				rf_port = true;
+				result = parse_u32(optarg, &rf_port_val);
+			break;
+
 			case 'v':
 				result = parse_u32(optarg, &vga_gain);
 			break;
@@ -720,6 +1052,13 @@ int main(int argc, char** argv)
 	}
 
 	bytes_to_xfer = samples_to_xfer * wav_nb_bits_per_sample * wav_nb_channels / 8;
+	if( receive_wav && limit_num_samples && bytes_to_xfer + wav_header_size - 8 > WAV_SIZE_MAX_U32 ) {
+		/* Too large for the 32bits sizes of the plain header */
+		wav_rf64 = true;
+	}
+	if( wav_rf64 ) {
+		wav_header_size = sizeof(t_wav_file_hdr);
+	}
 
 	if (samples_to_xfer >= SAMPLES_TO_XFER_MAX_U64) {
 		fprintf(stderr, "argument error: num_samples must be less than %s/%sMio\n",
@@ -755,6 +1094,14 @@ int main(int argc, char** argv)
 			return EXIT_FAILURE;
 		}
 
+		if (sample_type_val == HYDRASDR_SAMPLE_INT8_IQ || sample_type_val == HYDRASDR_SAMPLE_PACKED12_IQ ||
+			sample_type_val == HYDRASDR_SAMPLE_FLOAT16_IQ)
+		{
+			fprintf(stderr, "The INT8_IQ, PACKED12_IQ and FLOAT16_IQ sampling modes are not compatible with Wave files\n");
+			usage();
+			return EXIT_FAILURE;
+		}
+
 		time (&rawtime);
 		timeinfo = localtime (&rawtime);
 		receiver_mode = RECEIVER_MODE_RX;
@@ -766,12 +1113,85 @@ int main(int argc, char** argv)
 		fprintf(stderr, "Receive wav file: %s\n", path);
 	}
 
+	if( ring_mode ) 
+	{
+		if( (path == NULL) || receive_wav || !strcmp(path, "-") ) {
+			fprintf(stderr, "error: pre-trigger capture (-B) needs -r <filename> (not -w or stdout)\n");
+			usage();
+			return EXIT_FAILURE;
+		}
+		if( (ring_pre_seconds <= 0.0) || (ring_post_seconds < 0.0) ) {
+			fprintf(stderr, "argument error: -B/-A seconds out of range\n");
+			usage();
+			return EXIT_FAILURE;
+		}
+	} else if( power_trigger || (control_socket_path != NULL) ) {
+		fprintf(stderr, "argument error: -T and -S need the pre-trigger capture mode (-B)\n");
+		usage();
+		return EXIT_FAILURE;
+	}
+
 	if( path == NULL ) {
 		fprintf(stderr, "error: you shall specify at least -r <with filename> or -w option\n");
 		usage();
 		return EXIT_FAILURE;
 	}
 
+	if( (segment_seconds > 0.0) || (segment_mib > 0) )
+	{
+		if( receive_wav || sigmf_mode || ring_mode || !strcmp(path, "-") ) {
+			fprintf(stderr, "error: segmented recording (-z/-Z) needs -r <filename> (not -w, -M, -B or stdout)\n");
+			usage();
+			return EXIT_FAILURE;
+		}
+		if( (segment_seconds > 0.0) && (segment_mib > 0) ) {
+			fprintf(stderr, "argument error: -z and -Z are both set (choose only one option)\n");
+			usage();
+			return EXIT_FAILURE;
+		}
+	}
+
+	if( compress )
+	{
+		if( receive_wav || sigmf_mode || ring_mode ) {
+			fprintf(stderr, "error: compressed recording (-Y) is not compatible with -w, -M or -B\n");
+			usage();
+			return EXIT_FAILURE;
+		}
+		if( !(sample_type_val == HYDRASDR_SAMPLE_INT16_IQ || sample_type_val == HYDRASDR_SAMPLE_INT16_REAL ||
+			sample_type_val == HYDRASDR_SAMPLE_UINT16_REAL || (sample_type_val == HYDRASDR_SAMPLE_RAW && packing_val != PACKING_ON)) ) {
+			fprintf(stderr, "error: compressed recording (-Y) needs 16bits samples (-t 2, 3, 4 or 5 without packing)\n");
+			usage();
+			return EXIT_FAILURE;
+		}
+	}
+
+	if( sigmf_mode )
+	{
+		if( receive_wav || ring_mode || !strcmp(path, "-") ) {
+			fprintf(stderr, "error: SigMF recording (-M) needs -r <filename> (not -w, -B or stdout)\n");
+			usage();
+			return EXIT_FAILURE;
+		}
+		if( sigmf_datatype(sample_type_val) == NULL ) {
+			fprintf(stderr, "error: the %s sample type has no SigMF datatype\n", sample_type_str);
+			usage();
+			return EXIT_FAILURE;
+		}
+
+		/* Accept the base name or either file of the recording */
+		path_len = strlen(path);
+		if( (path_len > strlen(SIGMF_DATA_EXT)) &&
+			(!strcmp(path + path_len - strlen(SIGMF_DATA_EXT), SIGMF_DATA_EXT) ||
+			 !strcmp(path + path_len - strlen(SIGMF_META_EXT), SIGMF_META_EXT)) )
+		{
+			path_len -= strlen(SIGMF_DATA_EXT);
+		}
+		snprintf(sigmf_data_file, PATH_FILE_MAX_LEN, "%.*s%s", (int) path_len, path, SIGMF_DATA_EXT);
+		snprintf(sigmf_meta_file, PATH_FILE_MAX_LEN, "%.*s%s", (int) path_len, path, SIGMF_META_EXT);
+		path = sigmf_data_file;
+	}
+
 	if(packing_val == PACKING_MAX) {
 		fprintf(stderr, "argument error: packing out of range\n");
 		usage();
@@ -784,12 +1204,24 @@ int main(int argc, char** argv)
 		return EXIT_FAILURE;
 	}
 
+	if(dithering_val > DITHERING_MAX) {
+		fprintf(stderr, "argument error: dithering out of range\n");
+		usage();
+		return EXIT_FAILURE;
+	}
+
 	if(biast_val > BIAST_MAX) {
 		fprintf(stderr, "argument error: biast_val out of range\n");
 		usage();
 		return EXIT_FAILURE;
 	}
 
+	if( rf_port && (rf_port_val > RF_PORT_MAX) ) {
+		fprintf(stderr, "argument error: rf_port out of range\n");
+		usage();
+		return EXIT_FAILURE;
+	}
+
 	if(vga_gain > VGA_GAIN_MAX) {
 		fprintf(stderr, "argument error: vga_gain out of range\n");
 		usage();
@@ -820,6 +1252,22 @@ int main(int argc, char** argv)
 		return EXIT_FAILURE;
 	}
 
+	if( replay_path != NULL )
+	{
+		if( serial_number )
+		{
+			fprintf(stderr, "argument error: -F and -s are both set (choose only one option)\n");
+			usage();
+			return EXIT_FAILURE;
+		}
+		if( !sample_rate || sample_rate_val < MIN_SAMPLERATE_BY_VALUE )
+		{
+			fprintf(stderr, "argument error: -F needs the sample rate of the capture by value (-a)\n");
+			usage();
+			return EXIT_FAILURE;
+		}
+	}
+
 	if( (linearity_gain == true) && (sensitivity_gain == true) )
 	{
 		fprintf(stderr, "argument error: linearity_gain and sensitivity_gain are both set (choose only one option)\n");
@@ -842,7 +1290,10 @@ int main(int argc, char** argv)
 			u64toa((freq_hz/FREQ_ONE_MHZ), &ascii_u64_data1),
 			u64toa(freq_hz, &ascii_u64_data2) );
 		fprintf(stderr, "sample_type -t %d\n", sample_type_val);
+		fprintf(stderr, "dithering -e %u\n", dithering_val);
 		fprintf(stderr, "biast -b %d\n", biast_val);
+		if(rf_port)
+			fprintf(stderr, "rf_port -o %u\n", rf_port_val);
 
 		if( (linearity_gain == false) && (sensitivity_gain == false) )
 		{
@@ -869,7 +1320,17 @@ int main(int argc, char** argv)
 		}
 	}
 
-	if(serial_number == true)
+	if(replay_path != NULL)
+	{
+		/* -a is the real sample rate for real sample types, the replay device takes the IQ rate */
+		result = hydrasdr_open_file(&device, replay_path,
+			wav_nb_channels == 2 ? sample_rate_val : sample_rate_val / 2,
+			replay_realtime ? HYDRASDR_REPLAY_REALTIME : 0);
+		if( result != HYDRASDR_SUCCESS ) {
+			fprintf(stderr, "hydrasdr_open_file() failed: %s (%d)\n", hydrasdr_error_name(result), result);
+			return EXIT_FAILURE;
+		}
+	}else if(serial_number == true)
 	{
 		result = hydrasdr_open_sn(&device, serial_number_val);
 		if( result != HYDRASDR_SUCCESS ) {
@@ -892,6 +1353,13 @@ int main(int argc, char** argv)
 		return EXIT_FAILURE;
 	}
 
+	result = hydrasdr_set_dithering(device, (uint8_t) dithering_val);
+	if (result != HYDRASDR_SUCCESS) {
+		fprintf(stderr, "hydrasdr_set_dithering() failed: %s (%d)\n", hydrasdr_error_name(result), result);
+		hydrasdr_close(device);
+		return EXIT_FAILURE;
+	}
+
 	hydrasdr_get_samplerates(device, &count, 0);
 
 	supported_samplerates = (uint32_t *) malloc(count * sizeof(uint32_t));
@@ -958,27 +1426,150 @@ int main(int argc, char** argv)
 		return EXIT_FAILURE;
 	}
 
-	if (!strcmp(path,"-"))
-		fd = stdout;
-	else
-		fd = fopen(path, "wb");
-	if( fd == NULL ) {
-		fprintf(stderr, "Failed to open file: %s\n", path);
-		hydrasdr_close(device);
-		return EXIT_FAILURE;
+	if( rf_port )
+	{
+		result = hydrasdr_set_rf_port(device, (hydrasdr_rf_port_t) rf_port_val);
+		if( result != HYDRASDR_SUCCESS ) {
+			fprintf(stderr, "hydrasdr_set_rf_port() failed: %s (%d)\n", hydrasdr_error_name(result), result);
+			hydrasdr_close(device);
+			return EXIT_FAILURE;
+		}
 	}
-	/* Change fd buffer to have bigger one to store data to file */
-	result = setvbuf(fd , NULL , _IOFBF , FD_BUFFER_SIZE);
-	if( result != 0 ) {
-		fprintf(stderr, "setvbuf() failed: %d\n", result);
-		hydrasdr_close(device);
-		return EXIT_FAILURE;
+
+	if( shm_name != NULL )
+	{
+		result = hydrasdr_set_shm_publisher(device, shm_name, 0);
+		if( result != HYDRASDR_SUCCESS ) {
+			fprintf(stderr, "hydrasdr_set_shm_publisher() failed: %s (%d)\n", hydrasdr_error_name(result), result);
+			hydrasdr_close(device);
+			return EXIT_FAILURE;
+		}
 	}
-	
-	/* Write Wav header */
-	if( receive_wav ) 
+
+	sigmf_bytes_per_sample = wav_nb_channels * wav_nb_bits_per_sample / 8;
+	if( sigmf_mode )
 	{
-		fwrite(&wave_file_hdr, 1, sizeof(t_wav_file_hdr), fd);
+		sigmf_type = sigmf_datatype(sample_type_val);
+		sigmf_meta = sigmf_meta_create(sigmf_type, (double) wav_sample_per_sec, freq_hz);
+		if( sigmf_meta == NULL ) {
+			fprintf(stderr, "Failed to allocate SigMF metadata\n");
+			hydrasdr_close(device);
+			return EXIT_FAILURE;
+		}
+		snprintf(sigmf_str, sizeof(sigmf_str), "HydraSDR RFOne 0x%08X%08X",
+			read_partid_serialno.serial_no[2], read_partid_serialno.serial_no[3]);
+		sigmf_meta_set_string(sigmf_meta, "core:hw", sigmf_str);
+		snprintf(sigmf_str, sizeof(sigmf_str), "hydrasdr_rx v%s", HYDRASDR_RX_VERSION);
+		sigmf_meta_set_string(sigmf_meta, "core:recorder", sigmf_str);
+		snprintf(sigmf_str, sizeof(sigmf_str), "0x%08X%08X",
+			read_partid_serialno.serial_no[2], read_partid_serialno.serial_no[3]);
+		sigmf_meta_set_string(sigmf_meta, "hydrasdr:serial", sigmf_str);
+		if( linearity_gain )
+		{
+			sigmf_meta_set_uint(sigmf_meta, "hydrasdr:linearity_gain", linearity_gain_val);
+		}
+		else if( sensitivity_gain )
+		{
+			sigmf_meta_set_uint(sigmf_meta, "hydrasdr:sensitivity_gain", sensitivity_gain_val);
+		}
+		else
+		{
+			sigmf_meta_set_uint(sigmf_meta, "hydrasdr:lna_gain", lna_gain);
+			sigmf_meta_set_uint(sigmf_meta, "hydrasdr:mixer_gain", mixer_gain);
+			sigmf_meta_set_uint(sigmf_meta, "hydrasdr:vga_gain", vga_gain);
+		}
+		if( rf_port )
+		{
+			sigmf_meta_set_uint(sigmf_meta, "hydrasdr:rf_port", rf_port_val);
+		}
+		sigmf_meta_set_uint(sigmf_meta, "hydrasdr:bias_tee", biast_val);
+		sigmf_meta_set_uint(sigmf_meta, "hydrasdr:packing", packing_val);
+
+		/* Written now so the recording is described even if the process dies, rewritten on close */
+		if( sigmf_meta_write(sigmf_meta, sigmf_meta_file) != 0 ) {
+			fprintf(stderr, "Failed to write file: %s\n", sigmf_meta_file);
+			sigmf_meta_free(sigmf_meta);
+			sigmf_meta = NULL;
+			hydrasdr_close(device);
+			return EXIT_FAILURE;
+		}
+		fprintf(stderr, "Receive SigMF recording: %s (%s)\n", path, sigmf_type);
+	}
+
+	bits_per_sample = wav_nb_channels *
+		((sample_type_val == HYDRASDR_SAMPLE_RAW && packing_val != PACKING_ON) ? 16 : wav_nb_bits_per_sample);
+
+	if( ring_mode )
+	{
+		/* Rounded to pairs of samples so packed RAW (1.5 bytes per sample) stays on a byte boundary */
+		ring_pre_bytes = (uint64_t) (ring_pre_seconds * wav_sample_per_sec / 2) * 2 * bits_per_sample / 8;
+		ring_post_bytes = (uint64_t) (ring_post_seconds * wav_sample_per_sec / 2) * 2 * bits_per_sample / 8;
+
+		ring = ring_capture_open(path, ring_pre_bytes, ring_post_bytes);
+		if( ring == NULL ) {
+			fprintf(stderr, "Failed to create the pre-trigger ring: %s.ring\n", path);
+			hydrasdr_close(device);
+			return EXIT_FAILURE;
+		}
+		if( (control_socket_path != NULL) && (ring_capture_listen(ring, control_socket_path) != 0) ) {
+			fprintf(stderr, "Failed to listen on control socket: %s\n", control_socket_path);
+			ring_capture_close(ring);
+			hydrasdr_close(device);
+			return EXIT_FAILURE;
+		}
+		fprintf(stderr, "Pre-trigger capture: %.1fs before, %.1fs after each trigger\n", ring_pre_seconds, ring_post_seconds);
+	}
+	else
+	{
+		/* Data goes through a writer thread so disk latency does not stall the sample callback */
+		size_hint = 0;
+		if (limit_num_samples)
+		{
+			size_hint = bytes_to_xfer + (receive_wav ? wav_header_size : 0);
+		}
+		segment_bytes = 0;
+		if( segment_seconds > 0.0 )
+		{
+			/* Counted in samples rather than wall clock time so the files are gapless and of equal length */
+			segment_bytes = (uint64_t) (segment_seconds * wav_sample_per_sec) * bits_per_sample / 8;
+		}
+		else if( segment_mib > 0 )
+		{
+			segment_bytes = (uint64_t) segment_mib * 1024 * 1024;
+		}
+
+		writer_flags = direct_io ? FILE_WRITER_DIRECT : 0;
+		if( compress )
+		{
+			writer_flags |= (wav_nb_channels == 2) ? FILE_WRITER_COMPRESS_IQ : FILE_WRITER_COMPRESS_REAL;
+		}
+
+		if( segment_bytes > 0 )
+		{
+			writer = file_writer_open_segmented(path, writer_flags, segment_bytes, bits_per_sample);
+			fprintf(stderr, "Segmented recording: a new file every %s bytes\n", u64toa(segment_bytes, &ascii_u64_data1));
+		}
+		else
+		{
+			writer = file_writer_open(path, writer_flags, size_hint);
+		}
+		if( writer == NULL ) {
+			fprintf(stderr, "Failed to open file: %s\n", path);
+			if( sigmf_meta != NULL ) {
+				sigmf_meta_free(sigmf_meta);
+				sigmf_meta = NULL;
+			}
+			hydrasdr_close(device);
+			return EXIT_FAILURE;
+		}
+
+		/* Write Wav header */
+		if( receive_wav ) 
+		{
+			/* Valid empty file until the sizes are rewritten on exit */
+			wav_header_update(wav_header_size);
+			file_writer_write(writer, wav_header, wav_header_size);
+		}
 	}
 	
 #ifdef _MSC_VER
@@ -990,6 +1581,9 @@ int main(int argc, char** argv)
 	signal(SIGSEGV, &sigint_callback_handler);
 	signal(SIGTERM, &sigint_callback_handler);
 	signal(SIGABRT, &sigint_callback_handler);
+#ifdef SIGUSR1
+	signal(SIGUSR1, &sigusr1_callback_handler);
+#endif
 #endif
 
 	if( (linearity_gain == false) && (sensitivity_gain == false) )
@@ -1090,29 +1684,55 @@ int main(int argc, char** argv)
 		}
 	}
 		
-	if(fd != NULL)
+	if(ring != NULL)
 	{
-		if( receive_wav ) 
+		fprintf(stderr, "Pre-trigger capture: %u event(s) saved\n", ring_capture_events(ring));
+		ring_capture_close(ring);
+		ring = NULL;
+	}
+
+	if(writer != NULL)
+	{
+		/* Get size of file */
+		file_pos = file_writer_tell(writer);
+		if (file_writer_stalls(writer) > 0)
+		{
+			fprintf(stderr, "Warning: disk was too slow %u times, samples may have been dropped\n", file_writer_stalls(writer));
+		}
+		if (file_writer_close(writer) != 0)
+		{
+			fprintf(stderr, "Failed to write file: %s\n", path);
+			exit_code = EXIT_FAILURE;
+		}
+		writer = NULL;
+
+		fd = receive_wav ? fopen(path, "r+b") : NULL;
+		if( fd != NULL ) 
+		{
+			/* Overwrite header with the final sizes (also reached after SIGINT) */
+			wav_header_update(file_pos);
+			if( (fwrite(wav_header, 1, wav_header_size, fd) != wav_header_size) || (fclose(fd) != 0) )
+			{
+				fprintf(stderr, "Failed to update WAV header: %s\n", path);
+				exit_code = EXIT_FAILURE;
+			}
+			else if( file_pos - 8 > WAV_SIZE_MAX_U32 )
+			{
+				fprintf(stderr, wav_rf64 ? "Capture larger than 4GB written as RF64\n" :
+					"Capture larger than 4GB, its WAV sizes are saturated (use -W for RF64)\n");
+			}
+		}
+	}
+
+	if(sigmf_meta != NULL)
+	{
+		if (sigmf_meta_write(sigmf_meta, sigmf_meta_file) != 0)
 		{
-			/* Get size of file */
-			file_pos = ftell(fd);
-			/* Wav Header */
-			wave_file_hdr.hdr.size = file_pos - 8;
-			/* Wav Format Chunk */
-			wave_file_hdr.fmt_chunk.wFormatTag = wav_format_tag;
-			wave_file_hdr.fmt_chunk.wChannels = wav_nb_channels;
-			wave_file_hdr.fmt_chunk.dwSamplesPerSec = wav_sample_per_sec;
-			wave_file_hdr.fmt_chunk.dwAvgBytesPerSec = wave_file_hdr.fmt_chunk.dwSamplesPerSec * wav_nb_byte_per_sample;
-			wave_file_hdr.fmt_chunk.wBlockAlign = wav_nb_channels * (wav_nb_bits_per_sample / 8);
-			wave_file_hdr.fmt_chunk.wBitsPerSample = wav_nb_bits_per_sample;
-			/* Wav Data Chunk */
-			wave_file_hdr.data_chunk.chunkSize = file_pos - sizeof(t_wav_file_hdr);
-			/* Overwrite header with updated data */
-			rewind(fd);
-			fwrite(&wave_file_hdr, 1, sizeof(t_wav_file_hdr), fd);
-		}	
-		fclose(fd);
-		fd = NULL;
+			fprintf(stderr, "Failed to write file: %s\n", sigmf_meta_file);
+			exit_code = EXIT_FAILURE;
+		}
+		sigmf_meta_free(sigmf_meta);
+		sigmf_meta = NULL;
 	}
 	fprintf(stderr, "done\n");
 	return exit_code;
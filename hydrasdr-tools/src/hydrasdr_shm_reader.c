@@ -0,0 +1,174 @@
+/*
+ * Copyright 2025 Benjamin Vernoux <bvernoux@hydrasdr.com>
+ *
+ * This file is part of HydraSDR.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include <hydrasdr.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <getopt.h>
+#include <unistd.h>
+
+#define HYDRASDR_SHM_READER_VERSION "1.0.0"
+
+#define DEFAULT_SECONDS (5.0)
+#define READ_TIMEOUT_MS (1000)
+
+static void usage(void)
+{
+	fprintf(stderr, "hydrasdr_shm_reader v%s\n", HYDRASDR_SHM_READER_VERSION);
+	fprintf(stderr, "Reads the samples published by hydrasdr_rx -H, checks the sequence and optionally saves them.\n");
+	fprintf(stderr, "Usage:\n");
+	fprintf(stderr, "-H shm_name: Shared memory ring to read (e.g. /hydrasdr0)\n");
+	fprintf(stderr, "[-r <filename>]: Save the samples into file\n");
+	fprintf(stderr, "[-n seconds]: Read duration (default %.0f), 0 reads until the publisher stops\n", DEFAULT_SECONDS);
+	fprintf(stderr, "[-w delay_ms]: Wait after each buffer to emulate a slow reader\n");
+}
+
+static double wall_clock(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (double) ts.tv_sec + (double) ts.tv_nsec * 1e-9;
+}
+
+int main(int argc, char** argv)
+{
+	int opt;
+	const char* name = NULL;
+	const char* path = NULL;
+	double seconds = DEFAULT_SECONDS;
+	long delay_ms = 0;
+	struct hydrasdr_shm_reader* reader;
+	hydrasdr_shm_buffer_t buffer;
+	uint64_t buffers = 0, samples = 0, bytes = 0, lost = 0, overruns = 0, dropped = 0, gaps = 0;
+	uint64_t next_sequence = 0;
+	FILE* out = NULL;
+	double start, elapsed;
+	int result;
+	int status = EXIT_SUCCESS;
+
+	while( (opt = getopt(argc, argv, "H:r:n:w:")) != EOF )
+	{
+		switch( opt )
+		{
+			case 'H':
+				name = optarg;
+			break;
+
+			case 'r':
+				path = optarg;
+			break;
+
+			case 'n':
+				seconds = strtod(optarg, NULL);
+			break;
+
+			case 'w':
+				delay_ms = strtol(optarg, NULL, 10);
+			break;
+
+			default:
+				usage();
+				return EXIT_FAILURE;
+		}
+	}
+
+	if( name == NULL ) {
+		fprintf(stderr, "argument error: -H shm_name is required\n");
+		usage();
+		return EXIT_FAILURE;
+	}
+
+	result = hydrasdr_shm_open(&reader, name);
+	if( result != HYDRASDR_SUCCESS ) {
+		fprintf(stderr, "hydrasdr_shm_open() failed: %s (%d)\n", hydrasdr_error_name(result), result);
+		return EXIT_FAILURE;
+	}
+
+	if( path != NULL ) {
+		out = fopen(path, "wb");
+		if( out == NULL ) {
+			fprintf(stderr, "Failed to open file: %s\n", path);
+			hydrasdr_shm_close(reader);
+			return EXIT_FAILURE;
+		}
+	}
+
+	start = wall_clock();
+	while( seconds <= 0 || (wall_clock() - start) < seconds )
+	{
+		result = hydrasdr_shm_read(reader, &buffer, READ_TIMEOUT_MS);
+		if( result == HYDRASDR_ERROR_TIMEOUT ) {
+			continue;
+		}
+		if( result != HYDRASDR_SUCCESS ) {
+			break;
+		}
+
+		lost += buffer.lost_buffers;
+		/* Every buffer is either received or reported lost */
+		if( buffers > 0 && buffer.sequence != next_sequence + buffer.lost_buffers ) {
+			gaps++;
+		}
+		next_sequence = buffer.sequence + 1;
+
+		if( out != NULL && fwrite(buffer.samples, 1, buffer.bytes, out) != buffer.bytes ) {
+			fprintf(stderr, "Failed to write file: %s\n", path);
+			status = EXIT_FAILURE;
+			hydrasdr_shm_release(reader);
+			break;
+		}
+
+		if( hydrasdr_shm_release(reader) != HYDRASDR_SUCCESS ) {
+			/* The samples used (and saved) were being overwritten */
+			overruns++;
+		}
+		buffers++;
+		samples += (uint64_t) buffer.sample_count;
+		bytes += buffer.bytes;
+		dropped += buffer.dropped_samples;
+
+		if( delay_ms > 0 ) {
+			usleep((useconds_t) delay_ms * 1000);
+		}
+	}
+	elapsed = wall_clock() - start;
+
+	fprintf(stderr, "%llu buffers, %llu samples (%.3f MSPS) in %.2f s, %.1f MB/s\n",
+		(unsigned long long) buffers, (unsigned long long) samples, samples / elapsed / 1e6, elapsed,
+		bytes / elapsed / 1e6);
+	fprintf(stderr, "%llu buffers lost, %llu overwritten while read, %llu sequence errors, %llu samples dropped by the device\n",
+		(unsigned long long) lost, (unsigned long long) overruns, (unsigned long long) gaps, (unsigned long long) dropped);
+
+	hydrasdr_shm_close(reader);
+	if( out != NULL && fclose(out) != 0 ) {
+		fprintf(stderr, "Failed to write file: %s\n", path);
+		status = EXIT_FAILURE;
+	}
+
+	if( buffers == 0 || gaps != 0 ) {
+		status = EXIT_FAILURE;
+	}
+	return status;
+}
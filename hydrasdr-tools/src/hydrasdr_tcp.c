@@ -0,0 +1,838 @@
+/*
+ * Copyright 2025 Benjamin Vernoux <bvernoux@hydrasdr.com>
+ *
+ * This file is part of HydraSDR.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include <hydrasdr.h>
+#include "iq_codec.h"
+#include "tcp_protocol.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <errno.h>
+#include <getopt.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#define HYDRASDR_TCP_VERSION "1.0.0"
+
+#define DEFAULT_FREQ_HZ (900000000ull) /* 900MHz */
+#define DEFAULT_SAMPLERATE (0)         /* Index of the first sample rate of the device */
+#define DEFAULT_QUEUE_MIB (16)
+#define MIN_SAMPLERATE_BY_VALUE (1000000)
+#define MAX_CLIENTS (8)
+/* Data messages use at most QUEUE_DATA_SLOTS, the remaining slots are kept for format messages */
+#define QUEUE_SLOTS (256)
+#define QUEUE_DATA_SLOTS (QUEUE_SLOTS - 16)
+#define POLL_TIMEOUT_MS (200)
+
+/* Output bytes per sample, indexed by enum hydrasdr_sample_type */
+static const uint32_t sample_size[HYDRASDR_SAMPLE_END] = { 8, 4, 4, 2, 2, 2, 2, 3, 4 };
+
+/* Encoded once and shared by the queues of all clients, freed by the last one */
+typedef struct {
+	int refs;
+	uint32_t type;
+	uint64_t samples;
+	size_t size;      /* Header and payload */
+	uint8_t data[];
+} tcp_msg_t;
+
+typedef struct {
+	tcp_msg_t* msg;
+	uint64_t dropped; /* Samples lost before msg, sent first as a TCP_MSG_DROP */
+} tcp_queue_item_t;
+
+typedef struct {
+	int fd;
+	char name[64];
+	pthread_t thread;
+	pthread_cond_t cv;
+	int closed;
+	tcp_queue_item_t items[QUEUE_SLOTS];
+	uint32_t head;
+	uint32_t count;
+	size_t queued_bytes;
+	uint64_t pending_drop;
+	uint64_t dropped_total;
+	uint8_t cmd[TCP_CMD_SIZE];
+	uint32_t cmd_len;
+} tcp_client_t;
+
+/* Protects the client list, the queues and the message references */
+static pthread_mutex_t server_mp = PTHREAD_MUTEX_INITIALIZER;
+static tcp_client_t* clients[MAX_CLIENTS];
+static size_t queue_limit;
+
+static struct hydrasdr_device* device = NULL;
+static tcp_format_t format;
+static uint32_t samplerate_val = DEFAULT_SAMPLERATE;
+static int verbose = 0;
+
+static volatile sig_atomic_t do_exit = 0;
+
+static void usage(void)
+{
+	fprintf(stderr, "hydrasdr_tcp v%s\n", HYDRASDR_TCP_VERSION);
+	fprintf(stderr, "Usage:\n");
+	fprintf(stderr, "[-l address]: Listen address (default 127.0.0.1, 0.0.0.0 for all interfaces)\n");
+	fprintf(stderr, "[-P port]: Listen port (default %d)\n", TCP_DEFAULT_PORT);
+	fprintf(stderr, "[-s serial_number_64bits]: Open device with specified 64bits serial number\n");
+	fprintf(stderr, "[-F raw_file]: Serve a RAW capture (-t 5) in a loop at its sample rate instead of a device\n");
+	fprintf(stderr, "[-f frequency_MHz]: Set frequency in MHz (default %lluMHz)\n", DEFAULT_FREQ_HZ / 1000000ull);
+	fprintf(stderr, "[-a sample_rate]: Set sample rate (index or value, required by value with -F)\n");
+	fprintf(stderr, "[-t sample_type]: Set sample type, \n");
+	fprintf(stderr, " 0=FLOAT32_IQ, 1=FLOAT32_REAL, 2=INT16_IQ(default), 3=INT16_REAL, 4=U16_REAL,\n");
+	fprintf(stderr, " 6=INT8_IQ, 7=PACKED12_IQ(2*12bits in 3 bytes), 8=FLOAT16_IQ\n");
+	fprintf(stderr, "[-D decimation]: Decimate INT16_IQ, INT8_IQ and PACKED12_IQ by a power of 2 up to 256\n");
+	fprintf(stderr, "[-Y]: Compress losslessly (INT16_IQ, INT16_REAL, U16_REAL)\n");
+	fprintf(stderr, "[-g linearity_gain]: Set linearity simplified gain, 0-21\n");
+	fprintf(stderr, "[-q queue_MiB]: Send queue of each client, data is dropped for a client when full (default %d)\n",
+		DEFAULT_QUEUE_MIB);
+	fprintf(stderr, "[-d]: Verbose mode\n");
+}
+
+static void sigint_callback_handler(int signum)
+{
+	(void) signum;
+	do_exit = 1;
+}
+
+static int is_iq(uint32_t sample_type)
+{
+	return sample_type == HYDRASDR_SAMPLE_FLOAT32_IQ || sample_type == HYDRASDR_SAMPLE_INT16_IQ ||
+		sample_type == HYDRASDR_SAMPLE_INT8_IQ || sample_type == HYDRASDR_SAMPLE_PACKED12_IQ ||
+		sample_type == HYDRASDR_SAMPLE_FLOAT16_IQ;
+}
+
+static int can_decimate(uint32_t sample_type)
+{
+	return sample_type == HYDRASDR_SAMPLE_INT16_IQ || sample_type == HYDRASDR_SAMPLE_INT8_IQ ||
+		sample_type == HYDRASDR_SAMPLE_PACKED12_IQ;
+}
+
+static int can_compress(uint32_t sample_type)
+{
+	return sample_type == HYDRASDR_SAMPLE_INT16_IQ || sample_type == HYDRASDR_SAMPLE_INT16_REAL ||
+		sample_type == HYDRASDR_SAMPLE_UINT16_REAL;
+}
+
+static tcp_msg_t* msg_alloc(uint32_t type, size_t payload)
+{
+	tcp_msg_t* msg;
+
+	msg = (tcp_msg_t*) malloc(sizeof(tcp_msg_t) + TCP_MSG_HDR_SIZE + payload);
+	if (msg != NULL)
+	{
+		msg->refs = 0;
+		msg->type = type;
+		msg->samples = 0;
+		msg->size = TCP_MSG_HDR_SIZE + payload;
+		tcp_put_le32(msg->data, type);
+		tcp_put_le32(msg->data + 4, (uint32_t) payload);
+	}
+	return msg;
+}
+
+/* Shrinks the payload after encoding */
+static void msg_set_payload(tcp_msg_t* msg, size_t payload)
+{
+	msg->size = TCP_MSG_HDR_SIZE + payload;
+	tcp_put_le32(msg->data + 4, (uint32_t) payload);
+}
+
+/* server_mp held */
+static void msg_release(tcp_msg_t* msg)
+{
+	if (--msg->refs == 0)
+	{
+		free(msg);
+	}
+}
+
+/* server_mp held, data messages are dropped when the client queue is full */
+static void client_push(tcp_client_t* c, tcp_msg_t* msg)
+{
+	tcp_queue_item_t* item;
+
+	if (c->closed)
+	{
+		return;
+	}
+
+	if (msg->type == TCP_MSG_DATA &&
+		(c->count >= QUEUE_DATA_SLOTS || c->queued_bytes + msg->size > queue_limit))
+	{
+		c->pending_drop += msg->samples;
+		c->dropped_total += msg->samples;
+		return;
+	}
+
+	if (c->count == QUEUE_SLOTS)
+	{
+		/* Not even a format message fits, the client is not reading at all */
+		c->closed = 1;
+		pthread_cond_signal(&c->cv);
+		return;
+	}
+
+	item = &c->items[(c->head + c->count) % QUEUE_SLOTS];
+	item->msg = msg;
+	item->dropped = (msg->type == TCP_MSG_DATA) ? c->pending_drop : 0;
+	if (msg->type == TCP_MSG_DATA)
+	{
+		c->pending_drop = 0;
+	}
+	msg->refs++;
+	c->count++;
+	c->queued_bytes += msg->size;
+	pthread_cond_signal(&c->cv);
+}
+
+static tcp_msg_t* format_msg(void)
+{
+	tcp_msg_t* msg;
+
+	msg = msg_alloc(TCP_MSG_FORMAT, TCP_FORMAT_SIZE);
+	if (msg != NULL)
+	{
+		tcp_format_pack(&format, msg->data + TCP_MSG_HDR_SIZE);
+	}
+	return msg;
+}
+
+static void broadcast_format(void)
+{
+	tcp_msg_t* msg;
+	int i;
+
+	msg = format_msg();
+	if (msg == NULL)
+	{
+		return;
+	}
+
+	pthread_mutex_lock(&server_mp);
+	msg->refs++;
+	for (i = 0; i < MAX_CLIENTS; i++)
+	{
+		if (clients[i] != NULL)
+		{
+			client_push(clients[i], msg);
+		}
+	}
+	msg_release(msg);
+	pthread_mutex_unlock(&server_mp);
+}
+
+static int send_all(int fd, const uint8_t* data, size_t len)
+{
+	ssize_t n;
+
+	while (len > 0)
+	{
+		n = send(fd, data, len, 0);
+		if (n < 0 && errno == EINTR)
+		{
+			continue;
+		}
+		if (n <= 0)
+		{
+			return -1;
+		}
+		data += n;
+		len -= (size_t) n;
+	}
+	return 0;
+}
+
+/* Sender thread of a client, blocking on its socket never delays the sample callback */
+static void* client_threadproc(void* arg)
+{
+	tcp_client_t* c = (tcp_client_t*) arg;
+	tcp_queue_item_t item;
+	uint8_t drop[TCP_MSG_HDR_SIZE + TCP_DROP_SIZE];
+	int ok;
+
+	ok = (send_all(c->fd, (const uint8_t*) TCP_PROTOCOL_MAGIC, TCP_PROTOCOL_MAGIC_SIZE) == 0);
+
+	pthread_mutex_lock(&server_mp);
+	if (!ok)
+	{
+		c->closed = 1;
+	}
+	while (!c->closed)
+	{
+		while (c->count == 0 && !c->closed)
+		{
+			pthread_cond_wait(&c->cv, &server_mp);
+		}
+		if (c->closed)
+		{
+			break;
+		}
+
+		item = c->items[c->head];
+		c->head = (c->head + 1) % QUEUE_SLOTS;
+		c->count--;
+		pthread_mutex_unlock(&server_mp);
+
+		ok = 1;
+		if (item.dropped != 0)
+		{
+			tcp_put_le32(drop, TCP_MSG_DROP);
+			tcp_put_le32(drop + 4, TCP_DROP_SIZE);
+			tcp_put_le64(drop + TCP_MSG_HDR_SIZE, item.dropped);
+			ok = (send_all(c->fd, drop, sizeof(drop)) == 0);
+		}
+		if (ok)
+		{
+			ok = (send_all(c->fd, item.msg->data, item.msg->size) == 0);
+		}
+
+		pthread_mutex_lock(&server_mp);
+		c->queued_bytes -= item.msg->size;
+		msg_release(item.msg);
+		if (!ok)
+		{
+			c->closed = 1;
+		}
+	}
+	pthread_mutex_unlock(&server_mp);
+
+	/* Wakes up the poll loop which removes the client */
+	shutdown(c->fd, SHUT_RDWR);
+
+	return NULL;
+}
+
+static void client_add(int fd, const struct sockaddr_in* addr)
+{
+	tcp_client_t* c;
+	tcp_msg_t* msg;
+	int i;
+
+	for (i = 0; i < MAX_CLIENTS && clients[i] != NULL; i++)
+	{
+	}
+	c = (i < MAX_CLIENTS) ? (tcp_client_t*) calloc(1, sizeof(tcp_client_t)) : NULL;
+	msg = (c != NULL) ? format_msg() : NULL;
+	if (msg == NULL)
+	{
+		fprintf(stderr, "Connection refused, %d clients max\n", MAX_CLIENTS);
+		free(c);
+		close(fd);
+		return;
+	}
+
+	c->fd = fd;
+	snprintf(c->name, sizeof(c->name), "%s:%u", inet_ntoa(addr->sin_addr), ntohs(addr->sin_port));
+	pthread_cond_init(&c->cv, NULL);
+
+	/* The format is queued before the client becomes visible to the sample callback */
+	pthread_mutex_lock(&server_mp);
+	client_push(c, msg);
+	clients[i] = c;
+	pthread_mutex_unlock(&server_mp);
+
+	if (pthread_create(&c->thread, NULL, client_threadproc, c) != 0)
+	{
+		pthread_mutex_lock(&server_mp);
+		clients[i] = NULL;
+		msg_release(msg);
+		pthread_mutex_unlock(&server_mp);
+		pthread_cond_destroy(&c->cv);
+		close(fd);
+		free(c);
+		return;
+	}
+
+	fprintf(stderr, "%s connected\n", c->name);
+}
+
+static void client_remove(tcp_client_t* c)
+{
+	int i;
+
+	pthread_mutex_lock(&server_mp);
+	c->closed = 1;
+	pthread_cond_signal(&c->cv);
+	pthread_mutex_unlock(&server_mp);
+
+	pthread_join(c->thread, NULL);
+
+	pthread_mutex_lock(&server_mp);
+	for (i = 0; i < MAX_CLIENTS; i++)
+	{
+		if (clients[i] == c)
+		{
+			clients[i] = NULL;
+		}
+	}
+	while (c->count > 0)
+	{
+		msg_release(c->items[c->head].msg);
+		c->head = (c->head + 1) % QUEUE_SLOTS;
+		c->count--;
+	}
+	pthread_mutex_unlock(&server_mp);
+
+	fprintf(stderr, "%s disconnected, %llu samples dropped by its queue\n",
+		c->name, (unsigned long long) c->dropped_total);
+
+	pthread_cond_destroy(&c->cv);
+	close(c->fd);
+	free(c);
+}
+
+/* Runs in the library consumer thread: encodes once, then only queues references */
+static int sample_callback(hydrasdr_transfer_t* transfer)
+{
+	tcp_msg_t* msg;
+	size_t bytes;
+	uint32_t words;
+	uint16_t channels;
+	int i;
+
+	bytes = (size_t) transfer->sample_count * sample_size[transfer->sample_type];
+
+	if (format.encoding == TCP_ENCODING_COMPRESSED)
+	{
+		words = (uint32_t) (bytes / 2);
+		channels = is_iq(transfer->sample_type) ? 2 : 1;
+		msg = msg_alloc(TCP_MSG_DATA, iq_codec_block_bound(words));
+		if (msg == NULL)
+		{
+			return 0;
+		}
+		msg_set_payload(msg, iq_codec_encode_block((const uint16_t*) transfer->samples, words, channels,
+			msg->data + TCP_MSG_HDR_SIZE));
+	}
+	else
+	{
+		msg = msg_alloc(TCP_MSG_DATA, bytes);
+		if (msg == NULL)
+		{
+			return 0;
+		}
+		memcpy(msg->data + TCP_MSG_HDR_SIZE, transfer->samples, bytes);
+	}
+	msg->samples = (uint64_t) transfer->sample_count;
+
+	pthread_mutex_lock(&server_mp);
+	msg->refs++;
+	for (i = 0; i < MAX_CLIENTS; i++)
+	{
+		if (clients[i] != NULL)
+		{
+			clients[i]->pending_drop += transfer->dropped_samples;
+			client_push(clients[i], msg);
+		}
+	}
+	msg_release(msg);
+	pthread_mutex_unlock(&server_mp);
+
+	return 0;
+}
+
+static uint32_t output_rate(uint32_t samplerate, uint32_t decimation)
+{
+	uint32_t count = 0;
+	uint32_t* rates;
+	uint32_t rate = 0;
+
+	if (samplerate >= MIN_SAMPLERATE_BY_VALUE)
+	{
+		rate = samplerate;
+	}
+	else
+	{
+		/* The list holds real sample rates for real sample types */
+		hydrasdr_get_samplerates(device, &count, 0);
+		rates = (uint32_t*) malloc((count > 0 ? count : 1) * sizeof(uint32_t));
+		if (rates != NULL && samplerate < count)
+		{
+			hydrasdr_get_samplerates(device, rates, count);
+			rate = rates[samplerate];
+		}
+		free(rates);
+	}
+	return rate / decimation;
+}
+
+/* Stops streaming to change the sample type, rate, decimation or encoding, then restarts it */
+static int configure_stream(uint32_t sample_type, uint32_t samplerate, uint32_t decimation, uint32_t encoding)
+{
+	int result;
+
+	if (sample_type >= HYDRASDR_SAMPLE_END || sample_type == HYDRASDR_SAMPLE_RAW ||
+		(decimation > 1 && !can_decimate(sample_type)) ||
+		(encoding == TCP_ENCODING_COMPRESSED && !can_compress(sample_type)) ||
+		encoding > TCP_ENCODING_COMPRESSED)
+	{
+		return HYDRASDR_ERROR_INVALID_PARAM;
+	}
+
+	hydrasdr_stop_rx(device);
+
+	result = hydrasdr_set_sample_type(device, (enum hydrasdr_sample_type) sample_type);
+	if (result == HYDRASDR_SUCCESS)
+	{
+		result = hydrasdr_set_samplerate(device, samplerate);
+	}
+	if (result == HYDRASDR_SUCCESS)
+	{
+		result = hydrasdr_set_decimation(device, decimation);
+	}
+	if (result != HYDRASDR_SUCCESS)
+	{
+		/* Restore the previous stream */
+		hydrasdr_set_sample_type(device, (enum hydrasdr_sample_type) format.sample_type);
+		hydrasdr_set_samplerate(device, samplerate_val);
+		hydrasdr_set_decimation(device, format.decimation);
+		hydrasdr_start_rx(device, sample_callback, NULL);
+		return result;
+	}
+
+	samplerate_val = samplerate;
+	format.sample_type = sample_type;
+	format.decimation = decimation;
+	format.encoding = encoding;
+	format.sample_rate = output_rate(samplerate, decimation);
+	broadcast_format();
+
+	return hydrasdr_start_rx(device, sample_callback, NULL);
+}
+
+static void apply_command(tcp_client_t* c, uint8_t cmd, uint32_t value)
+{
+	int result;
+
+	switch (cmd)
+	{
+	case TCP_CMD_SET_FREQ:
+		result = hydrasdr_set_freq(device, value);
+		if (result == HYDRASDR_SUCCESS)
+		{
+			format.freq_hz = value;
+			broadcast_format();
+		}
+		break;
+
+	case TCP_CMD_SET_SAMPLERATE:
+		result = configure_stream(format.sample_type, value, format.decimation, format.encoding);
+		break;
+
+	case TCP_CMD_SET_LINEARITY_GAIN:
+		result = hydrasdr_set_linearity_gain(device, (uint8_t) value);
+		break;
+
+	case TCP_CMD_SET_SENSITIVITY_GAIN:
+		result = hydrasdr_set_sensitivity_gain(device, (uint8_t) value);
+		break;
+
+	case TCP_CMD_SET_VGA_GAIN:
+		result = hydrasdr_set_vga_gain(device, (uint8_t) value);
+		break;
+
+	case TCP_CMD_SET_MIXER_GAIN:
+		result = hydrasdr_set_mixer_gain(device, (uint8_t) value);
+		break;
+
+	case TCP_CMD_SET_LNA_GAIN:
+		result = hydrasdr_set_lna_gain(device, (uint8_t) value);
+		break;
+
+	case TCP_CMD_SET_SAMPLE_TYPE:
+		/* Decimation and compression are dropped when the new type does not support them */
+		result = configure_stream(value, samplerate_val,
+			can_decimate(value) ? format.decimation : 1,
+			can_compress(value) ? format.encoding : TCP_ENCODING_NONE);
+		break;
+
+	case TCP_CMD_SET_DECIMATION:
+		result = configure_stream(format.sample_type, samplerate_val, value, format.encoding);
+		break;
+
+	case TCP_CMD_SET_ENCODING:
+		result = configure_stream(format.sample_type, samplerate_val, format.decimation, value);
+		break;
+
+	case TCP_CMD_SET_BIAS_TEE:
+		result = hydrasdr_set_rf_bias(device, (uint8_t) value);
+		break;
+
+	default:
+		result = HYDRASDR_ERROR_INVALID_PARAM;
+		break;
+	}
+
+	if (verbose || result != HYDRASDR_SUCCESS)
+	{
+		fprintf(stderr, "%s: command 0x%02x %u: %s (%d)\n", c->name, cmd, value, hydrasdr_error_name(result), result);
+	}
+}
+
+/* Returns -1 when the client is gone */
+static int client_read(tcp_client_t* c)
+{
+	ssize_t n;
+
+	n = recv(c->fd, c->cmd + c->cmd_len, TCP_CMD_SIZE - c->cmd_len, 0);
+	if (n < 0 && errno == EINTR)
+	{
+		return 0;
+	}
+	if (n <= 0)
+	{
+		return -1;
+	}
+
+	c->cmd_len += (uint32_t) n;
+	if (c->cmd_len == TCP_CMD_SIZE)
+	{
+		c->cmd_len = 0;
+		apply_command(c, c->cmd[0], tcp_get_le32(c->cmd + 1));
+	}
+	return 0;
+}
+
+int main(int argc, char** argv)
+{
+	int opt;
+	const char* listen_addr = "127.0.0.1";
+	long port = TCP_DEFAULT_PORT;
+	const char* replay_path = NULL;
+	int serial_number = 0;
+	uint64_t serial_number_val = 0;
+	double freq_mhz = 0.0;
+	long sample_type = HYDRASDR_SAMPLE_INT16_IQ;
+	long decimation = 1;
+	int compress = 0;
+	long linearity_gain = -1;
+	long queue_mib = DEFAULT_QUEUE_MIB;
+	struct sockaddr_in addr;
+	socklen_t addr_len;
+	struct pollfd fds[MAX_CLIENTS + 1];
+	tcp_client_t* fd_clients[MAX_CLIENTS + 1];
+	int listen_fd;
+	int fd_count;
+	int fd;
+	int one = 1;
+	int i;
+	int result;
+
+	while( (opt = getopt(argc, argv, "l:P:s:F:f:a:t:D:Yg:q:d")) != EOF )
+	{
+		switch( opt )
+		{
+			case 'l':
+				listen_addr = optarg;
+			break;
+
+			case 'P':
+				port = strtol(optarg, NULL, 10);
+			break;
+
+			case 's':
+				serial_number = 1;
+				serial_number_val = strtoull(optarg, NULL, 0);
+			break;
+
+			case 'F':
+				replay_path = optarg;
+			break;
+
+			case 'f':
+				freq_mhz = strtod(optarg, NULL);
+			break;
+
+			case 'a':
+				samplerate_val = (uint32_t) strtoul(optarg, NULL, 0);
+			break;
+
+			case 't':
+				sample_type = strtol(optarg, NULL, 10);
+			break;
+
+			case 'D':
+				decimation = strtol(optarg, NULL, 10);
+			break;
+
+			case 'Y':
+				compress = 1;
+			break;
+
+			case 'g':
+				linearity_gain = strtol(optarg, NULL, 10);
+			break;
+
+			case 'q':
+				queue_mib = strtol(optarg, NULL, 10);
+			break;
+
+			case 'd':
+				verbose = 1;
+			break;
+
+			default:
+				usage();
+				return EXIT_FAILURE;
+		}
+	}
+
+	if( port <= 0 || port > 65535 || queue_mib <= 0 || decimation <= 0 ) {
+		fprintf(stderr, "argument error: port, queue size and decimation shall be positive\n");
+		usage();
+		return EXIT_FAILURE;
+	}
+	if( replay_path != NULL && samplerate_val < MIN_SAMPLERATE_BY_VALUE ) {
+		fprintf(stderr, "argument error: -F needs the sample rate of the capture by value (-a)\n");
+		usage();
+		return EXIT_FAILURE;
+	}
+	queue_limit = (size_t) queue_mib << 20;
+
+	memset(&addr, 0, sizeof(addr));
+	addr.sin_family = AF_INET;
+	addr.sin_port = htons((uint16_t) port);
+	if( inet_pton(AF_INET, listen_addr, &addr.sin_addr) != 1 ) {
+		fprintf(stderr, "argument error: invalid listen address %s\n", listen_addr);
+		usage();
+		return EXIT_FAILURE;
+	}
+
+	if( replay_path != NULL ) {
+		result = hydrasdr_open_file(&device, replay_path,
+			is_iq((uint32_t) sample_type) ? samplerate_val : samplerate_val / 2,
+			HYDRASDR_REPLAY_REALTIME | HYDRASDR_REPLAY_LOOP);
+	} else if( serial_number ) {
+		result = hydrasdr_open_sn(&device, serial_number_val);
+	} else {
+		result = hydrasdr_open(&device);
+	}
+	if( result != HYDRASDR_SUCCESS ) {
+		fprintf(stderr, "Failed to open the device: %s (%d)\n", hydrasdr_error_name(result), result);
+		return EXIT_FAILURE;
+	}
+
+	format.freq_hz = (freq_mhz > 0.0) ? (uint64_t) (freq_mhz * 1e6) : DEFAULT_FREQ_HZ;
+	result = hydrasdr_set_freq(device, format.freq_hz);
+	if( result == HYDRASDR_SUCCESS && linearity_gain >= 0 ) {
+		result = hydrasdr_set_linearity_gain(device, (uint8_t) linearity_gain);
+	}
+	if( result != HYDRASDR_SUCCESS ) {
+		fprintf(stderr, "Failed to configure the device: %s (%d)\n", hydrasdr_error_name(result), result);
+		hydrasdr_close(device);
+		return EXIT_FAILURE;
+	}
+
+	/* Stream restored by configure_stream() if the requested one cannot be set */
+	format.sample_type = (uint32_t) sample_type;
+	format.decimation = 1;
+	result = configure_stream((uint32_t) sample_type, samplerate_val, (uint32_t) decimation,
+		compress ? TCP_ENCODING_COMPRESSED : TCP_ENCODING_NONE);
+	if( result != HYDRASDR_SUCCESS ) {
+		fprintf(stderr, "Failed to start streaming: %s (%d)\n", hydrasdr_error_name(result), result);
+		hydrasdr_close(device);
+		return EXIT_FAILURE;
+	}
+
+	listen_fd = socket(AF_INET, SOCK_STREAM, 0);
+	if( listen_fd < 0 ) {
+		fprintf(stderr, "socket() failed: %s\n", strerror(errno));
+		hydrasdr_close(device);
+		return EXIT_FAILURE;
+	}
+	setsockopt(listen_fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+	if( bind(listen_fd, (struct sockaddr*) &addr, sizeof(addr)) != 0 || listen(listen_fd, 4) != 0 ) {
+		fprintf(stderr, "Failed to listen on %s:%ld: %s\n", listen_addr, port, strerror(errno));
+		close(listen_fd);
+		hydrasdr_close(device);
+		return EXIT_FAILURE;
+	}
+
+	signal(SIGINT, &sigint_callback_handler);
+	signal(SIGTERM, &sigint_callback_handler);
+	/* Send errors are handled by the client threads */
+	signal(SIGPIPE, SIG_IGN);
+
+	fprintf(stderr, "Listening on %s:%ld, %u samples/s, sample type %u, Ctrl-C to stop\n",
+		listen_addr, port, format.sample_rate, format.sample_type);
+
+	result = HYDRASDR_SUCCESS;
+	while( !do_exit )
+	{
+		fds[0].fd = listen_fd;
+		fds[0].events = POLLIN;
+		fd_count = 1;
+		for( i = 0; i < MAX_CLIENTS; i++ )
+		{
+			if( clients[i] != NULL ) {
+				fds[fd_count].fd = clients[i]->fd;
+				fds[fd_count].events = POLLIN;
+				fd_clients[fd_count] = clients[i];
+				fd_count++;
+			}
+		}
+
+		if( poll(fds, (nfds_t) fd_count, POLL_TIMEOUT_MS) > 0 )
+		{
+			for( i = 1; i < fd_count; i++ )
+			{
+				if( (fds[i].revents & (POLLIN | POLLHUP | POLLERR)) != 0 && client_read(fd_clients[i]) != 0 ) {
+					client_remove(fd_clients[i]);
+				}
+			}
+			if( (fds[0].revents & POLLIN) != 0 ) {
+				addr_len = sizeof(addr);
+				fd = accept(listen_fd, (struct sockaddr*) &addr, &addr_len);
+				if( fd >= 0 ) {
+					client_add(fd, &addr);
+				}
+			}
+		}
+
+		if( hydrasdr_is_streaming(device) != HYDRASDR_TRUE ) {
+			fprintf(stderr, "Streaming stopped\n");
+			result = HYDRASDR_ERROR_STREAMING_STOPPED;
+			break;
+		}
+	}
+
+	hydrasdr_stop_rx(device);
+	for( i = 0; i < MAX_CLIENTS; i++ )
+	{
+		if( clients[i] != NULL ) {
+			client_remove(clients[i]);
+		}
+	}
+	close(listen_fd);
+	hydrasdr_close(device);
+
+	fprintf(stderr, "done\n");
+
+	return (result == HYDRASDR_SUCCESS) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
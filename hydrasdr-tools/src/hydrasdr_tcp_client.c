@@ -0,0 +1,379 @@
+/*
+ * Copyright 2025 Benjamin Vernoux <bvernoux@hydrasdr.com>
+ *
+ * This file is part of HydraSDR.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include "iq_codec.h"
+#include "tcp_protocol.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <getopt.h>
+#include <unistd.h>
+#include <netdb.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+
+#define HYDRASDR_TCP_CLIENT_VERSION "1.0.0"
+
+#define DEFAULT_SECONDS (5.0)
+#define RECV_TIMEOUT_S (2)
+#define MAX_COMMANDS (16)
+
+/* Output bytes per sample, indexed by enum hydrasdr_sample_type */
+static const uint32_t sample_size[] = { 8, 4, 4, 2, 2, 2, 2, 3, 4 };
+#define SAMPLE_TYPE_COUNT (sizeof(sample_size) / sizeof(sample_size[0]))
+
+typedef struct {
+	uint8_t cmd;
+	uint32_t value;
+} command_t;
+
+static void usage(void)
+{
+	fprintf(stderr, "hydrasdr_tcp_client v%s\n", HYDRASDR_TCP_CLIENT_VERSION);
+	fprintf(stderr, "Receives a hydrasdr_tcp stream, checks it and optionally saves the samples.\n");
+	fprintf(stderr, "Usage:\n");
+	fprintf(stderr, "[-H host]: Server address (default 127.0.0.1)\n");
+	fprintf(stderr, "[-P port]: Server port (default %d)\n", TCP_DEFAULT_PORT);
+	fprintf(stderr, "[-r <filename>]: Save the received samples (decompressed) into file\n");
+	fprintf(stderr, "[-n seconds]: Receive duration (default %.0f)\n", DEFAULT_SECONDS);
+	fprintf(stderr, "[-w delay_ms]: Wait after each data message to emulate a slow client\n");
+	fprintf(stderr, "Commands sent after connecting:\n");
+	fprintf(stderr, "[-f frequency_MHz] [-a sample_rate] [-t sample_type] [-D decimation]\n");
+	fprintf(stderr, "[-Y encoding]: 0=none, 1=compressed\n");
+	fprintf(stderr, "[-g linearity_gain]\n");
+}
+
+static double wall_clock(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (double) ts.tv_sec + (double) ts.tv_nsec * 1e-9;
+}
+
+static int recv_all(int fd, uint8_t* data, size_t len)
+{
+	ssize_t n;
+
+	while (len > 0)
+	{
+		n = recv(fd, data, len, 0);
+		if (n < 0 && errno == EINTR)
+		{
+			continue;
+		}
+		if (n <= 0)
+		{
+			return -1;
+		}
+		data += n;
+		len -= (size_t) n;
+	}
+	return 0;
+}
+
+static int connect_to(const char* host, const char* port)
+{
+	struct addrinfo hints;
+	struct addrinfo* res;
+	struct addrinfo* ai;
+	struct timeval tv;
+	int fd = -1;
+
+	memset(&hints, 0, sizeof(hints));
+	hints.ai_family = AF_UNSPEC;
+	hints.ai_socktype = SOCK_STREAM;
+	if (getaddrinfo(host, port, &hints, &res) != 0)
+	{
+		return -1;
+	}
+	for (ai = res; ai != NULL; ai = ai->ai_next)
+	{
+		fd = socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol);
+		if (fd >= 0 && connect(fd, ai->ai_addr, ai->ai_addrlen) == 0)
+		{
+			break;
+		}
+		if (fd >= 0)
+		{
+			close(fd);
+			fd = -1;
+		}
+	}
+	freeaddrinfo(res);
+
+	if (fd >= 0)
+	{
+		/* A stalled server ends the test instead of blocking it */
+		tv.tv_sec = RECV_TIMEOUT_S;
+		tv.tv_usec = 0;
+		setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+	}
+	return fd;
+}
+
+int main(int argc, char** argv)
+{
+	int opt;
+	const char* host = "127.0.0.1";
+	const char* port = NULL;
+	char port_str[8];
+	const char* path = NULL;
+	double seconds = DEFAULT_SECONDS;
+	long delay_ms = 0;
+	command_t commands[MAX_COMMANDS];
+	int command_count = 0;
+	uint8_t hdr[TCP_MSG_HDR_SIZE];
+	uint8_t cmd[TCP_CMD_SIZE];
+	uint8_t* payload = NULL;
+	uint16_t* decoded = NULL;
+	size_t payload_size = 0;
+	size_t decoded_size = 0;
+	uint32_t type, len, words, block_payload;
+	tcp_format_t format = { 0 };
+	int have_format = 0;
+	uint64_t messages = 0, samples = 0, dropped = 0, wire_bytes = 0, sample_bytes = 0;
+	const void* data;
+	size_t data_len;
+	FILE* out = NULL;
+	double start, elapsed;
+	int fd;
+	int i;
+	int result = -1;
+
+	while( (opt = getopt(argc, argv, "H:P:r:n:w:f:a:t:D:Y:g:")) != EOF )
+	{
+		if( command_count == MAX_COMMANDS ) {
+			fprintf(stderr, "argument error: too many commands\n");
+			return EXIT_FAILURE;
+		}
+		switch( opt )
+		{
+			case 'H':
+				host = optarg;
+			break;
+
+			case 'P':
+				port = optarg;
+			break;
+
+			case 'r':
+				path = optarg;
+			break;
+
+			case 'n':
+				seconds = strtod(optarg, NULL);
+			break;
+
+			case 'w':
+				delay_ms = strtol(optarg, NULL, 10);
+			break;
+
+			case 'f':
+				commands[command_count].cmd = TCP_CMD_SET_FREQ;
+				commands[command_count++].value = (uint32_t) (strtod(optarg, NULL) * 1e6);
+			break;
+
+			case 'a':
+				commands[command_count].cmd = TCP_CMD_SET_SAMPLERATE;
+				commands[command_count++].value = (uint32_t) strtoul(optarg, NULL, 0);
+			break;
+
+			case 't':
+				commands[command_count].cmd = TCP_CMD_SET_SAMPLE_TYPE;
+				commands[command_count++].value = (uint32_t) strtoul(optarg, NULL, 0);
+			break;
+
+			case 'D':
+				commands[command_count].cmd = TCP_CMD_SET_DECIMATION;
+				commands[command_count++].value = (uint32_t) strtoul(optarg, NULL, 0);
+			break;
+
+			case 'Y':
+				commands[command_count].cmd = TCP_CMD_SET_ENCODING;
+				commands[command_count++].value = (uint32_t) strtoul(optarg, NULL, 0);
+			break;
+
+			case 'g':
+				commands[command_count].cmd = TCP_CMD_SET_LINEARITY_GAIN;
+				commands[command_count++].value = (uint32_t) strtoul(optarg, NULL, 0);
+			break;
+
+			default:
+				usage();
+				return EXIT_FAILURE;
+		}
+	}
+
+	if( port == NULL ) {
+		snprintf(port_str, sizeof(port_str), "%d", TCP_DEFAULT_PORT);
+		port = port_str;
+	}
+
+	fd = connect_to(host, port);
+	if( fd < 0 ) {
+		fprintf(stderr, "Failed to connect to %s:%s\n", host, port);
+		return EXIT_FAILURE;
+	}
+
+	if( path != NULL ) {
+		out = fopen(path, "wb");
+		if( out == NULL ) {
+			fprintf(stderr, "Failed to open file: %s\n", path);
+			close(fd);
+			return EXIT_FAILURE;
+		}
+	}
+
+	if( recv_all(fd, hdr, TCP_PROTOCOL_MAGIC_SIZE) != 0 || memcmp(hdr, TCP_PROTOCOL_MAGIC, TCP_PROTOCOL_MAGIC_SIZE) != 0 ) {
+		fprintf(stderr, "error: not a hydrasdr_tcp server\n");
+		goto done;
+	}
+
+	for( i = 0; i < command_count; i++ )
+	{
+		cmd[0] = commands[i].cmd;
+		tcp_put_le32(cmd + 1, commands[i].value);
+		if( send(fd, cmd, sizeof(cmd), 0) != (ssize_t) sizeof(cmd) ) {
+			fprintf(stderr, "error: failed to send command\n");
+			goto done;
+		}
+	}
+
+	start = wall_clock();
+	while( (elapsed = wall_clock() - start) < seconds )
+	{
+		if( recv_all(fd, hdr, TCP_MSG_HDR_SIZE) != 0 ) {
+			fprintf(stderr, "error: connection lost\n");
+			goto done;
+		}
+		type = tcp_get_le32(hdr);
+		len = tcp_get_le32(hdr + 4);
+		if( len > payload_size ) {
+			free(payload);
+			payload = (uint8_t*) malloc(len);
+			payload_size = len;
+			if( payload == NULL ) {
+				fprintf(stderr, "error: out of memory\n");
+				goto done;
+			}
+		}
+		if( recv_all(fd, payload, len) != 0 ) {
+			fprintf(stderr, "error: connection lost\n");
+			goto done;
+		}
+		wire_bytes += TCP_MSG_HDR_SIZE + len;
+		messages++;
+
+		switch( type )
+		{
+			case TCP_MSG_FORMAT:
+				if( len != TCP_FORMAT_SIZE ) {
+					fprintf(stderr, "error: bad format message\n");
+					goto done;
+				}
+				tcp_format_unpack(payload, &format);
+				if( format.sample_type >= SAMPLE_TYPE_COUNT ) {
+					fprintf(stderr, "error: unknown sample type %u\n", format.sample_type);
+					goto done;
+				}
+				have_format = 1;
+				fprintf(stderr, "format: sample type %u, %u samples/s, decimation %u, encoding %u, %llu Hz\n",
+					format.sample_type, format.sample_rate, format.decimation, format.encoding,
+					(unsigned long long) format.freq_hz);
+			break;
+
+			case TCP_MSG_DROP:
+				if( len != TCP_DROP_SIZE ) {
+					fprintf(stderr, "error: bad drop message\n");
+					goto done;
+				}
+				dropped += tcp_get_le64(payload);
+			break;
+
+			case TCP_MSG_DATA:
+				if( !have_format ) {
+					fprintf(stderr, "error: data before format\n");
+					goto done;
+				}
+				data = payload;
+				data_len = len;
+				if( format.encoding == TCP_ENCODING_COMPRESSED ) {
+					if( iq_codec_block_info(payload, &words, &block_payload) != 0 ||
+						IQ_CODEC_BLOCK_HDR_SIZE + block_payload != len ) {
+						fprintf(stderr, "error: bad compressed block\n");
+						goto done;
+					}
+					if( (size_t) words * 2 > decoded_size ) {
+						free(decoded);
+						decoded_size = (size_t) words * 2;
+						decoded = (uint16_t*) malloc(decoded_size);
+						if( decoded == NULL ) {
+							fprintf(stderr, "error: out of memory\n");
+							goto done;
+						}
+					}
+					/* Only INT16_IQ (type 2, 2 channels), INT16_REAL and U16_REAL are compressed */
+					if( iq_codec_decode_block(payload, len,
+						(format.sample_type == 2) ? 2 : 1, decoded) != 0 ) {
+						fprintf(stderr, "error: corrupted compressed block\n");
+						goto done;
+					}
+					data = decoded;
+					data_len = (size_t) words * 2;
+				}
+				sample_bytes += data_len;
+				samples += data_len / sample_size[format.sample_type];
+				if( out != NULL && fwrite(data, 1, data_len, out) != data_len ) {
+					fprintf(stderr, "Failed to write file: %s\n", path);
+					goto done;
+				}
+				if( delay_ms > 0 ) {
+					usleep((useconds_t) delay_ms * 1000);
+				}
+			break;
+
+			default:
+				fprintf(stderr, "error: unknown message type %u\n", type);
+				goto done;
+		}
+	}
+
+	fprintf(stderr, "%llu messages, %llu samples (%.3f MSPS) in %.2f s, %.1f MB/s on the wire, %.1f MB/s decoded\n",
+		(unsigned long long) messages, (unsigned long long) samples, samples / elapsed / 1e6, elapsed,
+		wire_bytes / elapsed / 1e6, sample_bytes / elapsed / 1e6);
+	fprintf(stderr, "%llu samples dropped\n", (unsigned long long) dropped);
+	result = (samples > 0) ? 0 : -1;
+
+done:
+	free(payload);
+	free(decoded);
+	close(fd);
+	if( out != NULL && fclose(out) != 0 ) {
+		fprintf(stderr, "Failed to write file: %s\n", path);
+		result = -1;
+	}
+
+	return (result == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
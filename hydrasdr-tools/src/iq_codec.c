@@ -0,0 +1,424 @@
+/*
+ * Copyright 2025 Benjamin Vernoux <bvernoux@hydrasdr.com>
+ *
+ * This file is part of HydraSDR.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include "iq_codec.h"
+
+#include <string.h>
+
+/* Per block shift of the common zero low bits (left aligned 12bits data), coded on 4 bits */
+#define SHIFT_BITS (4)
+/* Per group predictor: 0 none, 1 previous sample, 2 linear extrapolation of the two previous samples */
+#define PREDICTOR_BITS (2)
+#define PREDICTOR_COUNT (3)
+/* Rice parameter coded on 4 bits */
+#define RICE_K_BITS (4)
+#define RICE_K_MAX (15)
+/* Quotients from this value are escaped: QUOTIENT_ESCAPE zeros then the 16bits value */
+#define QUOTIENT_ESCAPE (24)
+
+typedef struct
+{
+	uint8_t* out;
+	uint64_t acc;
+	int bits;           /* Valid bits in acc (right aligned) */
+} bit_writer_t;
+
+typedef struct
+{
+	const uint8_t* in;
+	const uint8_t* end;
+	uint64_t acc;
+	int bits;           /* Valid bits in acc (left aligned) */
+} bit_reader_t;
+
+static void put_le32(uint8_t* p, uint32_t v)
+{
+	p[0] = (uint8_t) v;
+	p[1] = (uint8_t) (v >> 8);
+	p[2] = (uint8_t) (v >> 16);
+	p[3] = (uint8_t) (v >> 24);
+}
+
+static uint32_t get_le32(const uint8_t* p)
+{
+	return (uint32_t) p[0] | ((uint32_t) p[1] << 8) | ((uint32_t) p[2] << 16) | ((uint32_t) p[3] << 24);
+}
+
+/* Writes count (<= 32) bits of value, MSB first, with at most 31 bits pending the accumulator cannot overflow */
+static inline void put_bits(bit_writer_t* bw, uint32_t value, int count)
+{
+	uint32_t word;
+
+	bw->acc = (bw->acc << count) | value;
+	bw->bits += count;
+	if (bw->bits >= 32)
+	{
+		bw->bits -= 32;
+		word = (uint32_t) (bw->acc >> bw->bits);
+		bw->out[0] = (uint8_t) (word >> 24);
+		bw->out[1] = (uint8_t) (word >> 16);
+		bw->out[2] = (uint8_t) (word >> 8);
+		bw->out[3] = (uint8_t) word;
+		bw->out += 4;
+	}
+}
+
+static void flush_bits(bit_writer_t* bw)
+{
+	while (bw->bits >= 8)
+	{
+		bw->bits -= 8;
+		*bw->out++ = (uint8_t) (bw->acc >> bw->bits);
+	}
+	if (bw->bits > 0)
+	{
+		*bw->out++ = (uint8_t) (bw->acc << (8 - bw->bits));
+		bw->bits = 0;
+	}
+}
+
+static inline void refill(bit_reader_t* br)
+{
+	while (br->bits <= 56)
+	{
+		/* Reading past the end feeds zeros, caught by the quotient bound and the final position check */
+		br->acc |= (uint64_t) ((br->in < br->end) ? *br->in : 0) << (56 - br->bits);
+		br->in++;
+		br->bits += 8;
+	}
+}
+
+static inline uint32_t get_bits(bit_reader_t* br, int count)
+{
+	uint32_t value;
+
+	refill(br);
+	value = (uint32_t) (br->acc >> (64 - count));
+	br->acc <<= count;
+	br->bits -= count;
+
+	return value;
+}
+
+/* Number of zeros before the next one bit, at most limit */
+static inline int get_unary(bit_reader_t* br, int limit)
+{
+	int zeros;
+
+	refill(br);
+#if defined(__GNUC__) || defined(__clang__)
+	zeros = (br->acc != 0) ? __builtin_clzll(br->acc) : 64;
+#else
+	for (zeros = 0; zeros < 64 && !(br->acc & (0x8000000000000000ull >> zeros)); zeros++)
+	{
+	}
+#endif
+	if (zeros >= limit)
+	{
+		br->acc <<= limit;
+		br->bits -= limit;
+		return limit;
+	}
+
+	br->acc <<= zeros + 1;
+	br->bits -= zeros + 1;
+
+	return zeros;
+}
+
+static inline uint16_t zigzag(uint16_t delta)
+{
+	return (uint16_t) ((delta << 1) ^ (uint16_t) ((int16_t) delta >> 15));
+}
+
+static inline uint16_t unzigzag(uint16_t value)
+{
+	return (uint16_t) ((value >> 1) ^ (uint16_t) -(int16_t) (value & 1));
+}
+
+void iq_codec_stream_hdr_init(iq_codec_stream_hdr_t* hdr, uint16_t channels)
+{
+	uint8_t* p = (uint8_t*) hdr;
+
+	memset(hdr, 0, sizeof(iq_codec_stream_hdr_t));
+	memcpy(hdr->magic, IQ_CODEC_MAGIC, sizeof(hdr->magic));
+	p[8] = IQ_CODEC_VERSION;
+	p[10] = (uint8_t) channels;
+}
+
+uint16_t iq_codec_stream_hdr_check(const iq_codec_stream_hdr_t* hdr)
+{
+	const uint8_t* p = (const uint8_t*) hdr;
+	uint16_t channels;
+
+	channels = (uint16_t) (p[10] | (p[11] << 8));
+	if (memcmp(hdr->magic, IQ_CODEC_MAGIC, sizeof(hdr->magic)) != 0 ||
+		(p[8] | (p[9] << 8)) != IQ_CODEC_VERSION || channels == 0)
+	{
+		return 0;
+	}
+
+	return channels;
+}
+
+size_t iq_codec_block_bound(uint32_t words)
+{
+	/* Never larger than raw: incompressible blocks are stored */
+	return IQ_CODEC_BLOCK_HDR_SIZE + (size_t) words * 2;
+}
+
+static inline uint16_t predict(int predictor, uint16_t prev1, uint16_t prev2)
+{
+	switch (predictor)
+	{
+		case 1:  return prev1;
+		case 2:  return (uint16_t) (2 * prev1 - prev2);
+		default: return 0;
+	}
+}
+
+size_t iq_codec_encode_block(const uint16_t* in, uint32_t words, uint16_t channels, uint8_t* out)
+{
+	uint16_t zz[PREDICTOR_COUNT][IQ_CODEC_GROUP];
+	uint16_t prev1[IQ_CODEC_MAX_CHANNELS] = { 0 };
+	uint16_t prev2[IQ_CODEC_MAX_CHANNELS] = { 0 };
+	uint32_t sum[PREDICTOR_COUNT];
+	uint32_t i, j, n, q, bits, group_bits;
+	uint16_t value;
+	uint8_t* limit;
+	int k, p, best, shift;
+	uint16_t ch;
+	bit_writer_t bw;
+
+	if (channels == 0 || channels > IQ_CODEC_MAX_CHANNELS || words < 16)
+	{
+		goto store_raw;
+	}
+
+	bw.out = out + IQ_CODEC_BLOCK_HDR_SIZE;
+	bw.acc = 0;
+	bw.bits = 0;
+	/* Stop coding as soon as the payload would not be smaller than raw */
+	limit = out + IQ_CODEC_BLOCK_HDR_SIZE + (size_t) words * 2 - 16;
+
+	bits = 0;
+	for (i = 0; i < words; i++)
+	{
+		bits |= in[i];
+	}
+	for (shift = 0; shift < 15 && bits != 0 && !(bits & (1u << shift)); shift++)
+	{
+	}
+	put_bits(&bw, (uint32_t) shift, SHIFT_BITS);
+
+	ch = 0;
+	for (i = 0; i < words; i += n)
+	{
+		n = words - i;
+		if (n > IQ_CODEC_GROUP)
+		{
+			n = IQ_CODEC_GROUP;
+		}
+
+		/* Residuals of all the predictors, the history always holds the real samples */
+		sum[0] = sum[1] = sum[2] = 0;
+		for (j = 0; j < n; j++)
+		{
+			/* Arithmetic shift keeps signed samples continuous across zero */
+			value = (uint16_t) ((int16_t) in[i + j] >> shift);
+			for (p = 0; p < PREDICTOR_COUNT; p++)
+			{
+				zz[p][j] = zigzag((uint16_t) (value - predict(p, prev1[ch], prev2[ch])));
+				sum[p] += zz[p][j];
+			}
+			prev2[ch] = prev1[ch];
+			prev1[ch] = value;
+			if (++ch == channels)
+			{
+				ch = 0;
+			}
+		}
+
+		best = 0;
+		for (p = 1; p < PREDICTOR_COUNT; p++)
+		{
+			if (sum[p] < sum[best])
+			{
+				best = p;
+			}
+		}
+
+		/* Smallest k with n * 2^(k+1) >= sum, close to the optimum for a geometric distribution */
+		for (k = 0; k < RICE_K_MAX && ((uint64_t) n << (k + 1)) < sum[best]; k++)
+		{
+		}
+		/* Exact size of the group, checked before it is written: out holds no more than the raw size */
+		group_bits = PREDICTOR_BITS + RICE_K_BITS;
+		for (j = 0; j < n; j++)
+		{
+			q = zz[best][j] >> k;
+			group_bits += (q < QUOTIENT_ESCAPE) ? q + 1 + (uint32_t) k : QUOTIENT_ESCAPE + 16;
+		}
+		if (bw.out + ((uint32_t) bw.bits + group_bits + 7) / 8 >= limit)
+		{
+			goto store_raw;
+		}
+
+		put_bits(&bw, ((uint32_t) best << RICE_K_BITS) | (uint32_t) k, PREDICTOR_BITS + RICE_K_BITS);
+
+		for (j = 0; j < n; j++)
+		{
+			q = zz[best][j] >> k;
+			/* Written in pieces of at most 32 bits, put_bits() flushes one word per call */
+			if (q < QUOTIENT_ESCAPE)
+			{
+				/* q zeros, a one, then the k low bits */
+				put_bits(&bw, 1, (int) q + 1);
+				put_bits(&bw, zz[best][j] & ((1u << k) - 1), k);
+			}
+			else
+			{
+				put_bits(&bw, 0, QUOTIENT_ESCAPE);
+				put_bits(&bw, zz[best][j], 16);
+			}
+		}
+	}
+	flush_bits(&bw);
+
+	put_le32(out, words);
+	put_le32(out + 4, (uint32_t) (bw.out - out - IQ_CODEC_BLOCK_HDR_SIZE));
+
+	return (size_t) (bw.out - out);
+
+store_raw:
+	put_le32(out, words);
+	put_le32(out + 4, (words * 2) | IQ_CODEC_RAW_FLAG);
+	for (i = 0; i < words; i++)
+	{
+		out[IQ_CODEC_BLOCK_HDR_SIZE + i * 2] = (uint8_t) in[i];
+		out[IQ_CODEC_BLOCK_HDR_SIZE + i * 2 + 1] = (uint8_t) (in[i] >> 8);
+	}
+
+	return IQ_CODEC_BLOCK_HDR_SIZE + (size_t) words * 2;
+}
+
+int iq_codec_block_info(const uint8_t* block, uint32_t* words, uint32_t* payload_bytes)
+{
+	uint32_t payload;
+
+	*words = get_le32(block);
+	payload = get_le32(block + 4);
+	if (payload & IQ_CODEC_RAW_FLAG)
+	{
+		payload &= ~IQ_CODEC_RAW_FLAG;
+		if (payload != *words * 2)
+		{
+			return -1;
+		}
+	}
+	else if (payload > *words * 2)
+	{
+		return -1;
+	}
+	*payload_bytes = payload;
+
+	return 0;
+}
+
+int iq_codec_decode_block(const uint8_t* block, size_t block_len, uint16_t channels, uint16_t* out)
+{
+	uint16_t prev1[IQ_CODEC_MAX_CHANNELS] = { 0 };
+	uint16_t prev2[IQ_CODEC_MAX_CHANNELS] = { 0 };
+	uint32_t words, payload, i, j, n, value;
+	int k, q, predictor, shift;
+	uint16_t ch;
+	bit_reader_t br;
+
+	if (block_len < IQ_CODEC_BLOCK_HDR_SIZE || iq_codec_block_info(block, &words, &payload) != 0 ||
+		block_len != IQ_CODEC_BLOCK_HDR_SIZE + (size_t) payload || channels == 0 || channels > IQ_CODEC_MAX_CHANNELS)
+	{
+		return -1;
+	}
+	block += IQ_CODEC_BLOCK_HDR_SIZE;
+
+	if (get_le32(block - 4) & IQ_CODEC_RAW_FLAG)
+	{
+		for (i = 0; i < words; i++)
+		{
+			out[i] = (uint16_t) (block[i * 2] | (block[i * 2 + 1] << 8));
+		}
+		return 0;
+	}
+
+	br.in = block;
+	br.end = block + payload;
+	br.acc = 0;
+	br.bits = 0;
+
+	shift = (int) get_bits(&br, SHIFT_BITS);
+
+	ch = 0;
+	for (i = 0; i < words; i += n)
+	{
+		n = words - i;
+		if (n > IQ_CODEC_GROUP)
+		{
+			n = IQ_CODEC_GROUP;
+		}
+
+		k = (int) get_bits(&br, PREDICTOR_BITS + RICE_K_BITS);
+		predictor = k >> RICE_K_BITS;
+		k &= RICE_K_MAX;
+		if (predictor >= PREDICTOR_COUNT)
+		{
+			return -1;
+		}
+
+		for (j = 0; j < n; j++)
+		{
+			q = get_unary(&br, QUOTIENT_ESCAPE);
+			if (q == QUOTIENT_ESCAPE)
+			{
+				value = get_bits(&br, 16);
+			}
+			else
+			{
+				value = ((uint32_t) q << k) | ((k > 0) ? get_bits(&br, k) : 0);
+			}
+			value = (uint16_t) (predict(predictor, prev1[ch], prev2[ch]) + unzigzag((uint16_t) value));
+			prev2[ch] = prev1[ch];
+			prev1[ch] = (uint16_t) value;
+			out[i + j] = (uint16_t) (value << shift);
+			if (++ch == channels)
+			{
+				ch = 0;
+			}
+		}
+
+		if (br.in - (br.bits / 8) > br.end + 1)
+		{
+			return -1;
+		}
+	}
+
+	/* All payload bytes consumed: the bits left in acc are the final padding */
+	return (br.in - (br.bits >> 3) <= br.end) ? 0 : -1;
+}
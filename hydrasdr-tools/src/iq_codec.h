@@ -0,0 +1,67 @@
+/*
+ * Copyright 2025 Benjamin Vernoux <bvernoux@hydrasdr.com>
+ *
+ * This file is part of HydraSDR.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef IQ_CODEC_H
+#define IQ_CODEC_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+/*
+ * Lossless codec for 16bits sample streams (INT16_IQ, INT16_REAL, UINT16_REAL and unpacked RAW).
+ * Common zero low bits are dropped per block, then each channel is predicted from its previous
+ * samples (modulo 2^16 so any 16bits word is accepted), zigzag mapped and Rice coded.
+ * The predictor and Rice parameter are chosen for every group of IQ_CODEC_GROUP words.
+ * Blocks are independent so they can be encoded and decoded in parallel.
+ *
+ * Stream: iq_codec_stream_hdr_t then blocks of
+ *   uint32_t words (little endian), uint32_t payload bytes (bit 31 set: payload is stored raw), payload.
+ */
+
+#define IQ_CODEC_MAGIC "HSDRIQZ1"
+#define IQ_CODEC_VERSION (1)
+#define IQ_CODEC_GROUP (256)
+#define IQ_CODEC_MAX_CHANNELS (8)
+#define IQ_CODEC_BLOCK_HDR_SIZE (8)
+#define IQ_CODEC_RAW_FLAG (0x80000000u)
+
+typedef struct
+{
+	char magic[8];       /* IQ_CODEC_MAGIC */
+	uint16_t version;    /* IQ_CODEC_VERSION, little endian */
+	uint16_t channels;   /* 1 for real, 2 for interleaved IQ, little endian */
+	uint32_t reserved;
+} iq_codec_stream_hdr_t;
+
+void iq_codec_stream_hdr_init(iq_codec_stream_hdr_t* hdr, uint16_t channels);
+/* Returns the channels count, 0 if hdr is not a valid stream header */
+uint16_t iq_codec_stream_hdr_check(const iq_codec_stream_hdr_t* hdr);
+
+/* Worst case encoded size of a block of words, header included */
+size_t iq_codec_block_bound(uint32_t words);
+/* Encodes words (a multiple of channels) from in to out (iq_codec_block_bound() bytes), returns the block size */
+size_t iq_codec_encode_block(const uint16_t* in, uint32_t words, uint16_t channels, uint8_t* out);
+/* Reads the block header, returns 0 and the words and payload size, -1 if invalid */
+int iq_codec_block_info(const uint8_t* block, uint32_t* words, uint32_t* payload_bytes);
+/* Decodes a block (header included) of block_len bytes to out, returns 0 on success, -1 on corrupted data */
+int iq_codec_decode_block(const uint8_t* block, size_t block_len, uint16_t channels, uint16_t* out);
+
+#endif /* IQ_CODEC_H */
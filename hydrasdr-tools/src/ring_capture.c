@@ -0,0 +1,439 @@
+/*
+ * Copyright 2025 Benjamin Vernoux <bvernoux@hydrasdr.com>
+ *
+ * This file is part of HydraSDR.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include "ring_capture.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _WIN32
+
+ring_capture_t* ring_capture_open(const char* path, uint64_t pre_bytes, uint64_t post_bytes)
+{
+	(void) path;
+	(void) pre_bytes;
+	(void) post_bytes;
+	return NULL;
+}
+
+int ring_capture_write(ring_capture_t* rc, const void* data, size_t len)
+{
+	(void) rc;
+	(void) data;
+	(void) len;
+	return -1;
+}
+
+void ring_capture_trigger(ring_capture_t* rc)
+{
+	(void) rc;
+}
+
+int ring_capture_listen(ring_capture_t* rc, const char* socket_path)
+{
+	(void) rc;
+	(void) socket_path;
+	return -1;
+}
+
+uint32_t ring_capture_events(ring_capture_t* rc)
+{
+	(void) rc;
+	return 0;
+}
+
+void ring_capture_close(ring_capture_t* rc)
+{
+	(void) rc;
+}
+
+#else
+
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/types.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#define EVENT_PATH_MAX (FILENAME_MAX)
+
+enum ring_state
+{
+	RING_IDLE,        /* Waiting for a trigger */
+	RING_POST,        /* Trigger seen, collecting the post-trigger bytes */
+	RING_SAVING       /* Window complete, the save thread is copying it */
+};
+
+struct ring_capture
+{
+	char* path;
+	int fd;
+	uint8_t* ring;
+	uint64_t capacity;
+	uint64_t pre_bytes;
+	uint64_t post_bytes;
+	volatile uint64_t total;       /* Bytes written since open */
+	volatile sig_atomic_t trigger; /* Set by ring_capture_trigger() */
+	volatile int state;
+	uint64_t window_start;
+	uint64_t window_end;
+	uint32_t events;
+	int closing;
+	pthread_t save_thread;
+	pthread_mutex_t lock;
+	pthread_cond_t save_cv;
+	int listen_fd;
+	char* socket_path;
+	pthread_t listen_thread;
+	int listen_running;
+};
+
+static int save_window(ring_capture_t* rc)
+{
+	char name[EVENT_PATH_MAX];
+	uint64_t pos, start, end, len;
+	ssize_t written;
+	int fd;
+
+	snprintf(name, sizeof(name), "%s_event%04u.bin", rc->path, rc->events);
+	fd = open(name, O_WRONLY | O_CREAT | O_TRUNC, 0666);
+	if (fd < 0)
+	{
+		fprintf(stderr, "ring capture: failed to create %s\n", name);
+		return -1;
+	}
+
+	pos = rc->window_start;
+	end = rc->window_end;
+	while (pos < end)
+	{
+		start = pos % rc->capacity;
+		len = end - pos;
+		if (len > rc->capacity - start)
+		{
+			len = rc->capacity - start;
+		}
+
+		written = write(fd, rc->ring + start, (size_t) len);
+		if (written <= 0)
+		{
+			if (written < 0 && errno == EINTR)
+			{
+				continue;
+			}
+			fprintf(stderr, "ring capture: write error on %s\n", name);
+			close(fd);
+			return -1;
+		}
+		pos += (uint64_t) written;
+	}
+
+	close(fd);
+
+	/* The writer must not have wrapped onto the window while it was copied */
+	if (rc->total - rc->window_start > rc->capacity)
+	{
+		fprintf(stderr, "ring capture: %s was overwritten while saving, the beginning is corrupted\n", name);
+	}
+	else
+	{
+		fprintf(stderr, "ring capture: saved %s (%llu bytes)\n", name, (unsigned long long) (end - rc->window_start));
+	}
+
+	return 0;
+}
+
+static void* save_threadproc(void* arg)
+{
+	ring_capture_t* rc = (ring_capture_t*) arg;
+
+	pthread_mutex_lock(&rc->lock);
+
+	for (;;)
+	{
+		while (rc->state != RING_SAVING && !rc->closing)
+		{
+			pthread_cond_wait(&rc->save_cv, &rc->lock);
+		}
+		if (rc->state != RING_SAVING)
+		{
+			break;
+		}
+		pthread_mutex_unlock(&rc->lock);
+
+		save_window(rc);
+
+		pthread_mutex_lock(&rc->lock);
+		rc->events++;
+		rc->trigger = 0;
+		rc->state = RING_IDLE;
+	}
+
+	pthread_mutex_unlock(&rc->lock);
+
+	return NULL;
+}
+
+/* Hands the current window to the save thread */
+static void start_save(ring_capture_t* rc, uint64_t end)
+{
+	pthread_mutex_lock(&rc->lock);
+	rc->window_end = end;
+	rc->state = RING_SAVING;
+	pthread_cond_signal(&rc->save_cv);
+	pthread_mutex_unlock(&rc->lock);
+}
+
+ring_capture_t* ring_capture_open(const char* path, uint64_t pre_bytes, uint64_t post_bytes)
+{
+	char name[EVENT_PATH_MAX];
+	long page_size;
+	ring_capture_t* rc;
+
+	rc = (ring_capture_t*) calloc(1, sizeof(ring_capture_t));
+	if (rc == NULL)
+	{
+		return NULL;
+	}
+
+	rc->path = strdup(path);
+	rc->pre_bytes = pre_bytes;
+	rc->post_bytes = post_bytes;
+	rc->listen_fd = -1;
+
+	/* The second half leaves the save thread one window duration to copy the event */
+	page_size = sysconf(_SC_PAGESIZE);
+	rc->capacity = 2 * (pre_bytes + post_bytes);
+	rc->capacity = (rc->capacity + page_size - 1) / page_size * page_size;
+
+	snprintf(name, sizeof(name), "%s.ring", path);
+	rc->fd = open(name, O_RDWR | O_CREAT | O_TRUNC, 0666);
+	if (rc->path == NULL || rc->capacity == 0 || rc->fd < 0)
+	{
+		goto error;
+	}
+
+	if (ftruncate(rc->fd, (off_t) rc->capacity) != 0)
+	{
+		goto error;
+	}
+
+	rc->ring = (uint8_t*) mmap(NULL, (size_t) rc->capacity, PROT_READ | PROT_WRITE, MAP_SHARED, rc->fd, 0);
+	if (rc->ring == MAP_FAILED)
+	{
+		rc->ring = NULL;
+		goto error;
+	}
+
+	/* Fault the whole ring in now rather than in the sample callback */
+	memset(rc->ring, 0, (size_t) rc->capacity);
+
+	pthread_mutex_init(&rc->lock, NULL);
+	pthread_cond_init(&rc->save_cv, NULL);
+	if (pthread_create(&rc->save_thread, NULL, save_threadproc, rc) != 0)
+	{
+		pthread_cond_destroy(&rc->save_cv);
+		pthread_mutex_destroy(&rc->lock);
+		goto error;
+	}
+
+	return rc;
+
+error:
+	if (rc->ring != NULL)
+	{
+		munmap(rc->ring, (size_t) rc->capacity);
+	}
+	if (rc->fd >= 0)
+	{
+		close(rc->fd);
+	}
+	free(rc->path);
+	free(rc);
+	return NULL;
+}
+
+int ring_capture_write(ring_capture_t* rc, const void* data, size_t len)
+{
+	uint64_t start, chunk;
+	const uint8_t* src = (const uint8_t*) data;
+	uint64_t total = rc->total;
+	uint64_t end = total + len;
+
+	if (rc->trigger && rc->state == RING_IDLE)
+	{
+		rc->window_start = (total > rc->pre_bytes) ? total - rc->pre_bytes : 0;
+		rc->window_end = total + rc->post_bytes;
+		rc->state = RING_POST;
+	}
+
+	while (len > 0)
+	{
+		start = total % rc->capacity;
+		chunk = rc->capacity - start;
+		if (chunk > len)
+		{
+			chunk = len;
+		}
+
+		memcpy(rc->ring + start, src, (size_t) chunk);
+		src += chunk;
+		total += chunk;
+		len -= (size_t) chunk;
+	}
+
+	rc->total = end;
+
+	if (rc->state == RING_POST && end >= rc->window_end)
+	{
+		start_save(rc, rc->window_end);
+	}
+
+	return 0;
+}
+
+void ring_capture_trigger(ring_capture_t* rc)
+{
+	rc->trigger = 1;
+}
+
+static void* listen_threadproc(void* arg)
+{
+	ring_capture_t* rc = (ring_capture_t*) arg;
+	char line[64];
+	ssize_t len;
+	int client;
+	struct timeval timeout = { 1, 0 };
+
+	for (;;)
+	{
+		client = accept(rc->listen_fd, NULL, NULL);
+		if (client < 0)
+		{
+			if (errno == EINTR || errno == ECONNABORTED)
+			{
+				continue;
+			}
+			/* Socket shut down by ring_capture_close() */
+			break;
+		}
+
+		/* One command per connection, the timeout keeps a silent client from blocking close */
+		setsockopt(client, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+		len = read(client, line, sizeof(line) - 1);
+		if (len > 0)
+		{
+			line[len] = '\0';
+			if (strstr(line, "trigger") != NULL)
+			{
+				ring_capture_trigger(rc);
+				len = write(client, "ok\n", 3);
+			}
+			else
+			{
+				len = write(client, "unknown command\n", 16);
+			}
+		}
+		close(client);
+	}
+
+	return NULL;
+}
+
+int ring_capture_listen(ring_capture_t* rc, const char* socket_path)
+{
+	struct sockaddr_un addr;
+
+	if (strlen(socket_path) >= sizeof(addr.sun_path))
+	{
+		return -1;
+	}
+
+	memset(&addr, 0, sizeof(addr));
+	addr.sun_family = AF_UNIX;
+	strcpy(addr.sun_path, socket_path);
+	unlink(socket_path);
+
+	rc->listen_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (rc->listen_fd < 0)
+	{
+		return -1;
+	}
+
+	if (bind(rc->listen_fd, (struct sockaddr*) &addr, sizeof(addr)) != 0 ||
+		listen(rc->listen_fd, 4) != 0 ||
+		pthread_create(&rc->listen_thread, NULL, listen_threadproc, rc) != 0)
+	{
+		close(rc->listen_fd);
+		rc->listen_fd = -1;
+		return -1;
+	}
+
+	rc->socket_path = strdup(socket_path);
+	rc->listen_running = 1;
+
+	return 0;
+}
+
+uint32_t ring_capture_events(ring_capture_t* rc)
+{
+	return rc->events;
+}
+
+void ring_capture_close(ring_capture_t* rc)
+{
+	if (rc->listen_running)
+	{
+		shutdown(rc->listen_fd, SHUT_RDWR);
+		close(rc->listen_fd);
+		pthread_join(rc->listen_thread, NULL);
+		unlink(rc->socket_path);
+		free(rc->socket_path);
+	}
+
+	/* Streaming has stopped, an incomplete event keeps the post-trigger bytes received so far */
+	if (rc->state == RING_POST)
+	{
+		start_save(rc, rc->total);
+	}
+
+	pthread_mutex_lock(&rc->lock);
+	rc->closing = 1;
+	pthread_cond_signal(&rc->save_cv);
+	pthread_mutex_unlock(&rc->lock);
+	pthread_join(rc->save_thread, NULL);
+
+	pthread_cond_destroy(&rc->save_cv);
+	pthread_mutex_destroy(&rc->lock);
+	munmap(rc->ring, (size_t) rc->capacity);
+	close(rc->fd);
+	free(rc->path);
+	free(rc);
+}
+
+#endif /* _WIN32 */
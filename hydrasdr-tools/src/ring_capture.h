@@ -0,0 +1,53 @@
+/*
+ * Copyright 2025 Benjamin Vernoux <bvernoux@hydrasdr.com>
+ *
+ * This file is part of HydraSDR.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef RING_CAPTURE_H
+#define RING_CAPTURE_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+/*
+ * Pre-trigger capture into a memory-mapped circular file.
+ * The stream is copied continuously into <path>.ring, when a trigger fires the
+ * pre-trigger history and the following post-trigger bytes are saved by a
+ * background thread into <path>_eventNNNN.bin.
+ * Put the ring on tmpfs (/dev/shm) to keep the disk idle between events,
+ * on a regular filesystem the kernel writes the dirty pages back lazily.
+ * Not supported on Windows (ring_capture_open() returns NULL).
+ */
+
+typedef struct ring_capture ring_capture_t;
+
+/* pre_bytes and post_bytes shall be multiples of the sample size */
+ring_capture_t* ring_capture_open(const char* path, uint64_t pre_bytes, uint64_t post_bytes);
+/* Called from the sample callback, returns 0 on success */
+int ring_capture_write(ring_capture_t* rc, const void* data, size_t len);
+/* Requests an event, async-signal-safe, ignored while an event is in progress */
+void ring_capture_trigger(ring_capture_t* rc);
+/* Listens on a UNIX stream socket, each "trigger" line received fires an event, returns 0 on success */
+int ring_capture_listen(ring_capture_t* rc, const char* socket_path);
+/* Number of event files written */
+uint32_t ring_capture_events(ring_capture_t* rc);
+/* Saves a pending event with what has been received so far and releases everything */
+void ring_capture_close(ring_capture_t* rc);
+
+#endif /* RING_CAPTURE_H */
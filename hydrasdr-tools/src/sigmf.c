@@ -0,0 +1,249 @@
+/*
+ * Copyright 2025 Benjamin Vernoux <bvernoux@hydrasdr.com>
+ *
+ * This file is part of HydraSDR.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include "sigmf.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define SIGMF_FIELD_MAX_LEN (512)
+
+typedef struct
+{
+	uint64_t sample_start;
+	uint64_t dropped_samples;
+} sigmf_drop_t;
+
+struct sigmf_meta
+{
+	char datatype[16];
+	double sample_rate;
+	uint64_t frequency_hz;
+	char datetime[32];
+	char** fields;          /* Preformatted "key": value pairs */
+	int field_count;
+	sigmf_drop_t* drops;
+	int drop_count;
+	int drop_capacity;
+};
+
+const char* sigmf_datatype(enum hydrasdr_sample_type sample_type)
+{
+	switch (sample_type)
+	{
+		case HYDRASDR_SAMPLE_FLOAT32_IQ:   return "cf32_le";
+		case HYDRASDR_SAMPLE_FLOAT32_REAL: return "rf32_le";
+		case HYDRASDR_SAMPLE_INT16_IQ:     return "ci16_le";
+		case HYDRASDR_SAMPLE_INT16_REAL:   return "ri16_le";
+		case HYDRASDR_SAMPLE_UINT16_REAL:  return "ru16_le";
+		case HYDRASDR_SAMPLE_INT8_IQ:      return "ci8";
+		default:                           return NULL;
+	}
+}
+
+sigmf_meta_t* sigmf_meta_create(const char* datatype, double sample_rate, uint64_t frequency_hz)
+{
+	time_t now;
+	sigmf_meta_t* meta;
+
+	meta = (sigmf_meta_t*) calloc(1, sizeof(sigmf_meta_t));
+	if (meta == NULL)
+	{
+		return NULL;
+	}
+
+	snprintf(meta->datatype, sizeof(meta->datatype), "%s", datatype);
+	meta->sample_rate = sample_rate;
+	meta->frequency_hz = frequency_hz;
+
+	now = time(NULL);
+	strftime(meta->datetime, sizeof(meta->datetime), "%Y-%m-%dT%H:%M:%SZ", gmtime(&now));
+
+	return meta;
+}
+
+void sigmf_meta_free(sigmf_meta_t* meta)
+{
+	int i;
+
+	for (i = 0; i < meta->field_count; i++)
+	{
+		free(meta->fields[i]);
+	}
+	free(meta->fields);
+	free(meta->drops);
+	free(meta);
+}
+
+static int add_field(sigmf_meta_t* meta, const char* field)
+{
+	char** fields;
+	char* copy;
+
+	fields = (char**) realloc(meta->fields, (meta->field_count + 1) * sizeof(char*));
+	if (fields == NULL)
+	{
+		return -1;
+	}
+	meta->fields = fields;
+
+	copy = (char*) malloc(strlen(field) + 1);
+	if (copy == NULL)
+	{
+		return -1;
+	}
+	strcpy(copy, field);
+	meta->fields[meta->field_count++] = copy;
+
+	return 0;
+}
+
+int sigmf_meta_set_string(sigmf_meta_t* meta, const char* key, const char* value)
+{
+	char field[SIGMF_FIELD_MAX_LEN];
+	size_t len;
+
+	len = (size_t) snprintf(field, sizeof(field), "\"%s\": \"", key);
+
+	/* JSON string escaping */
+	for (; *value != '\0' && len + 8 < sizeof(field); value++)
+	{
+		if (*value == '"' || *value == '\\')
+		{
+			field[len++] = '\\';
+			field[len++] = *value;
+		}
+		else if ((unsigned char) *value < 0x20)
+		{
+			len += (size_t) snprintf(field + len, sizeof(field) - len, "\\u%04x", (unsigned char) *value);
+		}
+		else
+		{
+			field[len++] = *value;
+		}
+	}
+	field[len++] = '"';
+	field[len] = '\0';
+
+	return add_field(meta, field);
+}
+
+int sigmf_meta_set_uint(sigmf_meta_t* meta, const char* key, uint64_t value)
+{
+	char field[SIGMF_FIELD_MAX_LEN];
+
+	snprintf(field, sizeof(field), "\"%s\": %llu", key, (unsigned long long) value);
+
+	return add_field(meta, field);
+}
+
+int sigmf_meta_add_drop(sigmf_meta_t* meta, uint64_t sample_start, uint64_t dropped_samples)
+{
+	sigmf_drop_t* drops;
+
+	if (meta->drop_count == meta->drop_capacity)
+	{
+		drops = (sigmf_drop_t*) realloc(meta->drops, (meta->drop_capacity * 2 + 16) * sizeof(sigmf_drop_t));
+		if (drops == NULL)
+		{
+			return -1;
+		}
+		meta->drops = drops;
+		meta->drop_capacity = meta->drop_capacity * 2 + 16;
+	}
+
+	meta->drops[meta->drop_count].sample_start = sample_start;
+	meta->drops[meta->drop_count].dropped_samples = dropped_samples;
+	meta->drop_count++;
+
+	return 0;
+}
+
+int sigmf_meta_write(sigmf_meta_t* meta, const char* path)
+{
+	int i;
+	int result;
+	FILE* fd;
+	char* tmp_path;
+
+	tmp_path = (char*) malloc(strlen(path) + 5);
+	if (tmp_path == NULL)
+	{
+		return -1;
+	}
+	sprintf(tmp_path, "%s.tmp", path);
+
+	fd = fopen(tmp_path, "w");
+	if (fd == NULL)
+	{
+		free(tmp_path);
+		return -1;
+	}
+
+	fprintf(fd, "{\n  \"global\": {\n");
+	fprintf(fd, "    \"core:datatype\": \"%s\",\n", meta->datatype);
+	fprintf(fd, "    \"core:sample_rate\": %.1f,\n", meta->sample_rate);
+	fprintf(fd, "    \"core:version\": \"%s\",\n", SIGMF_VERSION);
+	fprintf(fd, "    \"core:extensions\": [ { \"name\": \"hydrasdr\", \"version\": \"1.0.0\", \"optional\": true } ]");
+	for (i = 0; i < meta->field_count; i++)
+	{
+		fprintf(fd, ",\n    %s", meta->fields[i]);
+	}
+	fprintf(fd, "\n  },\n");
+
+	fprintf(fd, "  \"captures\": [\n");
+	fprintf(fd, "    { \"core:sample_start\": 0, \"core:frequency\": %llu, \"core:datetime\": \"%s\" }\n",
+		(unsigned long long) meta->frequency_hz, meta->datetime);
+	fprintf(fd, "  ],\n");
+
+	fprintf(fd, "  \"annotations\": [");
+	for (i = 0; i < meta->drop_count; i++)
+	{
+		fprintf(fd, "%s\n    { \"core:sample_start\": %llu, \"core:label\": \"dropped\", "
+			"\"core:comment\": \"%llu samples dropped before this sample\", \"hydrasdr:dropped_samples\": %llu }",
+			(i == 0) ? "" : ",",
+			(unsigned long long) meta->drops[i].sample_start,
+			(unsigned long long) meta->drops[i].dropped_samples,
+			(unsigned long long) meta->drops[i].dropped_samples);
+	}
+	fprintf(fd, "%s]\n}\n", (meta->drop_count > 0) ? "\n  " : " ");
+
+	result = ferror(fd) ? -1 : 0;
+	if (fclose(fd) != 0)
+	{
+		result = -1;
+	}
+
+#ifdef _WIN32
+	/* rename() does not replace an existing file on Windows */
+	remove(path);
+#endif
+	if (result == 0 && rename(tmp_path, path) != 0)
+	{
+		result = -1;
+	}
+
+	free(tmp_path);
+
+	return result;
+}
@@ -0,0 +1,53 @@
+/*
+ * Copyright 2025 Benjamin Vernoux <bvernoux@hydrasdr.com>
+ *
+ * This file is part of HydraSDR.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef SIGMF_H
+#define SIGMF_H
+
+#include <stdint.h>
+#include <hydrasdr.h>
+
+/*
+ * SigMF (https://sigmf.org) metadata sidecar for hydrasdr_rx recordings.
+ * Holds the global object, one capture segment and the dropped samples
+ * annotations, and writes the .sigmf-meta JSON file.
+ */
+
+#define SIGMF_VERSION "1.0.0"
+#define SIGMF_DATA_EXT ".sigmf-data"
+#define SIGMF_META_EXT ".sigmf-meta"
+
+typedef struct sigmf_meta sigmf_meta_t;
+
+/* SigMF core:datatype of a sample type, NULL when SigMF cannot describe it */
+const char* sigmf_datatype(enum hydrasdr_sample_type sample_type);
+
+sigmf_meta_t* sigmf_meta_create(const char* datatype, double sample_rate, uint64_t frequency_hz);
+void sigmf_meta_free(sigmf_meta_t* meta);
+/* Additional global fields, key includes its namespace (e.g. "core:hw", "hydrasdr:vga_gain") */
+int sigmf_meta_set_string(sigmf_meta_t* meta, const char* key, const char* value);
+int sigmf_meta_set_uint(sigmf_meta_t* meta, const char* key, uint64_t value);
+/* Records that dropped_samples samples were lost just before sample_start */
+int sigmf_meta_add_drop(sigmf_meta_t* meta, uint64_t sample_start, uint64_t dropped_samples);
+/* Writes (or rewrites) the JSON file through a temporary file, returns 0 on success */
+int sigmf_meta_write(sigmf_meta_t* meta, const char* path);
+
+#endif /* SIGMF_H */
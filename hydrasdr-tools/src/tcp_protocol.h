@@ -0,0 +1,118 @@
+/*
+ * Copyright 2025 Benjamin Vernoux <bvernoux@hydrasdr.com>
+ *
+ * This file is part of HydraSDR.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef TCP_PROTOCOL_H
+#define TCP_PROTOCOL_H
+
+#include <stdint.h>
+
+/*
+ * hydrasdr_tcp streaming protocol, all integers little endian.
+ *
+ * Server to client: the 8 bytes magic, then messages made of a header
+ * (uint32 type, uint32 payload length) followed by the payload:
+ * - TCP_MSG_FORMAT: stream format (tcp_format_t), sent on connection and after each change
+ * - TCP_MSG_DATA: samples in the current format, or one iq_codec block when compressed
+ * - TCP_MSG_DROP: uint64 number of samples lost just before the next DATA message,
+ *   by the device or because the client queue was full
+ *
+ * Client to server: commands of 5 bytes, uint8 command followed by a uint32 value.
+ */
+
+#define TCP_PROTOCOL_MAGIC "HSDRTCP1"
+#define TCP_PROTOCOL_MAGIC_SIZE (8)
+#define TCP_DEFAULT_PORT (5557)
+
+#define TCP_MSG_HDR_SIZE (8)
+#define TCP_MSG_FORMAT (1)
+#define TCP_MSG_DATA (2)
+#define TCP_MSG_DROP (3)
+
+#define TCP_FORMAT_SIZE (24)
+#define TCP_DROP_SIZE (8)
+
+#define TCP_ENCODING_NONE (0)
+#define TCP_ENCODING_COMPRESSED (1) /* iq_codec blocks, 16bit sample types only */
+
+#define TCP_CMD_SIZE (5)
+#define TCP_CMD_SET_FREQ (0x01)             /* Hz */
+#define TCP_CMD_SET_SAMPLERATE (0x02)       /* Index or value in Hz, as hydrasdr_set_samplerate() */
+#define TCP_CMD_SET_LINEARITY_GAIN (0x03)
+#define TCP_CMD_SET_SENSITIVITY_GAIN (0x04)
+#define TCP_CMD_SET_VGA_GAIN (0x05)
+#define TCP_CMD_SET_MIXER_GAIN (0x06)
+#define TCP_CMD_SET_LNA_GAIN (0x07)
+#define TCP_CMD_SET_SAMPLE_TYPE (0x08)      /* enum hydrasdr_sample_type, RAW excluded */
+#define TCP_CMD_SET_DECIMATION (0x09)       /* Power of 2, INT16_IQ, INT8_IQ and PACKED12_IQ */
+#define TCP_CMD_SET_ENCODING (0x0A)         /* TCP_ENCODING_xxx */
+#define TCP_CMD_SET_BIAS_TEE (0x0B)
+
+typedef struct {
+	uint32_t sample_type;  /* enum hydrasdr_sample_type */
+	uint32_t sample_rate;  /* Output samples per second, after decimation */
+	uint32_t decimation;
+	uint32_t encoding;     /* TCP_ENCODING_xxx */
+	uint64_t freq_hz;
+} tcp_format_t;
+
+static inline void tcp_put_le32(uint8_t* p, uint32_t v)
+{
+	p[0] = (uint8_t) v;
+	p[1] = (uint8_t) (v >> 8);
+	p[2] = (uint8_t) (v >> 16);
+	p[3] = (uint8_t) (v >> 24);
+}
+
+static inline uint32_t tcp_get_le32(const uint8_t* p)
+{
+	return (uint32_t) p[0] | ((uint32_t) p[1] << 8) | ((uint32_t) p[2] << 16) | ((uint32_t) p[3] << 24);
+}
+
+static inline void tcp_put_le64(uint8_t* p, uint64_t v)
+{
+	tcp_put_le32(p, (uint32_t) v);
+	tcp_put_le32(p + 4, (uint32_t) (v >> 32));
+}
+
+static inline uint64_t tcp_get_le64(const uint8_t* p)
+{
+	return (uint64_t) tcp_get_le32(p) | ((uint64_t) tcp_get_le32(p + 4) << 32);
+}
+
+static inline void tcp_format_pack(const tcp_format_t* format, uint8_t* p)
+{
+	tcp_put_le32(p, format->sample_type);
+	tcp_put_le32(p + 4, format->sample_rate);
+	tcp_put_le32(p + 8, format->decimation);
+	tcp_put_le32(p + 12, format->encoding);
+	tcp_put_le64(p + 16, format->freq_hz);
+}
+
+static inline void tcp_format_unpack(const uint8_t* p, tcp_format_t* format)
+{
+	format->sample_type = tcp_get_le32(p);
+	format->sample_rate = tcp_get_le32(p + 4);
+	format->decimation = tcp_get_le32(p + 8);
+	format->encoding = tcp_get_le32(p + 12);
+	format->freq_hz = tcp_get_le64(p + 16);
+}
+
+#endif /* TCP_PROTOCOL_H */
@@ -0,0 +1,204 @@
+/*
+Copyright (c) 2025 Benjamin Vernoux <bvernoux@hydrasdr.com>
+
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+
+Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the
+documentation and/or other materials provided with the distribution.
+Neither the name of HydraSDR nor the names of its contributors may be used to endorse or promote products derived from this software
+without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "channelizer.h"
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+#define SIZE_FACTOR 16
+
+/* Offset of the delay line of branch k (each one holds SIZE_FACTOR * taps IQ samples) */
+#define BRANCH_QUEUE(ch, k) ((ch)->queue + (size_t) (k) * (ch)->taps * SIZE_FACTOR * 2)
+
+static void design_prototype(float *h, int channels, int len)
+{
+	int i;
+	double x, w, sum;
+	double fc = 0.5 / channels;
+
+	sum = 0.0;
+	for (i = 0; i < len; i++)
+	{
+		x = i - (len - 1) / 2.0;
+		/* Blackman window */
+		w = 0.42 - 0.5 * cos(2.0 * M_PI * i / (len - 1)) + 0.08 * cos(4.0 * M_PI * i / (len - 1));
+		h[i] = (float) (w * (x == 0.0 ? 2.0 * fc : sin(2.0 * M_PI * fc * x) / (M_PI * x)));
+		sum += h[i];
+	}
+
+	/* Unity gain in the passband */
+	for (i = 0; i < len; i++)
+	{
+		h[i] = (float) (h[i] / sum);
+	}
+}
+
+channelizer_t *channelizer_create(int channels, int taps_per_branch)
+{
+	int k, p;
+	float *h;
+	channelizer_t *ch;
+
+	if (channels < 2 || channels > CHANNELIZER_MAX_CHANNELS || (channels & (channels - 1)) != 0)
+	{
+		return NULL;
+	}
+
+	if (taps_per_branch <= 0)
+	{
+		taps_per_branch = CHANNELIZER_DEFAULT_TAPS_PER_BRANCH;
+	}
+
+	ch = (channelizer_t *) calloc(1, sizeof(channelizer_t));
+	if (ch == NULL)
+	{
+		return NULL;
+	}
+
+	ch->channels = channels;
+	ch->taps = taps_per_branch;
+	ch->kernel = (float *) malloc((size_t) channels * taps_per_branch * 2 * sizeof(float));
+	ch->queue = (float *) malloc((size_t) channels * taps_per_branch * SIZE_FACTOR * 2 * sizeof(float));
+	ch->fft_buf = (float *) malloc((size_t) channels * 2 * sizeof(float));
+	ch->fft = fft_create(channels, 1);
+	h = (float *) malloc((size_t) channels * taps_per_branch * sizeof(float));
+
+	if (ch->kernel == NULL || ch->queue == NULL || ch->fft_buf == NULL || ch->fft == NULL || h == NULL)
+	{
+		free(h);
+		channelizer_free(ch);
+		return NULL;
+	}
+
+	design_prototype(h, channels, channels * taps_per_branch);
+
+	/* Branch k sees every M-th sample, with coefficients h[p * M + k] */
+	for (k = 0; k < channels; k++)
+	{
+		for (p = 0; p < taps_per_branch; p++)
+		{
+			ch->kernel[(k * taps_per_branch + p) * 2 + 0] = h[p * channels + k];
+			ch->kernel[(k * taps_per_branch + p) * 2 + 1] = h[p * channels + k];
+		}
+	}
+
+	free(h);
+
+	channelizer_reset(ch);
+
+	return ch;
+}
+
+void channelizer_free(channelizer_t *ch)
+{
+	if (ch != NULL)
+	{
+		free(ch->kernel);
+		free(ch->queue);
+		free(ch->fft_buf);
+		fft_free(ch->fft);
+		free(ch);
+	}
+}
+
+void channelizer_reset(channelizer_t *ch)
+{
+	ch->fill = 0;
+	ch->queue_index = ch->taps * (SIZE_FACTOR - 1);
+	memset(ch->queue, 0, (size_t) ch->channels * ch->taps * SIZE_FACTOR * 2 * sizeof(float));
+}
+
+int channelizer_process(channelizer_t *ch, const float *samples, int len, float * const *channel_out)
+{
+	int i, k, c, p;
+	int count = 0;
+	int channels = ch->channels;
+	int taps = ch->taps;
+	int fill = ch->fill;
+	int queue_index = ch->queue_index;
+	float acc_i, acc_q;
+	float *queue;
+	const float *kernel;
+
+	for (i = 0; i < len; i += 2)
+	{
+		/* Commutator: the first sample of a block feeds the last branch */
+		queue = BRANCH_QUEUE(ch, channels - 1 - fill) + 2 * queue_index;
+		queue[0] = samples[i + 0];
+		queue[1] = samples[i + 1];
+
+		if (++fill < channels)
+		{
+			continue;
+		}
+		fill = 0;
+
+		for (k = 0; k < channels; k++)
+		{
+			queue = BRANCH_QUEUE(ch, k) + 2 * queue_index;
+			kernel = ch->kernel + (size_t) k * taps * 2;
+
+			acc_i = 0.0f;
+			acc_q = 0.0f;
+			for (p = 0; p < 2 * taps; p += 2)
+			{
+				acc_i += kernel[p + 0] * queue[p + 0];
+				acc_q += kernel[p + 1] * queue[p + 1];
+			}
+
+			ch->fft_buf[2 * k + 0] = acc_i;
+			ch->fft_buf[2 * k + 1] = acc_q;
+		}
+
+		fft_process(ch->fft, ch->fft_buf);
+
+		for (c = 0; c < channels; c++)
+		{
+			if (channel_out[c] != NULL)
+			{
+				channel_out[c][2 * count + 0] = ch->fft_buf[2 * c + 0];
+				channel_out[c][2 * count + 1] = ch->fft_buf[2 * c + 1];
+			}
+		}
+		count++;
+
+		/* All delay lines advance together, one sample per block */
+		if (--queue_index < 0)
+		{
+			queue_index = taps * (SIZE_FACTOR - 1);
+			for (k = 0; k < channels; k++)
+			{
+				queue = BRANCH_QUEUE(ch, k);
+				memcpy(queue + 2 * (queue_index + 1), queue, (taps - 1) * 2 * sizeof(float));
+			}
+		}
+	}
+
+	ch->fill = fill;
+	ch->queue_index = queue_index;
+
+	return count;
+}
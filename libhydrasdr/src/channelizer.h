@@ -0,0 +1,56 @@
+/*
+Copyright (c) 2025 Benjamin Vernoux <bvernoux@hydrasdr.com>
+
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+
+Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the
+documentation and/or other materials provided with the distribution.
+Neither the name of HydraSDR nor the names of its contributors may be used to endorse or promote products derived from this software
+without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef CHANNELIZER_H
+#define CHANNELIZER_H
+
+#include <stdint.h>
+#include "fft.h"
+
+/*
+ * Critically sampled polyphase filter-bank channelizer.
+ * Splits the complex input into M equally spaced channels, each decimated by M.
+ * Channel c is centered on c * samplerate / M (channels above M / 2 are the negative offsets).
+ * Cost per input sample is taps_per_branch MACs plus one M points FFT every M samples.
+ */
+
+#define CHANNELIZER_DEFAULT_TAPS_PER_BRANCH (12)
+#define CHANNELIZER_MAX_CHANNELS (4096)
+
+typedef struct {
+	int channels;
+	int taps;        /* Taps per polyphase branch */
+	int fill;        /* Input samples already pushed in the current block */
+	int queue_index;
+	float *kernel;   /* Per branch kernels, each coefficient duplicated for I and Q */
+	float *queue;    /* Per branch delay lines, interleaved IQ */
+	float *fft_buf;
+	fft_t *fft;
+} channelizer_t;
+
+channelizer_t *channelizer_create(int channels, int taps_per_branch);
+void channelizer_free(channelizer_t *ch);
+void channelizer_reset(channelizer_t *ch);
+/* Process len floats of interleaved IQ, channel_out[c] receives channel c (NULL entries are skipped).
+   Returns the number of IQ samples written in each channel output */
+int channelizer_process(channelizer_t *ch, const float *samples, int len, float * const *channel_out);
+
+#endif // CHANNELIZER_H
@@ -0,0 +1,210 @@
+/*
+Copyright (c) 2025 Benjamin Vernoux <bvernoux@hydrasdr.com>
+
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+
+Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the
+documentation and/or other materials provided with the distribution.
+Neither the name of HydraSDR nor the names of its contributors may be used to endorse or promote products derived from this software
+without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "decimator_int16.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define SIZE_FACTOR 16
+
+decimator_int16_t *decimator_int16_create(const int16_t *hb_kernel, int len, int factor)
+{
+	int i;
+	decimator_int16_t *dec;
+	decimator_int16_stage_t *stage;
+
+	if (factor < 2 || (factor & (factor - 1)) != 0 || factor > (1 << DECIMATOR_INT16_MAX_STAGES))
+	{
+		return NULL;
+	}
+
+	dec = (decimator_int16_t *) calloc(1, sizeof(decimator_int16_t));
+	if (dec == NULL)
+	{
+		return NULL;
+	}
+
+	dec->len = len / 2 + 1;
+	while ((1 << dec->stage_count) < factor)
+	{
+		dec->stage_count++;
+	}
+
+	dec->fir_kernel = (int32_t *) malloc(dec->len * 2 * sizeof(int32_t));
+	if (dec->fir_kernel == NULL)
+	{
+		decimator_int16_free(dec);
+		return NULL;
+	}
+
+	for (i = 0; i < dec->len; i++)
+	{
+		dec->fir_kernel[2 * i + 0] = hb_kernel[i * 2];
+		dec->fir_kernel[2 * i + 1] = hb_kernel[i * 2];
+	}
+
+	for (i = 0; i < dec->stage_count; i++)
+	{
+		stage = &dec->stages[i];
+		stage->fir_queue = (int32_t *) malloc(dec->len * SIZE_FACTOR * 2 * sizeof(int32_t));
+		stage->delay_line = (int16_t *) malloc((dec->len / 2 - 1) * 2 * sizeof(int16_t));
+		if (stage->fir_queue == NULL || stage->delay_line == NULL)
+		{
+			decimator_int16_free(dec);
+			return NULL;
+		}
+	}
+
+	decimator_int16_reset(dec);
+
+	return dec;
+}
+
+void decimator_int16_free(decimator_int16_t *dec)
+{
+	int i;
+
+	if (dec != NULL)
+	{
+		for (i = 0; i < dec->stage_count; i++)
+		{
+			free(dec->stages[i].fir_queue);
+			free(dec->stages[i].delay_line);
+		}
+		free(dec->fir_kernel);
+		free(dec);
+	}
+}
+
+void decimator_int16_reset(decimator_int16_t *dec)
+{
+	int i;
+	decimator_int16_stage_t *stage;
+
+	for (i = 0; i < dec->stage_count; i++)
+	{
+		stage = &dec->stages[i];
+		stage->phase = 0;
+		stage->fir_index = dec->len * (SIZE_FACTOR - 1);
+		stage->delay_index = 0;
+		memset(stage->fir_queue, 0, dec->len * SIZE_FACTOR * 2 * sizeof(int32_t));
+		stage->pending[0] = 0;
+		stage->pending[1] = 0;
+		memset(stage->delay_line, 0, (dec->len / 2 - 1) * 2 * sizeof(int16_t));
+	}
+}
+
+static int16_t saturate_q15(int32_t acc)
+{
+	acc = (acc + (1 << 14)) >> 15;
+
+	if (acc > 32767)
+	{
+		return 32767;
+	}
+	if (acc < -32768)
+	{
+		return -32768;
+	}
+	return (int16_t) acc;
+}
+
+static int decimate_by_2(decimator_int16_t *dec, decimator_int16_stage_t *stage, int16_t *samples, int len)
+{
+	int i, j;
+	int count = 0;
+	int fir_len = dec->len;
+	int delay_len = dec->len / 2 - 1;
+	int phase = stage->phase;
+	int fir_index = stage->fir_index;
+	int delay_index = stage->delay_index;
+	int32_t acc_i, acc_q;
+	int32_t *queue;
+	int16_t *delayed;
+	const int32_t *kernel = dec->fir_kernel;
+
+	for (i = 0; i < len; i += 2)
+	{
+		if (phase == 0)
+		{
+			/* Center tap branch, kept until the FIR branch sample of the pair arrives */
+			stage->pending[0] = samples[i + 0];
+			stage->pending[1] = samples[i + 1];
+			phase = 1;
+			continue;
+		}
+		phase = 0;
+
+		queue = stage->fir_queue + 2 * fir_index;
+		queue[0] = samples[i + 0];
+		queue[1] = samples[i + 1];
+
+		acc_i = 0;
+		acc_q = 0;
+
+		// Auto vectorization works on VS2012, VS2013 and GCC
+		for (j = 0; j < 2 * fir_len; j += 2)
+		{
+			acc_i += kernel[j + 0] * queue[j + 0];
+			acc_q += kernel[j + 1] * queue[j + 1];
+		}
+
+		/* Center tap is 0.5 */
+		delayed = stage->delay_line + 2 * delay_index;
+		acc_i += (int32_t) delayed[0] << 14;
+		acc_q += (int32_t) delayed[1] << 14;
+		delayed[0] = stage->pending[0];
+		delayed[1] = stage->pending[1];
+
+		if (++delay_index >= delay_len)
+		{
+			delay_index = 0;
+		}
+
+		if (--fir_index < 0)
+		{
+			fir_index = fir_len * (SIZE_FACTOR - 1);
+			memcpy(stage->fir_queue + 2 * (fir_index + 1), stage->fir_queue, (fir_len - 1) * 2 * sizeof(int32_t));
+		}
+
+		samples[count + 0] = saturate_q15(acc_i);
+		samples[count + 1] = saturate_q15(acc_q);
+		count += 2;
+	}
+
+	stage->phase = phase;
+	stage->fir_index = fir_index;
+	stage->delay_index = delay_index;
+
+	return count;
+}
+
+int decimator_int16_process(decimator_int16_t *dec, int16_t *samples, int len)
+{
+	int i;
+
+	for (i = 0; i < dec->stage_count; i++)
+	{
+		len = decimate_by_2(dec, &dec->stages[i], samples, len);
+	}
+
+	return len;
+}
@@ -0,0 +1,59 @@
+/*
+Copyright (c) 2025 Benjamin Vernoux <bvernoux@hydrasdr.com>
+
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+
+Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the
+documentation and/or other materials provided with the distribution.
+Neither the name of HydraSDR nor the names of its contributors may be used to endorse or promote products derived from this software
+without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef DECIMATOR_INT16_H
+#define DECIMATOR_INT16_H
+
+#include <stdint.h>
+
+/*
+ * Fixed-point decimator for interleaved int16 IQ.
+ * Cascade of half-band decimate-by-2 stages sharing the Q15 kernel of the IQ converter.
+ * Even taps run as a FIR on one polyphase branch, the center tap (0.5) is a delay on the other.
+ * Products accumulate in int32, outputs are rounded and saturated to int16.
+ */
+
+#define DECIMATOR_INT16_MAX_STAGES (8)
+
+typedef struct {
+	int phase;        /* 1 when the next input feeds the FIR branch */
+	int fir_index;
+	int delay_index;
+	int32_t *fir_queue;  /* Interleaved IQ, newest sample first */
+	int16_t pending[2];  /* Center tap branch sample waiting for its pair */
+	int16_t *delay_line; /* Interleaved IQ, holds the center tap branch for len / 2 - 1 pairs */
+} decimator_int16_stage_t;
+
+typedef struct {
+	int len;          /* Non zero taps of the FIR branch */
+	int stage_count;
+	int32_t *fir_kernel; /* Each coefficient duplicated for I and Q */
+	decimator_int16_stage_t stages[DECIMATOR_INT16_MAX_STAGES];
+} decimator_int16_t;
+
+/* factor shall be a power of 2 between 2 and 2^DECIMATOR_INT16_MAX_STAGES */
+decimator_int16_t *decimator_int16_create(const int16_t *hb_kernel, int len, int factor);
+void decimator_int16_free(decimator_int16_t *dec);
+void decimator_int16_reset(decimator_int16_t *dec);
+/* Decimates len int16 of interleaved IQ in place, returns the number of int16 written */
+int decimator_int16_process(decimator_int16_t *dec, int16_t *samples, int len);
+
+#endif // DECIMATOR_INT16_H
@@ -0,0 +1,133 @@
+/*
+Copyright (c) 2025 Benjamin Vernoux <bvernoux@hydrasdr.com>
+
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+
+Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the
+documentation and/or other materials provided with the distribution.
+Neither the name of HydraSDR nor the names of its contributors may be used to endorse or promote products derived from this software
+without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "fft.h"
+#include <stdlib.h>
+#include <math.h>
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+fft_t *fft_create(int size, int inverse)
+{
+	int i, j, bits;
+	double angle;
+	fft_t *fft;
+
+	if (size < 2 || (size & (size - 1)) != 0)
+	{
+		return NULL;
+	}
+
+	fft = (fft_t *) malloc(sizeof(fft_t));
+	if (fft == NULL)
+	{
+		return NULL;
+	}
+
+	fft->size = size;
+	fft->twiddle = (float *) malloc(size * sizeof(float));
+	fft->bitrev = (int *) malloc(size * sizeof(int));
+	if (fft->twiddle == NULL || fft->bitrev == NULL)
+	{
+		fft_free(fft);
+		return NULL;
+	}
+
+	for (i = 0; i < size / 2; i++)
+	{
+		angle = (inverse ? 2.0 : -2.0) * M_PI * i / size;
+		fft->twiddle[2 * i + 0] = (float) cos(angle);
+		fft->twiddle[2 * i + 1] = (float) sin(angle);
+	}
+
+	for (bits = 0; (1 << bits) < size; bits++)
+		;
+
+	for (i = 0; i < size; i++)
+	{
+		int r = 0;
+		for (j = 0; j < bits; j++)
+		{
+			r |= ((i >> j) & 1) << (bits - 1 - j);
+		}
+		fft->bitrev[i] = r;
+	}
+
+	return fft;
+}
+
+void fft_free(fft_t *fft)
+{
+	if (fft != NULL)
+	{
+		free(fft->twiddle);
+		free(fft->bitrev);
+		free(fft);
+	}
+}
+
+void fft_process(fft_t *fft, float *buf)
+{
+	int i, j, k, half, step;
+	int size = fft->size;
+	const float *tw = fft->twiddle;
+	float tr, ti, wr, wi;
+	float *a, *b;
+
+	for (i = 0; i < size; i++)
+	{
+		j = fft->bitrev[i];
+		if (j > i)
+		{
+			tr = buf[2 * i + 0];
+			ti = buf[2 * i + 1];
+			buf[2 * i + 0] = buf[2 * j + 0];
+			buf[2 * i + 1] = buf[2 * j + 1];
+			buf[2 * j + 0] = tr;
+			buf[2 * j + 1] = ti;
+		}
+	}
+
+	for (half = 1, step = size / 2; half < size; half <<= 1, step >>= 1)
+	{
+		for (i = 0; i < size; i += 2 * half)
+		{
+			a = buf + 2 * i;
+			b = a + 2 * half;
+
+			for (k = 0; k < half; k++)
+			{
+				wr = tw[2 * k * step + 0];
+				wi = tw[2 * k * step + 1];
+
+				tr = b[2 * k + 0] * wr - b[2 * k + 1] * wi;
+				ti = b[2 * k + 0] * wi + b[2 * k + 1] * wr;
+
+				b[2 * k + 0] = a[2 * k + 0] - tr;
+				b[2 * k + 1] = a[2 * k + 1] - ti;
+				a[2 * k + 0] += tr;
+				a[2 * k + 1] += ti;
+			}
+		}
+	}
+}
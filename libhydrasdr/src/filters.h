@@ -29,7 +29,7 @@ THE SOFTWARE.
 
 #define HB_KERNEL_FLOAT_LEN 47
 
-const float HB_KERNEL_FLOAT[HB_KERNEL_FLOAT_LEN] =
+static const float HB_KERNEL_FLOAT[HB_KERNEL_FLOAT_LEN] =
 {
 	-0.000998606272947510,
 	 0.000000000000000000,
@@ -82,7 +82,7 @@ const float HB_KERNEL_FLOAT[HB_KERNEL_FLOAT_LEN] =
 
 #define HB_KERNEL_INT16_LEN 47
 
-const int16_t HB_KERNEL_INT16[HB_KERNEL_INT16_LEN] =
+static const int16_t HB_KERNEL_INT16[HB_KERNEL_INT16_LEN] =
 {
 	-33,
 	 0,
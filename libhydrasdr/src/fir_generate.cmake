@@ -0,0 +1,133 @@
+# Copyright 2025 Benjamin Vernoux
+#
+# This file is part of HydraSDR.
+#
+# Generates the unrolled FIR loops of iqconverter_float.c and iqconverter_int16.c,
+# one per tap count from 1 to MAX_TAPS, with the symmetric kernel folded
+# (k[j] * (q[j] + q[taps - 1 - j]), half the multiplications).
+# Usage: cmake -DMAX_TAPS=<n> -DOUTPUT_FLOAT=<file> -DOUTPUT_INT16=<file> -P fir_generate.cmake
+
+if(NOT MAX_TAPS OR NOT OUTPUT_FLOAT OR NOT OUTPUT_INT16)
+  message(FATAL_ERROR "MAX_TAPS, OUTPUT_FLOAT and OUTPUT_INT16 are required")
+endif()
+
+set(header "/* Generated by fir_generate.cmake, do not edit */\n\n#define FIR_GENERATED_MAX_TAPS (${MAX_TAPS})\n")
+set(float_code "${header}")
+set(int16_code "${header}")
+set(float_table "")
+set(int16_table "")
+
+foreach(taps RANGE 1 ${MAX_TAPS})
+  math(EXPR half "${taps} / 2")
+  math(EXPR odd "${taps} % 2")
+
+  # Same summation order as the hand written 4, 8, 12 and 24 taps loops
+  set(float_sum "")
+  set(int16_sum "")
+  if(half GREATER 0)
+    math(EXPR last "${half} - 1")
+    foreach(j RANGE 0 ${last})
+      math(EXPR m "${taps} - 1 - ${j}")
+      if(j GREATER 0)
+        string(APPEND float_sum "\n\t\t\t+ ")
+        string(APPEND int16_sum "\n\t\t\t+ ")
+      endif()
+      string(APPEND float_sum "fir_kernel[${j}] * (queue[${j}] + queue[${m}])")
+      string(APPEND int16_sum "fir_kernel[${j}] * (queue[${j}] + queue[${m}])")
+    endforeach()
+  endif()
+  if(odd)
+    if(half GREATER 0)
+      string(APPEND float_sum "\n\t\t\t+ ")
+      string(APPEND int16_sum "\n\t\t\t+ ")
+    endif()
+    string(APPEND float_sum "fir_kernel[${half}] * queue[${half}]")
+    string(APPEND int16_sum "fir_kernel[${half}] * queue[${half}]")
+  endif()
+
+  string(APPEND float_code "
+static void fir_generated_${taps}(iqconverter_float_t *cnv, float *samples, int len)
+{
+	int i;
+	int fir_index = cnv->fir_index;
+	int fir_len = cnv->len;
+	const float *fir_kernel = cnv->fir_kernel;
+	float *fir_queue = cnv->fir_queue;
+	float *queue;
+
+	for (i = 0; i < len; i += 2)
+	{
+		queue = fir_queue + fir_index;
+
+		queue[0] = samples[i];
+
+		samples[i] = ${float_sum};
+
+		if (--fir_index < 0)
+		{
+			fir_index = fir_len * (SIZE_FACTOR - 1);
+			memcpy(fir_queue + fir_index + 1, fir_queue, (fir_len - 1) * sizeof(float));
+		}
+	}
+
+	cnv->fir_index = fir_index;
+}
+")
+
+  string(APPEND int16_code "
+static void fir_generated_${taps}(iqconverter_int16_t *cnv, int16_t *samples, int len)
+{
+	int i;
+	int fir_index = cnv->fir_index;
+	int fir_len = cnv->len;
+	const int32_t *fir_kernel = cnv->fir_kernel;
+	int32_t *fir_queue = cnv->fir_queue;
+	int32_t *queue;
+	int32_t acc;
+
+	for (i = 0; i < len; i += 2)
+	{
+		queue = fir_queue + fir_index;
+
+		queue[0] = samples[i];
+
+		acc = ${int16_sum};
+
+		if (--fir_index < 0)
+		{
+			fir_index = fir_len * (SIZE_FACTOR - 1);
+			memcpy(fir_queue + fir_index + 1, fir_queue, (fir_len - 1) * sizeof(int32_t));
+		}
+
+		samples[i] = acc >> 15;
+	}
+
+	cnv->fir_index = fir_index;
+}
+")
+
+  string(APPEND float_table "\tfir_generated_${taps},\n")
+  string(APPEND int16_table "\tfir_generated_${taps},\n")
+endforeach()
+
+string(APPEND float_code "
+/* Indexed by the number of taps */
+static void (* const fir_generated[FIR_GENERATED_MAX_TAPS + 1])(iqconverter_float_t *cnv, float *samples, int len) =
+{
+\tNULL,
+${float_table}};
+")
+string(APPEND int16_code "
+/* Indexed by the number of taps */
+static void (* const fir_generated[FIR_GENERATED_MAX_TAPS + 1])(iqconverter_int16_t *cnv, int16_t *samples, int len) =
+{
+\tNULL,
+${int16_table}};
+")
+
+# Only rewrite changed files so that the converters are not rebuilt needlessly
+file(WRITE "${OUTPUT_FLOAT}.tmp" "${float_code}")
+file(WRITE "${OUTPUT_INT16}.tmp" "${int16_code}")
+execute_process(COMMAND ${CMAKE_COMMAND} -E copy_if_different "${OUTPUT_FLOAT}.tmp" "${OUTPUT_FLOAT}")
+execute_process(COMMAND ${CMAKE_COMMAND} -E copy_if_different "${OUTPUT_INT16}.tmp" "${OUTPUT_INT16}")
+file(REMOVE "${OUTPUT_FLOAT}.tmp" "${OUTPUT_INT16}.tmp")
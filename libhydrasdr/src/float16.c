@@ -0,0 +1,136 @@
+/*
+Copyright (c) 2025 Benjamin Vernoux <bvernoux@hydrasdr.com>
+
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+
+Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the
+documentation and/or other materials provided with the distribution.
+Neither the name of HydraSDR nor the names of its contributors may be used to endorse or promote products derived from this software
+without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "float16.h"
+#include <string.h>
+
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+  #include <immintrin.h>
+  #define FLOAT16_F16C_TARGET __attribute__((target("avx,f16c")))
+  /* Every AVX2 CPU has F16C and "avx2" is known by all __builtin_cpu_supports() versions */
+  #define FLOAT16_F16C_AVAILABLE() __builtin_cpu_supports("avx2")
+#elif defined(_MSC_VER) && defined(__AVX2__)
+  #include <immintrin.h>
+  #define FLOAT16_F16C_TARGET
+  #define FLOAT16_F16C_AVAILABLE() 1
+#elif defined(__aarch64__)
+  #include <arm_neon.h>
+  #define FLOAT16_USE_NEON
+#endif
+
+/* Scalar conversion, F. Giesen "float_to_half_fast3_rtne" */
+static uint16_t float_to_half(float value)
+{
+	const uint32_t f32infty = 255u << 23;
+	const uint32_t f16max = (127u + 16) << 23;
+	const uint32_t denorm_magic_bits = ((127u - 15) + (23 - 10) + 1) << 23;
+	uint32_t f, sign, mant_odd;
+	float tmp, denorm_magic;
+	uint16_t o;
+
+	memcpy(&f, &value, sizeof(f));
+	sign = f & 0x80000000u;
+	f ^= sign;
+
+	if (f >= f16max)
+	{
+		/* Overflow to infinity, NaN stays a quiet NaN */
+		o = (f > f32infty) ? 0x7E00 : 0x7C00;
+	}
+	else if (f < (113u << 23))
+	{
+		/* Subnormal result, the float addition does the rounding */
+		memcpy(&tmp, &f, sizeof(tmp));
+		memcpy(&denorm_magic, &denorm_magic_bits, sizeof(denorm_magic));
+		tmp += denorm_magic;
+		memcpy(&f, &tmp, sizeof(f));
+		o = (uint16_t) (f - denorm_magic_bits);
+	}
+	else
+	{
+		mant_odd = (f >> 13) & 1;
+		f += ((uint32_t) (15 - 127) << 23) + 0xFFF;
+		f += mant_odd;
+		o = (uint16_t) (f >> 13);
+	}
+
+	return o | (uint16_t) (sign >> 16);
+}
+
+static void convert_scalar(const float *src, uint16_t *dest, int start, int len)
+{
+	int i;
+
+	for (i = start; i < len; i++)
+	{
+		dest[i] = float_to_half(src[i]);
+	}
+}
+
+#ifdef FLOAT16_F16C_TARGET
+FLOAT16_F16C_TARGET
+static void convert_f16c(const float *src, uint16_t *dest, int len)
+{
+	int i;
+	__m256 v;
+
+	/* Each load happens before the (twice smaller) store, which keeps the in place case valid */
+	for (i = 0; i + 8 <= len; i += 8)
+	{
+		v = _mm256_loadu_ps(src + i);
+		_mm_storeu_si128((__m128i *) (dest + i), _mm256_cvtps_ph(v, _MM_FROUND_TO_NEAREST_INT));
+	}
+
+	convert_scalar(src, dest, i, len);
+}
+#endif
+
+#ifdef FLOAT16_USE_NEON
+static void convert_neon(const float *src, uint16_t *dest, int len)
+{
+	int i;
+	float32x4_t v;
+
+	for (i = 0; i + 4 <= len; i += 4)
+	{
+		v = vld1q_f32(src + i);
+		vst1_u16(dest + i, vreinterpret_u16_f16(vcvt_f16_f32(v)));
+	}
+
+	convert_scalar(src, dest, i, len);
+}
+#endif
+
+void float16_convert(const float *src, uint16_t *dest, int len)
+{
+#if defined(FLOAT16_F16C_TARGET)
+	if (FLOAT16_F16C_AVAILABLE())
+	{
+		convert_f16c(src, dest, len);
+		return;
+	}
+#elif defined(FLOAT16_USE_NEON)
+	convert_neon(src, dest, len);
+	return;
+#endif
+
+	convert_scalar(src, dest, 0, len);
+}
@@ -26,6 +26,7 @@ ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSI
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
 #include <libusb.h>
 
 #if _MSC_VER > 1700  // To avoid error with Visual Studio 2017/2019 or more define which define timespec as it is already defined in pthread.h
@@ -37,6 +38,14 @@ ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSI
 #include "hydrasdr.h"
 #include "iqconverter_float.h"
 #include "iqconverter_int16.h"
+#include "nco.h"
+#include "channelizer.h"
+#include "resampler.h"
+#include "decimator_int16.h"
+#include "sample_convert.h"
+#include "sample_pack.h"
+#include "float16.h"
+#include "shm_ring.h"
 #include "filters.h"
 
 #if !defined(__STDC_VERSION__) || __STDC_VERSION__ < 202311L
@@ -50,6 +59,13 @@ typedef int bool;
 #define UNPACKED_SIZE (16) /* ADC Sample unpacked size in bits */
 #define PACKED_SIZE (12) /* ADC Sample Packed size in bits */
 #define RAW_BUFFER_COUNT (8)
+#define BUFFER_SIZE_UNPACKED (262144)
+#define BUFFER_SIZE_PACKED (6144 * 24)
+/* Largest number of IQ samples delivered per buffer (unpacked buffers hold the most samples) */
+#define MAX_IQ_SAMPLES_PER_BUFFER (BUFFER_SIZE_UNPACKED / 4)
+/* Shared memory slots hold the largest FLOAT32_IQ buffer, the resampler may output one more sample than it reads */
+#define SHM_SLOT_SIZE ((MAX_IQ_SAMPLES_PER_BUFFER + 1) * 2 * sizeof(float))
+#define SHM_DEFAULT_SLOT_COUNT (64)
 
 #ifdef HYDRASDR_BIG_ENDIAN
 #define TO_LE_32(x) __builtin_bswap32(x)
@@ -59,12 +75,6 @@ typedef int bool;
 #define TO_LE_64(x) x
 #endif
 
-#define SAMPLE_RESOLUTION 12
-#define SAMPLE_ENCAPSULATION 16
-
-#define SAMPLE_SHIFT (SAMPLE_ENCAPSULATION - SAMPLE_RESOLUTION)
-#define SAMPLE_SCALE (1.0f / (1 << (15 - SAMPLE_SHIFT)))
-
 #define SERIAL_NUMBER_UNUSED (0ULL)
 #define FILE_DESCRIPTOR_UNUSED (-1)
 
@@ -72,7 +82,8 @@ typedef int bool;
 #define STR_DESCRIPTOR_SIZE (250)
 
 #define MIN_SAMPLERATE_BY_VALUE (1000000)
-#define SAMPLE_TYPE_IS_IQ(x) ((x) == HYDRASDR_SAMPLE_FLOAT32_IQ || (x) == HYDRASDR_SAMPLE_INT16_IQ)
+#define SAMPLE_TYPE_IS_IQ(x) ((x) == HYDRASDR_SAMPLE_FLOAT32_IQ || (x) == HYDRASDR_SAMPLE_INT16_IQ || \
+	(x) == HYDRASDR_SAMPLE_INT8_IQ || (x) == HYDRASDR_SAMPLE_PACKED12_IQ || (x) == HYDRASDR_SAMPLE_FLOAT16_IQ)
 #define LIBUSB_CTRL_TIMEOUT_MS (500)
 #define LIBUSB_CTRL_TIMEOUT_CHIPERASE_MS (32000) // W25Q80DV Chip Erase Time up to 8s or 64KB Erase Block(s)(16blocks of 64KB) 32s max
 
@@ -97,6 +108,20 @@ typedef struct {
 	uint64_t freq_hz;
 } set_freq_params_t;
 
+typedef struct {
+	volatile hydrasdr_sample_block_cb_fn callback;
+	void* volatile ctx;
+	float *samples;
+} hydrasdr_channel_t;
+
+/* Buffers lost just before the one being converted, by where they were lost */
+typedef struct {
+	uint32_t sequence;
+	uint32_t dropped_firmware;
+	uint32_t dropped_usb;
+	uint32_t dropped_host;
+} buffer_info_t;
+
 typedef struct hydrasdr_device
 {
 	libusb_context* usb_context;
@@ -111,26 +136,86 @@ typedef struct hydrasdr_device
 	bool consumer_thread_running;
 	pthread_cond_t consumer_cv;
 	pthread_mutex_t consumer_mp;
+	/* The threads are parked between sessions on io_cv (consumer_mp locked) until hydrasdr_close() */
+	pthread_cond_t io_cv;
+	uint32_t io_session; /* Incremented by each hydrasdr_start_rx() */
+	int io_busy; /* Threads in a session */
+	bool io_exit;
+	int transfers_in_flight; /* Submitted USB transfers, owned by the thread handling the USB events while streaming */
+	bool external_events; /* USB events handled by hydrasdr_handle_events_nonblocking(), no transfer thread */
 	uint32_t supported_samplerate_count;
 	uint32_t *supported_samplerates;
 	uint32_t transfer_count;
 	uint32_t buffer_size;
 	uint32_t dropped_buffers;
+	uint32_t dropped_flags; /* HYDRASDR_TRANSFER_DROPPED_NEWEST/OLDEST for the next buffer queued */
 	uint32_t dropped_buffers_queue[RAW_BUFFER_COUNT];
+	uint32_t dropped_flags_queue[RAW_BUFFER_COUNT];
 	uint16_t *received_samples_queue[RAW_BUFFER_COUNT];
+	uint16_t *consumer_samples; /* Swapped with the queue slot at dequeue, so every slot can be queued */
+	enum hydrasdr_overflow_policy overflow_policy;
+	int overflow_watermark; /* Queued buffers from which HYDRASDR_OVERFLOW_DEGRADE skips the conversion */
+	bool degraded;
 	volatile int received_samples_queue_head;
 	volatile int received_samples_queue_tail;
 	volatile int received_buffer_count;
 	void *output_buffer;
 	uint16_t *unpacked_samples;
 	bool packing_enabled;
+	bool header_enabled; /* Packing mode 2, the buffers starting with hydrasdr_buffer_header_t carry it */
+	bool header_synced; /* A valid header was received since hydrasdr_start_rx() */
+	uint32_t header_sequence; /* Sequence expected in the next header */
+	uint32_t header_dropped; /* Firmware drop counter of the last header */
+	uint64_t sample_index; /* Next output sample since hydrasdr_start_rx(), dropped samples included */
+	uint64_t channel_sample_index;
 	iqconverter_float_t *cnv_f;
 	iqconverter_int16_t *cnv_i;
+	nco_t *nco;
+	volatile uint32_t nco_phase_inc;
+	int32_t nco_freq_hz;
+	uint32_t adc_samplerate;
+	uint32_t iq_samplerate;
+	decimator_int16_t *decimator;
+	resampler_t *resampler;
+	float *resampler_buffer;
+	channelizer_t *channelizer;
+	hydrasdr_channel_t *channels;
+	float **channel_out;
+	bool dithering;
+	uint32_t dither_state;
 	void* ctx;
 	enum hydrasdr_sample_type sample_type;
 	bool reset_command; /* HYDRASDR_RESET command executed ? */
+	FILE* replay_file; /* RAW capture replayed instead of a USB device (hydrasdr_open_file) */
+	bool replay_realtime;
+	bool replay_loop;
+	uint64_t replay_offset;
+	uint64_t replay_length; /* 0 replays up to the end of the file */
+	shm_ring_t* shm_ring; /* Every buffer delivered is also published here (hydrasdr_set_shm_publisher) */
+	/* Set while streaming, installed by the consumer thread between two buffers (consumer_mp locked) */
+	iqconverter_float_t *pending_cnv_f;
+	iqconverter_int16_t *pending_cnv_i;
+	enum hydrasdr_sample_type pending_sample_type;
+	uint32_t pending_flags; /* enum hydrasdr_transfer_flags */
 } hydrasdr_device_t;
 
+struct hydrasdr_shm_reader
+{
+	shm_ring_t* ring;
+};
+
+static const uint8_t sample_type_bytes[HYDRASDR_SAMPLE_END] = {
+	8, /* HYDRASDR_SAMPLE_FLOAT32_IQ */
+	4, /* HYDRASDR_SAMPLE_FLOAT32_REAL */
+	4, /* HYDRASDR_SAMPLE_INT16_IQ */
+	2, /* HYDRASDR_SAMPLE_INT16_REAL */
+	2, /* HYDRASDR_SAMPLE_UINT16_REAL */
+	0, /* HYDRASDR_SAMPLE_RAW, size of the device buffer */
+	2, /* HYDRASDR_SAMPLE_INT8_IQ */
+	3, /* HYDRASDR_SAMPLE_PACKED12_IQ */
+	4, /* HYDRASDR_SAMPLE_FLOAT16_IQ */
+};
+
 #define STR_PREFIX_SERIAL_HYDRASDR_SIZE (12)
 
 #define SERIAL_HYDRASDR_EXPECTED_SIZE (28)
@@ -164,6 +249,12 @@ static int cancel_transfers(hydrasdr_device_t* device)
 
 	if (device->transfers != NULL)
 	{
+		if (device->replay_file != NULL)
+		{
+			/* Replay transfers are never submitted */
+			return HYDRASDR_SUCCESS;
+		}
+
 		for (transfer_index = 0; transfer_index<device->transfer_count; transfer_index++)
 		{
 			if (device->transfers[transfer_index] != NULL)
@@ -218,6 +309,9 @@ static int free_transfers(hydrasdr_device_t* device)
 				device->received_samples_queue[i] = NULL;
 			}
 		}
+
+		free(device->consumer_samples);
+		device->consumer_samples = NULL;
 	}
 
 	return HYDRASDR_SUCCESS;
@@ -242,6 +336,12 @@ static int allocate_transfers(hydrasdr_device_t* const device)
 			memset(device->received_samples_queue[i], 0, device->buffer_size);
 		}
 
+		device->consumer_samples = (uint16_t *)calloc(1, device->buffer_size);
+		if (device->consumer_samples == NULL)
+		{
+			return HYDRASDR_ERROR_NO_MEM;
+		}
+
 		if (device->packing_enabled)
 		{
 			sample_count = ((device->buffer_size / 2) * 4) / 3;
@@ -320,6 +420,7 @@ static int prepare_transfers(hydrasdr_device_t* device, const uint_fast8_t endpo
 			{
 				return HYDRASDR_ERROR_LIBUSB;
 			}
+			device->transfers_in_flight++;
 		}
 		return HYDRASDR_SUCCESS;
 	}
@@ -329,63 +430,231 @@ static int prepare_transfers(hydrasdr_device_t* device, const uint_fast8_t endpo
 	}
 }
 
-static void convert_samples_int16(uint16_t *src, int16_t *dest, int count)
+/* 1 for the float IQ chain, 2 for the int16 IQ chain, 0 for the stateless conversions */
+static int sample_type_chain(enum hydrasdr_sample_type sample_type)
 {
-	int i;
-	for (i = 0; i < count; i += 4)
+	switch (sample_type)
 	{
-		dest[i + 0] = (src[i + 0] - 2048) << SAMPLE_SHIFT;
-		dest[i + 1] = (src[i + 1] - 2048) << SAMPLE_SHIFT;
-		dest[i + 2] = (src[i + 2] - 2048) << SAMPLE_SHIFT;
-		dest[i + 3] = (src[i + 3] - 2048) << SAMPLE_SHIFT;
+	case HYDRASDR_SAMPLE_FLOAT32_IQ:
+	case HYDRASDR_SAMPLE_FLOAT16_IQ:
+		return 1;
+
+	case HYDRASDR_SAMPLE_INT16_IQ:
+	case HYDRASDR_SAMPLE_INT8_IQ:
+	case HYDRASDR_SAMPLE_PACKED12_IQ:
+		return 2;
+
+	default:
+		return 0;
 	}
 }
 
-static void convert_samples_float(uint16_t *src, float *dest, int count)
+/* IQ rate of the firmware ADC rate (0 if not set yet) whatever the sample type it was set with, and the NCO increment */
+static void update_iq_samplerate(hydrasdr_device_t* device)
 {
-	int i;
-	for (i = 0; i < count; i += 4)
+	device->iq_samplerate = device->adc_samplerate / 2;
+	device->nco_phase_inc = nco_freq_to_phase_inc(-(int64_t) device->nco_freq_hz, device->iq_samplerate);
+}
+
+/* Installs the changes made while streaming, consumer_mp locked, returns their flags */
+static uint32_t apply_pending_config(hydrasdr_device_t* device)
+{
+	uint32_t flags = device->pending_flags;
+	int chain;
+
+	/* The new filter continues the input history, a longer one misses the oldest of it (flagged for the chain in use) */
+	chain = sample_type_chain((flags & HYDRASDR_TRANSFER_SAMPLE_TYPE_CHANGED) ? device->pending_sample_type : device->sample_type);
+	if (device->pending_cnv_f != NULL)
 	{
-		dest[i + 0] = (src[i + 0] - 2048) * SAMPLE_SCALE;
-		dest[i + 1] = (src[i + 1] - 2048) * SAMPLE_SCALE;
-		dest[i + 2] = (src[i + 2] - 2048) * SAMPLE_SCALE;
-		dest[i + 3] = (src[i + 3] - 2048) * SAMPLE_SCALE;
+		if (iqconverter_float_seed(device->pending_cnv_f, device->cnv_f) && chain == 1)
+		{
+			flags |= HYDRASDR_TRANSFER_FILTER_TRANSIENT;
+		}
+		iqconverter_float_free(device->cnv_f);
+		device->cnv_f = device->pending_cnv_f;
+		device->pending_cnv_f = NULL;
 	}
+
+	if (device->pending_cnv_i != NULL)
+	{
+		if (iqconverter_int16_seed(device->pending_cnv_i, device->cnv_i) && chain == 2)
+		{
+			flags |= HYDRASDR_TRANSFER_FILTER_TRANSIENT;
+		}
+		iqconverter_int16_free(device->cnv_i);
+		device->cnv_i = device->pending_cnv_i;
+		device->pending_cnv_i = NULL;
+	}
+
+	if (flags & HYDRASDR_TRANSFER_SAMPLE_TYPE_CHANGED)
+	{
+		chain = sample_type_chain(device->pending_sample_type);
+		if (chain != sample_type_chain(device->sample_type))
+		{
+			/* The chain of the new type may still hold samples of an earlier stream */
+			if (chain == 1)
+			{
+				iqconverter_float_reset(device->cnv_f);
+				if (device->resampler != NULL)
+				{
+					resampler_reset(device->resampler);
+				}
+				if (device->channelizer != NULL)
+				{
+					channelizer_reset(device->channelizer);
+				}
+			}
+			else if (chain == 2)
+			{
+				iqconverter_int16_reset(device->cnv_i);
+				if (device->decimator != NULL)
+				{
+					decimator_int16_reset(device->decimator);
+				}
+			}
+		}
+		device->sample_type = device->pending_sample_type;
+		update_iq_samplerate(device);
+	}
+
+	device->pending_flags = 0;
+
+	return flags;
 }
 
-static inline void unpack_samples(uint32_t *input, uint16_t *output, int length)
+/*
+ * Header mode: splits the buffers lost before this one by where they were lost, info->dropped_host holds the host queue drops.
+ * The sequence gap counts all of them, the firmware counter its own and the rest of the gap was lost on USB.
+ * Returns false if the buffer does not start with the magic, which 12 bits samples never match: a firmware
+ * without the header streams its buffers as in PACKING_OFF.
+ */
+static bool read_buffer_header(hydrasdr_device_t* device, const uint16_t* samples, buffer_info_t* info)
 {
-	int i, j;
+	const hydrasdr_buffer_header_t* header = (const hydrasdr_buffer_header_t*) samples;
+	uint32_t lost;
+
+	if (header->magic != HYDRASDR_BUFFER_HEADER_MAGIC)
+	{
+		/* The losses are unknown until the next valid header */
+		device->header_synced = false;
+		return false;
+	}
 
-	for (i = 0, j = 0; j < length; i += 3, j += 8)
+	info->sequence = header->sequence;
+	if (device->header_synced)
 	{
-		output[j + 0] = (input[i] >> 20) & 0xfff;
-		output[j + 1] = (input[i] >> 8) & 0xfff;
-		output[j + 2] = ((input[i] & 0xff) << 4) | ((input[i + 1] >> 28) & 0xf);
-		output[j + 3] = ((input[i + 1] & 0xfff0000) >> 16);
-		output[j + 4] = ((input[i + 1] & 0xfff0) >> 4);
-		output[j + 5] = ((input[i + 1] & 0xf) << 8) | ((input[i + 2] & 0xff000000) >> 24);
-		output[j + 6] = ((input[i + 2] >> 12) & 0xfff);
-		output[j + 7] = ((input[i + 2] & 0xfff));
+		lost = header->sequence - device->header_sequence;
+		info->dropped_firmware = header->dropped - device->header_dropped;
+		if (info->dropped_firmware > lost)
+		{
+			info->dropped_firmware = lost;
+		}
+		lost -= info->dropped_firmware;
+		if (info->dropped_host > lost)
+		{
+			info->dropped_host = lost;
+		}
+		info->dropped_usb = lost - info->dropped_host;
 	}
+	device->header_synced = true;
+	device->header_sequence = header->sequence + 1;
+	device->header_dropped = header->dropped;
+
+	return true;
 }
 
-static void* consumer_threadproc(void *arg)
+/* Fills the drop fields of transfer, the lost buffers had samples_per_buffer output samples each */
+static void set_transfer_drops(hydrasdr_transfer_t* transfer, const buffer_info_t* info, uint64_t samples_per_buffer)
 {
-	int sample_count;
-	uint16_t* input_samples;
-	uint32_t dropped_buffers;
-	hydrasdr_device_t* device = (hydrasdr_device_t*)arg;
+	transfer->dropped_firmware_samples = (uint64_t) info->dropped_firmware * samples_per_buffer;
+	transfer->dropped_usb_samples = (uint64_t) info->dropped_usb * samples_per_buffer;
+	transfer->dropped_host_samples = (uint64_t) info->dropped_host * samples_per_buffer;
+	transfer->dropped_samples = transfer->dropped_firmware_samples + transfer->dropped_usb_samples + transfer->dropped_host_samples;
+	transfer->sequence = info->sequence;
+}
+
+static void process_channels(hydrasdr_device_t* device, float *samples, int len, const buffer_info_t* info, uint32_t flags)
+{
+	int i;
+	int count;
+	int channel_count = device->channelizer->channels;
+	hydrasdr_sample_block_cb_fn callback;
 	hydrasdr_transfer_t transfer;
+	uint64_t dropped_buffers;
 
-#ifdef _WIN32
+	for (i = 0; i < channel_count; i++)
+	{
+		device->channel_out[i] = (device->channels[i].callback != NULL) ? device->channels[i].samples : NULL;
+	}
 
-	SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_HIGHEST);
+	count = channelizer_process(device->channelizer, samples, len, device->channel_out);
 
-#endif
+	dropped_buffers = (uint64_t) info->dropped_firmware + info->dropped_usb + info->dropped_host;
+	device->channel_sample_index += dropped_buffers * (uint64_t) (len / 2 / channel_count);
+
+	for (i = 0; i < channel_count; i++)
+	{
+		callback = device->channels[i].callback;
+		if (callback == NULL || device->channel_out[i] == NULL || count == 0)
+		{
+			continue;
+		}
+
+		transfer.device = device;
+		transfer.ctx = device->channels[i].ctx;
+		transfer.samples = device->channels[i].samples;
+		transfer.sample_count = count;
+		transfer.sample_type = HYDRASDR_SAMPLE_FLOAT32_IQ;
+		set_transfer_drops(&transfer, info, (uint64_t) (len / 2 / channel_count));
+		transfer.sample_index = device->channel_sample_index;
+		transfer.flags = flags;
+
+		if (callback(&transfer) != 0)
+		{
+			device->streaming = false;
+		}
+	}
+
+	device->channel_sample_index += (uint64_t) count;
+}
+
+static void free_channelizer(hydrasdr_device_t* device)
+{
+	int i;
+
+	if (device->channelizer != NULL)
+	{
+		for (i = 0; i < device->channelizer->channels; i++)
+		{
+			free(device->channels[i].samples);
+		}
+		free(device->channels);
+		free(device->channel_out);
+		channelizer_free(device->channelizer);
+
+		device->channels = NULL;
+		device->channel_out = NULL;
+		device->channelizer = NULL;
+	}
+}
+
+static void consumer_session(hydrasdr_device_t* device)
+{
+	int sample_count;
+	float *iq_samples;
+	uint16_t* input_samples;
+	uint32_t raw_bytes;
+	uint32_t flags;
+	uint64_t buffer_samples = 0;
+	int backlog;
+	bool callback_stopped = false;
+	enum hydrasdr_sample_type sample_type;
+	buffer_info_t info;
+	hydrasdr_transfer_t transfer;
 
 	pthread_mutex_lock(&device->consumer_mp);
 
+	sample_type = device->sample_type;
 	while (device->streaming && !device->stop_requested)
 	{
 		while (device->received_buffer_count == 0 && device->streaming && !device->stop_requested)
@@ -397,17 +666,64 @@ static void* consumer_threadproc(void *arg)
 			break;
 		}
 
+		/* The slot gets the previous buffer of the consumer back, the producers can fill it at once */
 		input_samples = device->received_samples_queue[device->received_samples_queue_tail];
-		dropped_buffers = device->dropped_buffers_queue[device->received_samples_queue_tail];
+		device->received_samples_queue[device->received_samples_queue_tail] = device->consumer_samples;
+		device->consumer_samples = input_samples;
+		memset(&info, 0, sizeof(info));
+		info.dropped_host = device->dropped_buffers_queue[device->received_samples_queue_tail];
+		flags = device->dropped_flags_queue[device->received_samples_queue_tail];
 		device->received_samples_queue_tail = (device->received_samples_queue_tail + 1) & (RAW_BUFFER_COUNT - 1);
+		/* The backlog counts the buffer being delivered, so a watermark of RAW_BUFFER_COUNT engages on a full queue */
+		backlog = device->received_buffer_count--;
+
+		if (device->replay_file != NULL)
+		{
+			/* Wake up the replay thread waiting for a free buffer */
+			pthread_cond_signal(&device->consumer_cv);
+		}
+
+		if (device->pending_flags != 0)
+		{
+			flags |= apply_pending_config(device);
+		}
+
+		sample_type = device->sample_type;
+		/* A replay at maximum speed keeps the queue full by design */
+		if (device->overflow_policy == HYDRASDR_OVERFLOW_DEGRADE && (device->replay_file == NULL || device->replay_realtime))
+		{
+			/* From the watermark until the backlog is under half of it */
+			if (backlog >= device->overflow_watermark)
+			{
+				device->degraded = true;
+			}
+			else if (backlog < (device->overflow_watermark + 1) / 2)
+			{
+				device->degraded = false;
+			}
+			if (device->degraded)
+			{
+				sample_type = HYDRASDR_SAMPLE_RAW;
+				flags |= HYDRASDR_TRANSFER_DEGRADED;
+			}
+		}
 
 		pthread_mutex_unlock(&device->consumer_mp);
 
+		raw_bytes = device->buffer_size;
+		if (device->header_enabled && read_buffer_header(device, input_samples, &info))
+		{
+			/* The samples follow the header in place, a buffer without it is all samples */
+			flags |= HYDRASDR_TRANSFER_SEQUENCE_VALID;
+			input_samples += sizeof(hydrasdr_buffer_header_t) / sizeof(uint16_t);
+			raw_bytes -= sizeof(hydrasdr_buffer_header_t);
+		}
+
 		if (device->packing_enabled)
 		{
 			sample_count = ((device->buffer_size / 2) * 4) / 3;
 
-			if (device->sample_type != HYDRASDR_SAMPLE_RAW)
+			if (sample_type != HYDRASDR_SAMPLE_RAW)
 			{
 				unpack_samples((uint32_t*)input_samples, device->unpacked_samples, sample_count);
 
@@ -416,16 +732,37 @@ static void* consumer_threadproc(void *arg)
 		}
 		else
 		{
-			sample_count = device->buffer_size / 2;
+			sample_count = raw_bytes / 2;
 		}
 
-		switch (device->sample_type)
+		switch (sample_type)
 		{
 		case HYDRASDR_SAMPLE_FLOAT32_IQ:
-			convert_samples_float(input_samples, (float *)device->output_buffer, sample_count);
-			iqconverter_float_process(device->cnv_f, (float *) device->output_buffer, sample_count);
+		case HYDRASDR_SAMPLE_FLOAT16_IQ:
+			iq_samples = (float *) device->output_buffer;
+			convert_samples_float(input_samples, iq_samples, sample_count);
+			iqconverter_float_process(device->cnv_f, iq_samples, sample_count);
+			if (device->nco_phase_inc != 0)
+			{
+				nco_set_phase_inc(device->nco, device->nco_phase_inc);
+				nco_process_float(device->nco, iq_samples, sample_count);
+			}
+			if (device->resampler != NULL)
+			{
+				sample_count = 2 * resampler_process(device->resampler, iq_samples, sample_count, device->resampler_buffer);
+				iq_samples = device->resampler_buffer;
+			}
+			if (device->channelizer != NULL)
+			{
+				process_channels(device, iq_samples, sample_count, &info, flags);
+			}
+			if (sample_type == HYDRASDR_SAMPLE_FLOAT16_IQ)
+			{
+				float16_convert(iq_samples, (uint16_t *) device->output_buffer, sample_count);
+				iq_samples = (float *) device->output_buffer;
+			}
 			sample_count /= 2;
-			transfer.samples = device->output_buffer;
+			transfer.samples = iq_samples;
 			break;
 
 		case HYDRASDR_SAMPLE_FLOAT32_REAL:
@@ -434,8 +771,29 @@ static void* consumer_threadproc(void *arg)
 			break;
 
 		case HYDRASDR_SAMPLE_INT16_IQ:
+		case HYDRASDR_SAMPLE_INT8_IQ:
+		case HYDRASDR_SAMPLE_PACKED12_IQ:
 			convert_samples_int16(input_samples, (int16_t *)device->output_buffer, sample_count);
 			iqconverter_int16_process(device->cnv_i, (int16_t *) device->output_buffer, sample_count);
+			if (device->nco_phase_inc != 0)
+			{
+				nco_set_phase_inc(device->nco, device->nco_phase_inc);
+				nco_process_int16(device->nco, (int16_t *) device->output_buffer, sample_count);
+			}
+			if (device->decimator != NULL)
+			{
+				sample_count = decimator_int16_process(device->decimator, (int16_t *) device->output_buffer, sample_count);
+			}
+			if (sample_type == HYDRASDR_SAMPLE_INT8_IQ)
+			{
+				sample_pack_int8((int16_t *) device->output_buffer, (int8_t *) device->output_buffer, sample_count,
+					device->dithering ? &device->dither_state : NULL);
+			}
+			else if (sample_type == HYDRASDR_SAMPLE_PACKED12_IQ)
+			{
+				sample_pack_packed12((int16_t *) device->output_buffer, (uint8_t *) device->output_buffer, sample_count,
+					device->dithering ? &device->dither_state : NULL);
+			}
 			sample_count /= 2;
 			transfer.samples = device->output_buffer;
 			break;
@@ -458,76 +816,360 @@ static void* consumer_threadproc(void *arg)
 		transfer.device = device;
 		transfer.ctx = device->ctx;
 		transfer.sample_count = sample_count;
-		transfer.sample_type = device->sample_type;
-		transfer.dropped_samples = (uint64_t) dropped_buffers * (uint64_t) sample_count;
+		transfer.sample_type = sample_type;
+		set_transfer_drops(&transfer, &info, (uint64_t) sample_count);
+		transfer.sample_index = device->sample_index + transfer.dropped_samples;
+		transfer.flags = flags;
+		device->sample_index = transfer.sample_index + (uint64_t) sample_count;
+
+		if (device->shm_ring != NULL)
+		{
+			shm_ring_publish(device->shm_ring, transfer.sample_type, transfer.samples, sample_count,
+				transfer.sample_type == HYDRASDR_SAMPLE_RAW ? raw_bytes : (uint32_t) sample_count * sample_type_bytes[transfer.sample_type],
+				transfer.dropped_samples);
+		}
 
 		if (device->callback(&transfer) != 0)
 		{
 			device->streaming = false;
+			callback_stopped = true;
 		}
+		buffer_samples = (uint64_t) sample_count;
 
 		pthread_mutex_lock(&device->consumer_mp);
-		device->received_buffer_count--;
 	}
 
 	device->streaming = false;
 
+	/* HYDRASDR_OVERFLOW_DROP_NEWEST reports its drops with the next buffer queued, the last ones get an empty transfer */
+	if (device->dropped_buffers != 0 && !callback_stopped)
+	{
+		memset(&info, 0, sizeof(info));
+		info.dropped_host = device->dropped_buffers;
+		flags = device->dropped_flags;
+		device->dropped_buffers = 0;
+		device->dropped_flags = 0;
+		pthread_mutex_unlock(&device->consumer_mp);
+
+		transfer.device = device;
+		transfer.ctx = device->ctx;
+		transfer.samples = device->output_buffer;
+		transfer.sample_count = 0;
+		transfer.sample_type = sample_type;
+		/* The dropped buffers are counted at the size and type of the last one delivered */
+		set_transfer_drops(&transfer, &info, buffer_samples);
+		transfer.sample_index = device->sample_index + transfer.dropped_samples;
+		transfer.flags = flags;
+		device->sample_index = transfer.sample_index;
+
+		device->callback(&transfer);
+		return;
+	}
+
 	pthread_mutex_unlock(&device->consumer_mp);
+}
 
-	return NULL;
+/* Queues a received buffer by swapping it with the free slot, consumer_mp locked */
+static void queue_buffer(hydrasdr_device_t* device, uint8_t** buffer)
+{
+	uint16_t *temp;
+	int oldest;
+
+	if (device->received_buffer_count == RAW_BUFFER_COUNT)
+	{
+		if (device->overflow_policy != HYDRASDR_OVERFLOW_DROP_OLDEST)
+		{
+			/* Reported with the next buffer queued */
+			device->dropped_buffers++;
+			device->dropped_flags |= HYDRASDR_TRANSFER_DROPPED_NEWEST;
+			return;
+		}
+
+		/* The next buffer in the queue carries the drops of the oldest one and the oldest itself */
+		oldest = device->received_samples_queue_tail;
+		device->received_samples_queue_tail = (oldest + 1) & (RAW_BUFFER_COUNT - 1);
+		device->received_buffer_count--;
+		device->dropped_buffers_queue[device->received_samples_queue_tail] += device->dropped_buffers_queue[oldest] + 1;
+		device->dropped_flags_queue[device->received_samples_queue_tail] |= device->dropped_flags_queue[oldest] | HYDRASDR_TRANSFER_DROPPED_OLDEST;
+	}
+
+	temp = device->received_samples_queue[device->received_samples_queue_head];
+	device->received_samples_queue[device->received_samples_queue_head] = (uint16_t *)*buffer;
+	*buffer = (uint8_t *)temp;
+
+	device->dropped_buffers_queue[device->received_samples_queue_head] = device->dropped_buffers;
+	device->dropped_flags_queue[device->received_samples_queue_head] = device->dropped_flags;
+	device->dropped_buffers = 0;
+	device->dropped_flags = 0;
+
+	device->received_samples_queue_head = (device->received_samples_queue_head + 1) & (RAW_BUFFER_COUNT - 1);
+	device->received_buffer_count++;
+
+	pthread_cond_signal(&device->consumer_cv);
 }
 
 static void hydrasdr_libusb_transfer_callback(struct libusb_transfer* usb_transfer)
 {
-	uint16_t *temp;
 	hydrasdr_device_t* device = (hydrasdr_device_t*)usb_transfer->user_data;
 
 	if (!device->streaming || device->stop_requested)
 	{
+		device->transfers_in_flight--;
 		return;
 	}
 
-	if (usb_transfer->status == LIBUSB_TRANSFER_COMPLETED && usb_transfer->actual_length == usb_transfer->length)
-	{
-		pthread_mutex_lock(&device->consumer_mp);
+	if (usb_transfer->status == LIBUSB_TRANSFER_COMPLETED && usb_transfer->actual_length == usb_transfer->length)
+	{
+		pthread_mutex_lock(&device->consumer_mp);
+		queue_buffer(device, &usb_transfer->buffer);
+		pthread_mutex_unlock(&device->consumer_mp);
+
+		if (libusb_submit_transfer(usb_transfer) != 0)
+		{
+			device->transfers_in_flight--;
+			device->streaming = false;
+		}
+	}
+	else
+	{
+		device->transfers_in_flight--;
+		device->streaming = false;
+	}
+}
+
+/* Waits for the cancelled transfers, they can be submitted again afterwards */
+static void drain_transfers(hydrasdr_device_t* device)
+{
+	int error;
+	struct timeval timeout = { 0, 100000 };
+
+	cancel_transfers(device);
+	while (device->transfers_in_flight > 0)
+	{
+		error = libusb_handle_events_timeout_completed(device->usb_context, &timeout, NULL);
+		if (error < 0 && error != LIBUSB_ERROR_INTERRUPTED)
+		{
+			device->transfers_in_flight = 0;
+		}
+	}
+}
+
+static void transfer_session(hydrasdr_device_t* device)
+{
+	int error;
+	struct timeval timeout = { 0, 500000 };
+
+	while (device->streaming && !device->stop_requested)
+	{
+		error = libusb_handle_events_timeout_completed(device->usb_context, &timeout, NULL);
+		if (error < 0)
+		{
+			if (error != LIBUSB_ERROR_INTERRUPTED)
+				device->streaming = false;
+		}
+	}
+	
+	device->streaming = false;
+
+	drain_transfers(device);
+}
+
+static int replay_seek(FILE* file, uint64_t offset)
+{
+#ifdef _WIN32
+	return _fseeki64(file, (__int64) offset, SEEK_SET);
+#else
+	return fseeko(file, (off_t) offset, SEEK_SET);
+#endif
+}
+
+static double replay_clock(void)
+{
+#ifdef _WIN32
+	LARGE_INTEGER count;
+	LARGE_INTEGER frequency;
+
+	QueryPerformanceCounter(&count);
+	QueryPerformanceFrequency(&frequency);
+	return (double) count.QuadPart / (double) frequency.QuadPart;
+#else
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (double) ts.tv_sec + (double) ts.tv_nsec * 1e-9;
+#endif
+}
+
+static void replay_sleep(double seconds)
+{
+#ifdef _WIN32
+	Sleep((DWORD) (seconds * 1000.0));
+#else
+	struct timespec ts;
+
+	ts.tv_sec = (time_t) seconds;
+	ts.tv_nsec = (long) ((seconds - (double) ts.tv_sec) * 1e9);
+	nanosleep(&ts, NULL);
+#endif
+}
+
+/*
+ * Replaces transfer_threadproc for devices opened with hydrasdr_open_file().
+ * Buffers read from the capture enter the same queue as the USB transfers, so the
+ * consumer thread unpacks and converts them exactly as it does for a device.
+ */
+static void replay_session(hydrasdr_device_t* device)
+{
+	struct libusb_transfer* spare = device->transfers[0];
+	size_t length;
+	size_t sample_count;
+	uint64_t remaining;
+	bool rewound;
+	double buffer_duration;
+	double deadline;
+	double now;
+
+	if (device->packing_enabled)
+	{
+		sample_count = ((device->buffer_size / 2) * 4) / 3;
+	}
+	else
+	{
+		sample_count = device->buffer_size / 2;
+	}
+
+	/* The ADC delivers 2 real samples per IQ sample */
+	buffer_duration = device->iq_samplerate != 0 ? (double) sample_count / (2.0 * (double) device->iq_samplerate) : 0.0;
+	deadline = replay_clock();
+	remaining = device->replay_length;
+	rewound = true;
+
+	while (device->streaming && !device->stop_requested)
+	{
+		length = 0;
+		if (device->replay_length == 0 || remaining >= device->buffer_size)
+		{
+			length = fread(spare->buffer, 1, device->buffer_size, device->replay_file);
+		}
+		if (length < device->buffer_size)
+		{
+			/* A trailing partial buffer is not delivered */
+			if (device->replay_loop && !rewound && !ferror(device->replay_file))
+			{
+				replay_seek(device->replay_file, device->replay_offset);
+				remaining = device->replay_length;
+				rewound = true;
+				continue;
+			}
+
+			/* End of the capture, let the consumer drain the queue before stopping */
+			pthread_mutex_lock(&device->consumer_mp);
+			while (device->received_buffer_count != 0 && device->streaming && !device->stop_requested)
+			{
+				pthread_cond_wait(&device->consumer_cv, &device->consumer_mp);
+			}
+			device->streaming = false;
+			pthread_cond_signal(&device->consumer_cv);
+			pthread_mutex_unlock(&device->consumer_mp);
+			break;
+		}
+		rewound = false;
+		if (device->replay_length != 0)
+		{
+			remaining -= length;
+		}
+
+		if (device->replay_realtime)
+		{
+			deadline += buffer_duration;
+			now = replay_clock();
+			if (deadline > now)
+			{
+				replay_sleep(deadline - now);
+			}
+		}
+
+		pthread_mutex_lock(&device->consumer_mp);
+
+		if (!device->replay_realtime)
+		{
+			while (device->received_buffer_count == RAW_BUFFER_COUNT && device->streaming && !device->stop_requested)
+			{
+				pthread_cond_wait(&device->consumer_cv, &device->consumer_mp);
+			}
+		}
+
+		/* Real-time replay drops like the USB path when the consumer falls behind */
+		queue_buffer(device, &spare->buffer);
+
+		pthread_mutex_unlock(&device->consumer_mp);
+	}
+
+	device->streaming = false;
+}
+
+/* Runs the sessions started by hydrasdr_start_rx() until hydrasdr_close() */
+static void io_thread_loop(hydrasdr_device_t* device, void (*session)(hydrasdr_device_t* device))
+{
+	uint32_t session_done = 0;
+
+	pthread_mutex_lock(&device->consumer_mp);
+	while (!device->io_exit)
+	{
+		if (device->io_session == session_done)
+		{
+			pthread_cond_wait(&device->io_cv, &device->consumer_mp);
+			continue;
+		}
+		session_done = device->io_session;
+		pthread_mutex_unlock(&device->consumer_mp);
+
+		session(device);
+
+		pthread_mutex_lock(&device->consumer_mp);
+		device->io_busy--;
+		pthread_cond_broadcast(&device->io_cv);
+	}
+	pthread_mutex_unlock(&device->consumer_mp);
+}
+
+static void* consumer_threadproc(void *arg)
+{
+	hydrasdr_device_t* device = (hydrasdr_device_t*)arg;
+
+#ifdef _WIN32
 
-		if (device->received_buffer_count < RAW_BUFFER_COUNT)
-		{
-			temp = device->received_samples_queue[device->received_samples_queue_head];
-			device->received_samples_queue[device->received_samples_queue_head] = (uint16_t *)usb_transfer->buffer;
-			usb_transfer->buffer = (uint8_t *)temp;
+	SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_HIGHEST);
 
-			device->dropped_buffers_queue[device->received_samples_queue_head] = device->dropped_buffers;
-			device->dropped_buffers = 0;
-			
-			device->received_samples_queue_head = (device->received_samples_queue_head + 1) & (RAW_BUFFER_COUNT - 1);
-			device->received_buffer_count++;
+#endif
 
-			pthread_cond_signal(&device->consumer_cv);
-		}
-		else
-		{
-			device->dropped_buffers++;
-		}
+	io_thread_loop(device, consumer_session);
 
-		pthread_mutex_unlock(&device->consumer_mp);
+	return NULL;
+}
 
-		if (libusb_submit_transfer(usb_transfer) != 0)
-		{
-			device->streaming = false;
-		}
+/* The application handles the USB events, the transfers run without transfer thread */
+static bool usb_events_external(hydrasdr_device_t* device)
+{
+	return device->external_events && device->replay_file == NULL;
+}
+
+static void transfer_thread_session(hydrasdr_device_t* device)
+{
+	if (device->replay_file != NULL)
+	{
+		replay_session(device);
 	}
-	else
+	else if (!usb_events_external(device))
 	{
-		device->streaming = false;
+		transfer_session(device);
 	}
+	/* else parked since an earlier session, hydrasdr_handle_events_nonblocking() runs the transfers */
 }
 
 static void* transfer_threadproc(void* arg)
 {
 	hydrasdr_device_t* device = (hydrasdr_device_t*)arg;
-	int error;
-	struct timeval timeout = { 0, 500000 };
 
 #ifdef _WIN32
 
@@ -535,50 +1177,64 @@ static void* transfer_threadproc(void* arg)
 
 #endif
 
-	while (device->streaming && !device->stop_requested)
-	{
-		error = libusb_handle_events_timeout_completed(device->usb_context, &timeout, NULL);
-		if (error < 0)
-		{
-			if (error != LIBUSB_ERROR_INTERRUPTED)
-				device->streaming = false;
-		}
-	}
-	
-	device->streaming = false;
+	io_thread_loop(device, transfer_thread_session);
 
 	return NULL;
 }
 
-static int kill_io_threads(hydrasdr_device_t* device)
+/* Waits for both threads to finish their session, consumer_mp locked */
+static void wait_io_idle(hydrasdr_device_t* device)
 {
-	struct timeval timeout = { 0, 0 };
+	while (device->io_busy > 0)
+	{
+		pthread_cond_wait(&device->io_cv, &device->consumer_mp);
+	}
+}
 
+static int kill_io_threads(hydrasdr_device_t* device)
+{
 	if (device->stop_requested)
 	{
-		device->stop_requested = false;
 		device->streaming = false;
 		cancel_transfers(device);
 
 		pthread_mutex_lock(&device->consumer_mp);
-		pthread_cond_signal(&device->consumer_cv);
+		pthread_cond_broadcast(&device->consumer_cv);
+		wait_io_idle(device);
+
+		/* Changes made after the last buffer */
+		apply_pending_config(device);
 		pthread_mutex_unlock(&device->consumer_mp);
 
-		if (device->transfer_thread_running) {
-		    pthread_join(device->transfer_thread, NULL);
-		    device->transfer_thread_running = false;
-		}
-		if (device->consumer_thread_running) {
-		    pthread_join(device->consumer_thread, NULL);
-		    device->consumer_thread_running = false;
+		if (usb_events_external(device))
+		{
+			drain_transfers(device);
 		}
 
-		libusb_handle_events_timeout_completed(device->usb_context, &timeout, NULL);
+		device->stop_requested = false;
 	}
 
 	return HYDRASDR_SUCCESS;
 }
 
+/* Joins the parked threads, at hydrasdr_close() */
+static void exit_io_threads(hydrasdr_device_t* device)
+{
+	pthread_mutex_lock(&device->consumer_mp);
+	device->io_exit = true;
+	pthread_cond_broadcast(&device->io_cv);
+	pthread_mutex_unlock(&device->consumer_mp);
+
+	if (device->transfer_thread_running) {
+	    pthread_join(device->transfer_thread, NULL);
+	    device->transfer_thread_running = false;
+	}
+	if (device->consumer_thread_running) {
+	    pthread_join(device->consumer_thread, NULL);
+	    device->consumer_thread_running = false;
+	}
+}
+
 static int create_io_threads(hydrasdr_device_t* device, hydrasdr_sample_block_cb_fn callback)
 {
 	int result;
@@ -586,37 +1242,80 @@ static int create_io_threads(hydrasdr_device_t* device, hydrasdr_sample_block_cb
 
 	if (!device->streaming && !device->stop_requested)
 	{
+		/* The threads are idle, see hydrasdr_start_rx() */
+		if (usb_events_external(device) && device->transfers_in_flight > 0)
+		{
+			drain_transfers(device);
+		}
+
 		device->callback = callback;
 		device->streaming = true;
 
-		result = prepare_transfers(device, LIBUSB_ENDPOINT_IN | 1, (libusb_transfer_cb_fn)hydrasdr_libusb_transfer_callback);
-		if (result != HYDRASDR_SUCCESS)
+		if (device->replay_file != NULL)
 		{
-			return result;
+			if (replay_seek(device->replay_file, device->replay_offset) != 0)
+			{
+				device->streaming = false;
+				return HYDRASDR_ERROR_INVALID_PARAM;
+			}
+		}
+		else
+		{
+			result = prepare_transfers(device, LIBUSB_ENDPOINT_IN | 1, (libusb_transfer_cb_fn)hydrasdr_libusb_transfer_callback);
+			if (result != HYDRASDR_SUCCESS)
+			{
+				device->streaming = false;
+				drain_transfers(device);
+				return result;
+			}
 		}
 
 		device->received_samples_queue_head = 0;
 		device->received_samples_queue_tail = 0;
 		device->received_buffer_count = 0;
 
-		pthread_attr_init(&attr);
-		pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_JOINABLE);
+		/* Wakes up the parked threads */
+		pthread_mutex_lock(&device->consumer_mp);
+		device->io_busy = (usb_events_external(device) && !device->transfer_thread_running) ? 1 : 2;
+		device->io_session++;
+		pthread_cond_broadcast(&device->io_cv);
+		pthread_mutex_unlock(&device->consumer_mp);
 
-		result = pthread_create(&device->consumer_thread, &attr, consumer_threadproc, device);
-		if (result != 0)
+		result = 0;
+		if (!device->consumer_thread_running || (!device->transfer_thread_running && !usb_events_external(device)))
 		{
-			return HYDRASDR_ERROR_THREAD;
+			pthread_attr_init(&attr);
+			pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_JOINABLE);
+
+			if (!device->consumer_thread_running)
+			{
+				result = pthread_create(&device->consumer_thread, &attr, consumer_threadproc, device);
+				device->consumer_thread_running = (result == 0);
+			}
+			if (result == 0 && !device->transfer_thread_running && !usb_events_external(device))
+			{
+				result = pthread_create(&device->transfer_thread, &attr, transfer_threadproc, device);
+				device->transfer_thread_running = (result == 0);
+			}
+
+			pthread_attr_destroy(&attr);
 		}
-		device->consumer_thread_running = true;
 
-		result = pthread_create(&device->transfer_thread, &attr, transfer_threadproc, device);
 		if (result != 0)
 		{
+			/* Only the threads that exist run this session */
+			pthread_mutex_lock(&device->consumer_mp);
+			device->io_busy = (device->consumer_thread_running ? 1 : 0) + (device->transfer_thread_running ? 1 : 0);
+			pthread_mutex_unlock(&device->consumer_mp);
+
+			device->stop_requested = true;
+			kill_io_threads(device);
+			if (device->replay_file == NULL && !usb_events_external(device))
+			{
+				drain_transfers(device);
+			}
 			return HYDRASDR_ERROR_THREAD;
 		}
-		device->transfer_thread_running = true;
-
-		pthread_attr_destroy(&attr);
 	}
 	else {
 		return HYDRASDR_ERROR_BUSY;
@@ -633,8 +1332,16 @@ static void hydrasdr_open_exit(hydrasdr_device_t* device)
 		libusb_close(device->usb_device);
 		device->usb_device = NULL;
 	}
-	libusb_exit(device->usb_context);
-	device->usb_context = NULL;
+	if (device->usb_context != NULL)
+	{
+		libusb_exit(device->usb_context);
+		device->usb_context = NULL;
+	}
+	if (device->replay_file != NULL)
+	{
+		fclose(device->replay_file);
+		device->replay_file = NULL;
+	}
 }
 
 static void hydrasdr_open_device(hydrasdr_device_t* device,
@@ -877,12 +1584,28 @@ static void hydrasdr_open_device_fd(hydrasdr_device_t* device, int* ret, int fd)
 	return;
 }
 
+/* Control requests to a replay device succeed without effect and read back zeros */
+static int control_transfer(hydrasdr_device_t* device, uint8_t request_type, uint8_t request,
+	uint16_t value, uint16_t index, unsigned char* data, uint16_t length, unsigned int timeout)
+{
+	if (device->replay_file != NULL)
+	{
+		if ((request_type & LIBUSB_ENDPOINT_IN) != 0 && data != NULL)
+		{
+			memset(data, 0, length);
+		}
+		return length;
+	}
+
+	return libusb_control_transfer(device->usb_device, request_type, request, value, index, data, length, timeout);
+}
+
 static int hydrasdr_read_samplerates_from_fw(struct hydrasdr_device* device, uint32_t* buffer, const uint32_t len)
 {
 	int result;
 
-	result = libusb_control_transfer(
-		device->usb_device,
+	result = control_transfer(
+		device,
 		LIBUSB_ENDPOINT_IN | LIBUSB_REQUEST_TYPE_VENDOR | LIBUSB_RECIPIENT_DEVICE,
 		HYDRASDR_GET_SAMPLERATES,
 		0,
@@ -899,6 +1622,39 @@ static int hydrasdr_read_samplerates_from_fw(struct hydrasdr_device* device, uin
 	return HYDRASDR_SUCCESS;
 }
 
+/* Buffers, converters and synchronization shared by USB and replay devices */
+static int hydrasdr_open_pipeline(hydrasdr_device_t* lib_device)
+{
+	int result;
+
+	result = allocate_transfers(lib_device);
+	if (result != 0)
+	{
+		free_transfers(lib_device);
+		return HYDRASDR_ERROR_NO_MEM;
+	}
+
+	lib_device->overflow_policy = HYDRASDR_OVERFLOW_DROP_NEWEST;
+	lib_device->overflow_watermark = RAW_BUFFER_COUNT / 2;
+
+	lib_device->cnv_f = iqconverter_float_create(HB_KERNEL_FLOAT, HB_KERNEL_FLOAT_LEN);
+	lib_device->cnv_i = iqconverter_int16_create(HB_KERNEL_INT16, HB_KERNEL_INT16_LEN);
+	lib_device->nco = nco_create();
+	if (lib_device->nco == NULL)
+	{
+		iqconverter_float_free(lib_device->cnv_f);
+		iqconverter_int16_free(lib_device->cnv_i);
+		free_transfers(lib_device);
+		return HYDRASDR_ERROR_NO_MEM;
+	}
+
+	pthread_cond_init(&lib_device->consumer_cv, NULL);
+	pthread_cond_init(&lib_device->io_cv, NULL);
+	pthread_mutex_init(&lib_device->consumer_mp, NULL);
+
+	return HYDRASDR_SUCCESS;
+}
+
 static int hydrasdr_open_init(hydrasdr_device_t** device, uint64_t serial_number, int fd)
 {
 	hydrasdr_device_t* lib_device;
@@ -946,16 +1702,18 @@ static int hydrasdr_open_init(hydrasdr_device_t** device, uint64_t serial_number
 	lib_device->transfers = NULL;
 	lib_device->callback = NULL;
 	lib_device->transfer_count = 16;
-	lib_device->buffer_size = 262144;
+	lib_device->buffer_size = BUFFER_SIZE_UNPACKED;
 	lib_device->packing_enabled = false;
 	lib_device->streaming = false;
 	lib_device->stop_requested = false;
 	lib_device->sample_type = HYDRASDR_SAMPLE_FLOAT32_IQ;
+	lib_device->dither_state = 0x2545F491;
 
 	result = hydrasdr_read_samplerates_from_fw(lib_device, &lib_device->supported_samplerate_count, 0);
 	if (result == HYDRASDR_SUCCESS)
 	{
-		lib_device->supported_samplerates = (uint32_t *) malloc(lib_device->supported_samplerate_count * sizeof(uint32_t));
+		/* The request below reads at least one entry */
+		lib_device->supported_samplerates = (uint32_t *) malloc((lib_device->supported_samplerate_count > 0 ? lib_device->supported_samplerate_count : 1) * sizeof(uint32_t));
 		if (lib_device->supported_samplerates == NULL)
 		{
 			hydrasdr_open_exit(lib_device);
@@ -981,22 +1739,15 @@ static int hydrasdr_open_init(hydrasdr_device_t** device, uint64_t serial_number
 
 	hydrasdr_set_packing(lib_device, 0);
 
-	result = allocate_transfers(lib_device);
-	if (result != 0)
+	result = hydrasdr_open_pipeline(lib_device);
+	if (result != HYDRASDR_SUCCESS)
 	{
-		free_transfers(lib_device);
 		hydrasdr_open_exit(lib_device);
 		free(lib_device->supported_samplerates);
 		free(lib_device);
-		return HYDRASDR_ERROR_NO_MEM;
+		return result;
 	}
 
-	lib_device->cnv_f = iqconverter_float_create(HB_KERNEL_FLOAT, HB_KERNEL_FLOAT_LEN);
-	lib_device->cnv_i = iqconverter_int16_create(HB_KERNEL_INT16, HB_KERNEL_INT16_LEN);
-
-	pthread_cond_init(&lib_device->consumer_cv, NULL);
-	pthread_mutex_init(&lib_device->consumer_mp, NULL);
-
 	*device = lib_device;
 
 	return HYDRASDR_SUCCESS;
@@ -1099,33 +1850,234 @@ int hydrasdr_list_devices(uint64_t *serials, int count)
 		}
 	}
 
-	libusb_free_device_list(devices, 1);
-	libusb_exit(context);
-	return output_count;
-}
-
-	int ADDCALL hydrasdr_open_sn(hydrasdr_device_t** device, uint64_t serial_number)
+	libusb_free_device_list(devices, 1);
+	libusb_exit(context);
+	return output_count;
+}
+
+	int ADDCALL hydrasdr_open_sn(hydrasdr_device_t** device, uint64_t serial_number)
+	{
+		int result;
+
+		result = hydrasdr_open_init(device, serial_number, FILE_DESCRIPTOR_UNUSED);
+		return result;
+	}
+
+	int ADDCALL hydrasdr_open_fd(hydrasdr_device_t** device, int fd)
+	{
+		int result;
+
+		result = hydrasdr_open_init(device, SERIAL_NUMBER_UNUSED, fd);
+		return result;
+	}
+
+	int ADDCALL hydrasdr_open(hydrasdr_device_t** device)
+	{
+		int result;
+
+		result = hydrasdr_open_init(device, SERIAL_NUMBER_UNUSED, FILE_DESCRIPTOR_UNUSED);
+		return result;
+	}
+
+	int ADDCALL hydrasdr_open_file(hydrasdr_device_t** device, const char* path, uint32_t samplerate, uint32_t flags)
+	{
+		hydrasdr_device_t* lib_device;
+		int result;
+
+		*device = NULL;
+
+		if (path == NULL || samplerate == 0)
+		{
+			return HYDRASDR_ERROR_INVALID_PARAM;
+		}
+
+		lib_device = (hydrasdr_device_t*)calloc(1, sizeof(hydrasdr_device_t));
+		if (lib_device == NULL)
+		{
+			return HYDRASDR_ERROR_NO_MEM;
+		}
+
+		lib_device->replay_file = fopen(path, "rb");
+		if (lib_device->replay_file == NULL)
+		{
+			free(lib_device);
+			return HYDRASDR_ERROR_NOT_FOUND;
+		}
+		lib_device->replay_realtime = (flags & HYDRASDR_REPLAY_REALTIME) != 0;
+		lib_device->replay_loop = (flags & HYDRASDR_REPLAY_LOOP) != 0;
+
+		lib_device->supported_samplerates = (uint32_t *) malloc(sizeof(uint32_t));
+		if (lib_device->supported_samplerates == NULL)
+		{
+			hydrasdr_open_exit(lib_device);
+			free(lib_device);
+			return HYDRASDR_ERROR_NO_MEM;
+		}
+		lib_device->supported_samplerates[0] = samplerate;
+		lib_device->supported_samplerate_count = 1;
+		lib_device->adc_samplerate = samplerate * 2;
+		update_iq_samplerate(lib_device);
+
+		/* A single spare buffer is exchanged with the queue by the replay thread */
+		lib_device->transfer_count = 1;
+		lib_device->buffer_size = BUFFER_SIZE_UNPACKED;
+		lib_device->packing_enabled = false;
+		lib_device->sample_type = HYDRASDR_SAMPLE_FLOAT32_IQ;
+		lib_device->dither_state = 0x2545F491;
+
+		result = hydrasdr_open_pipeline(lib_device);
+		if (result != HYDRASDR_SUCCESS)
+		{
+			hydrasdr_open_exit(lib_device);
+			free(lib_device->supported_samplerates);
+			free(lib_device);
+			return result;
+		}
+
+		*device = lib_device;
+
+		return HYDRASDR_SUCCESS;
+	}
+
+	int ADDCALL hydrasdr_set_replay_range(hydrasdr_device_t* device, uint64_t offset, uint64_t length)
+	{
+		if (device->replay_file == NULL)
+		{
+			return HYDRASDR_ERROR_UNSUPPORTED;
+		}
+
+		if (device->streaming)
+		{
+			return HYDRASDR_ERROR_BUSY;
+		}
+
+		device->replay_offset = offset;
+		device->replay_length = length;
+
+		return HYDRASDR_SUCCESS;
+	}
+
+	int ADDCALL hydrasdr_get_buffer_size(hydrasdr_device_t* device, uint32_t* size)
+	{
+		*size = device->buffer_size;
+		return HYDRASDR_SUCCESS;
+	}
+
+	int ADDCALL hydrasdr_set_shm_publisher(hydrasdr_device_t* device, const char* name, uint32_t slot_count)
+	{
+		if (device->streaming)
+		{
+			return HYDRASDR_ERROR_BUSY;
+		}
+
+		/* A reader keeps clear of the slot being rewritten, a single slot could never be read */
+		if (name != NULL && slot_count == 1)
+		{
+			return HYDRASDR_ERROR_INVALID_PARAM;
+		}
+
+		shm_ring_close(device->shm_ring);
+		device->shm_ring = NULL;
+
+		if (name == NULL)
+		{
+			return HYDRASDR_SUCCESS;
+		}
+
+#ifdef _WIN32
+		(void) slot_count;
+		return HYDRASDR_ERROR_UNSUPPORTED;
+#else
+		device->shm_ring = shm_ring_create(name, slot_count == 0 ? SHM_DEFAULT_SLOT_COUNT : slot_count, (uint32_t) SHM_SLOT_SIZE);
+		if (device->shm_ring == NULL)
+		{
+			return HYDRASDR_ERROR_OTHER;
+		}
+
+		return HYDRASDR_SUCCESS;
+#endif
+	}
+
+	int ADDCALL hydrasdr_shm_open(struct hydrasdr_shm_reader** reader, const char* name)
+	{
+#ifdef _WIN32
+		(void) reader;
+		(void) name;
+		return HYDRASDR_ERROR_UNSUPPORTED;
+#else
+		struct hydrasdr_shm_reader* lib_reader;
+
+		lib_reader = (struct hydrasdr_shm_reader*) malloc(sizeof(struct hydrasdr_shm_reader));
+		if (lib_reader == NULL)
+		{
+			return HYDRASDR_ERROR_NO_MEM;
+		}
+
+		lib_reader->ring = shm_ring_open(name);
+		if (lib_reader->ring == NULL)
+		{
+			free(lib_reader);
+			return HYDRASDR_ERROR_NOT_FOUND;
+		}
+
+		*reader = lib_reader;
+		return HYDRASDR_SUCCESS;
+#endif
+	}
+
+	int ADDCALL hydrasdr_shm_read(struct hydrasdr_shm_reader* reader, hydrasdr_shm_buffer_t* buffer, uint32_t timeout_ms)
 	{
 		int result;
+		uint64_t lost;
+		double deadline;
+		shm_ring_buffer_t ring_buffer;
 
-		result = hydrasdr_open_init(device, serial_number, FILE_DESCRIPTOR_UNUSED);
-		return result;
+		deadline = replay_clock() + timeout_ms * 1e-3;
+		buffer->lost_buffers = 0;
+
+		for (;;)
+		{
+			result = shm_ring_next(reader->ring, &ring_buffer, &lost);
+			buffer->lost_buffers += lost;
+			if (result > 0)
+			{
+				break;
+			}
+			if (result < 0)
+			{
+				return HYDRASDR_ERROR_STREAMING_STOPPED;
+			}
+			if (replay_clock() >= deadline)
+			{
+				return HYDRASDR_ERROR_TIMEOUT;
+			}
+			replay_sleep(0.0005);
+		}
+
+		buffer->sequence = ring_buffer.sequence;
+		buffer->dropped_samples = ring_buffer.dropped_samples;
+		buffer->sample_type = (enum hydrasdr_sample_type) ring_buffer.sample_type;
+		buffer->sample_count = (int) ring_buffer.sample_count;
+		buffer->bytes = ring_buffer.bytes;
+		buffer->samples = ring_buffer.samples;
+
+		return HYDRASDR_SUCCESS;
 	}
 
-	int ADDCALL hydrasdr_open_fd(hydrasdr_device_t** device, int fd)
+	int ADDCALL hydrasdr_shm_release(struct hydrasdr_shm_reader* reader)
 	{
-		int result;
-
-		result = hydrasdr_open_init(device, SERIAL_NUMBER_UNUSED, fd);
-		return result;
+		return shm_ring_release(reader->ring) == 0 ? HYDRASDR_SUCCESS : HYDRASDR_ERROR_OVERRUN;
 	}
 
-	int ADDCALL hydrasdr_open(hydrasdr_device_t** device)
+	int ADDCALL hydrasdr_shm_close(struct hydrasdr_shm_reader* reader)
 	{
-		int result;
+		if (reader != NULL)
+		{
+			shm_ring_close(reader->ring);
+			free(reader);
+		}
 
-		result = hydrasdr_open_init(device, SERIAL_NUMBER_UNUSED, FILE_DESCRIPTOR_UNUSED);
-		return result;
+		return HYDRASDR_SUCCESS;
 	}
 
 	int ADDCALL hydrasdr_close(hydrasdr_device_t* device)
@@ -1142,10 +2094,19 @@ int hydrasdr_list_devices(uint64_t *serials, int count)
 				result = HYDRASDR_SUCCESS;
 			}
 
+			exit_io_threads(device);
+
 			iqconverter_float_free(device->cnv_f);
 			iqconverter_int16_free(device->cnv_i);
+			nco_free(device->nco);
+			free_channelizer(device);
+			resampler_free(device->resampler);
+			free(device->resampler_buffer);
+			decimator_int16_free(device->decimator);
+			shm_ring_close(device->shm_ring);
 
 			pthread_cond_destroy(&device->consumer_cv);
+			pthread_cond_destroy(&device->io_cv);
 			pthread_mutex_destroy(&device->consumer_mp);
 
 			free_transfers(device);
@@ -1213,12 +2174,15 @@ int hydrasdr_list_devices(uint64_t *serials, int count)
 			}
 		}
 
-		libusb_clear_halt(device->usb_device, LIBUSB_ENDPOINT_IN | 1);
+		if (device->replay_file == NULL)
+		{
+			libusb_clear_halt(device->usb_device, LIBUSB_ENDPOINT_IN | 1);
+		}
 
 		length = 1;
 
-		result = libusb_control_transfer(
-			device->usb_device,
+		result = control_transfer(
+			device,
 			LIBUSB_ENDPOINT_IN | LIBUSB_REQUEST_TYPE_VENDOR | LIBUSB_RECIPIENT_DEVICE,
 			HYDRASDR_SET_SAMPLERATE,
 			0,
@@ -1231,16 +2195,26 @@ int hydrasdr_list_devices(uint64_t *serials, int count)
 		{
 			return HYDRASDR_ERROR_LIBUSB;
 		}
-		else {
-			return HYDRASDR_SUCCESS;
+
+		/* An index selects an IQ rate of the list, a value is the ADC rate in kHz */
+		if (samplerate < device->supported_samplerate_count)
+		{
+			device->adc_samplerate = device->supported_samplerates[samplerate] * 2;
+		}
+		else
+		{
+			device->adc_samplerate = samplerate * 1000;
 		}
+		update_iq_samplerate(device);
+
+		return HYDRASDR_SUCCESS;
 	}
 
 	int ADDCALL hydrasdr_set_receiver_mode(hydrasdr_device_t* device, receiver_mode_t value)
 	{
 		int result;
-		result = libusb_control_transfer(
-			device->usb_device,
+		result = control_transfer(
+			device,
 			LIBUSB_ENDPOINT_OUT | LIBUSB_REQUEST_TYPE_VENDOR | LIBUSB_RECIPIENT_DEVICE,
 			HYDRASDR_RECEIVER_MODE,
 			value,
@@ -1262,11 +2236,39 @@ int hydrasdr_list_devices(uint64_t *serials, int count)
 	{
 		int result;
 
+		if (!device->streaming && !device->stop_requested)
+		{
+			/* A session that ended by itself (callback, USB error, end of replay) without hydrasdr_stop_rx() */
+			/* may still be delivering its last buffer, wait for it before resetting the converters */
+			pthread_mutex_lock(&device->consumer_mp);
+			wait_io_idle(device);
+			pthread_mutex_unlock(&device->consumer_mp);
+		}
+
 		iqconverter_float_reset(device->cnv_f);
 		iqconverter_int16_reset(device->cnv_i);
+		nco_reset(device->nco);
+		if (device->decimator != NULL)
+		{
+			decimator_int16_reset(device->decimator);
+		}
+		if (device->resampler != NULL)
+		{
+			resampler_reset(device->resampler);
+		}
+		if (device->channelizer != NULL)
+		{
+			channelizer_reset(device->channelizer);
+		}
 
 		memset(device->dropped_buffers_queue, 0, RAW_BUFFER_COUNT * sizeof(uint32_t));
+		memset(device->dropped_flags_queue, 0, RAW_BUFFER_COUNT * sizeof(uint32_t));
 		device->dropped_buffers = 0;
+		device->dropped_flags = 0;
+		device->degraded = false;
+		device->header_synced = false;
+		device->sample_index = 0;
+		device->channel_sample_index = 0;
 
 		result = hydrasdr_set_receiver_mode(device, RECEIVER_MODE_OFF);
 		if (result != HYDRASDR_SUCCESS)
@@ -1274,7 +2276,10 @@ int hydrasdr_list_devices(uint64_t *serials, int count)
 			return result;
 		}
 
-		libusb_clear_halt(device->usb_device, LIBUSB_ENDPOINT_IN | 1);
+		if (device->replay_file == NULL)
+		{
+			libusb_clear_halt(device->usb_device, LIBUSB_ENDPOINT_IN | 1);
+		}
 
 		result = hydrasdr_set_receiver_mode(device, RECEIVER_MODE_RX);
 		if (result == HYDRASDR_SUCCESS)
@@ -1307,8 +2312,8 @@ int hydrasdr_list_devices(uint64_t *serials, int count)
 		int result;
 
 		temp_value = 0;
-		result = libusb_control_transfer(
-			device->usb_device,
+		result = control_transfer(
+			device,
 			LIBUSB_ENDPOINT_IN | LIBUSB_REQUEST_TYPE_VENDOR | LIBUSB_RECIPIENT_DEVICE,
 			HYDRASDR_SI5351C_READ,
 			0,
@@ -1331,8 +2336,8 @@ int hydrasdr_list_devices(uint64_t *serials, int count)
 	{
 		int result;
 
-		result = libusb_control_transfer(
-			device->usb_device,
+		result = control_transfer(
+			device,
 			LIBUSB_ENDPOINT_OUT | LIBUSB_REQUEST_TYPE_VENDOR | LIBUSB_RECIPIENT_DEVICE,
 			HYDRASDR_SI5351C_WRITE,
 			value,
@@ -1354,8 +2359,8 @@ int hydrasdr_list_devices(uint64_t *serials, int count)
 	{
 		int result;
 
-		result = libusb_control_transfer(
-			device->usb_device,
+		result = control_transfer(
+			device,
 			LIBUSB_ENDPOINT_IN | LIBUSB_REQUEST_TYPE_VENDOR | LIBUSB_RECIPIENT_DEVICE,
 			HYDRASDR_R82X_READ,
 			0,
@@ -1377,8 +2382,8 @@ int hydrasdr_list_devices(uint64_t *serials, int count)
 	{
 		int result;
 
-		result = libusb_control_transfer(
-			device->usb_device,
+		result = control_transfer(
+			device,
 			LIBUSB_ENDPOINT_OUT | LIBUSB_REQUEST_TYPE_VENDOR | LIBUSB_RECIPIENT_DEVICE,
 			HYDRASDR_R82X_WRITE,
 			value,
@@ -1404,8 +2409,8 @@ int hydrasdr_list_devices(uint64_t *serials, int count)
 		port_pin = ((uint8_t)port) << 5;
 		port_pin = port_pin | pin;
 
-		result = libusb_control_transfer(
-			device->usb_device,
+		result = control_transfer(
+			device,
 			LIBUSB_ENDPOINT_IN | LIBUSB_REQUEST_TYPE_VENDOR | LIBUSB_RECIPIENT_DEVICE,
 			HYDRASDR_GPIO_READ,
 			0,
@@ -1431,8 +2436,8 @@ int hydrasdr_list_devices(uint64_t *serials, int count)
 		port_pin = ((uint8_t)port) << 5;
 		port_pin = port_pin | pin;
 
-		result = libusb_control_transfer(
-			device->usb_device,
+		result = control_transfer(
+			device,
 			LIBUSB_ENDPOINT_OUT | LIBUSB_REQUEST_TYPE_VENDOR | LIBUSB_RECIPIENT_DEVICE,
 			HYDRASDR_GPIO_WRITE,
 			value,
@@ -1458,8 +2463,8 @@ int hydrasdr_list_devices(uint64_t *serials, int count)
 		port_pin = ((uint8_t)port) << 5;
 		port_pin = port_pin | pin;
 
-		result = libusb_control_transfer(
-			device->usb_device,
+		result = control_transfer(
+			device,
 			LIBUSB_ENDPOINT_IN | LIBUSB_REQUEST_TYPE_VENDOR | LIBUSB_RECIPIENT_DEVICE,
 			HYDRASDR_GPIODIR_READ,
 			0,
@@ -1485,8 +2490,8 @@ int hydrasdr_list_devices(uint64_t *serials, int count)
 		port_pin = ((uint8_t)port) << 5;
 		port_pin = port_pin | pin;
 
-		result = libusb_control_transfer(
-			device->usb_device,
+		result = control_transfer(
+			device,
 			LIBUSB_ENDPOINT_OUT | LIBUSB_REQUEST_TYPE_VENDOR | LIBUSB_RECIPIENT_DEVICE,
 			HYDRASDR_GPIODIR_WRITE,
 			value,
@@ -1507,8 +2512,8 @@ int hydrasdr_list_devices(uint64_t *serials, int count)
 	int ADDCALL hydrasdr_spiflash_erase(hydrasdr_device_t* device)
 	{
 		int result;
-		result = libusb_control_transfer(
-			device->usb_device,
+		result = control_transfer(
+			device,
 			LIBUSB_ENDPOINT_OUT | LIBUSB_REQUEST_TYPE_VENDOR | LIBUSB_RECIPIENT_DEVICE,
 			HYDRASDR_SPIFLASH_ERASE,
 			0,
@@ -1529,8 +2534,8 @@ int hydrasdr_list_devices(uint64_t *serials, int count)
 	int ADDCALL hydrasdr_spiflash_erase_sector(hydrasdr_device_t* device, const uint16_t sector_num)
 	{
 		int result;
-		result = libusb_control_transfer(
-			device->usb_device,
+		result = control_transfer(
+			device,
 			LIBUSB_ENDPOINT_OUT | LIBUSB_REQUEST_TYPE_VENDOR | LIBUSB_RECIPIENT_DEVICE,
 			HYDRASDR_SPIFLASH_ERASE_SECTOR,
 			sector_num,
@@ -1557,8 +2562,8 @@ int hydrasdr_list_devices(uint64_t *serials, int count)
 			return HYDRASDR_ERROR_INVALID_PARAM;
 		}
 
-		result = libusb_control_transfer(
-			device->usb_device,
+		result = control_transfer(
+			device,
 			LIBUSB_ENDPOINT_OUT | LIBUSB_REQUEST_TYPE_VENDOR | LIBUSB_RECIPIENT_DEVICE,
 			HYDRASDR_SPIFLASH_WRITE,
 			address >> 16,
@@ -1580,8 +2585,8 @@ int hydrasdr_list_devices(uint64_t *serials, int count)
 	{
 		int result;
 
-		result = libusb_control_transfer(
-			device->usb_device,
+		result = control_transfer(
+			device,
 			LIBUSB_ENDPOINT_IN | LIBUSB_REQUEST_TYPE_VENDOR | LIBUSB_RECIPIENT_DEVICE,
 			HYDRASDR_SPIFLASH_READ,
 			address >> 16,
@@ -1602,8 +2607,8 @@ int hydrasdr_list_devices(uint64_t *serials, int count)
 	int ADDCALL hydrasdr_board_id_read(hydrasdr_device_t* device, uint8_t* value)
 	{
 		int result;
-		result = libusb_control_transfer(
-			device->usb_device,
+		result = control_transfer(
+			device,
 			LIBUSB_ENDPOINT_IN | LIBUSB_REQUEST_TYPE_VENDOR | LIBUSB_RECIPIENT_DEVICE,
 			HYDRASDR_BOARD_ID_READ,
 			0,
@@ -1627,8 +2632,8 @@ int hydrasdr_list_devices(uint64_t *serials, int count)
 		int result;
 		char version_local[VERSION_LOCAL_SIZE] = "";
 
-		result = libusb_control_transfer(
-			device->usb_device,
+		result = control_transfer(
+			device,
 			LIBUSB_ENDPOINT_IN | LIBUSB_REQUEST_TYPE_VENDOR | LIBUSB_RECIPIENT_DEVICE,
 			HYDRASDR_VERSION_STRING_READ,
 			0,
@@ -1663,8 +2668,8 @@ int hydrasdr_list_devices(uint64_t *serials, int count)
 		int result;
 
 		length = sizeof(hydrasdr_read_partid_serialno_t);
-		result = libusb_control_transfer(
-			device->usb_device,
+		result = control_transfer(
+			device,
 			LIBUSB_ENDPOINT_IN | LIBUSB_REQUEST_TYPE_VENDOR | LIBUSB_RECIPIENT_DEVICE,
 			HYDRASDR_BOARD_PARTID_SERIALNO_READ,
 			0,
@@ -1692,7 +2697,25 @@ int hydrasdr_list_devices(uint64_t *serials, int count)
 
 	int ADDCALL hydrasdr_set_sample_type(struct hydrasdr_device* device, enum hydrasdr_sample_type sample_type)
 	{
-		device->sample_type = sample_type;
+		pthread_mutex_lock(&device->consumer_mp);
+		if (device->io_busy > 0)
+		{
+			device->pending_sample_type = sample_type;
+			device->pending_flags |= HYDRASDR_TRANSFER_SAMPLE_TYPE_CHANGED;
+		}
+		else
+		{
+			device->sample_type = sample_type;
+			update_iq_samplerate(device);
+		}
+		pthread_mutex_unlock(&device->consumer_mp);
+
+		return HYDRASDR_SUCCESS;
+	}
+
+	int ADDCALL hydrasdr_set_dithering(struct hydrasdr_device* device, uint8_t value)
+	{
+		device->dithering = value != 0;
 		return HYDRASDR_SUCCESS;
 	}
 
@@ -1705,8 +2728,8 @@ int hydrasdr_list_devices(uint64_t *serials, int count)
 		set_freq_params.freq_hz = TO_LE_64(freq_hz);
 		length = sizeof(set_freq_params_t);
 
-		result = libusb_control_transfer(
-			device->usb_device,
+		result = control_transfer(
+			device,
 			LIBUSB_ENDPOINT_OUT | LIBUSB_REQUEST_TYPE_VENDOR | LIBUSB_RECIPIENT_DEVICE,
 			HYDRASDR_SET_FREQ,
 			0,
@@ -1724,28 +2747,230 @@ int hydrasdr_list_devices(uint64_t *serials, int count)
 		}
 	}
 
-	int ADDCALL hydrasdr_set_conversion_filter_float32(struct hydrasdr_device* device, const float *kernel, const uint32_t len)
+	int ADDCALL hydrasdr_set_nco_freq(struct hydrasdr_device* device, const int32_t freq_hz)
+	{
+		if (device->iq_samplerate != 0 && (freq_hz > (int32_t) (device->iq_samplerate / 2) || freq_hz < -(int32_t) (device->iq_samplerate / 2)))
+		{
+			return HYDRASDR_ERROR_INVALID_PARAM;
+		}
+
+		device->nco_freq_hz = freq_hz;
+		device->nco_phase_inc = nco_freq_to_phase_inc(-(int64_t) freq_hz, device->iq_samplerate);
+
+		return HYDRASDR_SUCCESS;
+	}
+
+	int ADDCALL hydrasdr_set_decimation(struct hydrasdr_device* device, const uint32_t factor)
 	{
+		decimator_int16_t *decimator = NULL;
+
 		if (device->streaming)
 		{
 			return HYDRASDR_ERROR_BUSY;
 		}
 
-		iqconverter_float_free(device->cnv_f);
-		device->cnv_f = iqconverter_float_create(kernel, len);
+		if (factor == 0 || (factor & (factor - 1)) != 0 || factor > (1 << DECIMATOR_INT16_MAX_STAGES))
+		{
+			return HYDRASDR_ERROR_INVALID_PARAM;
+		}
+
+		if (factor > 1)
+		{
+			decimator = decimator_int16_create(HB_KERNEL_INT16, HB_KERNEL_INT16_LEN, factor);
+			if (decimator == NULL)
+			{
+				return HYDRASDR_ERROR_NO_MEM;
+			}
+		}
+
+		decimator_int16_free(device->decimator);
+		device->decimator = decimator;
 
 		return HYDRASDR_SUCCESS;
 	}
 
-	int ADDCALL hydrasdr_set_conversion_filter_int16(struct hydrasdr_device* device, const int16_t *kernel, const uint32_t len)
+	int ADDCALL hydrasdr_set_resampler(struct hydrasdr_device* device, const uint32_t interpolation, const uint32_t decimation)
 	{
+		uint32_t a, b, t;
+		int max_output;
+
 		if (device->streaming)
 		{
 			return HYDRASDR_ERROR_BUSY;
 		}
 
-		iqconverter_int16_free(device->cnv_i);
-		device->cnv_i = iqconverter_int16_create(kernel, len);
+		if (interpolation == 0 || decimation == 0)
+		{
+			return HYDRASDR_ERROR_INVALID_PARAM;
+		}
+
+		/* Reduce L/M to lowest terms */
+		a = interpolation;
+		b = decimation;
+		while (b != 0)
+		{
+			t = a % b;
+			a = b;
+			b = t;
+		}
+
+		/* Only rate reduction is supported so the downstream buffers keep their size */
+		if (interpolation / a > decimation / a ||
+			interpolation / a > RESAMPLER_MAX_INTERPOLATION || decimation / a > RESAMPLER_MAX_DECIMATION)
+		{
+			return HYDRASDR_ERROR_INVALID_PARAM;
+		}
+
+		resampler_free(device->resampler);
+		free(device->resampler_buffer);
+		device->resampler = NULL;
+		device->resampler_buffer = NULL;
+
+		if (interpolation == decimation)
+		{
+			return HYDRASDR_SUCCESS;
+		}
+
+		device->resampler = resampler_create(interpolation / a, decimation / a, 0);
+		if (device->resampler == NULL)
+		{
+			return HYDRASDR_ERROR_NO_MEM;
+		}
+
+		max_output = resampler_max_output(device->resampler, MAX_IQ_SAMPLES_PER_BUFFER * 2);
+		device->resampler_buffer = (float *) malloc((size_t) max_output * 2 * sizeof(float));
+		if (device->resampler_buffer == NULL)
+		{
+			resampler_free(device->resampler);
+			device->resampler = NULL;
+			return HYDRASDR_ERROR_NO_MEM;
+		}
+
+		return HYDRASDR_SUCCESS;
+	}
+
+	int ADDCALL hydrasdr_set_channelizer(struct hydrasdr_device* device, const uint32_t channel_count, const uint32_t taps_per_channel)
+	{
+		uint32_t i;
+		size_t channel_size;
+
+		if (device->streaming)
+		{
+			return HYDRASDR_ERROR_BUSY;
+		}
+
+		free_channelizer(device);
+
+		if (channel_count == 0)
+		{
+			return HYDRASDR_SUCCESS;
+		}
+
+		if (channel_count < 2 || channel_count > CHANNELIZER_MAX_CHANNELS || (channel_count & (channel_count - 1)) != 0)
+		{
+			return HYDRASDR_ERROR_INVALID_PARAM;
+		}
+
+		device->channelizer = channelizer_create(channel_count, taps_per_channel);
+		device->channels = (hydrasdr_channel_t *) calloc(channel_count, sizeof(hydrasdr_channel_t));
+		device->channel_out = (float **) calloc(channel_count, sizeof(float *));
+		if (device->channelizer == NULL || device->channels == NULL || device->channel_out == NULL)
+		{
+			channelizer_free(device->channelizer);
+			free(device->channels);
+			free(device->channel_out);
+			device->channelizer = NULL;
+			device->channels = NULL;
+			device->channel_out = NULL;
+			return HYDRASDR_ERROR_NO_MEM;
+		}
+
+		channel_size = (MAX_IQ_SAMPLES_PER_BUFFER / channel_count + 1) * 2 * sizeof(float);
+		for (i = 0; i < channel_count; i++)
+		{
+			device->channels[i].samples = (float *) malloc(channel_size);
+			if (device->channels[i].samples == NULL)
+			{
+				free_channelizer(device);
+				return HYDRASDR_ERROR_NO_MEM;
+			}
+		}
+
+		return HYDRASDR_SUCCESS;
+	}
+
+	int ADDCALL hydrasdr_subscribe_channel(struct hydrasdr_device* device, const uint32_t channel, hydrasdr_sample_block_cb_fn callback, void* ctx)
+	{
+		if (device->channelizer == NULL)
+		{
+			return HYDRASDR_ERROR_UNSUPPORTED;
+		}
+
+		if (channel >= (uint32_t) device->channelizer->channels)
+		{
+			return HYDRASDR_ERROR_INVALID_PARAM;
+		}
+
+		if (callback == NULL)
+		{
+			device->channels[channel].callback = NULL;
+			device->channels[channel].ctx = NULL;
+		}
+		else
+		{
+			device->channels[channel].ctx = ctx;
+			device->channels[channel].callback = callback;
+		}
+
+		return HYDRASDR_SUCCESS;
+	}
+
+	int ADDCALL hydrasdr_set_conversion_filter_float32(struct hydrasdr_device* device, const float *kernel, const uint32_t len)
+	{
+		/* Created outside of the lock, the FFT crossover may be measured here */
+		iqconverter_float_t *cnv = iqconverter_float_create(kernel, len);
+
+		pthread_mutex_lock(&device->consumer_mp);
+		if (device->io_busy > 0)
+		{
+			/* A filter set twice before the next buffer is never used */
+			if (device->pending_cnv_f != NULL)
+			{
+				iqconverter_float_free(device->pending_cnv_f);
+			}
+			device->pending_cnv_f = cnv;
+			device->pending_flags |= HYDRASDR_TRANSFER_FILTER_CHANGED;
+		}
+		else
+		{
+			iqconverter_float_free(device->cnv_f);
+			device->cnv_f = cnv;
+		}
+		pthread_mutex_unlock(&device->consumer_mp);
+
+		return HYDRASDR_SUCCESS;
+	}
+
+	int ADDCALL hydrasdr_set_conversion_filter_int16(struct hydrasdr_device* device, const int16_t *kernel, const uint32_t len)
+	{
+		iqconverter_int16_t *cnv = iqconverter_int16_create(kernel, len);
+
+		pthread_mutex_lock(&device->consumer_mp);
+		if (device->io_busy > 0)
+		{
+			if (device->pending_cnv_i != NULL)
+			{
+				iqconverter_int16_free(device->pending_cnv_i);
+			}
+			device->pending_cnv_i = cnv;
+			device->pending_flags |= HYDRASDR_TRANSFER_FILTER_CHANGED;
+		}
+		else
+		{
+			iqconverter_int16_free(device->cnv_i);
+			device->cnv_i = cnv;
+		}
+		pthread_mutex_unlock(&device->consumer_mp);
 
 		return HYDRASDR_SUCCESS;
 	}
@@ -1761,8 +2986,8 @@ int hydrasdr_list_devices(uint64_t *serials, int count)
 
 		length = 1;
 
-		result = libusb_control_transfer(
-			device->usb_device,
+		result = control_transfer(
+			device,
 			LIBUSB_ENDPOINT_IN | LIBUSB_REQUEST_TYPE_VENDOR | LIBUSB_RECIPIENT_DEVICE,
 			HYDRASDR_SET_LNA_GAIN,
 			0,
@@ -1791,8 +3016,8 @@ int hydrasdr_list_devices(uint64_t *serials, int count)
 
 		length = 1;
 
-		result = libusb_control_transfer(
-			device->usb_device,
+		result = control_transfer(
+			device,
 			LIBUSB_ENDPOINT_IN | LIBUSB_REQUEST_TYPE_VENDOR | LIBUSB_RECIPIENT_DEVICE,
 			HYDRASDR_SET_MIXER_GAIN,
 			0,
@@ -1821,8 +3046,8 @@ int hydrasdr_list_devices(uint64_t *serials, int count)
 
 		length = 1;
 
-		result = libusb_control_transfer(
-			device->usb_device,
+		result = control_transfer(
+			device,
 			LIBUSB_ENDPOINT_IN | LIBUSB_REQUEST_TYPE_VENDOR | LIBUSB_RECIPIENT_DEVICE,
 			HYDRASDR_SET_VGA_GAIN,
 			0,
@@ -1848,8 +3073,8 @@ int hydrasdr_list_devices(uint64_t *serials, int count)
 
 		length = 1;
 
-		result = libusb_control_transfer(
-			device->usb_device,
+		result = control_transfer(
+			device,
 			LIBUSB_ENDPOINT_IN | LIBUSB_REQUEST_TYPE_VENDOR | LIBUSB_RECIPIENT_DEVICE,
 			HYDRASDR_SET_LNA_AGC,
 			0,
@@ -1875,8 +3100,8 @@ int hydrasdr_list_devices(uint64_t *serials, int count)
 
 		length = 1;
 
-		result = libusb_control_transfer(
-			device->usb_device,
+		result = control_transfer(
+			device,
 			LIBUSB_ENDPOINT_IN | LIBUSB_REQUEST_TYPE_VENDOR | LIBUSB_RECIPIENT_DEVICE,
 			HYDRASDR_SET_MIXER_AGC,
 			0,
@@ -1965,8 +3190,8 @@ int hydrasdr_list_devices(uint64_t *serials, int count)
 	int ADDCALL hydrasdr_set_rf_bias(hydrasdr_device_t* device, uint8_t value)
 	{
 		int result;
-		result = libusb_control_transfer(
-			device->usb_device,
+		result = control_transfer(
+			device,
 			LIBUSB_ENDPOINT_OUT | LIBUSB_REQUEST_TYPE_VENDOR | LIBUSB_RECIPIENT_DEVICE,
 			HYDRASDR_SET_RF_BIAS_CMD,
 			0, // setup.value
@@ -1995,8 +3220,8 @@ int hydrasdr_list_devices(uint64_t *serials, int count)
 			return HYDRASDR_ERROR_BUSY;
 		}
 
-		result = libusb_control_transfer(
-			device->usb_device,
+		result = control_transfer(
+			device,
 			LIBUSB_ENDPOINT_IN | LIBUSB_REQUEST_TYPE_VENDOR | LIBUSB_RECIPIENT_DEVICE,
 			HYDRASDR_SET_PACKING,
 			0,
@@ -2010,7 +3235,7 @@ int hydrasdr_list_devices(uint64_t *serials, int count)
 			return  HYDRASDR_ERROR_LIBUSB;
 		}
 
-		if(value == 1)
+		if(value == PACKING_ON)
 		{
 			/* 1 = Enable Packing */
 			packing_enabled = true;
@@ -2022,13 +3247,14 @@ int hydrasdr_list_devices(uint64_t *serials, int count)
 			*/
 			packing_enabled = false;
 		}
+		device->header_enabled = (value == PACKING_OFF_HEADER);
 		if (packing_enabled != device->packing_enabled)
 		{
 			cancel_transfers(device);
 			free_transfers(device);
 
 			device->packing_enabled = packing_enabled;
-			device->buffer_size = packing_enabled ? (6144 * 24) : 262144;
+			device->buffer_size = packing_enabled ? BUFFER_SIZE_PACKED : BUFFER_SIZE_UNPACKED;
 
 			result = allocate_transfers(device);
 			if (result != 0)
@@ -2046,8 +3272,8 @@ int hydrasdr_list_devices(uint64_t *serials, int count)
 		uint8_t length;
 
 		length = 1;
-		libusb_control_transfer(
-			device->usb_device,
+		control_transfer(
+			device,
 			LIBUSB_ENDPOINT_IN | LIBUSB_REQUEST_TYPE_VENDOR | LIBUSB_RECIPIENT_DEVICE,
 			HYDRASDR_RESET,
 			0,
@@ -2070,8 +3296,8 @@ int hydrasdr_list_devices(uint64_t *serials, int count)
 
 		length = 1;
 		value = (uint8_t)rf_port;
-		result = libusb_control_transfer(
-			device->usb_device,
+		result = control_transfer(
+			device,
 			LIBUSB_ENDPOINT_IN | LIBUSB_REQUEST_TYPE_VENDOR | LIBUSB_RECIPIENT_DEVICE,
 			HYDRASDR_SET_RF_PORT,
 			0,
@@ -2092,6 +3318,91 @@ int hydrasdr_list_devices(uint64_t *serials, int count)
 		return (device->streaming == true && device->stop_requested == false);
 	}
 
+	int ADDCALL hydrasdr_set_overflow_policy(hydrasdr_device_t* device, enum hydrasdr_overflow_policy policy, uint32_t high_watermark)
+	{
+		if ((int) policy < 0 || policy > HYDRASDR_OVERFLOW_DEGRADE || high_watermark > RAW_BUFFER_COUNT)
+		{
+			return HYDRASDR_ERROR_INVALID_PARAM;
+		}
+
+		pthread_mutex_lock(&device->consumer_mp);
+		device->overflow_policy = policy;
+		device->overflow_watermark = high_watermark != 0 ? (int) high_watermark : RAW_BUFFER_COUNT / 2;
+		if (policy != HYDRASDR_OVERFLOW_DEGRADE)
+		{
+			device->degraded = false;
+		}
+		pthread_mutex_unlock(&device->consumer_mp);
+
+		return HYDRASDR_SUCCESS;
+	}
+
+	int ADDCALL hydrasdr_set_external_events(hydrasdr_device_t* device, uint8_t value)
+	{
+		if (device->streaming || device->io_busy > 0)
+		{
+			return HYDRASDR_ERROR_BUSY;
+		}
+
+		device->external_events = value ? true : false;
+
+		return HYDRASDR_SUCCESS;
+	}
+
+	int ADDCALL hydrasdr_get_pollfds(hydrasdr_device_t* device, hydrasdr_pollfd_t* pollfds, int count)
+	{
+		const struct libusb_pollfd** usb_pollfds;
+		int i;
+
+		if (count < 0 || (pollfds == NULL && count > 0))
+		{
+			return HYDRASDR_ERROR_INVALID_PARAM;
+		}
+
+		if (device->replay_file != NULL)
+		{
+			return 0;
+		}
+
+		usb_pollfds = libusb_get_pollfds(device->usb_context);
+		if (usb_pollfds == NULL)
+		{
+			return HYDRASDR_ERROR_UNSUPPORTED;
+		}
+
+		for (i = 0; usb_pollfds[i] != NULL; i++)
+		{
+			if (i < count)
+			{
+				pollfds[i].fd = usb_pollfds[i]->fd;
+				pollfds[i].events = usb_pollfds[i]->events;
+			}
+		}
+		libusb_free_pollfds(usb_pollfds);
+
+		return i;
+	}
+
+	int ADDCALL hydrasdr_handle_events_nonblocking(hydrasdr_device_t* device)
+	{
+		int error;
+		struct timeval timeout = { 0, 0 };
+
+		if (device->replay_file != NULL)
+		{
+			return HYDRASDR_SUCCESS;
+		}
+
+		error = libusb_handle_events_timeout_completed(device->usb_context, &timeout, NULL);
+		if (error < 0 && error != LIBUSB_ERROR_INTERRUPTED)
+		{
+			device->streaming = false;
+			return HYDRASDR_ERROR_LIBUSB;
+		}
+
+		return HYDRASDR_SUCCESS;
+	}
+
 	const char* ADDCALL hydrasdr_error_name(enum hydrasdr_error errcode)
 	{
 		switch (errcode)
@@ -2126,6 +3437,12 @@ int hydrasdr_list_devices(uint64_t *serials, int count)
 		case HYDRASDR_ERROR_STREAMING_STOPPED:
 			return "HYDRASDR_ERROR_STREAMING_STOPPED";
 
+		case HYDRASDR_ERROR_TIMEOUT:
+			return "HYDRASDR_ERROR_TIMEOUT";
+
+		case HYDRASDR_ERROR_OVERRUN:
+			return "HYDRASDR_ERROR_OVERRUN";
+
 		case HYDRASDR_ERROR_OTHER:
 			return "HYDRASDR_ERROR_OTHER";
 
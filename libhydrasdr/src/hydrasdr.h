@@ -72,6 +72,8 @@ enum hydrasdr_error
 	HYDRASDR_ERROR_THREAD = -1001,
 	HYDRASDR_ERROR_STREAMING_THREAD_ERR = -1002,
 	HYDRASDR_ERROR_STREAMING_STOPPED = -1003,
+	HYDRASDR_ERROR_TIMEOUT = -1004,
+	HYDRASDR_ERROR_OVERRUN = -1005,
 	HYDRASDR_ERROR_OTHER = -9999,
 };
 
@@ -90,7 +92,36 @@ enum hydrasdr_sample_type
 	HYDRASDR_SAMPLE_INT16_REAL = 3,   /* 1 * 16bit int per sample */
 	HYDRASDR_SAMPLE_UINT16_REAL = 4,  /* 1 * 16bit unsigned int per sample */
 	HYDRASDR_SAMPLE_RAW = 5,          /* Raw packed samples from the device */
-	HYDRASDR_SAMPLE_END = 6           /* Number of supported sample types */
+	HYDRASDR_SAMPLE_INT8_IQ = 6,      /* 2 * 8bit int per sample */
+	HYDRASDR_SAMPLE_PACKED12_IQ = 7,  /* 2 * 12bit int per sample packed in 3 bytes: I[7:0], Q[3:0]<<4 | I[11:8], Q[11:4] */
+	HYDRASDR_SAMPLE_FLOAT16_IQ = 8,   /* 2 * 16bit IEEE 754 half float per sample */
+	HYDRASDR_SAMPLE_END = 9           /* Number of supported sample types */
+};
+
+enum hydrasdr_replay_flags
+{
+	HYDRASDR_REPLAY_REALTIME = (1 << 0), /* Pace buffers at the sample rate and drop them when the consumer is late */
+	HYDRASDR_REPLAY_LOOP = (1 << 1),     /* Restart from the beginning of the file instead of stopping at its end */
+};
+
+/* hydrasdr_transfer_t flags, set on the first buffer produced with the change */
+enum hydrasdr_transfer_flags
+{
+	HYDRASDR_TRANSFER_FILTER_CHANGED = (1 << 0),      /* Conversion filter set while streaming */
+	HYDRASDR_TRANSFER_SAMPLE_TYPE_CHANGED = (1 << 1), /* Sample type set while streaming */
+	HYDRASDR_TRANSFER_SEQUENCE_VALID = (1 << 2),      /* Header mode: sequence and the firmware and USB drops are exact */
+	HYDRASDR_TRANSFER_DROPPED_NEWEST = (1 << 3),      /* The host drops before this buffer were buffers received on a full queue */
+	HYDRASDR_TRANSFER_DROPPED_OLDEST = (1 << 4),      /* The host drops before this buffer were the oldest of a full queue */
+	HYDRASDR_TRANSFER_DEGRADED = (1 << 5),            /* HYDRASDR_OVERFLOW_DEGRADE: delivered as HYDRASDR_SAMPLE_RAW, without conversion */
+	HYDRASDR_TRANSFER_FILTER_TRANSIENT = (1 << 6),    /* With FILTER_CHANGED: the new filter is longer, its first taps of output see zeros for the older input */
+};
+
+/* What the host does when its queue of received buffers is full, see hydrasdr_set_overflow_policy() */
+enum hydrasdr_overflow_policy
+{
+	HYDRASDR_OVERFLOW_DROP_NEWEST = 0, /* Default, keeps the continuity of the queued data, drops at the end of the stream come with an empty transfer */
+	HYDRASDR_OVERFLOW_DROP_OLDEST = 1, /* Keeps the freshest data */
+	HYDRASDR_OVERFLOW_DEGRADE = 2,     /* Drops the newest, and delivers RAW buffers without conversion above the high watermark */
 };
 
 #define MAX_CONFIG_PAGE_SIZE (0x10000)
@@ -104,8 +135,34 @@ typedef struct {
 	int sample_count;
 	uint64_t dropped_samples;
 	enum hydrasdr_sample_type sample_type;
+	uint32_t flags; /* enum hydrasdr_transfer_flags */
+	/* Where the dropped_samples (their sum) were lost, just before samples */
+	uint64_t dropped_firmware_samples; /* No USB buffer free in the firmware, header mode only (hydrasdr_set_packing(device, 2)) */
+	uint64_t dropped_usb_samples;      /* Lost between the firmware and the host, header mode only */
+	uint64_t dropped_host_samples;     /* Queue of the received buffers full */
+	uint64_t sample_index;             /* Index of samples[0] since hydrasdr_start_rx(), dropped samples included */
+	uint32_t sequence;                 /* Header mode: firmware sequence number of the buffer */
 } hydrasdr_transfer_t, hydrasdr_transfer;
 
+/* Buffer read from a shared memory ring with hydrasdr_shm_read() */
+typedef struct {
+	uint64_t sequence;        /* Number of the buffer since the publisher was set, consecutive unless buffers were lost */
+	uint64_t lost_buffers;    /* Buffers overwritten by the publisher before this reader got them */
+	uint64_t dropped_samples; /* Samples dropped by the device before this buffer (as hydrasdr_transfer_t) */
+	enum hydrasdr_sample_type sample_type;
+	int sample_count;
+	uint32_t bytes;
+	const void* samples;      /* Read in place in the shared memory, valid until hydrasdr_shm_release() */
+} hydrasdr_shm_buffer_t;
+
+struct hydrasdr_shm_reader;
+
+/* File descriptor to poll for the USB events, see hydrasdr_get_pollfds() */
+typedef struct {
+	int fd;
+	short events; /* POLLIN and/or POLLOUT as for poll() */
+} hydrasdr_pollfd_t;
+
 typedef struct {
 	uint32_t part_id[2];
 	uint32_t serial_no[4];
@@ -126,6 +183,19 @@ extern ADDAPI int ADDCALL hydrasdr_list_devices(uint64_t *serials, int count);
 extern ADDAPI int ADDCALL hydrasdr_open_sn(struct hydrasdr_device** device, uint64_t serial_number);
 extern ADDAPI int ADDCALL hydrasdr_open_fd(struct hydrasdr_device** device, int fd);
 extern ADDAPI int ADDCALL hydrasdr_open(struct hydrasdr_device** device);
+/*
+ * Open a RAW capture (hydrasdr_rx -t 5) as a virtual device replayed through the sample pipeline.
+ * samplerate is the IQ sample rate of the capture, call hydrasdr_set_packing(device, 1) for packed captures.
+ * Without HYDRASDR_REPLAY_REALTIME buffers are delivered as fast as the callback consumes them.
+ * Streaming stops at the end of the file, each hydrasdr_start_rx() replays it from the beginning
+ * (or from the range set with hydrasdr_set_replay_range()).
+ * Control requests (frequency, gains...) are accepted and ignored.
+ */
+extern ADDAPI int ADDCALL hydrasdr_open_file(struct hydrasdr_device** device, const char* path, uint32_t samplerate, uint32_t flags);
+/* Replay length bytes from offset (0 = up to the end of the file), use multiples of hydrasdr_get_buffer_size() */
+extern ADDAPI int ADDCALL hydrasdr_set_replay_range(struct hydrasdr_device* device, uint64_t offset, uint64_t length);
+/* Size in bytes of the RAW buffers received from the device, it depends on packing */
+extern ADDAPI int ADDCALL hydrasdr_get_buffer_size(struct hydrasdr_device* device, uint32_t* size);
 extern ADDAPI int ADDCALL hydrasdr_close(struct hydrasdr_device* device);
 
 /* Use hydrasdr_get_samplerates(device, buffer, 0) to get the number of available sample rates. It will be returned in the first element of buffer */
@@ -134,6 +204,61 @@ extern ADDAPI int ADDCALL hydrasdr_get_samplerates(struct hydrasdr_device* devic
 /* Parameter samplerate can be either the index of a samplerate or directly its value in Hz within the list returned by hydrasdr_get_samplerates() */
 extern ADDAPI int ADDCALL hydrasdr_set_samplerate(struct hydrasdr_device* device, uint32_t samplerate);
 
+/*
+ Host-side NCO fine tuning for the IQ sample types, applied after the IQ conversion without any USB transfer.
+ Parameter freq_hz is the offset from the tuned frequency which is brought to DC, within +/- samplerate/2 (0 disables the NCO).
+ The change is phase continuous and takes effect on the next buffer, even while streaming.
+ Tuning the device off-center by an offset and setting the same offset here moves the signal of interest away from the DC spike.
+*/
+extern ADDAPI int ADDCALL hydrasdr_set_nco_freq(struct hydrasdr_device* device, const int32_t freq_hz);
+
+/*
+ Fixed-point decimation of the HYDRASDR_SAMPLE_INT16_IQ output (after the NCO) by a cascade of half-band filters.
+ Parameter factor shall be a power of 2 between 1 (disabled) and 256, the callback receives int16 IQ at samplerate / factor.
+*/
+extern ADDAPI int ADDCALL hydrasdr_set_decimation(struct hydrasdr_device* device, const uint32_t factor);
+
+/*
+ Rational L/M polyphase resampler applied to the HYDRASDR_SAMPLE_FLOAT32_IQ/FLOAT16_IQ output (after the NCO, before the channelizer).
+ The output rate is samplerate * interpolation / decimation, the ratio is reduced to lowest terms and shall not exceed 1
+ (after reduction interpolation <= 1024 and decimation <= 65536). interpolation == decimation disables the resampler.
+ Example: 10 MSPS to 2.048 MSPS is interpolation=128 decimation=625.
+*/
+extern ADDAPI int ADDCALL hydrasdr_set_resampler(struct hydrasdr_device* device, const uint32_t interpolation, const uint32_t decimation);
+
+/*
+ Polyphase filter-bank channelizer fed by the HYDRASDR_SAMPLE_FLOAT32_IQ/FLOAT16_IQ output (after the NCO), channels are always FLOAT32_IQ.
+ Parameter channel_count shall be a power of 2 between 2 and 4096 (0 disables the channelizer), each channel is sampled at samplerate / channel_count.
+ Parameter taps_per_channel is the prototype filter length per polyphase branch (0 selects the default of 12).
+*/
+extern ADDAPI int ADDCALL hydrasdr_set_channelizer(struct hydrasdr_device* device, const uint32_t channel_count, const uint32_t taps_per_channel);
+/*
+ Channel c is centered on c * samplerate / channel_count from the tuned frequency (c >= channel_count / 2 are negative offsets).
+ The callback receives the FLOAT32_IQ channel samples on the consumer thread, callback=NULL unsubscribes the channel.
+*/
+extern ADDAPI int ADDCALL hydrasdr_subscribe_channel(struct hydrasdr_device* device, const uint32_t channel, hydrasdr_sample_block_cb_fn callback, void* ctx);
+
+/*
+ Shared memory fan-out (POSIX only, HYDRASDR_ERROR_UNSUPPORTED on Windows).
+ Every buffer passed to the callback is also published in the shared memory ring name (e.g. "/hydrasdr0") of slot_count buffers
+ (0 selects 64, 1 is rejected with HYDRASDR_ERROR_INVALID_PARAM), so any number of processes on the host get the stream converted once. name=NULL stops publishing.
+ The publisher never waits for the readers, a reader more than slot_count buffers late skips ahead and is told how many it lost.
+*/
+extern ADDAPI int ADDCALL hydrasdr_set_shm_publisher(struct hydrasdr_device* device, const char* name, uint32_t slot_count);
+/* Reader side, the reader starts with the next buffer published */
+extern ADDAPI int ADDCALL hydrasdr_shm_open(struct hydrasdr_shm_reader** reader, const char* name);
+/* Waits up to timeout_ms for the next buffer, returns HYDRASDR_ERROR_TIMEOUT if none came or HYDRASDR_ERROR_STREAMING_STOPPED once the publisher is closed and its last buffers were read */
+extern ADDAPI int ADDCALL hydrasdr_shm_read(struct hydrasdr_shm_reader* reader, hydrasdr_shm_buffer_t* buffer, uint32_t timeout_ms);
+/* Shall follow each successful hydrasdr_shm_read(), returns HYDRASDR_ERROR_OVERRUN if the buffer was overwritten meanwhile (discard its samples) */
+extern ADDAPI int ADDCALL hydrasdr_shm_release(struct hydrasdr_shm_reader* reader);
+extern ADDAPI int ADDCALL hydrasdr_shm_close(struct hydrasdr_shm_reader* reader);
+
+/*
+ * Long filters (from a tap count measured on the host) use an overlap-save FFT FIR, same output within float rounding.
+ * While streaming the filter (or sample type) is swapped in at the next buffer, flagged in hydrasdr_transfer_t.
+ * A new filter continues the input history of the previous one, the output has no step at the swap
+ * (except for a longer filter, flagged HYDRASDR_TRANSFER_FILTER_TRANSIENT).
+ */
 extern ADDAPI int ADDCALL hydrasdr_set_conversion_filter_float32(struct hydrasdr_device* device, const float *kernel, const uint32_t len);
 extern ADDAPI int ADDCALL hydrasdr_set_conversion_filter_int16(struct hydrasdr_device* device, const int16_t *kernel, const uint32_t len);
 
@@ -143,6 +268,29 @@ extern ADDAPI int ADDCALL hydrasdr_stop_rx(struct hydrasdr_device* device);
 /* return HYDRASDR_TRUE if success */
 extern ADDAPI int ADDCALL hydrasdr_is_streaming(struct hydrasdr_device* device);
 
+/*
+ Overflow policy, can be changed while streaming. high_watermark is the number of queued buffers, the one being delivered included
+ (1..8, 0 selects 4, 8 is a full queue), from which HYDRASDR_OVERFLOW_DEGRADE delivers HYDRASDR_SAMPLE_RAW buffers until the backlog is under half of it. The converters keep their
+ state across the degraded buffers, so the first converted buffer after them starts with a discontinuity as after a drop.
+ Replays at maximum speed keep their queue full by design and are never degraded.
+*/
+extern ADDAPI int ADDCALL hydrasdr_set_overflow_policy(struct hydrasdr_device* device, enum hydrasdr_overflow_policy policy, uint32_t high_watermark);
+
+/*
+ Event loop integration (not while streaming): with value=1 hydrasdr_start_rx() creates no transfer thread, the application
+ polls the file descriptors from hydrasdr_get_pollfds() in its own loop (epoll, libuv, asio...) and calls
+ hydrasdr_handle_events_nonblocking() when one is ready, and at least every 100 ms. The callback still runs in the conversion thread.
+ Devices opened with hydrasdr_open_file() have no USB events and keep their replay thread.
+*/
+extern ADDAPI int ADDCALL hydrasdr_set_external_events(struct hydrasdr_device* device, uint8_t value);
+/*
+ Copies up to count descriptors, returns the number of descriptors of the device (0 for a replay), HYDRASDR_ERROR_UNSUPPORTED (Windows)
+ or HYDRASDR_ERROR_INVALID_PARAM (count < 0, or pollfds NULL with count > 0)
+*/
+extern ADDAPI int ADDCALL hydrasdr_get_pollfds(struct hydrasdr_device* device, hydrasdr_pollfd_t* pollfds, int count);
+/* Completes the ready USB transfers without blocking */
+extern ADDAPI int ADDCALL hydrasdr_handle_events_nonblocking(struct hydrasdr_device* device);
+
 extern ADDAPI int ADDCALL hydrasdr_si5351c_write(struct hydrasdr_device* device, uint8_t register_number, uint8_t value);
 extern ADDAPI int ADDCALL hydrasdr_si5351c_read(struct hydrasdr_device* device, uint8_t register_number, uint8_t* value);
 
@@ -173,6 +321,9 @@ extern ADDAPI int ADDCALL hydrasdr_set_sample_type(struct hydrasdr_device* devic
 /* Parameter freq_hz shall be between 24000000(24MHz) and 1800000000(1.8GHz) and more with extensions */
 extern ADDAPI int ADDCALL hydrasdr_set_freq(struct hydrasdr_device* device, const uint64_t freq_hz);
 
+/* Parameter value shall be 0=Disable TPDF dithering(default) or 1=Enable, applies to HYDRASDR_SAMPLE_INT8_IQ and HYDRASDR_SAMPLE_PACKED12_IQ */
+extern ADDAPI int ADDCALL hydrasdr_set_dithering(struct hydrasdr_device* device, uint8_t value);
+
 /* Parameter value shall be between 0 and 15 */
 extern ADDAPI int ADDCALL hydrasdr_set_lna_gain(struct hydrasdr_device* device, uint8_t value);
 
@@ -202,7 +353,10 @@ extern ADDAPI int ADDCALL hydrasdr_set_sensitivity_gain(struct hydrasdr_device*
 /* Parameter value shall be 0=Disable BiasT or 1=Enable BiasT */
 extern ADDAPI int ADDCALL hydrasdr_set_rf_bias(struct hydrasdr_device* dev, uint8_t value);
 
-/* Parameter value shall be 0=Disable Packing or 1=Enable Packing */
+/*
+ Parameter value shall be 0=Disable Packing, 1=Enable Packing or 2=Disable Packing+Header (exact drop accounting, see hydrasdr_buffer_header_t).
+ With 2 only the buffers starting with the header magic are parsed (flagged HYDRASDR_TRANSFER_SEQUENCE_VALID), the others are all samples.
+*/
 extern ADDAPI int ADDCALL hydrasdr_set_packing(struct hydrasdr_device* device, uint8_t value);
 
 extern ADDAPI const char* ADDCALL hydrasdr_error_name(enum hydrasdr_error errcode);
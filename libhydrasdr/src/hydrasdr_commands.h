@@ -125,6 +125,30 @@ typedef enum
 	RF_PORT_RX2 = 2  /* RX Channel 2 (called also CABLE2) */
 } hydrasdr_rf_port_t;
 
+/* HYDRASDR_SET_PACKING modes */
+typedef enum
+{
+	PACKING_OFF = 0,       /* 16bits samples */
+	PACKING_ON = 1,        /* 12bits packed samples */
+	PACKING_OFF_HEADER = 2 /* 16bits samples, the USB buffers may start with hydrasdr_buffer_header_t */
+} hydrasdr_packing_t;
+
+/* "HSDR", its 16bits halves are above the 12bits sample range so sample data never matches it */
+#define HYDRASDR_BUFFER_HEADER_MAGIC (0x52445348)
+
+/*
+ * In-band header of the USB buffers in PACKING_OFF_HEADER mode (little endian), the samples follow it.
+ * Not negotiated with the firmware: the host only parses the buffers starting with the magic and delivers
+ * the others whole, as in PACKING_OFF. Replayed captures (hydrasdr_open_file()) may carry it as well.
+ */
+typedef struct
+{
+	uint32_t magic;    /* HYDRASDR_BUFFER_HEADER_MAGIC */
+	uint32_t sequence; /* Buffer number since RECEIVER_MODE_RX, incremented for every buffer filled by the ADC, sent or not */
+	uint32_t dropped;  /* Buffers the firmware could not send (no USB buffer free) since RECEIVER_MODE_RX */
+	uint32_t reserved;
+} hydrasdr_buffer_header_t;
+
 #ifdef __cplusplus
 } // __cplusplus defined.
 #endif
@@ -25,9 +25,17 @@ THE SOFTWARE.
 #include "iqconverter_float.h"
 #include <stdlib.h>
 #include <string.h>
+#include <limits.h>
+#include <pthread.h>
 
 #include <stdio.h>
 
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <time.h>
+#endif
+
 #if defined(__MINGW32__) && !defined(__MINGW64_VERSION_MAJOR)
   #include <malloc.h>
   #define _aligned_malloc __mingw_aligned_malloc
@@ -70,13 +78,53 @@ void *_aligned_malloc(size_t size, size_t alignment)
 #define DEFAULT_ALIGNMENT 16
 #define HPF_COEFF 0.01f
 
+/* Overlap-save: FFT size >= FFT_SIZE_FACTOR * taps, never for less than FFT_MIN_TAPS in auto mode */
+#define FFT_SIZE_FACTOR 8
+#define FFT_MIN_SIZE 64
+#define FFT_MIN_TAPS 32
+#define FFT_MAX_MEASURED_TAPS 1024
+#define FFT_MEASURE_SAMPLES 32768
+
 #if defined(_MSC_VER)
 	#define ALIGNED __declspec(align(DEFAULT_ALIGNMENT))
 #else
 	#define ALIGNED
 #endif
 
-iqconverter_float_t *iqconverter_float_create(const float *hb_kernel, int len)
+static void fft_kernel_create(iqconverter_float_t *cnv)
+{
+	int i;
+	int size = FFT_MIN_SIZE;
+	float scale;
+
+	while (size < FFT_SIZE_FACTOR * cnv->len)
+	{
+		size <<= 1;
+	}
+
+	cnv->fft = fft_create(size, 0);
+	cnv->ifft = fft_create(size, 1);
+	cnv->fft_block = size - (cnv->len - 1);
+	cnv->fft_kernel = (float *) _aligned_malloc(size * 2 * sizeof(float), DEFAULT_ALIGNMENT);
+	cnv->fft_buf = (float *) _aligned_malloc(size * 2 * sizeof(float), DEFAULT_ALIGNMENT);
+	cnv->fft_input = (float *) _aligned_malloc((cnv->len - 1 + 2 * cnv->fft_block) * sizeof(float), DEFAULT_ALIGNMENT);
+
+	/* Frequency response, scaled for the unnormalized inverse FFT */
+	memset(cnv->fft_kernel, 0, size * 2 * sizeof(float));
+	for (i = 0; i < cnv->len; i++)
+	{
+		cnv->fft_kernel[2 * i] = cnv->fir_kernel[i];
+	}
+	fft_process(cnv->fft, cnv->fft_kernel);
+
+	scale = 1.0f / size;
+	for (i = 0; i < size * 2; i++)
+	{
+		cnv->fft_kernel[i] *= scale;
+	}
+}
+
+iqconverter_float_t *iqconverter_float_create_fir(const float *hb_kernel, int len, int fir_mode)
 {
 	int i, j;
 	size_t buffer_size;
@@ -91,21 +139,59 @@ iqconverter_float_t *iqconverter_float_create(const float *hb_kernel, int len)
 	cnv->fir_queue = (float *) _aligned_malloc(buffer_size * SIZE_FACTOR, DEFAULT_ALIGNMENT);
 	cnv->delay_line = (float *) _aligned_malloc(buffer_size / 2, DEFAULT_ALIGNMENT);
 
-	iqconverter_float_reset(cnv);
-
 	for (i = 0, j = 0; i < cnv->len; i++, j += 2)
 	{
 		cnv->fir_kernel[i] = hb_kernel[j];
 	} 
 
+	/* The unrolled FIR loops fold the kernel, they need it symmetric */
+	cnv->symmetric = 1;
+	for (i = 0; i < cnv->len / 2; i++)
+	{
+		if (cnv->fir_kernel[i] != cnv->fir_kernel[cnv->len - 1 - i])
+		{
+			cnv->symmetric = 0;
+		}
+	}
+
+	if (fir_mode == IQCONVERTER_FIR_AUTO)
+	{
+		fir_mode = (cnv->len >= FFT_MIN_TAPS && cnv->len >= iqconverter_float_fft_crossover()) ? IQCONVERTER_FIR_FFT : IQCONVERTER_FIR_DIRECT;
+	}
+
+	cnv->fft = NULL;
+	cnv->ifft = NULL;
+	cnv->fft_kernel = NULL;
+	cnv->fft_buf = NULL;
+	cnv->fft_input = NULL;
+	if (fir_mode == IQCONVERTER_FIR_FFT)
+	{
+		fft_kernel_create(cnv);
+	}
+
+	iqconverter_float_reset(cnv);
+
 	return cnv;
 }
 
+iqconverter_float_t *iqconverter_float_create(const float *hb_kernel, int len)
+{
+	return iqconverter_float_create_fir(hb_kernel, len, IQCONVERTER_FIR_AUTO);
+}
+
 void iqconverter_float_free(iqconverter_float_t *cnv)
 {
 	_aligned_free(cnv->fir_kernel);
 	_aligned_free(cnv->fir_queue);
 	_aligned_free(cnv->delay_line);
+	if (cnv->fft != NULL)
+	{
+		fft_free(cnv->fft);
+		fft_free(cnv->ifft);
+		_aligned_free(cnv->fft_kernel);
+		_aligned_free(cnv->fft_buf);
+		_aligned_free(cnv->fft_input);
+	}
 	_aligned_free(cnv);
 }
 
@@ -116,6 +202,58 @@ void iqconverter_float_reset(iqconverter_float_t *cnv)
 	cnv->delay_index = 0;
 	memset(cnv->delay_line, 0, cnv->len * sizeof(float) / 2);
 	memset(cnv->fir_queue, 0, cnv->len * sizeof(float) * SIZE_FACTOR);
+	if (cnv->fft != NULL)
+	{
+		memset(cnv->fft_input, 0, (cnv->len - 1) * sizeof(float));
+	}
+}
+
+/* I sample age samples before the last one processed, age < len - 1 */
+static float fir_history(const iqconverter_float_t *cnv, int age)
+{
+	if (cnv->fft != NULL)
+	{
+		return cnv->fft_input[cnv->len - 2 - age];
+	}
+
+	return cnv->fir_queue[cnv->fir_index + 1 + age];
+}
+
+int iqconverter_float_seed(iqconverter_float_t *cnv, const iqconverter_float_t *from)
+{
+	int i, age;
+	int half_len = cnv->len >> 1;
+	int from_half_len = from->len >> 1;
+	float scale;
+
+	iqconverter_float_reset(cnv);
+	cnv->avg = from->avg;
+
+	/* Newest first after fir_index 0, oldest first in the FFT input */
+	for (age = 0; age < cnv->len - 1 && age < from->len - 1; age++)
+	{
+		if (cnv->fft != NULL)
+		{
+			cnv->fft_input[cnv->len - 2 - age] = fir_history(from, age);
+		}
+		else
+		{
+			cnv->fir_queue[1 + age] = fir_history(from, age);
+		}
+	}
+
+	/* The delayed Q samples are scaled by hbc, read from delay_index = 0 the oldest first */
+	scale = (from->hbc != 0.0f) ? cnv->hbc / from->hbc : 0.0f;
+	for (i = 0; i < half_len; i++)
+	{
+		age = half_len - i;
+		if (age <= from_half_len)
+		{
+			cnv->delay_line[i] = from->delay_line[(from->delay_index - age + from_half_len) % from_half_len] * scale;
+		}
+	}
+
+	return cnv->len > from->len;
 }
 
 static _inline float process_fir_taps(const float *kernel, const float *queue, int len)
@@ -219,19 +357,26 @@ static _inline float process_fir_taps(const float *kernel, const float *queue, i
 		sum += kernel[0] * queue[0]
 			+ kernel[1] * queue[1];
 
-		//kernel += 2;
-		//queue += 2;
-		//len &= 1;
+		kernel += 2;
+		queue += 2;
+		len &= 1;
 	}
 
-	//if (len >= 1)
-	//{
-	//	sum += kernel[0] * queue[0];
-	//}
+	if (len >= 1)
+	{
+		sum += kernel[0] * queue[0];
+	}
 
 	return sum;
 }
 
+#ifdef HYDRASDR_FIR_GENERATED
+
+/* fir_generated[taps], built by fir_generate.cmake */
+#include "fir_float_generated.h"
+
+#else
+
 static void fir_interleaved_4(iqconverter_float_t *cnv, float *samples, int len)
 {
 	int i;
@@ -372,6 +517,8 @@ static void fir_interleaved_24(iqconverter_float_t *cnv, float *samples, int len
 	cnv->fir_index = fir_index;
 }
 
+#endif
+
 static void fir_interleaved_generic(iqconverter_float_t *cnv, float *samples, int len)
 {
 	int i;
@@ -399,8 +546,95 @@ static void fir_interleaved_generic(iqconverter_float_t *cnv, float *samples, in
 	cnv->fir_index = fir_index;
 }
 
+/*
+ * Overlap-save convolution, the real I samples of two consecutive blocks go
+ * in the real and imaginary parts of one complex FFT (the kernel is real).
+ * A partial block is zero padded, so the output does not depend on the
+ * buffer sizes and the stream has no added latency.
+ */
+static void fir_fft(iqconverter_float_t *cnv, float *samples, int len)
+{
+	int k, count, len1, len2;
+	int history = cnv->len - 1;
+	int block = cnv->fft_block;
+	int size = cnv->fft->size;
+	const float *kernel = cnv->fft_kernel;
+	float *input = cnv->fft_input;
+	float *buf = cnv->fft_buf;
+	float re, im;
+
+	count = (len + 1) / 2;
+	while (count > 0)
+	{
+		len1 = (count < block) ? count : block;
+		len2 = (count - len1 < block) ? count - len1 : block;
+
+		/* input holds the last history samples then the new ones */
+		for (k = 0; k < len1 + len2; k++)
+		{
+			input[history + k] = samples[2 * k];
+		}
+
+		memset(buf, 0, size * 2 * sizeof(float));
+		for (k = 0; k < history + len1; k++)
+		{
+			buf[2 * k] = input[k];
+		}
+		for (k = 0; k < history + len2 && len2 > 0; k++)
+		{
+			buf[2 * k + 1] = input[len1 + k];
+		}
+
+		fft_process(cnv->fft, buf);
+		for (k = 0; k < size; k++)
+		{
+			re = buf[2 * k] * kernel[2 * k] - buf[2 * k + 1] * kernel[2 * k + 1];
+			im = buf[2 * k] * kernel[2 * k + 1] + buf[2 * k + 1] * kernel[2 * k];
+			buf[2 * k] = re;
+			buf[2 * k + 1] = im;
+		}
+		fft_process(cnv->ifft, buf);
+
+		/* The first history outputs are wrapped around, the others are the linear convolution */
+		for (k = 0; k < len1; k++)
+		{
+			samples[2 * k] = buf[2 * (history + k)];
+		}
+		for (k = 0; k < len2; k++)
+		{
+			samples[2 * (len1 + k)] = buf[2 * (history + k) + 1];
+		}
+
+		memmove(input, input + len1 + len2, history * sizeof(float));
+		samples += 2 * (len1 + len2);
+		count -= len1 + len2;
+	}
+}
+
 static void fir_interleaved(iqconverter_float_t *cnv, float *samples, int len)
 {
+	if (cnv->fft != NULL)
+	{
+		fir_fft(cnv, samples, len);
+		return;
+	}
+
+	if (!cnv->symmetric)
+	{
+		fir_interleaved_generic(cnv, samples, len);
+		return;
+	}
+
+#ifdef HYDRASDR_FIR_GENERATED
+	if (cnv->len <= FIR_GENERATED_MAX_TAPS)
+	{
+		fir_generated[cnv->len](cnv, samples, len);
+	}
+	else
+	{
+		fir_interleaved_generic(cnv, samples, len);
+	}
+#else
 	switch (cnv->len)
 	{
 	case 4:
@@ -419,6 +653,7 @@ static void fir_interleaved(iqconverter_float_t *cnv, float *samples, int len)
 		fir_interleaved_generic(cnv, samples, len);
 		break;
 	}
+#endif
 }
 
 static void delay_interleaved(iqconverter_float_t *cnv, float *samples, int len)
@@ -504,3 +739,100 @@ void iqconverter_float_process(iqconverter_float_t *cnv, float *samples, int len
 	remove_dc(cnv, samples, len);
 	translate_fs_4(cnv, samples, len);
 }
+
+static double measure_clock(void)
+{
+#ifdef _WIN32
+	LARGE_INTEGER count;
+	LARGE_INTEGER frequency;
+
+	QueryPerformanceCounter(&count);
+	QueryPerformanceFrequency(&frequency);
+	return (double) count.QuadPart / (double) frequency.QuadPart;
+#else
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (double) ts.tv_sec + (double) ts.tv_nsec * 1e-9;
+#endif
+}
+
+static double measure_fir(const float *kernel, int len, int fir_mode, float *samples)
+{
+	int i, j;
+	double start, elapsed, best = 0.0;
+	iqconverter_float_t *cnv = iqconverter_float_create_fir(kernel, len, fir_mode);
+
+	/* Best of 3 runs, the first one also warms up the caches */
+	for (i = 0; i < 3; i++)
+	{
+		for (j = 0; j < FFT_MEASURE_SAMPLES; j++)
+		{
+			samples[j] = (float) ((j * 7919) % 4096 - 2048) / 2048.0f;
+		}
+
+		start = measure_clock();
+		iqconverter_float_process(cnv, samples, FFT_MEASURE_SAMPLES);
+		elapsed = measure_clock() - start;
+		if (i == 0 || elapsed < best)
+		{
+			best = elapsed;
+		}
+	}
+
+	iqconverter_float_free(cnv);
+	return best;
+}
+
+static int fft_crossover;
+static pthread_once_t fft_crossover_once = PTHREAD_ONCE_INIT;
+
+static void measure_fft_crossover(void)
+{
+	int taps, len, i;
+	float *kernel;
+	float *samples;
+
+	kernel = (float *) malloc((2 * FFT_MAX_MEASURED_TAPS - 1) * sizeof(float));
+	samples = (float *) malloc(FFT_MEASURE_SAMPLES * sizeof(float));
+	if (kernel == NULL || samples == NULL)
+	{
+		/* Nothing measured, the direct FIR is always used */
+		free(kernel);
+		free(samples);
+		fft_crossover = INT_MAX;
+		return;
+	}
+
+	taps = FFT_MIN_TAPS;
+	while (taps <= FFT_MAX_MEASURED_TAPS)
+	{
+		len = 2 * taps - 1;
+		for (i = 0; i < len; i++)
+		{
+			kernel[i] = 1.0f / (float) (len + 1);
+		}
+		if (measure_fir(kernel, len, IQCONVERTER_FIR_FFT, samples) < measure_fir(kernel, len, IQCONVERTER_FIR_DIRECT, samples))
+		{
+			break;
+		}
+		taps += taps / 2;
+	}
+
+	free(kernel);
+	free(samples);
+
+	fft_crossover = taps;
+}
+
+/*
+ * Smallest tap count where the FFT path beats the direct FIR on this host,
+ * measured once per process, by the first converter of FFT_MIN_TAPS taps or
+ * more (converters created concurrently wait for the measure).
+ * Past FFT_MAX_MEASURED_TAPS the FFT path is assumed faster.
+ */
+int iqconverter_float_fft_crossover(void)
+{
+	pthread_once(&fft_crossover_once, measure_fft_crossover);
+	return fft_crossover;
+}
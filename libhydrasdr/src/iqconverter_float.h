@@ -26,24 +26,44 @@ THE SOFTWARE.
 #define IQCONVERTER_FLOAT_H
 
 #include <stdint.h>
+#include "fft.h"
 
 #define IQCONVERTER_NZEROS 2
 #define IQCONVERTER_NPOLES 2
 
+/* FIR of the I samples: direct, overlap-save FFT, or chosen from the measured crossover */
+#define IQCONVERTER_FIR_AUTO 0
+#define IQCONVERTER_FIR_DIRECT 1
+#define IQCONVERTER_FIR_FFT 2
+
 typedef struct {
 	float avg;
 	float hbc;
 	int len;
+	int symmetric;
 	int fir_index;
 	int delay_index;
 	float *fir_kernel;
 	float *fir_queue;
 	float *delay_line;
+	fft_t *fft;
+	fft_t *ifft;
+	int fft_block;
+	float *fft_kernel;
+	float *fft_buf;
+	float *fft_input;
 } iqconverter_float_t;
 
 iqconverter_float_t *iqconverter_float_create(const float *hb_kernel, int len);
+iqconverter_float_t *iqconverter_float_create_fir(const float *hb_kernel, int len, int fir_mode);
+int iqconverter_float_fft_crossover(void);
 void iqconverter_float_free(iqconverter_float_t *cnv);
 void iqconverter_float_reset(iqconverter_float_t *cnv);
+/*
+ * Continues the stream of from: DC filter, FIR and delay line history.
+ * Returns 1 if cnv is the longer filter, its history older than the one of from is zero (a transient of cnv->len IQ samples).
+ */
+int iqconverter_float_seed(iqconverter_float_t *cnv, const iqconverter_float_t *from);
 void iqconverter_float_process(iqconverter_float_t *cnv, float *samples, int len);
 
 #endif // IQCONVERTER_FLOAT_H
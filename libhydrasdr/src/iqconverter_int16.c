@@ -71,6 +71,16 @@ iqconverter_int16_t *iqconverter_int16_create(const int16_t *hb_kernel, int len)
 		cnv->fir_kernel[i] = hb_kernel[i * 2];
 	}
 
+	/* The unrolled FIR loops fold the kernel, they need it symmetric */
+	cnv->symmetric = 1;
+	for (i = 0; i < cnv->len / 2; i++)
+	{
+		if (cnv->fir_kernel[i] != cnv->fir_kernel[cnv->len - 1 - i])
+		{
+			cnv->symmetric = 0;
+		}
+	}
+
 	return cnv;
 }
 
@@ -93,7 +103,44 @@ void iqconverter_int16_reset(iqconverter_int16_t *cnv)
 	memset(cnv->fir_queue, 0, cnv->len * sizeof(int16_t) * SIZE_FACTOR);
 }
 
-static void fir_interleaved(iqconverter_int16_t *cnv, int16_t *samples, int len)
+int iqconverter_int16_seed(iqconverter_int16_t *cnv, const iqconverter_int16_t *from)
+{
+	int i, age;
+	int half_len = cnv->len >> 1;
+	int from_half_len = from->len >> 1;
+
+	iqconverter_int16_reset(cnv);
+	cnv->old_x = from->old_x;
+	cnv->old_y = from->old_y;
+	cnv->old_e = from->old_e;
+
+	/* The I history follows fir_index newest first */
+	for (age = 0; age < cnv->len - 1 && age < from->len - 1; age++)
+	{
+		cnv->fir_queue[1 + age] = from->fir_queue[from->fir_index + 1 + age];
+	}
+
+	/* Read from delay_index = 0 the oldest first */
+	for (i = 0; i < half_len; i++)
+	{
+		age = half_len - i;
+		if (age <= from_half_len)
+		{
+			cnv->delay_line[i] = from->delay_line[(from->delay_index - age + from_half_len) % from_half_len];
+		}
+	}
+
+	return cnv->len > from->len;
+}
+
+#ifdef HYDRASDR_FIR_GENERATED
+
+/* fir_generated[taps], built by fir_generate.cmake */
+#include "fir_int16_generated.h"
+
+#endif
+
+static void fir_interleaved_generic(iqconverter_int16_t *cnv, int16_t *samples, int len)
 {
 	int i;
 	int j;
@@ -131,6 +178,19 @@ static void fir_interleaved(iqconverter_int16_t *cnv, int16_t *samples, int len)
 	cnv->fir_index = fir_index;
 }
 
+static void fir_interleaved(iqconverter_int16_t *cnv, int16_t *samples, int len)
+{
+#ifdef HYDRASDR_FIR_GENERATED
+	if (cnv->symmetric && cnv->len <= FIR_GENERATED_MAX_TAPS)
+	{
+		fir_generated[cnv->len](cnv, samples, len);
+		return;
+	}
+#endif
+
+	fir_interleaved_generic(cnv, samples, len);
+}
+
 static void delay_interleaved(iqconverter_int16_t *cnv, int16_t *samples, int len)
 {
 	int i;
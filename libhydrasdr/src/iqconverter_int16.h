@@ -29,6 +29,7 @@ THE SOFTWARE.
 
 typedef struct {
 	int len;
+	int symmetric;
 	int fir_index;
 	int delay_index;
 	int16_t old_x;
@@ -42,6 +43,11 @@ typedef struct {
 iqconverter_int16_t *iqconverter_int16_create(const int16_t *hb_kernel, int len);
 void iqconverter_int16_free(iqconverter_int16_t *cnv);
 void iqconverter_int16_reset(iqconverter_int16_t *cnv);
+/*
+ * Continues the stream of from: DC filter, FIR and delay line history.
+ * Returns 1 if cnv is the longer filter, its history older than the one of from is zero (a transient of cnv->len IQ samples).
+ */
+int iqconverter_int16_seed(iqconverter_int16_t *cnv, const iqconverter_int16_t *from);
 void iqconverter_int16_process(iqconverter_int16_t *cnv, int16_t *samples, int len);
 
 #endif // IQCONVERTER_INT16_H
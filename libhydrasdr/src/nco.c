@@ -0,0 +1,199 @@
+/*
+Copyright (c) 2025 Benjamin Vernoux <bvernoux@hydrasdr.com>
+
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+
+Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the
+documentation and/or other materials provided with the distribution.
+Neither the name of HydraSDR nor the names of its contributors may be used to endorse or promote products derived from this software
+without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "nco.h"
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+#define NCO_PHASE_TO_RAD (2.0 * M_PI / 4294967296.0)
+#define NCO_LANES 4
+/* Complex samples between two re-anchorings of the recursive oscillator on the phase accumulator */
+#define NCO_BLOCK 256
+
+nco_t *nco_create(void)
+{
+	int i;
+	nco_t *nco = (nco_t *) malloc(sizeof(nco_t));
+
+	if (nco == NULL)
+	{
+		return NULL;
+	}
+
+	nco->cos_lut = (int16_t *) malloc(NCO_LUT_SIZE * sizeof(int16_t));
+	if (nco->cos_lut == NULL)
+	{
+		free(nco);
+		return NULL;
+	}
+
+	for (i = 0; i < NCO_LUT_SIZE; i++)
+	{
+		nco->cos_lut[i] = (int16_t) lrint(32767.0 * cos(2.0 * M_PI * i / NCO_LUT_SIZE));
+	}
+
+	nco->phase_inc = 0;
+	nco_reset(nco);
+
+	return nco;
+}
+
+void nco_free(nco_t *nco)
+{
+	if (nco != NULL)
+	{
+		free(nco->cos_lut);
+		free(nco);
+	}
+}
+
+void nco_reset(nco_t *nco)
+{
+	nco->phase = 0;
+}
+
+void nco_set_phase_inc(nco_t *nco, uint32_t phase_inc)
+{
+	nco->phase_inc = phase_inc;
+}
+
+uint32_t nco_freq_to_phase_inc(int64_t freq_hz, uint32_t samplerate)
+{
+	int64_t inc;
+
+	if (samplerate == 0)
+	{
+		return 0;
+	}
+
+	inc = (int64_t) llround((double) freq_hz * 4294967296.0 / (double) samplerate);
+
+	return (uint32_t) inc;
+}
+
+void nco_process_float(nco_t *nco, float *samples, int len)
+{
+	int i, j, k, n, count;
+	uint32_t phase = nco->phase;
+	uint32_t inc = nco->phase_inc;
+	float c[NCO_LANES], s[NCO_LANES];
+	float rc, rs, t, xi, xq;
+	float *buf;
+
+	count = len / 2;
+
+	/* Rotation applied to each lane between two iterations (NCO_LANES samples) */
+	rc = (float) cos((double) (uint32_t) (inc * NCO_LANES) * NCO_PHASE_TO_RAD);
+	rs = (float) sin((double) (uint32_t) (inc * NCO_LANES) * NCO_PHASE_TO_RAD);
+
+	for (i = 0; i < count; i += NCO_BLOCK)
+	{
+		n = count - i;
+		if (n > NCO_BLOCK)
+		{
+			n = NCO_BLOCK;
+		}
+
+		/* Re-anchor each lane on the accumulator to avoid amplitude/phase drift */
+		for (k = 0; k < NCO_LANES; k++)
+		{
+			double p = (double) (uint32_t) (phase + k * inc) * NCO_PHASE_TO_RAD;
+			c[k] = (float) cos(p);
+			s[k] = (float) sin(p);
+		}
+
+		buf = samples + 2 * i;
+
+		for (j = 0; j + NCO_LANES <= n; j += NCO_LANES, buf += 2 * NCO_LANES)
+		{
+			for (k = 0; k < NCO_LANES; k++)
+			{
+				xi = buf[2 * k + 0];
+				xq = buf[2 * k + 1];
+				buf[2 * k + 0] = xi * c[k] - xq * s[k];
+				buf[2 * k + 1] = xi * s[k] + xq * c[k];
+			}
+
+			for (k = 0; k < NCO_LANES; k++)
+			{
+				t = c[k] * rc - s[k] * rs;
+				s[k] = c[k] * rs + s[k] * rc;
+				c[k] = t;
+			}
+		}
+
+		for (k = 0; j < n; j++, k++, buf += 2)
+		{
+			xi = buf[0];
+			xq = buf[1];
+			buf[0] = xi * c[k] - xq * s[k];
+			buf[1] = xi * s[k] + xq * c[k];
+		}
+
+		phase += inc * (uint32_t) n;
+	}
+
+	nco->phase = phase;
+}
+
+static inline int16_t saturate_int16(int32_t x)
+{
+	if (x > 32767)
+	{
+		return 32767;
+	}
+	if (x < -32768)
+	{
+		return -32768;
+	}
+	return (int16_t) x;
+}
+
+void nco_process_int16(nco_t *nco, int16_t *samples, int len)
+{
+	int i;
+	uint32_t index;
+	uint32_t phase = nco->phase;
+	uint32_t inc = nco->phase_inc;
+	const int16_t *lut = nco->cos_lut;
+	int32_t c, s, xi, xq;
+
+	for (i = 0; i < len; i += 2)
+	{
+		index = phase >> (32 - NCO_LUT_BITS);
+		c = lut[index];
+		s = lut[(index - (NCO_LUT_SIZE / 4)) & (NCO_LUT_SIZE - 1)];
+
+		xi = samples[i + 0];
+		xq = samples[i + 1];
+		samples[i + 0] = saturate_int16((xi * c - xq * s + (1 << 14)) >> 15);
+		samples[i + 1] = saturate_int16((xi * s + xq * c + (1 << 14)) >> 15);
+
+		phase += inc;
+	}
+
+	nco->phase = phase;
+}
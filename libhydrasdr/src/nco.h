@@ -0,0 +1,50 @@
+/*
+Copyright (c) 2025 Benjamin Vernoux <bvernoux@hydrasdr.com>
+
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+
+Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the
+documentation and/or other materials provided with the distribution.
+Neither the name of HydraSDR nor the names of its contributors may be used to endorse or promote products derived from this software
+without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef NCO_H
+#define NCO_H
+
+#include <stdint.h>
+
+/*
+ * Host-side numerically controlled oscillator / complex mixer.
+ * The phase is kept in a 32bit accumulator (2^32 = 2*PI) so the frequency
+ * can be changed between two buffers without any phase discontinuity.
+ */
+
+#define NCO_LUT_BITS 12
+#define NCO_LUT_SIZE (1 << NCO_LUT_BITS)
+
+typedef struct {
+	uint32_t phase;
+	uint32_t phase_inc;
+	int16_t *cos_lut; /* Q15 cosine table used by the int16 path */
+} nco_t;
+
+nco_t *nco_create(void);
+void nco_free(nco_t *nco);
+void nco_reset(nco_t *nco);
+void nco_set_phase_inc(nco_t *nco, uint32_t phase_inc);
+uint32_t nco_freq_to_phase_inc(int64_t freq_hz, uint32_t samplerate);
+void nco_process_float(nco_t *nco, float *samples, int len);
+void nco_process_int16(nco_t *nco, int16_t *samples, int len);
+
+#endif // NCO_H
@@ -0,0 +1,191 @@
+/*
+Copyright (c) 2025 Benjamin Vernoux <bvernoux@hydrasdr.com>
+
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+
+Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the
+documentation and/or other materials provided with the distribution.
+Neither the name of HydraSDR nor the names of its contributors may be used to endorse or promote products derived from this software
+without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "resampler.h"
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+#define SIZE_FACTOR 16
+
+static void design_prototype(float *h, int len, double fc, double gain)
+{
+	int i;
+	double x, w, sum;
+
+	sum = 0.0;
+	for (i = 0; i < len; i++)
+	{
+		x = i - (len - 1) / 2.0;
+		/* Blackman window */
+		w = 0.42 - 0.5 * cos(2.0 * M_PI * i / (len - 1)) + 0.08 * cos(4.0 * M_PI * i / (len - 1));
+		h[i] = (float) (w * (x == 0.0 ? 2.0 * fc : sin(2.0 * M_PI * fc * x) / (M_PI * x)));
+		sum += h[i];
+	}
+
+	/* Each of the L phases gets unity DC gain */
+	for (i = 0; i < len; i++)
+	{
+		h[i] = (float) (h[i] * gain / sum);
+	}
+}
+
+resampler_t *resampler_create(int interpolation, int decimation, int taps_per_phase)
+{
+	int p, k, len;
+	float *h;
+	resampler_t *rs;
+
+	if (interpolation < 1 || interpolation > RESAMPLER_MAX_INTERPOLATION ||
+		decimation < 1 || decimation > RESAMPLER_MAX_DECIMATION)
+	{
+		return NULL;
+	}
+
+	if (taps_per_phase <= 0)
+	{
+		taps_per_phase = RESAMPLER_DEFAULT_TAPS_PER_PHASE;
+	}
+
+	if (decimation > interpolation)
+	{
+		taps_per_phase *= (decimation + interpolation - 1) / interpolation;
+	}
+
+	rs = (resampler_t *) calloc(1, sizeof(resampler_t));
+	if (rs == NULL)
+	{
+		return NULL;
+	}
+
+	rs->interpolation = interpolation;
+	rs->decimation = decimation;
+	rs->taps = taps_per_phase;
+	len = interpolation * taps_per_phase;
+
+	rs->kernel = (float *) malloc((size_t) len * 2 * sizeof(float));
+	rs->queue = (float *) malloc((size_t) taps_per_phase * SIZE_FACTOR * 2 * sizeof(float));
+	h = (float *) malloc((size_t) len * sizeof(float));
+
+	if (rs->kernel == NULL || rs->queue == NULL || h == NULL)
+	{
+		free(h);
+		resampler_free(rs);
+		return NULL;
+	}
+
+	design_prototype(h, len, 0.5 / (interpolation > decimation ? interpolation : decimation), interpolation);
+
+	/* Phase p applies h[p + k * L] to the input k samples back */
+	for (p = 0; p < interpolation; p++)
+	{
+		for (k = 0; k < taps_per_phase; k++)
+		{
+			rs->kernel[(p * taps_per_phase + k) * 2 + 0] = h[p + k * interpolation];
+			rs->kernel[(p * taps_per_phase + k) * 2 + 1] = h[p + k * interpolation];
+		}
+	}
+
+	free(h);
+
+	resampler_reset(rs);
+
+	return rs;
+}
+
+void resampler_free(resampler_t *rs)
+{
+	if (rs != NULL)
+	{
+		free(rs->kernel);
+		free(rs->queue);
+		free(rs);
+	}
+}
+
+void resampler_reset(resampler_t *rs)
+{
+	rs->phase = 0;
+	rs->queue_index = rs->taps * (SIZE_FACTOR - 1);
+	memset(rs->queue, 0, (size_t) rs->taps * SIZE_FACTOR * 2 * sizeof(float));
+}
+
+int resampler_max_output(resampler_t *rs, int len)
+{
+	return (int) (((int64_t) (len / 2) * rs->interpolation + rs->decimation - 1) / rs->decimation) + 1;
+}
+
+int resampler_process(resampler_t *rs, const float *samples, int len, float *output)
+{
+	int i, k;
+	int count = 0;
+	int taps = rs->taps;
+	int interpolation = rs->interpolation;
+	int decimation = rs->decimation;
+	int phase = rs->phase;
+	int queue_index = rs->queue_index;
+	float acc_i, acc_q;
+	float *queue;
+	const float *kernel;
+
+	for (i = 0; i < len; i += 2)
+	{
+		queue = rs->queue + 2 * queue_index;
+		queue[0] = samples[i + 0];
+		queue[1] = samples[i + 1];
+
+		/* Every output falling between this input and the next one */
+		while (phase < interpolation)
+		{
+			kernel = rs->kernel + (size_t) phase * taps * 2;
+
+			acc_i = 0.0f;
+			acc_q = 0.0f;
+			for (k = 0; k < 2 * taps; k += 2)
+			{
+				acc_i += kernel[k + 0] * queue[k + 0];
+				acc_q += kernel[k + 1] * queue[k + 1];
+			}
+
+			output[2 * count + 0] = acc_i;
+			output[2 * count + 1] = acc_q;
+			count++;
+
+			phase += decimation;
+		}
+		phase -= interpolation;
+
+		if (--queue_index < 0)
+		{
+			queue_index = taps * (SIZE_FACTOR - 1);
+			memcpy(rs->queue + 2 * (queue_index + 1), rs->queue, (taps - 1) * 2 * sizeof(float));
+		}
+	}
+
+	rs->phase = phase;
+	rs->queue_index = queue_index;
+
+	return count;
+}
@@ -0,0 +1,57 @@
+/*
+Copyright (c) 2025 Benjamin Vernoux <bvernoux@hydrasdr.com>
+
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+
+Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the
+documentation and/or other materials provided with the distribution.
+Neither the name of HydraSDR nor the names of its contributors may be used to endorse or promote products derived from this software
+without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef RESAMPLER_H
+#define RESAMPLER_H
+
+#include <stdint.h>
+
+/*
+ * Rational L/M polyphase resampler for interleaved float IQ.
+ * The prototype lowpass runs at L times the input rate with cutoff at the
+ * narrower of the input and output Nyquist, only the outputs actually needed are computed.
+ * When decimating, the taps per phase scale with ceil(M / L) to keep the same transition band.
+ */
+
+#define RESAMPLER_DEFAULT_TAPS_PER_PHASE (16)
+#define RESAMPLER_MAX_INTERPOLATION (1024)
+#define RESAMPLER_MAX_DECIMATION (65536)
+
+typedef struct {
+	int interpolation; /* L */
+	int decimation;    /* M */
+	int taps;          /* Taps per polyphase branch */
+	int phase;         /* Position of the next output, in 1/L input sample units ahead of the newest input */
+	int queue_index;
+	float *kernel;     /* Per phase kernels, each coefficient duplicated for I and Q */
+	float *queue;      /* Delay line, interleaved IQ, newest sample first */
+} resampler_t;
+
+resampler_t *resampler_create(int interpolation, int decimation, int taps_per_phase);
+void resampler_free(resampler_t *rs);
+void resampler_reset(resampler_t *rs);
+/* Largest number of IQ samples produced for len floats of input */
+int resampler_max_output(resampler_t *rs, int len);
+/* Process len floats of interleaved IQ into output (see resampler_max_output()).
+   Returns the number of IQ samples written */
+int resampler_process(resampler_t *rs, const float *samples, int len, float *output);
+
+#endif // RESAMPLER_H
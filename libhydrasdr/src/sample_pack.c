@@ -0,0 +1,107 @@
+/*
+Copyright (c) 2025 Benjamin Vernoux <bvernoux@hydrasdr.com>
+
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+
+Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the
+documentation and/or other materials provided with the distribution.
+Neither the name of HydraSDR nor the names of its contributors may be used to endorse or promote products derived from this software
+without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "sample_pack.h"
+#include <stdlib.h>
+
+/* xorshift32, only used to generate the dither */
+static uint32_t next_random(uint32_t *state)
+{
+	uint32_t x = *state;
+
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+	*state = x;
+
+	return x;
+}
+
+/* Rounds x to (16 - shift) bits with saturation */
+static int32_t narrow(int32_t x, int shift, int32_t dither)
+{
+	x = (x + dither + (1 << (shift - 1))) >> shift;
+
+	if (x > (32767 >> shift))
+	{
+		return 32767 >> shift;
+	}
+	if (x < (-32768 >> shift))
+	{
+		return -32768 >> shift;
+	}
+	return x;
+}
+
+/* Sum of two uniform variables of one output LSB each, centered on 0 */
+static int32_t tpdf(uint32_t *state, int shift)
+{
+	uint32_t r = next_random(state);
+	int32_t mask = (1 << shift) - 1;
+
+	return (int32_t) (r & mask) + (int32_t) ((r >> 16) & mask) - mask;
+}
+
+void sample_pack_int8(const int16_t *src, int8_t *dest, int len, uint32_t *dither_state)
+{
+	int i;
+
+	if (dither_state == NULL)
+	{
+		for (i = 0; i < len; i++)
+		{
+			dest[i] = (int8_t) narrow(src[i], 8, 0);
+		}
+	}
+	else
+	{
+		for (i = 0; i < len; i++)
+		{
+			dest[i] = (int8_t) narrow(src[i], 8, tpdf(dither_state, 8));
+		}
+	}
+}
+
+void sample_pack_packed12(const int16_t *src, uint8_t *dest, int len, uint32_t *dither_state)
+{
+	int i;
+	int32_t x, y;
+
+	for (i = 0; i < len; i += 2)
+	{
+		if (dither_state == NULL)
+		{
+			x = narrow(src[i + 0], 4, 0);
+			y = narrow(src[i + 1], 4, 0);
+		}
+		else
+		{
+			x = narrow(src[i + 0], 4, tpdf(dither_state, 4));
+			y = narrow(src[i + 1], 4, tpdf(dither_state, 4));
+		}
+
+		/* Both components are read before the 3 output bytes overwrite them when in place */
+		dest[0] = (uint8_t) x;
+		dest[1] = (uint8_t) (((x >> 8) & 0x0F) | ((y & 0x0F) << 4));
+		dest[2] = (uint8_t) (y >> 4);
+		dest += 3;
+	}
+}
@@ -0,0 +1,41 @@
+/*
+Copyright (c) 2025 Benjamin Vernoux <bvernoux@hydrasdr.com>
+
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+
+Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the
+documentation and/or other materials provided with the distribution.
+Neither the name of HydraSDR nor the names of its contributors may be used to endorse or promote products derived from this software
+without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef SAMPLE_PACK_H
+#define SAMPLE_PACK_H
+
+#include <stdint.h>
+
+/*
+ * Narrowing of full scale int16 IQ to the compact output types.
+ * INT8_IQ keeps the 8 MSB of each component.
+ * PACKED12_IQ keeps the 12 MSB, one IQ sample per 3 bytes:
+ *   byte0 = I[7:0], byte1 = Q[3:0] << 4 | I[11:8], byte2 = Q[11:4]
+ * Both round to nearest with saturation, dither_state != NULL adds TPDF dither of +/-1 output LSB.
+ * Conversion can be done in place (dest == src).
+ */
+
+/* len is the number of int16 values (2 per IQ sample), writes len bytes */
+void sample_pack_int8(const int16_t *src, int8_t *dest, int len, uint32_t *dither_state);
+/* len is the number of int16 values (2 per IQ sample, shall be even), writes len * 3 / 2 bytes */
+void sample_pack_packed12(const int16_t *src, uint8_t *dest, int len, uint32_t *dither_state);
+
+#endif // SAMPLE_PACK_H
@@ -0,0 +1,383 @@
+/*
+Copyright (c) 2025 Benjamin Vernoux <bvernoux@hydrasdr.com>
+
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+
+Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the
+documentation and/or other materials provided with the distribution.
+Neither the name of HydraSDR nor the names of its contributors may be used to endorse or promote products derived from this software
+without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "shm_ring.h"
+#include <stdlib.h>
+#include <string.h>
+
+#ifndef _WIN32
+
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#define SHM_RING_MAGIC "HSDRSHM1"
+#define SHM_RING_VERSION (1)
+#define SHM_RING_ALIGN (64)
+/* Slot payloads start on their own cache line after the slot header */
+#define SHM_RING_HEADER_SIZE (SHM_RING_ALIGN)
+#define SHM_RING_SLOT_HEADER_SIZE (SHM_RING_ALIGN)
+
+typedef struct {
+	char magic[8];
+	uint32_t version;
+	uint32_t slot_count;
+	uint32_t slot_size;      /* Payload bytes of a slot */
+	uint32_t slot_stride;    /* Slot header and payload rounded up to SHM_RING_ALIGN */
+	uint64_t write_sequence; /* Sequence of the next buffer, buffers up to write_sequence - 1 are complete */
+	uint32_t closed;
+	int32_t writer_pid;
+} shm_ring_header_t;
+
+typedef struct {
+	uint64_t lock;
+	uint64_t dropped_samples;
+	uint32_t sample_type;
+	uint32_t sample_count;
+	uint32_t bytes;
+	uint32_t reserved;
+} shm_ring_slot_t;
+
+struct shm_ring {
+	shm_ring_header_t *header;
+	size_t map_size;
+	char *name;
+	int writer;
+	uint64_t cursor;     /* Reader: sequence of the next buffer to read */
+	uint64_t held_lock;  /* Reader: lock value of the buffer returned by shm_ring_next() */
+};
+
+static shm_ring_slot_t *slot_at(shm_ring_t *ring, uint64_t sequence)
+{
+	return (shm_ring_slot_t *) ((uint8_t *) ring->header + SHM_RING_HEADER_SIZE +
+		(size_t) (sequence % ring->header->slot_count) * ring->header->slot_stride);
+}
+
+static shm_ring_t *ring_alloc(const char *name)
+{
+	shm_ring_t *ring;
+
+	ring = (shm_ring_t *) calloc(1, sizeof(shm_ring_t));
+	if (ring == NULL)
+	{
+		return NULL;
+	}
+
+	ring->name = strdup(name);
+	if (ring->name == NULL)
+	{
+		free(ring);
+		return NULL;
+	}
+
+	return ring;
+}
+
+static void ring_free(shm_ring_t *ring)
+{
+	free(ring->name);
+	free(ring);
+}
+
+shm_ring_t *shm_ring_create(const char *name, uint32_t slot_count, uint32_t slot_size)
+{
+	int fd;
+	void *map;
+	uint32_t stride;
+	size_t size;
+	shm_ring_t *ring;
+
+	/* The reader never reads the slot being rewritten */
+	if (slot_count < 2)
+	{
+		return NULL;
+	}
+
+	stride = (SHM_RING_SLOT_HEADER_SIZE + slot_size + SHM_RING_ALIGN - 1) & ~(uint32_t) (SHM_RING_ALIGN - 1);
+	size = SHM_RING_HEADER_SIZE + (size_t) slot_count * stride;
+
+	ring = ring_alloc(name);
+	if (ring == NULL)
+	{
+		return NULL;
+	}
+
+	shm_unlink(name);
+	fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0644);
+	if (fd < 0)
+	{
+		ring_free(ring);
+		return NULL;
+	}
+
+	if (ftruncate(fd, (off_t) size) != 0)
+	{
+		close(fd);
+		shm_unlink(name);
+		ring_free(ring);
+		return NULL;
+	}
+
+	map = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	close(fd);
+	if (map == MAP_FAILED)
+	{
+		shm_unlink(name);
+		ring_free(ring);
+		return NULL;
+	}
+
+	/* ftruncate() zero fills, every slot starts with lock 0 which matches no sequence */
+	ring->header = (shm_ring_header_t *) map;
+	ring->map_size = size;
+	ring->writer = 1;
+	ring->header->version = SHM_RING_VERSION;
+	ring->header->slot_count = slot_count;
+	ring->header->slot_size = slot_size;
+	ring->header->slot_stride = stride;
+	ring->header->writer_pid = (int32_t) getpid();
+	__atomic_thread_fence(__ATOMIC_RELEASE);
+	memcpy(ring->header->magic, SHM_RING_MAGIC, sizeof(ring->header->magic));
+
+	return ring;
+}
+
+int shm_ring_publish(shm_ring_t *ring, uint32_t sample_type, const void *samples, uint32_t sample_count, uint32_t bytes, uint64_t dropped_samples)
+{
+	uint64_t sequence;
+	shm_ring_slot_t *slot;
+
+	if (bytes > ring->header->slot_size)
+	{
+		return -1;
+	}
+
+	sequence = ring->header->write_sequence;
+	slot = slot_at(ring, sequence);
+
+	__atomic_store_n(&slot->lock, 2 * sequence + 1, __ATOMIC_RELAXED);
+	__atomic_thread_fence(__ATOMIC_RELEASE);
+
+	slot->dropped_samples = dropped_samples;
+	slot->sample_type = sample_type;
+	slot->sample_count = sample_count;
+	slot->bytes = bytes;
+	memcpy((uint8_t *) slot + SHM_RING_SLOT_HEADER_SIZE, samples, bytes);
+
+	__atomic_store_n(&slot->lock, 2 * sequence + 2, __ATOMIC_RELEASE);
+	__atomic_store_n(&ring->header->write_sequence, sequence + 1, __ATOMIC_RELEASE);
+
+	return 0;
+}
+
+shm_ring_t *shm_ring_open(const char *name)
+{
+	int fd;
+	void *map;
+	struct stat st;
+	shm_ring_header_t *header;
+	shm_ring_t *ring;
+
+	ring = ring_alloc(name);
+	if (ring == NULL)
+	{
+		return NULL;
+	}
+
+	fd = shm_open(name, O_RDONLY, 0);
+	if (fd < 0)
+	{
+		ring_free(ring);
+		return NULL;
+	}
+
+	if (fstat(fd, &st) != 0 || (size_t) st.st_size < SHM_RING_HEADER_SIZE)
+	{
+		close(fd);
+		ring_free(ring);
+		return NULL;
+	}
+
+	map = mmap(NULL, (size_t) st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);
+	if (map == MAP_FAILED)
+	{
+		ring_free(ring);
+		return NULL;
+	}
+
+	header = (shm_ring_header_t *) map;
+	if (memcmp(header->magic, SHM_RING_MAGIC, sizeof(header->magic)) != 0 ||
+		header->version != SHM_RING_VERSION || header->slot_count < 2 ||
+		header->slot_stride < SHM_RING_SLOT_HEADER_SIZE + header->slot_size ||
+		SHM_RING_HEADER_SIZE + (size_t) header->slot_count * header->slot_stride > (size_t) st.st_size)
+	{
+		munmap(map, (size_t) st.st_size);
+		ring_free(ring);
+		return NULL;
+	}
+	__atomic_thread_fence(__ATOMIC_ACQUIRE);
+
+	ring->header = header;
+	ring->map_size = (size_t) st.st_size;
+	/* Start with the next buffer published */
+	ring->cursor = __atomic_load_n(&header->write_sequence, __ATOMIC_ACQUIRE);
+
+	return ring;
+}
+
+static int writer_gone(shm_ring_t *ring)
+{
+	if (__atomic_load_n(&ring->header->closed, __ATOMIC_ACQUIRE) != 0)
+	{
+		return 1;
+	}
+
+	/* A writer which crashed never sets closed */
+	return kill((pid_t) ring->header->writer_pid, 0) != 0 && errno == ESRCH;
+}
+
+int shm_ring_next(shm_ring_t *ring, shm_ring_buffer_t *buffer, uint64_t *lost_buffers)
+{
+	uint64_t write_sequence;
+	uint64_t lock;
+	uint64_t lost;
+	shm_ring_slot_t *slot;
+
+	lost = 0;
+	for (;;)
+	{
+		write_sequence = __atomic_load_n(&ring->header->write_sequence, __ATOMIC_ACQUIRE);
+		if (ring->cursor >= write_sequence)
+		{
+			*lost_buffers = lost;
+			return writer_gone(ring) ? -1 : 0;
+		}
+
+		/* The slot of write_sequence - slot_count may be the one being rewritten, keep clear of it */
+		if (write_sequence - ring->cursor >= ring->header->slot_count)
+		{
+			lost += write_sequence - ring->header->slot_count + 1 - ring->cursor;
+			ring->cursor = write_sequence - ring->header->slot_count + 1;
+		}
+
+		slot = slot_at(ring, ring->cursor);
+		lock = __atomic_load_n(&slot->lock, __ATOMIC_ACQUIRE);
+		if (lock == 2 * ring->cursor + 2)
+		{
+			break;
+		}
+
+		/* Overwritten since write_sequence was read */
+		lost++;
+		ring->cursor++;
+	}
+
+	buffer->sequence = ring->cursor;
+	buffer->dropped_samples = slot->dropped_samples;
+	buffer->sample_type = slot->sample_type;
+	buffer->sample_count = slot->sample_count;
+	buffer->bytes = slot->bytes;
+	buffer->samples = (const uint8_t *) slot + SHM_RING_SLOT_HEADER_SIZE;
+	ring->held_lock = lock;
+	*lost_buffers = lost;
+
+	return 1;
+}
+
+int shm_ring_release(shm_ring_t *ring)
+{
+	uint64_t lock;
+
+	__atomic_thread_fence(__ATOMIC_ACQUIRE);
+	lock = __atomic_load_n(&slot_at(ring, ring->cursor)->lock, __ATOMIC_RELAXED);
+	ring->cursor++;
+
+	return lock == ring->held_lock ? 0 : -1;
+}
+
+void shm_ring_close(shm_ring_t *ring)
+{
+	if (ring == NULL)
+	{
+		return;
+	}
+
+	if (ring->writer)
+	{
+		__atomic_store_n(&ring->header->closed, 1, __ATOMIC_RELEASE);
+		shm_unlink(ring->name);
+	}
+
+	munmap(ring->header, ring->map_size);
+	ring_free(ring);
+}
+
+#else
+
+shm_ring_t *shm_ring_create(const char *name, uint32_t slot_count, uint32_t slot_size)
+{
+	(void) name;
+	(void) slot_count;
+	(void) slot_size;
+	return NULL;
+}
+
+int shm_ring_publish(shm_ring_t *ring, uint32_t sample_type, const void *samples, uint32_t sample_count, uint32_t bytes, uint64_t dropped_samples)
+{
+	(void) ring;
+	(void) sample_type;
+	(void) samples;
+	(void) sample_count;
+	(void) bytes;
+	(void) dropped_samples;
+	return -1;
+}
+
+shm_ring_t *shm_ring_open(const char *name)
+{
+	(void) name;
+	return NULL;
+}
+
+int shm_ring_next(shm_ring_t *ring, shm_ring_buffer_t *buffer, uint64_t *lost_buffers)
+{
+	(void) ring;
+	(void) buffer;
+	(void) lost_buffers;
+	return -1;
+}
+
+int shm_ring_release(shm_ring_t *ring)
+{
+	(void) ring;
+	return -1;
+}
+
+void shm_ring_close(shm_ring_t *ring)
+{
+	(void) ring;
+}
+
+#endif
@@ -0,0 +1,61 @@
+/*
+Copyright (c) 2025 Benjamin Vernoux <bvernoux@hydrasdr.com>
+
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+
+Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the
+documentation and/or other materials provided with the distribution.
+Neither the name of HydraSDR nor the names of its contributors may be used to endorse or promote products derived from this software
+without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef SHM_RING_H
+#define SHM_RING_H
+
+#include <stdint.h>
+
+/*
+ * Ring of converted buffers in POSIX shared memory, one writer and any number of readers.
+ * Readers map it read-only and keep their cursor in their own process, the writer never waits for them:
+ * a reader more than slot_count buffers behind skips ahead and is told how many buffers it lost.
+ * Each slot is guarded by a sequence lock, odd while it is written, 2 * (sequence + 1) once complete.
+ * Not available on Windows (create and open return NULL).
+ */
+
+typedef struct shm_ring shm_ring_t;
+
+typedef struct {
+	uint64_t sequence;
+	uint64_t dropped_samples;
+	uint32_t sample_type;
+	uint32_t sample_count;
+	uint32_t bytes;
+	const void *samples; /* Points into the shared memory */
+} shm_ring_buffer_t;
+
+/* Writer side, replaces any ring left with the same name, slot_count shall be at least 2 */
+shm_ring_t *shm_ring_create(const char *name, uint32_t slot_count, uint32_t slot_size);
+/* Never blocks, returns -1 when bytes exceeds the slot size */
+int shm_ring_publish(shm_ring_t *ring, uint32_t sample_type, const void *samples, uint32_t sample_count, uint32_t bytes, uint64_t dropped_samples);
+
+/* Reader side */
+shm_ring_t *shm_ring_open(const char *name);
+/* Returns 1 with the next buffer, 0 when none is available yet, -1 once the writer is gone and the ring is drained */
+int shm_ring_next(shm_ring_t *ring, shm_ring_buffer_t *buffer, uint64_t *lost_buffers);
+/* Returns 0 if the buffer of the last shm_ring_next() was left intact until now, -1 if the writer overwrote it */
+int shm_ring_release(shm_ring_t *ring);
+
+/* The writer marks the ring closed and removes its name, readers keep their mapping until they close it */
+void shm_ring_close(shm_ring_t *ring);
+
+#endif // SHM_RING_H
@@ -0,0 +1,112 @@
+/*
+Copyright (c) 2025 Benjamin Vernoux <bvernoux@hydrasdr.com>
+
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+
+Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the
+documentation and/or other materials provided with the distribution.
+Neither the name of HydraSDR nor the names of its contributors may be used to endorse or promote products derived from this software
+without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "iqconverter_ref.h"
+#include <stdlib.h>
+
+#define DC_SCALE (0.01f)
+#define DC_POLE (32100)
+
+void iqconverter_float_ref(const float *hb_kernel, int kernel_len, const float *input, float *output, int len)
+{
+	int taps = kernel_len / 2 + 1;
+	int delay = taps / 2;
+	float hbc = hb_kernel[kernel_len / 2];
+	float avg = 0.0f;
+	float *rotated = (float *) malloc(len * sizeof(float));
+	double acc;
+	int n, m, j;
+
+	for (n = 0; n < len; n++)
+	{
+		float y = input[n] - avg;
+		avg += DC_SCALE * y;
+
+		/* Multiplication by exp(-j * pi / 2 * n) of the real signal, Q scaled by the half band center tap */
+		switch (n & 3)
+		{
+		case 0: rotated[n] = -y; break;
+		case 1: rotated[n] = -y * hbc; break;
+		case 2: rotated[n] = y; break;
+		default: rotated[n] = y * hbc; break;
+		}
+	}
+
+	for (m = 0; m < len / 2; m++)
+	{
+		/* I: even taps of the half band kernel, newest sample first */
+		acc = 0.0;
+		for (j = 0; j < taps && j <= m; j++)
+		{
+			acc += (double) hb_kernel[2 * j] * rotated[2 * (m - j)];
+		}
+		output[2 * m] = (float) acc;
+
+		/* Q: delayed to the center of the FIR */
+		output[2 * m + 1] = (m >= delay) ? rotated[2 * (m - delay) + 1] : 0.0f;
+	}
+
+	free(rotated);
+}
+
+void iqconverter_int16_ref(const int16_t *hb_kernel, int kernel_len, const int16_t *input, int16_t *output, int len)
+{
+	int taps = kernel_len / 2 + 1;
+	int delay = taps / 2;
+	int16_t *rotated = (int16_t *) malloc(len * sizeof(int16_t));
+	int32_t prev_x = 0, prev_y = 0, err = 0;
+	int32_t x, y, u, s;
+	int32_t acc;
+	int n, m, j;
+
+	for (n = 0; n < len; n++)
+	{
+		/* First order high pass y[n] = x[n] - x[n-1] + y[n-1] * DC_POLE / 2^15 with error feedback, in int16 */
+		x = input[n];
+		u = err + prev_y * DC_POLE;
+		s = (int16_t) (u >> 15);
+		y = (int16_t) ((int16_t) (x - prev_x) + s);
+		err = u - s * 32768;
+		prev_x = x;
+		prev_y = y;
+
+		switch (n & 3)
+		{
+		case 0: rotated[n] = (int16_t) -y; break;
+		case 1: rotated[n] = (int16_t) ((-y) >> 1); break;
+		case 2: rotated[n] = (int16_t) y; break;
+		default: rotated[n] = (int16_t) (y >> 1); break;
+		}
+	}
+
+	for (m = 0; m < len / 2; m++)
+	{
+		acc = 0;
+		for (j = 0; j < taps && j <= m; j++)
+		{
+			acc += (int32_t) hb_kernel[2 * j] * rotated[2 * (m - j)];
+		}
+		output[2 * m] = (int16_t) (acc >> 15);
+		output[2 * m + 1] = (m >= delay) ? rotated[2 * (m - delay) + 1] : 0;
+	}
+
+	free(rotated);
+}
@@ -0,0 +1,38 @@
+/*
+Copyright (c) 2025 Benjamin Vernoux <bvernoux@hydrasdr.com>
+
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+
+Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the
+documentation and/or other materials provided with the distribution.
+Neither the name of HydraSDR nor the names of its contributors may be used to endorse or promote products derived from this software
+without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef IQCONVERTER_REF_H
+#define IQCONVERTER_REF_H
+
+#include <stdint.h>
+
+/*
+ * Plain reference of the IQ converters, written from the algorithm rather than from the optimized code:
+ * DC removal, fs/4 translation, half band FIR on the I samples and matching delay on the Q samples.
+ * The whole input is processed in one call with a linear history, there is no state to carry.
+ * hb_kernel is the full half band kernel (len = 4 * n + 3) as given to iqconverter_*_create().
+ * len is the number of ADC samples and shall be a multiple of 4.
+ */
+
+void iqconverter_float_ref(const float *hb_kernel, int kernel_len, const float *input, float *output, int len);
+void iqconverter_int16_ref(const int16_t *hb_kernel, int kernel_len, const int16_t *input, int16_t *output, int len);
+
+#endif // IQCONVERTER_REF_H
@@ -0,0 +1,280 @@
+/*
+Copyright (c) 2025 Benjamin Vernoux <bvernoux@hydrasdr.com>
+
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+
+Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the
+documentation and/or other materials provided with the distribution.
+Neither the name of HydraSDR nor the names of its contributors may be used to endorse or promote products derived from this software
+without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "test_common.h"
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <time.h>
+#endif
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+uint32_t test_random(uint32_t *state)
+{
+	uint32_t x = *state;
+
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+	*state = x;
+
+	return x;
+}
+
+void test_generate_adc(uint16_t *samples, int count, uint32_t seed)
+{
+	int i;
+	int value;
+	int step = 0;
+	uint32_t state = seed;
+
+	for (i = 0; i < count; i++)
+	{
+		if ((i % 5000) == 4999)
+		{
+			step = (int) (test_random(&state) % 600) - 300;
+		}
+		value = 2048 + 150 + step + (int) (1200.0 * sin(2.0 * M_PI * 0.0371 * i)) + (int) (test_random(&state) % 257) - 128;
+		if (value < 0)
+		{
+			value = 0;
+		}
+		if (value > 4095)
+		{
+			value = 4095;
+		}
+		samples[i] = (uint16_t) value;
+	}
+}
+
+void test_pack_adc(const uint16_t *samples, uint32_t *packed, int count)
+{
+	int i, j;
+
+	for (i = 0, j = 0; j < count; i += 3, j += 8)
+	{
+		packed[i + 0] = ((uint32_t) samples[j + 0] << 20) | ((uint32_t) samples[j + 1] << 8) | (samples[j + 2] >> 4);
+		packed[i + 1] = ((uint32_t) (samples[j + 2] & 0xf) << 28) | ((uint32_t) samples[j + 3] << 16) |
+			((uint32_t) samples[j + 4] << 4) | (samples[j + 5] >> 8);
+		packed[i + 2] = ((uint32_t) (samples[j + 5] & 0xff) << 24) | ((uint32_t) samples[j + 6] << 12) | samples[j + 7];
+	}
+}
+
+void test_halfband_float(float *kernel, int len)
+{
+	int i;
+	int center = len / 2;
+	double n, window;
+
+	for (i = 0; i < len; i++)
+	{
+		n = i - center;
+		window = 0.5 + 0.5 * cos(M_PI * n / (center + 1));
+		kernel[i] = (i == center) ? 0.5f : ((i - center) % 2 == 0) ? 0.0f : (float) (window * sin(M_PI * n / 2.0) / (M_PI * n));
+	}
+}
+
+void test_halfband_int16(int16_t *kernel, int len)
+{
+	int i;
+	float kernel_float[TEST_KERNEL_MAX_LEN];
+
+	test_halfband_float(kernel_float, len);
+	for (i = 0; i < len; i++)
+	{
+		kernel[i] = (int16_t) lrint(kernel_float[i] * 32767.0f);
+	}
+}
+
+static int read_le(const char *path, uint8_t *data, int count, int size)
+{
+	FILE *file;
+	size_t n;
+
+	file = fopen(path, "rb");
+	if (file == NULL)
+	{
+		return -1;
+	}
+	n = fread(data, size, count, file);
+	fclose(file);
+
+	return (int) n;
+}
+
+static int write_le(const char *path, const uint8_t *data, int count, int size)
+{
+	FILE *file;
+	size_t n;
+
+	file = fopen(path, "wb");
+	if (file == NULL)
+	{
+		return -1;
+	}
+	n = fwrite(data, size, count, file);
+	if (fclose(file) != 0)
+	{
+		return -1;
+	}
+
+	return (int) n;
+}
+
+/* Vector files are little endian, swap in place on big endian hosts */
+static void to_le(uint8_t *data, int count, int size)
+{
+	const uint16_t one = 1;
+	uint8_t t;
+	int i, j;
+
+	if (*(const uint8_t *) &one == 1)
+	{
+		return;
+	}
+	for (i = 0; i < count; i++, data += size)
+	{
+		for (j = 0; j < size / 2; j++)
+		{
+			t = data[j];
+			data[j] = data[size - 1 - j];
+			data[size - 1 - j] = t;
+		}
+	}
+}
+
+int test_read_u16(const char *path, uint16_t *data, int count)
+{
+	int n = read_le(path, (uint8_t *) data, count, sizeof(uint16_t));
+
+	if (n > 0)
+	{
+		to_le((uint8_t *) data, n, sizeof(uint16_t));
+	}
+	return n;
+}
+
+int test_read_float(const char *path, float *data, int count)
+{
+	int n = read_le(path, (uint8_t *) data, count, sizeof(float));
+
+	if (n > 0)
+	{
+		to_le((uint8_t *) data, n, sizeof(float));
+	}
+	return n;
+}
+
+int test_write_u16(const char *path, const uint16_t *data, int count)
+{
+	int n;
+	uint16_t *copy = (uint16_t *) malloc(count * sizeof(uint16_t));
+
+	memcpy(copy, data, count * sizeof(uint16_t));
+	to_le((uint8_t *) copy, count, sizeof(uint16_t));
+	n = write_le(path, (const uint8_t *) copy, count, sizeof(uint16_t));
+	free(copy);
+
+	return n;
+}
+
+int test_write_float(const char *path, const float *data, int count)
+{
+	int n;
+	float *copy = (float *) malloc(count * sizeof(float));
+
+	memcpy(copy, data, count * sizeof(float));
+	to_le((uint8_t *) copy, count, sizeof(float));
+	n = write_le(path, (const uint8_t *) copy, count, sizeof(float));
+	free(copy);
+
+	return n;
+}
+
+int test_compare_int16(const int16_t *a, const int16_t *b, int count)
+{
+	int i;
+
+	for (i = 0; i < count; i++)
+	{
+		if (a[i] != b[i])
+		{
+			return i;
+		}
+	}
+	return -1;
+}
+
+int test_compare_float(const float *a, const float *b, int count, float tolerance)
+{
+	int i;
+
+	for (i = 0; i < count; i++)
+	{
+		if (!(fabsf(a[i] - b[i]) <= tolerance))
+		{
+			return i;
+		}
+	}
+	return -1;
+}
+
+int test_compare_float_exact(const float *a, const float *b, int count)
+{
+	return memcmp(a, b, count * sizeof(float)) == 0 ? -1 : test_compare_float(a, b, count, 0.0f);
+}
+
+double test_clock(void)
+{
+#ifdef _WIN32
+	LARGE_INTEGER count;
+	LARGE_INTEGER frequency;
+
+	QueryPerformanceCounter(&count);
+	QueryPerformanceFrequency(&frequency);
+	return (double) count.QuadPart / (double) frequency.QuadPart;
+#else
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (double) ts.tv_sec + (double) ts.tv_nsec * 1e-9;
+#endif
+}
+
+void test_sleep_ms(int ms)
+{
+#ifdef _WIN32
+	Sleep(ms);
+#else
+	struct timespec ts;
+
+	ts.tv_sec = ms / 1000;
+	ts.tv_nsec = (long) (ms % 1000) * 1000000L;
+	nanosleep(&ts, NULL);
+#endif
+}
@@ -0,0 +1,56 @@
+/*
+Copyright (c) 2025 Benjamin Vernoux <bvernoux@hydrasdr.com>
+
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+
+Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the
+documentation and/or other materials provided with the distribution.
+Neither the name of HydraSDR nor the names of its contributors may be used to endorse or promote products derived from this software
+without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef TEST_COMMON_H
+#define TEST_COMMON_H
+
+#include <stdint.h>
+#include <stdio.h>
+
+/* Half band kernels of 4 * n + 3 taps (n + 1 non zero even taps on each side) */
+#define TEST_KERNEL_MAX_LEN (511)
+
+#define TEST_FAIL(...) do { fprintf(stderr, "FAIL %s:%d: ", __FILE__, __LINE__); fprintf(stderr, __VA_ARGS__); fprintf(stderr, "\n"); return 1; } while (0)
+
+/* Synthetic 12bit ADC samples: DC offset, a tone, noise and a few steps */
+void test_generate_adc(uint16_t *samples, int count, uint32_t seed);
+/* Device packing (hydrasdr_set_packing), inverse of unpack_samples(), count multiple of 8 */
+void test_pack_adc(const uint16_t *samples, uint32_t *packed, int count);
+/* Windowed sinc half band kernel, same shape as filters.h, len = 4 * n + 3 */
+void test_halfband_float(float *kernel, int len);
+void test_halfband_int16(int16_t *kernel, int len);
+uint32_t test_random(uint32_t *state);
+
+/* Little endian vector files, return the number of elements read or -1 */
+int test_read_u16(const char *path, uint16_t *data, int count);
+int test_read_float(const char *path, float *data, int count);
+int test_write_u16(const char *path, const uint16_t *data, int count);
+int test_write_float(const char *path, const float *data, int count);
+
+/* Return the index of the first difference or -1 */
+int test_compare_int16(const int16_t *a, const int16_t *b, int count);
+int test_compare_float(const float *a, const float *b, int count, float tolerance);
+int test_compare_float_exact(const float *a, const float *b, int count);
+
+double test_clock(void);
+void test_sleep_ms(int ms);
+
+#endif // TEST_COMMON_H
@@ -0,0 +1,499 @@
+/*
+Copyright (c) 2025 Benjamin Vernoux <bvernoux@hydrasdr.com>
+
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+
+Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the
+documentation and/or other materials provided with the distribution.
+Neither the name of HydraSDR nor the names of its contributors may be used to endorse or promote products derived from this software
+without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+/*
+ * Correctness of iqconverter_float and iqconverter_int16.
+ *   golden <data_dir>      Default filters against the stored vectors (int16 bit exact, float within FLOAT_TOLERANCE)
+ *   reference float|int16  Several kernel lengths (all the FIR code paths) against iqconverter_ref
+ *   splits float|int16     Input split in buffers of many sizes, shall be bit exact with a single call
+ *   reference|splits fft   Same with the float overlap-save FFT FIR forced (splits within FLOAT_TOLERANCE)
+ *   swap float|int16|fft   Filter swapped mid stream (seeded from the previous one), no step at the swap
+ *   generate <data_dir>    Rewrites the golden vectors (only after a reviewed change of the algorithm)
+ */
+
+#include "test_common.h"
+#include "iqconverter_ref.h"
+#include "iqconverter_float.h"
+#include "iqconverter_int16.h"
+#include "sample_convert.h"
+#include "filters.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#define GOLDEN_SAMPLES (16384)
+#define GOLDEN_INPUT "iq_input_u12.bin"
+#define GOLDEN_FLOAT "iqconverter_float_hb47.bin"
+#define GOLDEN_INT16 "iqconverter_int16_hb47.bin"
+#define GOLDEN_SEED (0x4859)
+
+#define TEST_SAMPLES (65536)
+#define TEST_SEED (0x2545F491)
+/* Summation order differs from the reference, the DC average feeds back the rounding errors */
+#define FLOAT_TOLERANCE (2e-5f)
+
+/*
+ * Exercise the unrolled FIR loops (odd taps count for 21) and the generic FIR
+ * (taps % 8 = 0, 4 and 2), 135 is past the default HYDRASDR_FIR_MAX_TAPS,
+ * 255 and 511 are long filters for the FFT FIR
+ */
+static const int kernel_lens[] = { 7, 15, 21, 23, 27, 31, 39, 47, 63, 135, 255, 511 };
+#define KERNEL_LEN_COUNT (sizeof(kernel_lens) / sizeof(kernel_lens[0]))
+
+/* Buffer sizes in ADC samples, all multiples of 4 (one fs/4 period), 0 ends a pattern */
+static const int fixed_splits[][4] = {
+	{ 4, 0 },
+	{ 12, 0 },
+	{ 28, 0 },
+	{ 44, 0 },
+	{ 1004, 0 },
+	{ 4092, 0 },
+	{ 4, 4092, 0 },
+	{ 12, 744, 1496, 0 },          /* Around the float FIR queue wrap (24 taps * 31) */
+	{ 98304, 0 },                  /* Packed device buffer */
+	{ 131072, 0 },                 /* Unpacked device buffer */
+};
+#define FIXED_SPLIT_COUNT (sizeof(fixed_splits) / sizeof(fixed_splits[0]))
+#define RANDOM_SPLIT_COUNT (8)
+
+/* Kernel lengths before and after the swap: same, shorter, longer */
+static const int swap_lens[][2] = { { 47, 47 }, { 47, 23 }, { 135, 31 }, { 23, 47 }, { 7, 135 } };
+#define SWAP_LEN_COUNT (sizeof(swap_lens) / sizeof(swap_lens[0]))
+/* Swap points in ADC samples, at the start, around the float FIR queue wrap and later */
+static const int swap_points[] = { 4, 1000, 1488, 32812 };
+#define SWAP_POINT_COUNT (sizeof(swap_points) / sizeof(swap_points[0]))
+
+/* IQCONVERTER_FIR_DIRECT or IQCONVERTER_FIR_FFT for the float converter */
+static int float_fir_mode = IQCONVERTER_FIR_DIRECT;
+
+static char *join_path(const char *dir, const char *name)
+{
+	size_t len = strlen(dir) + strlen(name) + 2;
+	char *path = (char *) malloc(len);
+
+	snprintf(path, len, "%s/%s", dir, name);
+	return path;
+}
+
+static void process_float(const float *kernel, int kernel_len, const uint16_t *adc, float *output, int count, const int *splits, uint32_t seed)
+{
+	iqconverter_float_t *cnv = iqconverter_float_create_fir(kernel, kernel_len, float_fir_mode);
+	int done = 0;
+	int len;
+	int k = 0;
+
+	convert_samples_float(adc, output, count);
+	while (done < count)
+	{
+		if (splits == NULL)
+		{
+			len = (seed == 0) ? count : 4 * (1 + (int) (test_random(&seed) % 2048));
+		}
+		else
+		{
+			len = splits[k];
+			k = (splits[k + 1] != 0) ? k + 1 : 0;
+		}
+		if (len > count - done)
+		{
+			len = count - done;
+		}
+		iqconverter_float_process(cnv, output + done, len);
+		done += len;
+	}
+	iqconverter_float_free(cnv);
+}
+
+static void process_int16(const int16_t *kernel, int kernel_len, const uint16_t *adc, int16_t *output, int count, const int *splits, uint32_t seed)
+{
+	iqconverter_int16_t *cnv = iqconverter_int16_create(kernel, kernel_len);
+	int done = 0;
+	int len;
+	int k = 0;
+
+	convert_samples_int16(adc, output, count);
+	while (done < count)
+	{
+		if (splits == NULL)
+		{
+			len = (seed == 0) ? count : 4 * (1 + (int) (test_random(&seed) % 2048));
+		}
+		else
+		{
+			len = splits[k];
+			k = (splits[k + 1] != 0) ? k + 1 : 0;
+		}
+		if (len > count - done)
+		{
+			len = count - done;
+		}
+		iqconverter_int16_process(cnv, output + done, len);
+		done += len;
+	}
+	iqconverter_int16_free(cnv);
+}
+
+static int test_golden(const char *dir)
+{
+	uint16_t *adc = (uint16_t *) malloc(GOLDEN_SAMPLES * sizeof(uint16_t));
+	float *golden_float = (float *) malloc(GOLDEN_SAMPLES * sizeof(float));
+	int16_t *golden_int16 = (int16_t *) malloc(GOLDEN_SAMPLES * sizeof(int16_t));
+	float *out_float = (float *) malloc(GOLDEN_SAMPLES * sizeof(float));
+	int16_t *out_int16 = (int16_t *) malloc(GOLDEN_SAMPLES * sizeof(int16_t));
+	char *path;
+	int n;
+	int i;
+
+	path = join_path(dir, GOLDEN_INPUT);
+	n = test_read_u16(path, adc, GOLDEN_SAMPLES);
+	free(path);
+	if (n != GOLDEN_SAMPLES)
+		TEST_FAIL("cannot read %s/%s", dir, GOLDEN_INPUT);
+
+	path = join_path(dir, GOLDEN_FLOAT);
+	n = test_read_float(path, golden_float, GOLDEN_SAMPLES);
+	free(path);
+	if (n != GOLDEN_SAMPLES)
+		TEST_FAIL("cannot read %s/%s", dir, GOLDEN_FLOAT);
+
+	path = join_path(dir, GOLDEN_INT16);
+	n = test_read_u16(path, (uint16_t *) golden_int16, GOLDEN_SAMPLES);
+	free(path);
+	if (n != GOLDEN_SAMPLES)
+		TEST_FAIL("cannot read %s/%s", dir, GOLDEN_INT16);
+
+	process_float(HB_KERNEL_FLOAT, HB_KERNEL_FLOAT_LEN, adc, out_float, GOLDEN_SAMPLES, NULL, 0);
+	i = test_compare_float(out_float, golden_float, GOLDEN_SAMPLES, FLOAT_TOLERANCE);
+	if (i >= 0)
+		TEST_FAIL("float sample %d: %.9g, golden %.9g", i, out_float[i], golden_float[i]);
+
+	process_int16(HB_KERNEL_INT16, HB_KERNEL_INT16_LEN, adc, out_int16, GOLDEN_SAMPLES, NULL, 0);
+	i = test_compare_int16(out_int16, golden_int16, GOLDEN_SAMPLES);
+	if (i >= 0)
+		TEST_FAIL("int16 sample %d: %d, golden %d", i, out_int16[i], golden_int16[i]);
+
+	free(adc);
+	free(golden_float);
+	free(golden_int16);
+	free(out_float);
+	free(out_int16);
+	return 0;
+}
+
+static int test_generate(const char *dir)
+{
+	uint16_t *adc = (uint16_t *) malloc(GOLDEN_SAMPLES * sizeof(uint16_t));
+	float *out_float = (float *) malloc(GOLDEN_SAMPLES * sizeof(float));
+	int16_t *out_int16 = (int16_t *) malloc(GOLDEN_SAMPLES * sizeof(int16_t));
+	char *path;
+	int n;
+
+	test_generate_adc(adc, GOLDEN_SAMPLES, GOLDEN_SEED);
+	process_float(HB_KERNEL_FLOAT, HB_KERNEL_FLOAT_LEN, adc, out_float, GOLDEN_SAMPLES, NULL, 0);
+	process_int16(HB_KERNEL_INT16, HB_KERNEL_INT16_LEN, adc, out_int16, GOLDEN_SAMPLES, NULL, 0);
+
+	path = join_path(dir, GOLDEN_INPUT);
+	n = test_write_u16(path, adc, GOLDEN_SAMPLES);
+	free(path);
+	if (n != GOLDEN_SAMPLES)
+		TEST_FAIL("cannot write %s/%s", dir, GOLDEN_INPUT);
+
+	path = join_path(dir, GOLDEN_FLOAT);
+	n = test_write_float(path, out_float, GOLDEN_SAMPLES);
+	free(path);
+	if (n != GOLDEN_SAMPLES)
+		TEST_FAIL("cannot write %s/%s", dir, GOLDEN_FLOAT);
+
+	path = join_path(dir, GOLDEN_INT16);
+	n = test_write_u16(path, (const uint16_t *) out_int16, GOLDEN_SAMPLES);
+	free(path);
+	if (n != GOLDEN_SAMPLES)
+		TEST_FAIL("cannot write %s/%s", dir, GOLDEN_INT16);
+
+	free(adc);
+	free(out_float);
+	free(out_int16);
+	return 0;
+}
+
+static int test_reference(int is_float)
+{
+	uint16_t *adc = (uint16_t *) malloc(TEST_SAMPLES * sizeof(uint16_t));
+	float *in_float = (float *) malloc(TEST_SAMPLES * sizeof(float));
+	float *ref_float = (float *) malloc(TEST_SAMPLES * sizeof(float));
+	float *out_float = (float *) malloc(TEST_SAMPLES * sizeof(float));
+	int16_t *in_int16 = (int16_t *) malloc(TEST_SAMPLES * sizeof(int16_t));
+	int16_t *ref_int16 = (int16_t *) malloc(TEST_SAMPLES * sizeof(int16_t));
+	int16_t *out_int16 = (int16_t *) malloc(TEST_SAMPLES * sizeof(int16_t));
+	float kernel_float[TEST_KERNEL_MAX_LEN];
+	int16_t kernel_int16[TEST_KERNEL_MAX_LEN];
+	unsigned int k;
+	int len;
+	int i;
+
+	test_generate_adc(adc, TEST_SAMPLES, TEST_SEED);
+	convert_samples_float(adc, in_float, TEST_SAMPLES);
+	convert_samples_int16(adc, in_int16, TEST_SAMPLES);
+
+	for (k = 0; k < KERNEL_LEN_COUNT; k++)
+	{
+		len = kernel_lens[k];
+		if (is_float)
+		{
+			test_halfband_float(kernel_float, len);
+			iqconverter_float_ref(kernel_float, len, in_float, ref_float, TEST_SAMPLES);
+			process_float(kernel_float, len, adc, out_float, TEST_SAMPLES, NULL, 0);
+			i = test_compare_float(out_float, ref_float, TEST_SAMPLES, FLOAT_TOLERANCE);
+			if (i >= 0)
+				TEST_FAIL("kernel %d, sample %d: %.9g, reference %.9g", len, i, out_float[i], ref_float[i]);
+		}
+		else
+		{
+			test_halfband_int16(kernel_int16, len);
+			iqconverter_int16_ref(kernel_int16, len, in_int16, ref_int16, TEST_SAMPLES);
+			process_int16(kernel_int16, len, adc, out_int16, TEST_SAMPLES, NULL, 0);
+			i = test_compare_int16(out_int16, ref_int16, TEST_SAMPLES);
+			if (i >= 0)
+				TEST_FAIL("kernel %d, sample %d: %d, reference %d", len, i, out_int16[i], ref_int16[i]);
+		}
+	}
+
+	free(adc);
+	free(in_float);
+	free(ref_float);
+	free(out_float);
+	free(in_int16);
+	free(ref_int16);
+	free(out_int16);
+	return 0;
+}
+
+static int test_splits(int is_float)
+{
+	uint16_t *adc = (uint16_t *) malloc(TEST_SAMPLES * 3 * sizeof(uint16_t));
+	float *whole_float = (float *) malloc(TEST_SAMPLES * 3 * sizeof(float));
+	float *split_float = (float *) malloc(TEST_SAMPLES * 3 * sizeof(float));
+	int16_t *whole_int16 = (int16_t *) malloc(TEST_SAMPLES * 3 * sizeof(int16_t));
+	int16_t *split_int16 = (int16_t *) malloc(TEST_SAMPLES * 3 * sizeof(int16_t));
+	float kernel_float[TEST_KERNEL_MAX_LEN];
+	int16_t kernel_int16[TEST_KERNEL_MAX_LEN];
+	/*
+	 * Long enough for several device buffers, the FIR queues wrap many times.
+	 * Shorter for the FFT FIR, tiny buffers cost one FFT each (still many FFT blocks).
+	 */
+	int count = (float_fir_mode == IQCONVERTER_FIR_FFT) ? TEST_SAMPLES / 2 : TEST_SAMPLES * 3;
+	unsigned int k, s;
+	int len;
+	int i;
+
+	test_generate_adc(adc, count, TEST_SEED);
+
+	for (k = 0; k < KERNEL_LEN_COUNT; k++)
+	{
+		len = kernel_lens[k];
+		test_halfband_float(kernel_float, len);
+		test_halfband_int16(kernel_int16, len);
+		if (is_float)
+		{
+			process_float(kernel_float, len, adc, whole_float, count, NULL, 0);
+		}
+		else
+		{
+			process_int16(kernel_int16, len, adc, whole_int16, count, NULL, 0);
+		}
+
+		for (s = 0; s < FIXED_SPLIT_COUNT + RANDOM_SPLIT_COUNT; s++)
+		{
+			const int *splits = (s < FIXED_SPLIT_COUNT) ? fixed_splits[s] : NULL;
+			uint32_t seed = (s < FIXED_SPLIT_COUNT) ? 0 : s * 7919;
+
+			if (is_float)
+			{
+				process_float(kernel_float, len, adc, split_float, count, splits, seed);
+				/* FFT blocks start at the buffer boundaries, the rounding differs */
+				if (float_fir_mode == IQCONVERTER_FIR_FFT)
+					i = test_compare_float(split_float, whole_float, count, FLOAT_TOLERANCE);
+				else
+					i = test_compare_float_exact(split_float, whole_float, count);
+				if (i >= 0)
+					TEST_FAIL("kernel %d, split pattern %u, sample %d: %.9g, single buffer %.9g", len, s, i, split_float[i], whole_float[i]);
+			}
+			else
+			{
+				process_int16(kernel_int16, len, adc, split_int16, count, splits, seed);
+				i = test_compare_int16(split_int16, whole_int16, count);
+				if (i >= 0)
+					TEST_FAIL("kernel %d, split pattern %u, sample %d: %d, single buffer %d", len, s, i, split_int16[i], whole_int16[i]);
+			}
+		}
+	}
+
+	free(adc);
+	free(whole_float);
+	free(split_float);
+	free(whole_int16);
+	free(split_int16);
+	return 0;
+}
+
+/* Converter from up to swap then to seeded from it, returns the seed transient */
+static int process_float_swap(const float *from_kernel, int from_len, const float *to_kernel, int to_len,
+	const uint16_t *adc, float *output, int count, int swap)
+{
+	iqconverter_float_t *from = iqconverter_float_create_fir(from_kernel, from_len, float_fir_mode);
+	iqconverter_float_t *to = iqconverter_float_create_fir(to_kernel, to_len, float_fir_mode);
+	int transient;
+
+	convert_samples_float(adc, output, count);
+	iqconverter_float_process(from, output, swap);
+	transient = iqconverter_float_seed(to, from);
+	iqconverter_float_process(to, output + swap, count - swap);
+	iqconverter_float_free(from);
+	iqconverter_float_free(to);
+	return transient;
+}
+
+static int process_int16_swap(const int16_t *from_kernel, int from_len, const int16_t *to_kernel, int to_len,
+	const uint16_t *adc, int16_t *output, int count, int swap)
+{
+	iqconverter_int16_t *from = iqconverter_int16_create(from_kernel, from_len);
+	iqconverter_int16_t *to = iqconverter_int16_create(to_kernel, to_len);
+	int transient;
+
+	convert_samples_int16(adc, output, count);
+	iqconverter_int16_process(from, output, swap);
+	transient = iqconverter_int16_seed(to, from);
+	iqconverter_int16_process(to, output + swap, count - swap);
+	iqconverter_int16_free(from);
+	iqconverter_int16_free(to);
+	return transient;
+}
+
+/*
+ * After the swap the output shall be the one of the new filter over the whole stream (no step):
+ * at once when the new filter is not longer, otherwise once its history is all past the swap,
+ * with the transient reported.
+ */
+static int test_swap(int is_float)
+{
+	int count = TEST_SAMPLES;
+	uint16_t *adc = (uint16_t *) malloc(count * sizeof(uint16_t));
+	float *whole_float = (float *) malloc(count * sizeof(float));
+	float *swap_float = (float *) malloc(count * sizeof(float));
+	int16_t *whole_int16 = (int16_t *) malloc(count * sizeof(int16_t));
+	int16_t *swap_int16 = (int16_t *) malloc(count * sizeof(int16_t));
+	float from_float[TEST_KERNEL_MAX_LEN], to_float[TEST_KERNEL_MAX_LEN];
+	int16_t from_int16[TEST_KERNEL_MAX_LEN], to_int16[TEST_KERNEL_MAX_LEN];
+	unsigned int k, p;
+	int from_len, to_len, swap, settle, transient;
+	int i;
+
+	test_generate_adc(adc, count, TEST_SEED);
+
+	for (k = 0; k < SWAP_LEN_COUNT; k++)
+	{
+		from_len = swap_lens[k][0];
+		to_len = swap_lens[k][1];
+		test_halfband_float(from_float, from_len);
+		test_halfband_float(to_float, to_len);
+		test_halfband_int16(from_int16, from_len);
+		test_halfband_int16(to_int16, to_len);
+		/* ADC samples until the I history (to_len / 2 + 1 taps, every other sample) is all past the swap */
+		settle = (to_len > from_len) ? 2 * (to_len / 2 + 1) : 0;
+
+		if (is_float)
+		{
+			process_float(to_float, to_len, adc, whole_float, count, NULL, 0);
+		}
+		else
+		{
+			process_int16(to_int16, to_len, adc, whole_int16, count, NULL, 0);
+		}
+
+		for (p = 0; p < SWAP_POINT_COUNT; p++)
+		{
+			swap = swap_points[p];
+			if (is_float)
+			{
+				transient = process_float_swap(from_float, from_len, to_float, to_len, adc, swap_float, count, swap);
+				/* The delayed Q samples are rescaled to the center tap of the new filter */
+				i = test_compare_float(swap_float + swap + settle, whole_float + swap + settle, count - swap - settle, FLOAT_TOLERANCE);
+				if (i >= 0)
+					TEST_FAIL("kernels %d to %d, swap at %d, sample %d: %.9g, new filter only %.9g", from_len, to_len, swap,
+						swap + settle + i, swap_float[swap + settle + i], whole_float[swap + settle + i]);
+			}
+			else
+			{
+				transient = process_int16_swap(from_int16, from_len, to_int16, to_len, adc, swap_int16, count, swap);
+				i = test_compare_int16(swap_int16 + swap + settle, whole_int16 + swap + settle, count - swap - settle);
+				if (i >= 0)
+					TEST_FAIL("kernels %d to %d, swap at %d, sample %d: %d, new filter only %d", from_len, to_len, swap,
+						swap + settle + i, swap_int16[swap + settle + i], whole_int16[swap + settle + i]);
+			}
+			if (transient != (settle > 0))
+				TEST_FAIL("kernels %d to %d, swap at %d: transient %d", from_len, to_len, swap, transient);
+		}
+	}
+
+	free(adc);
+	free(whole_float);
+	free(swap_float);
+	free(whole_int16);
+	free(swap_int16);
+	return 0;
+}
+
+static int is_float_arg(const char *arg)
+{
+	if (strcmp(arg, "fft") == 0)
+	{
+		float_fir_mode = IQCONVERTER_FIR_FFT;
+		return 1;
+	}
+	return strcmp(arg, "float") == 0;
+}
+
+int main(int argc, char **argv)
+{
+	if (argc == 3 && strcmp(argv[1], "golden") == 0)
+	{
+		return test_golden(argv[2]);
+	}
+	if (argc == 3 && strcmp(argv[1], "generate") == 0)
+	{
+		return test_generate(argv[2]);
+	}
+	if (argc == 3 && strcmp(argv[1], "reference") == 0)
+	{
+		return test_reference(is_float_arg(argv[2]));
+	}
+	if (argc == 3 && strcmp(argv[1], "splits") == 0)
+	{
+		return test_splits(is_float_arg(argv[2]));
+	}
+	if (argc == 3 && strcmp(argv[1], "swap") == 0)
+	{
+		return test_swap(is_float_arg(argv[2]));
+	}
+
+	fprintf(stderr, "usage: %s golden|generate <data_dir> | reference|splits|swap float|int16|fft\n", argv[0]);
+	return 2;
+}
@@ -0,0 +1,777 @@
+/*
+Copyright (c) 2025 Benjamin Vernoux <bvernoux@hydrasdr.com>
+
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+
+Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the
+documentation and/or other materials provided with the distribution.
+Neither the name of HydraSDR nor the names of its contributors may be used to endorse or promote products derived from this software
+without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+/*
+ * Whole consumer thread chain, RAW capture replayed with hydrasdr_open_file() against the reference converter.
+ *   test_replay float|int16 <work_dir>
+ * Checks the converter state carried across device buffers, with and without packing.
+ *   test_replay swap <work_dir>
+ * Sample type then conversion filter changed while streaming, applied and flagged at the next buffer.
+ *   test_replay header <work_dir>
+ * Header mode (packing 2): samples after the header, drops split between firmware and USB from the sequence gaps,
+ * a buffer without the header magic delivered whole.
+ *   test_replay overflow <work_dir>
+ * Real-time replay into a callback stalled on the first buffer, with each overflow policy and the drops at the end reported.
+ *   test_replay restart <work_dir>
+ * Replay restarted after it ended by itself, without hydrasdr_stop_rx(): every run starts from a reset converter.
+ *   test_replay events <work_dir>
+ * External event mode: argument checks, refused while streaming, a replay has no descriptors and keeps its thread.
+ */
+
+#include "test_common.h"
+#include "iqconverter_ref.h"
+#include "sample_convert.h"
+#include "filters.h"
+#include "hydrasdr.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#define BUFFER_COUNT (12)
+#define PACKED_BUFFER_SAMPLES (98304)
+#define UNPACKED_BUFFER_SAMPLES (131072)
+#define TOTAL_SAMPLES (BUFFER_COUNT * UNPACKED_BUFFER_SAMPLES)
+#define SAMPLERATE (10000000)
+#define SEED (0x600D)
+#define FLOAT_TOLERANCE (2e-5f)
+/* Buffers after which the swap test changes the sample type, then the filter */
+#define SWAP_TYPE_BUFFER (3)
+#define SWAP_FILTER_BUFFER (7)
+/* Shorter than the default filter, all its history is seeded at the swap */
+#define SWAP_KERNEL_LEN (31)
+#define HEADER_BUFFER_COUNT (10)
+#define HEADER_BUFFER_SAMPLES ((UNPACKED_BUFFER_SAMPLES * 2 - (int) sizeof(hydrasdr_buffer_header_t)) / 2)
+/* The whole capture arrives while the callback stalls: 20 buffers of 6.6 ms, for a queue of 8 */
+#define OVERFLOW_BUFFER_COUNT (20)
+#define OVERFLOW_QUEUE (8)
+#define OVERFLOW_SAMPLERATE (10000000)
+#define OVERFLOW_STALL_MS (400)
+#define OVERFLOW_WATERMARK (4)
+#define RESTART_COUNT (6)
+
+typedef struct {
+	uint8_t *output;
+	size_t size;
+	size_t used;
+	uint64_t dropped;
+	int wrong_type;
+	enum hydrasdr_sample_type sample_type;
+} replay_ctx_t;
+
+static int replay_callback(hydrasdr_transfer_t *transfer)
+{
+	replay_ctx_t *ctx = (replay_ctx_t *) transfer->ctx;
+	size_t bytes = (size_t) transfer->sample_count * (ctx->sample_type == HYDRASDR_SAMPLE_FLOAT32_IQ ? 8 : 4);
+
+	ctx->dropped += transfer->dropped_samples;
+	ctx->wrong_type |= transfer->sample_type != ctx->sample_type;
+	if (ctx->used + bytes <= ctx->size)
+	{
+		memcpy(ctx->output + ctx->used, transfer->samples, bytes);
+	}
+	ctx->used += bytes;
+	return 0;
+}
+
+typedef struct {
+	int count;
+	enum hydrasdr_sample_type sample_type[BUFFER_COUNT];
+	uint32_t flags[BUFFER_COUNT];
+	int16_t *output; /* INT16_IQ buffers, at their position in the stream */
+	int16_t kernel[SWAP_KERNEL_LEN];
+	int result;
+} swap_ctx_t;
+
+static int swap_callback(hydrasdr_transfer_t *transfer)
+{
+	swap_ctx_t *ctx = (swap_ctx_t *) transfer->ctx;
+	int n = ctx->count++;
+
+	if (n >= BUFFER_COUNT)
+	{
+		return 0;
+	}
+	ctx->sample_type[n] = transfer->sample_type;
+	ctx->flags[n] = transfer->flags;
+	if (transfer->sample_type == HYDRASDR_SAMPLE_INT16_IQ && transfer->sample_count * 2 == UNPACKED_BUFFER_SAMPLES)
+	{
+		memcpy(ctx->output + (size_t) n * UNPACKED_BUFFER_SAMPLES, transfer->samples, UNPACKED_BUFFER_SAMPLES * sizeof(int16_t));
+	}
+
+	/* Called from the consumer thread, as an application reacting to its data would */
+	if (n == SWAP_TYPE_BUFFER)
+	{
+		ctx->result |= hydrasdr_set_sample_type(transfer->device, HYDRASDR_SAMPLE_INT16_IQ);
+	}
+	else if (n == SWAP_FILTER_BUFFER)
+	{
+		ctx->result |= hydrasdr_set_conversion_filter_int16(transfer->device, ctx->kernel, SWAP_KERNEL_LEN);
+	}
+	return 0;
+}
+
+static int run_replay(const char *path, int packed, replay_ctx_t *ctx)
+{
+	struct hydrasdr_device *device;
+	int result;
+
+	result = hydrasdr_open_file(&device, path, SAMPLERATE, 0);
+	if (result != HYDRASDR_SUCCESS)
+	{
+		return result;
+	}
+	hydrasdr_set_packing(device, (uint8_t) packed);
+	hydrasdr_set_sample_type(device, ctx->sample_type);
+
+	result = hydrasdr_start_rx(device, replay_callback, ctx);
+	if (result == HYDRASDR_SUCCESS)
+	{
+		while (hydrasdr_is_streaming(device) == HYDRASDR_TRUE)
+		{
+			/* Replay stops by itself at the end of the file */
+			test_sleep_ms(1);
+		}
+		result = hydrasdr_stop_rx(device);
+	}
+	hydrasdr_close(device);
+
+	return result;
+}
+
+typedef struct {
+	int count;
+	hydrasdr_transfer_t transfer[HEADER_BUFFER_COUNT];
+	uint16_t first[HEADER_BUFFER_COUNT]; /* First and last samples of the buffers */
+	uint16_t last[HEADER_BUFFER_COUNT];
+} header_ctx_t;
+
+static int header_callback(hydrasdr_transfer_t *transfer)
+{
+	header_ctx_t *ctx = (header_ctx_t *) transfer->ctx;
+	const uint16_t *samples = (const uint16_t *) transfer->samples;
+
+	if (ctx->count < HEADER_BUFFER_COUNT)
+	{
+		ctx->transfer[ctx->count] = *transfer;
+		ctx->first[ctx->count] = samples[0];
+		ctx->last[ctx->count] = samples[transfer->sample_count - 1];
+	}
+	ctx->count++;
+	return 0;
+}
+
+typedef struct {
+	int count;
+	int id[OVERFLOW_BUFFER_COUNT]; /* First ADC sample of the RAW buffers, the buffer number in the capture */
+	int sample_count[OVERFLOW_BUFFER_COUNT];
+	uint32_t flags[OVERFLOW_BUFFER_COUNT];
+	uint64_t dropped[OVERFLOW_BUFFER_COUNT];
+	enum hydrasdr_sample_type sample_type[OVERFLOW_BUFFER_COUNT];
+} overflow_ctx_t;
+
+static int overflow_callback(hydrasdr_transfer_t *transfer)
+{
+	overflow_ctx_t *ctx = (overflow_ctx_t *) transfer->ctx;
+	int n = ctx->count++;
+
+	if (n >= OVERFLOW_BUFFER_COUNT)
+	{
+		return 0;
+	}
+	ctx->id[n] = (transfer->sample_type == HYDRASDR_SAMPLE_RAW && transfer->sample_count > 0) ? ((const uint16_t *) transfer->samples)[0] : -1;
+	ctx->sample_count[n] = transfer->sample_count;
+	ctx->flags[n] = transfer->flags;
+	ctx->dropped[n] = transfer->dropped_host_samples;
+	ctx->sample_type[n] = transfer->sample_type;
+	if (n == 0)
+	{
+		test_sleep_ms(OVERFLOW_STALL_MS);
+	}
+	return 0;
+}
+
+static int write_capture(const char *path, const uint16_t *adc, int count, int packed)
+{
+	FILE *file;
+	size_t size;
+	size_t n;
+	void *data;
+
+	if (packed)
+	{
+		data = malloc((size_t) count * 3 / 2);
+		test_pack_adc(adc, (uint32_t *) data, count);
+		size = (size_t) count * 3 / 2;
+	}
+	else
+	{
+		data = (void *) adc;
+		size = (size_t) count * sizeof(uint16_t);
+	}
+
+	file = fopen(path, "wb");
+	if (file == NULL)
+	{
+		return -1;
+	}
+	n = fwrite(data, 1, size, file);
+	if (packed)
+	{
+		free(data);
+	}
+
+	return (fclose(file) == 0 && n == size) ? 0 : -1;
+}
+
+static int test_swap(const char *work_dir)
+{
+	uint16_t *adc = (uint16_t *) malloc(TOTAL_SAMPLES * sizeof(uint16_t));
+	int16_t *in_int16 = (int16_t *) malloc(TOTAL_SAMPLES * sizeof(int16_t));
+	int16_t *ref_int16 = (int16_t *) malloc(TOTAL_SAMPLES * sizeof(int16_t));
+	struct hydrasdr_device *device;
+	swap_ctx_t ctx;
+	char path[4096];
+	uint32_t expected;
+	int start, count, swap;
+	int result;
+	int i;
+
+	memset(&ctx, 0, sizeof(ctx));
+	ctx.output = (int16_t *) calloc(TOTAL_SAMPLES, sizeof(int16_t));
+	test_halfband_int16(ctx.kernel, SWAP_KERNEL_LEN);
+	snprintf(path, sizeof(path), "%s/test_replay_swap.raw", work_dir);
+
+	test_generate_adc(adc, TOTAL_SAMPLES, SEED);
+	if (write_capture(path, adc, TOTAL_SAMPLES, 0) != 0)
+		TEST_FAIL("cannot write %s", path);
+
+	result = hydrasdr_open_file(&device, path, SAMPLERATE, 0);
+	if (result == HYDRASDR_SUCCESS)
+	{
+		hydrasdr_set_packing(device, 0);
+		hydrasdr_set_sample_type(device, HYDRASDR_SAMPLE_FLOAT32_IQ);
+		result = hydrasdr_start_rx(device, swap_callback, &ctx);
+		if (result == HYDRASDR_SUCCESS)
+		{
+			while (hydrasdr_is_streaming(device) == HYDRASDR_TRUE)
+			{
+				test_sleep_ms(1);
+			}
+			result = hydrasdr_stop_rx(device);
+		}
+		hydrasdr_close(device);
+	}
+	remove(path);
+	if (result != HYDRASDR_SUCCESS || ctx.result != HYDRASDR_SUCCESS)
+		TEST_FAIL("replay failed: %s (%d), setters %d", hydrasdr_error_name(result), result, ctx.result);
+	if (ctx.count != BUFFER_COUNT)
+		TEST_FAIL("%d buffers received, expected %d", ctx.count, BUFFER_COUNT);
+
+	for (i = 0; i < BUFFER_COUNT; i++)
+	{
+		expected = (i == SWAP_TYPE_BUFFER + 1) ? HYDRASDR_TRANSFER_SAMPLE_TYPE_CHANGED :
+			(i == SWAP_FILTER_BUFFER + 1) ? HYDRASDR_TRANSFER_FILTER_CHANGED : 0;
+		if (ctx.flags[i] != expected)
+			TEST_FAIL("buffer %d: flags 0x%x, expected 0x%x", i, ctx.flags[i], expected);
+		if (ctx.sample_type[i] != (i <= SWAP_TYPE_BUFFER ? HYDRASDR_SAMPLE_FLOAT32_IQ : HYDRASDR_SAMPLE_INT16_IQ))
+			TEST_FAIL("buffer %d: sample type %d", i, ctx.sample_type[i]);
+	}
+
+	/* The int16 chain starts from its reset state at the buffer after the change */
+	start = (SWAP_TYPE_BUFFER + 1) * UNPACKED_BUFFER_SAMPLES;
+	count = (SWAP_FILTER_BUFFER - SWAP_TYPE_BUFFER) * UNPACKED_BUFFER_SAMPLES;
+	convert_samples_int16(adc + start, in_int16, count);
+	iqconverter_int16_ref(HB_KERNEL_INT16, HB_KERNEL_INT16_LEN, in_int16, ref_int16, count);
+	i = test_compare_int16(ctx.output + start, ref_int16, count);
+	if (i >= 0)
+		TEST_FAIL("sample %d after the sample type change: %d, reference %d", i, ctx.output[start + i], ref_int16[i]);
+
+	/* The new filter continues the stream, from the swap it matches the new filter alone (no step) */
+	count = (BUFFER_COUNT - SWAP_TYPE_BUFFER - 1) * UNPACKED_BUFFER_SAMPLES;
+	convert_samples_int16(adc + start, in_int16, count);
+	iqconverter_int16_ref(ctx.kernel, SWAP_KERNEL_LEN, in_int16, ref_int16, count);
+	swap = (SWAP_FILTER_BUFFER - SWAP_TYPE_BUFFER) * UNPACKED_BUFFER_SAMPLES;
+	i = test_compare_int16(ctx.output + start + swap, ref_int16 + swap, count - swap);
+	if (i >= 0)
+		TEST_FAIL("sample %d after the filter change: %d, reference %d", i, ctx.output[start + swap + i], ref_int16[swap + i]);
+
+	free(adc);
+	free(in_int16);
+	free(ref_int16);
+	free(ctx.output);
+
+	return 0;
+}
+
+static int test_header(const char *work_dir)
+{
+	/* Buffers 3, 5, 6 and 9 never reach the host, 3 and 9 dropped by the firmware, buffer 8 has no header (all samples) */
+	static const uint32_t sequence[HEADER_BUFFER_COUNT] = { 0, 1, 2, 4, 7, 8, 10, 11, 12, 14 };
+	static const uint32_t firmware_dropped[HEADER_BUFFER_COUNT] = { 0, 0, 0, 1, 1, 1, 2, 2, 2, 2 };
+	static const uint32_t expected_firmware[HEADER_BUFFER_COUNT] = { 0, 0, 0, 1, 0, 0, 1, 0, 0, 0 };
+	static const uint32_t expected_usb[HEADER_BUFFER_COUNT] = { 0, 0, 0, 0, 2, 0, 0, 0, 0, 0 };
+	static const uint64_t expected_index[HEADER_BUFFER_COUNT] = { 0, 1, 2, 4, 7, 8, 10, 11, 12, 13 };
+	uint16_t *buffer = (uint16_t *) calloc(UNPACKED_BUFFER_SAMPLES, sizeof(uint16_t));
+	hydrasdr_buffer_header_t *header = (hydrasdr_buffer_header_t *) buffer;
+	uint16_t *samples = buffer + sizeof(hydrasdr_buffer_header_t) / sizeof(uint16_t);
+	struct hydrasdr_device *device;
+	const hydrasdr_transfer_t *transfer;
+	header_ctx_t ctx;
+	char path[4096];
+	FILE *file;
+	uint32_t flags;
+	uint64_t index;
+	int count;
+	int result;
+	int i;
+
+	memset(&ctx, 0, sizeof(ctx));
+	snprintf(path, sizeof(path), "%s/test_replay_header.raw", work_dir);
+
+	file = fopen(path, "wb");
+	if (file == NULL)
+		TEST_FAIL("cannot write %s", path);
+	for (i = 0; i < HEADER_BUFFER_COUNT; i++)
+	{
+		header->magic = HYDRASDR_BUFFER_HEADER_MAGIC;
+		header->sequence = sequence[i];
+		header->dropped = firmware_dropped[i];
+		samples[0] = (uint16_t) (0x100 + i);
+		samples[HEADER_BUFFER_SAMPLES - 1] = (uint16_t) (0x200 + i);
+		if (i == 8)
+		{
+			memset(buffer, 0, sizeof(hydrasdr_buffer_header_t));
+			buffer[0] = (uint16_t) (0x100 + i);
+		}
+		if (fwrite(buffer, sizeof(uint16_t), UNPACKED_BUFFER_SAMPLES, file) != UNPACKED_BUFFER_SAMPLES)
+			TEST_FAIL("cannot write %s", path);
+	}
+	if (fclose(file) != 0)
+		TEST_FAIL("cannot write %s", path);
+
+	result = hydrasdr_open_file(&device, path, SAMPLERATE, 0);
+	if (result == HYDRASDR_SUCCESS)
+	{
+		hydrasdr_set_packing(device, PACKING_OFF_HEADER);
+		hydrasdr_set_sample_type(device, HYDRASDR_SAMPLE_RAW);
+		result = hydrasdr_start_rx(device, header_callback, &ctx);
+		if (result == HYDRASDR_SUCCESS)
+		{
+			while (hydrasdr_is_streaming(device) == HYDRASDR_TRUE)
+			{
+				test_sleep_ms(1);
+			}
+			result = hydrasdr_stop_rx(device);
+		}
+		hydrasdr_close(device);
+	}
+	remove(path);
+	if (result != HYDRASDR_SUCCESS)
+		TEST_FAIL("replay failed: %s (%d)", hydrasdr_error_name(result), result);
+	if (ctx.count != HEADER_BUFFER_COUNT)
+		TEST_FAIL("%d buffers received, expected %d", ctx.count, HEADER_BUFFER_COUNT);
+
+	for (i = 0; i < HEADER_BUFFER_COUNT; i++)
+	{
+		transfer = &ctx.transfer[i];
+		flags = (i == 8) ? 0 : HYDRASDR_TRANSFER_SEQUENCE_VALID;
+		/* Without the magic nothing is stripped */
+		count = (i == 8) ? UNPACKED_BUFFER_SAMPLES : HEADER_BUFFER_SAMPLES;
+		if (transfer->sample_count != count || transfer->flags != flags)
+			TEST_FAIL("buffer %d: %d samples, flags 0x%x", i, transfer->sample_count, transfer->flags);
+		if (ctx.first[i] != 0x100 + i || ctx.last[i] != 0x200 + i)
+			TEST_FAIL("buffer %d: samples 0x%x..0x%x, the header is not stripped or samples are", i, ctx.first[i], ctx.last[i]);
+		if (flags != 0 && transfer->sequence != sequence[i])
+			TEST_FAIL("buffer %d: sequence %u, expected %u", i, transfer->sequence, sequence[i]);
+		if (transfer->dropped_firmware_samples != (uint64_t) expected_firmware[i] * HEADER_BUFFER_SAMPLES ||
+			transfer->dropped_usb_samples != (uint64_t) expected_usb[i] * HEADER_BUFFER_SAMPLES ||
+			transfer->dropped_host_samples != 0 ||
+			transfer->dropped_samples != transfer->dropped_firmware_samples + transfer->dropped_usb_samples)
+			TEST_FAIL("buffer %d: %llu samples dropped in the firmware, %llu on USB", i,
+				(unsigned long long) transfer->dropped_firmware_samples, (unsigned long long) transfer->dropped_usb_samples);
+		/* Buffer 8 is longer by the header size */
+		index = expected_index[i] * HEADER_BUFFER_SAMPLES + ((i > 8) ? UNPACKED_BUFFER_SAMPLES - HEADER_BUFFER_SAMPLES : 0);
+		if (transfer->sample_index != index)
+			TEST_FAIL("buffer %d: sample index %llu, expected %llu", i, (unsigned long long) transfer->sample_index,
+				(unsigned long long) index);
+	}
+
+	free(buffer);
+
+	return 0;
+}
+
+static int run_overflow(const char *path, enum hydrasdr_overflow_policy policy, uint32_t watermark, enum hydrasdr_sample_type sample_type,
+	overflow_ctx_t *ctx)
+{
+	struct hydrasdr_device *device;
+	int result;
+
+	memset(ctx, 0, sizeof(*ctx));
+	result = hydrasdr_open_file(&device, path, OVERFLOW_SAMPLERATE, HYDRASDR_REPLAY_REALTIME);
+	if (result != HYDRASDR_SUCCESS)
+	{
+		return result;
+	}
+	hydrasdr_set_packing(device, 0);
+	hydrasdr_set_sample_type(device, sample_type);
+	result = hydrasdr_set_overflow_policy(device, policy, watermark);
+	if (result == HYDRASDR_SUCCESS)
+	{
+		result = hydrasdr_start_rx(device, overflow_callback, ctx);
+	}
+	if (result == HYDRASDR_SUCCESS)
+	{
+		while (hydrasdr_is_streaming(device) == HYDRASDR_TRUE)
+		{
+			test_sleep_ms(1);
+		}
+		result = hydrasdr_stop_rx(device);
+	}
+	hydrasdr_close(device);
+
+	return result;
+}
+
+static int test_overflow(const char *work_dir)
+{
+	uint16_t *adc = (uint16_t *) calloc((size_t) OVERFLOW_BUFFER_COUNT * UNPACKED_BUFFER_SAMPLES, sizeof(uint16_t));
+	static const uint32_t watermarks[2] = { OVERFLOW_WATERMARK, OVERFLOW_QUEUE };
+	overflow_ctx_t ctx;
+	char path[4096];
+	int result;
+	int degraded;
+	int w;
+	int i;
+
+	snprintf(path, sizeof(path), "%s/test_replay_overflow.raw", work_dir);
+	for (i = 0; i < OVERFLOW_BUFFER_COUNT; i++)
+	{
+		adc[(size_t) i * UNPACKED_BUFFER_SAMPLES] = (uint16_t) i;
+	}
+	if (write_capture(path, adc, OVERFLOW_BUFFER_COUNT * UNPACKED_BUFFER_SAMPLES, 0) != 0)
+		TEST_FAIL("cannot write %s", path);
+
+	/* The first buffer, the queue filled during the stall, then an empty transfer with the drops after it */
+	result = run_overflow(path, HYDRASDR_OVERFLOW_DROP_NEWEST, 0, HYDRASDR_SAMPLE_RAW, &ctx);
+	if (result != HYDRASDR_SUCCESS)
+		TEST_FAIL("drop newest: %s (%d)", hydrasdr_error_name(result), result);
+	if (ctx.count != 2 + OVERFLOW_QUEUE)
+		TEST_FAIL("drop newest: %d buffers received, expected %d", ctx.count, 2 + OVERFLOW_QUEUE);
+	for (i = 0; i < ctx.count - 1; i++)
+	{
+		if (ctx.id[i] != i || ctx.flags[i] != 0 || ctx.dropped[i] != 0)
+			TEST_FAIL("drop newest: buffer %d is %d, flags 0x%x", i, ctx.id[i], ctx.flags[i]);
+	}
+	if (ctx.sample_count[i] != 0 || ctx.flags[i] != HYDRASDR_TRANSFER_DROPPED_NEWEST ||
+		ctx.dropped[i] != (uint64_t) (OVERFLOW_BUFFER_COUNT - OVERFLOW_QUEUE - 1) * UNPACKED_BUFFER_SAMPLES)
+		TEST_FAIL("drop newest: last transfer of %d samples, flags 0x%x, %llu samples dropped", ctx.sample_count[i], ctx.flags[i],
+			(unsigned long long) ctx.dropped[i]);
+
+	/* The first buffer, then the last ones of the capture with the drops before them */
+	result = run_overflow(path, HYDRASDR_OVERFLOW_DROP_OLDEST, 0, HYDRASDR_SAMPLE_RAW, &ctx);
+	if (result != HYDRASDR_SUCCESS)
+		TEST_FAIL("drop oldest: %s (%d)", hydrasdr_error_name(result), result);
+	if (ctx.count != 1 + OVERFLOW_QUEUE)
+		TEST_FAIL("drop oldest: %d buffers received, expected %d", ctx.count, 1 + OVERFLOW_QUEUE);
+	for (i = 1; i < ctx.count; i++)
+	{
+		if (ctx.id[i] != OVERFLOW_BUFFER_COUNT - OVERFLOW_QUEUE + i - 1)
+			TEST_FAIL("drop oldest: buffer %d is %d", i, ctx.id[i]);
+	}
+	if (ctx.flags[1] != HYDRASDR_TRANSFER_DROPPED_OLDEST ||
+		ctx.dropped[1] != (uint64_t) (OVERFLOW_BUFFER_COUNT - OVERFLOW_QUEUE - 1) * UNPACKED_BUFFER_SAMPLES)
+		TEST_FAIL("drop oldest: flags 0x%x, %llu samples dropped", ctx.flags[1], (unsigned long long) ctx.dropped[1]);
+
+	/* RAW from the watermark until the backlog is under half of it, a watermark of a full queue engages too */
+	for (w = 0; w < 2; w++)
+	{
+		result = run_overflow(path, HYDRASDR_OVERFLOW_DEGRADE, watermarks[w], HYDRASDR_SAMPLE_INT16_IQ, &ctx);
+		if (result != HYDRASDR_SUCCESS)
+			TEST_FAIL("degrade %u: %s (%d)", watermarks[w], hydrasdr_error_name(result), result);
+		if (ctx.count != 2 + OVERFLOW_QUEUE)
+			TEST_FAIL("degrade %u: %d buffers received, expected %d", watermarks[w], ctx.count, 2 + OVERFLOW_QUEUE);
+		for (i = 0; i < ctx.count - 1; i++)
+		{
+			/* Backlog of OVERFLOW_QUEUE + 1 - i when buffer i > 0 is taken, itself included */
+			degraded = i > 0 && OVERFLOW_QUEUE + 1 - i >= (int) (watermarks[w] + 1) / 2;
+			if ((ctx.flags[i] == HYDRASDR_TRANSFER_DEGRADED) != degraded ||
+				ctx.sample_type[i] != (degraded ? HYDRASDR_SAMPLE_RAW : HYDRASDR_SAMPLE_INT16_IQ) || (degraded && ctx.id[i] != i))
+				TEST_FAIL("degrade %u: buffer %d, flags 0x%x, sample type %d", watermarks[w], i, ctx.flags[i], ctx.sample_type[i]);
+		}
+		/* The drops are counted in IQ samples of the last buffer */
+		if (ctx.sample_count[i] != 0 || ctx.flags[i] != HYDRASDR_TRANSFER_DROPPED_NEWEST ||
+			ctx.dropped[i] != (uint64_t) (OVERFLOW_BUFFER_COUNT - OVERFLOW_QUEUE - 1) * UNPACKED_BUFFER_SAMPLES / 2)
+			TEST_FAIL("degrade %u: last transfer of %d samples, flags 0x%x, %llu samples dropped", watermarks[w], ctx.sample_count[i],
+				ctx.flags[i], (unsigned long long) ctx.dropped[i]);
+	}
+	remove(path);
+
+	free(adc);
+
+	return 0;
+}
+
+typedef struct {
+	int count;
+	int busy; /* hydrasdr_set_external_events() result while streaming */
+} events_ctx_t;
+
+static int events_callback(hydrasdr_transfer_t *transfer)
+{
+	events_ctx_t *ctx = (events_ctx_t *) transfer->ctx;
+
+	if (ctx->count++ == 0)
+	{
+		ctx->busy = hydrasdr_set_external_events(transfer->device, 0);
+	}
+	return 0;
+}
+
+static int test_events(const char *work_dir)
+{
+	uint16_t *adc = (uint16_t *) calloc(TOTAL_SAMPLES, sizeof(uint16_t));
+	hydrasdr_pollfd_t pollfds[2];
+	struct hydrasdr_device *device;
+	events_ctx_t ctx;
+	char path[4096];
+	int result;
+
+	memset(&ctx, 0, sizeof(ctx));
+	snprintf(path, sizeof(path), "%s/test_replay_events.raw", work_dir);
+	if (write_capture(path, adc, TOTAL_SAMPLES, 0) != 0)
+		TEST_FAIL("cannot write %s", path);
+	free(adc);
+
+	result = hydrasdr_open_file(&device, path, SAMPLERATE, 0);
+	if (result != HYDRASDR_SUCCESS)
+		TEST_FAIL("cannot open %s: %s (%d)", path, hydrasdr_error_name(result), result);
+	hydrasdr_set_packing(device, 0);
+
+	if ((result = hydrasdr_get_pollfds(device, NULL, 2)) != HYDRASDR_ERROR_INVALID_PARAM)
+		TEST_FAIL("get_pollfds(NULL, 2): %d", result);
+	if ((result = hydrasdr_get_pollfds(device, pollfds, -1)) != HYDRASDR_ERROR_INVALID_PARAM)
+		TEST_FAIL("get_pollfds(-1): %d", result);
+	/* No USB events to poll for a replay */
+	if ((result = hydrasdr_get_pollfds(device, pollfds, 2)) != 0)
+		TEST_FAIL("get_pollfds(2): %d descriptors", result);
+	if ((result = hydrasdr_set_external_events(device, 1)) != HYDRASDR_SUCCESS)
+		TEST_FAIL("set_external_events(1): %d", result);
+
+	/* The replay thread still feeds the callback, the application loop handles events meanwhile */
+	result = hydrasdr_start_rx(device, events_callback, &ctx);
+	if (result == HYDRASDR_SUCCESS)
+	{
+		while (hydrasdr_is_streaming(device) == HYDRASDR_TRUE && result == HYDRASDR_SUCCESS)
+		{
+			result = hydrasdr_handle_events_nonblocking(device);
+			test_sleep_ms(1);
+		}
+		if (result == HYDRASDR_SUCCESS)
+		{
+			result = hydrasdr_stop_rx(device);
+		}
+		else
+		{
+			hydrasdr_stop_rx(device);
+		}
+	}
+	if (result != HYDRASDR_SUCCESS)
+	{
+		hydrasdr_close(device);
+		remove(path);
+		TEST_FAIL("replay failed: %s (%d)", hydrasdr_error_name(result), result);
+	}
+	if (ctx.busy != HYDRASDR_ERROR_BUSY)
+		TEST_FAIL("set_external_events() while streaming: %d", ctx.busy);
+	if (ctx.count != BUFFER_COUNT)
+		TEST_FAIL("%d buffers received, expected %d", ctx.count, BUFFER_COUNT);
+
+	/* Stopped: the mode can change again */
+	result = hydrasdr_set_external_events(device, 0);
+	hydrasdr_close(device);
+	remove(path);
+	if (result != HYDRASDR_SUCCESS)
+		TEST_FAIL("set_external_events(0) after the stream: %d", result);
+
+	return 0;
+}
+
+static int test_restart(const char *work_dir)
+{
+	uint16_t *adc = (uint16_t *) malloc(TOTAL_SAMPLES * sizeof(uint16_t));
+	int16_t *in_int16 = (int16_t *) malloc(TOTAL_SAMPLES * sizeof(int16_t));
+	int16_t *ref_int16 = (int16_t *) malloc(TOTAL_SAMPLES * sizeof(int16_t));
+	struct hydrasdr_device *device;
+	replay_ctx_t ctx[RESTART_COUNT];
+	char path[4096];
+	int result;
+	int run;
+	int i;
+
+	snprintf(path, sizeof(path), "%s/test_replay_restart.raw", work_dir);
+	test_generate_adc(adc, TOTAL_SAMPLES, SEED);
+	if (write_capture(path, adc, TOTAL_SAMPLES, 0) != 0)
+		TEST_FAIL("cannot write %s", path);
+	convert_samples_int16(adc, in_int16, TOTAL_SAMPLES);
+	iqconverter_int16_ref(HB_KERNEL_INT16, HB_KERNEL_INT16_LEN, in_int16, ref_int16, TOTAL_SAMPLES);
+
+	result = hydrasdr_open_file(&device, path, SAMPLERATE, 0);
+	if (result != HYDRASDR_SUCCESS)
+		TEST_FAIL("open: %s (%d)", hydrasdr_error_name(result), result);
+	hydrasdr_set_packing(device, 0);
+	hydrasdr_set_sample_type(device, HYDRASDR_SAMPLE_INT16_IQ);
+
+	/* Restarted as soon as streaming ends, while the consumer may still be converting the last buffer */
+	for (run = 0; run < RESTART_COUNT; run++)
+	{
+		memset(&ctx[run], 0, sizeof(replay_ctx_t));
+		ctx[run].sample_type = HYDRASDR_SAMPLE_INT16_IQ;
+		ctx[run].size = TOTAL_SAMPLES * sizeof(int16_t);
+		ctx[run].output = (uint8_t *) malloc(ctx[run].size);
+		result = hydrasdr_start_rx(device, replay_callback, &ctx[run]);
+		if (result != HYDRASDR_SUCCESS)
+			TEST_FAIL("run %d: start_rx: %s (%d)", run, hydrasdr_error_name(result), result);
+		while (hydrasdr_is_streaming(device) == HYDRASDR_TRUE)
+		{
+			test_sleep_ms(1);
+		}
+	}
+	result = hydrasdr_stop_rx(device);
+	hydrasdr_close(device);
+	remove(path);
+	if (result != HYDRASDR_SUCCESS)
+		TEST_FAIL("stop_rx: %s (%d)", hydrasdr_error_name(result), result);
+
+	for (run = 0; run < RESTART_COUNT; run++)
+	{
+		if (ctx[run].used != ctx[run].size || ctx[run].dropped != 0 || ctx[run].wrong_type)
+			TEST_FAIL("run %d: %zu bytes received, expected %zu", run, ctx[run].used, ctx[run].size);
+		i = test_compare_int16((const int16_t *) ctx[run].output, ref_int16, TOTAL_SAMPLES);
+		if (i >= 0)
+			TEST_FAIL("run %d, sample %d: %d, reference %d", run, i, ((const int16_t *) ctx[run].output)[i], ref_int16[i]);
+		free(ctx[run].output);
+	}
+
+	free(adc);
+	free(in_int16);
+	free(ref_int16);
+
+	return 0;
+}
+
+int main(int argc, char **argv)
+{
+	uint16_t *adc;
+	float *in_float, *ref_float;
+	int16_t *in_int16, *ref_int16;
+	replay_ctx_t ctx;
+	char path[4096];
+	int packed;
+	int count;
+	int result;
+	int i;
+
+	if (argc != 3)
+	{
+		fprintf(stderr, "usage: %s float|int16|swap|header|overflow|restart|events <work_dir>\n", argv[0]);
+		return 2;
+	}
+	if (strcmp(argv[1], "swap") == 0)
+	{
+		return test_swap(argv[2]);
+	}
+	if (strcmp(argv[1], "header") == 0)
+	{
+		return test_header(argv[2]);
+	}
+	if (strcmp(argv[1], "overflow") == 0)
+	{
+		return test_overflow(argv[2]);
+	}
+	if (strcmp(argv[1], "restart") == 0)
+	{
+		return test_restart(argv[2]);
+	}
+	if (strcmp(argv[1], "events") == 0)
+	{
+		return test_events(argv[2]);
+	}
+
+	memset(&ctx, 0, sizeof(ctx));
+	ctx.sample_type = strcmp(argv[1], "float") == 0 ? HYDRASDR_SAMPLE_FLOAT32_IQ : HYDRASDR_SAMPLE_INT16_IQ;
+	snprintf(path, sizeof(path), "%s/test_replay_%s.raw", argv[2], argv[1]);
+
+	adc = (uint16_t *) malloc(TOTAL_SAMPLES * sizeof(uint16_t));
+	in_float = (float *) malloc(TOTAL_SAMPLES * sizeof(float));
+	ref_float = (float *) malloc(TOTAL_SAMPLES * sizeof(float));
+	in_int16 = (int16_t *) malloc(TOTAL_SAMPLES * sizeof(int16_t));
+	ref_int16 = (int16_t *) malloc(TOTAL_SAMPLES * sizeof(int16_t));
+	ctx.size = TOTAL_SAMPLES * sizeof(float);
+	ctx.output = (uint8_t *) malloc(ctx.size);
+
+	test_generate_adc(adc, TOTAL_SAMPLES, SEED);
+
+	for (packed = 0; packed <= 1; packed++)
+	{
+		count = BUFFER_COUNT * (packed ? PACKED_BUFFER_SAMPLES : UNPACKED_BUFFER_SAMPLES);
+		if (write_capture(path, adc, count, packed) != 0)
+			TEST_FAIL("cannot write %s", path);
+
+		ctx.used = 0;
+		result = run_replay(path, packed, &ctx);
+		remove(path);
+		if (result != HYDRASDR_SUCCESS)
+			TEST_FAIL("replay failed: %s (%d)", hydrasdr_error_name(result), result);
+		if (ctx.dropped != 0 || ctx.wrong_type)
+			TEST_FAIL("packing %d: %llu samples dropped, wrong type %d", packed, (unsigned long long) ctx.dropped, ctx.wrong_type);
+
+		if (ctx.sample_type == HYDRASDR_SAMPLE_FLOAT32_IQ)
+		{
+			if (ctx.used != (size_t) count * sizeof(float))
+				TEST_FAIL("packing %d: %zu bytes received, expected %zu", packed, ctx.used, (size_t) count * sizeof(float));
+			convert_samples_float(adc, in_float, count);
+			iqconverter_float_ref(HB_KERNEL_FLOAT, HB_KERNEL_FLOAT_LEN, in_float, ref_float, count);
+			i = test_compare_float((const float *) ctx.output, ref_float, count, FLOAT_TOLERANCE);
+			if (i >= 0)
+				TEST_FAIL("packing %d, sample %d: %.9g, reference %.9g", packed, i, ((const float *) ctx.output)[i], ref_float[i]);
+		}
+		else
+		{
+			if (ctx.used != (size_t) count * sizeof(int16_t))
+				TEST_FAIL("packing %d: %zu bytes received, expected %zu", packed, ctx.used, (size_t) count * sizeof(int16_t));
+			convert_samples_int16(adc, in_int16, count);
+			iqconverter_int16_ref(HB_KERNEL_INT16, HB_KERNEL_INT16_LEN, in_int16, ref_int16, count);
+			i = test_compare_int16((const int16_t *) ctx.output, ref_int16, count);
+			if (i >= 0)
+				TEST_FAIL("packing %d, sample %d: %d, reference %d", packed, i, ((const int16_t *) ctx.output)[i], ref_int16[i]);
+		}
+	}
+
+	free(adc);
+	free(in_float);
+	free(ref_float);
+	free(in_int16);
+	free(ref_int16);
+	free(ctx.output);
+
+	return 0;
+}
@@ -0,0 +1,107 @@
+/*
+Copyright (c) 2025 Benjamin Vernoux <bvernoux@hydrasdr.com>
+
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+
+Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the
+documentation and/or other materials provided with the distribution.
+Neither the name of HydraSDR nor the names of its contributors may be used to endorse or promote products derived from this software
+without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+/*
+ * Throughput of iqconverter_float and iqconverter_int16 on unpacked device buffers.
+ *   test_throughput float|int16 <min_msps>
+ * Fails below min_msps million ADC samples per second on one core (20 keeps up with 10 MSPS IQ).
+ */
+
+#include "test_common.h"
+#include "iqconverter_float.h"
+#include "iqconverter_int16.h"
+#include "sample_convert.h"
+#include "filters.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#define BUFFER_SAMPLES (131072)
+#define MIN_TIME (0.3)
+#define SEED (0x1234)
+
+int main(int argc, char **argv)
+{
+	uint16_t *adc;
+	float *ref_float, *buf_float;
+	int16_t *ref_int16, *buf_int16;
+	iqconverter_float_t *cnv_f;
+	iqconverter_int16_t *cnv_i;
+	double min_msps, msps;
+	double t0, total = 0.0;
+	uint64_t samples = 0;
+	int is_float;
+
+	if (argc != 3)
+	{
+		fprintf(stderr, "usage: %s float|int16 <min_msps>\n", argv[0]);
+		return 2;
+	}
+	is_float = strcmp(argv[1], "float") == 0;
+	min_msps = strtod(argv[2], NULL);
+
+	adc = (uint16_t *) malloc(BUFFER_SAMPLES * sizeof(uint16_t));
+	ref_float = (float *) malloc(BUFFER_SAMPLES * sizeof(float));
+	buf_float = (float *) malloc(BUFFER_SAMPLES * sizeof(float));
+	ref_int16 = (int16_t *) malloc(BUFFER_SAMPLES * sizeof(int16_t));
+	buf_int16 = (int16_t *) malloc(BUFFER_SAMPLES * sizeof(int16_t));
+	cnv_f = iqconverter_float_create(HB_KERNEL_FLOAT, HB_KERNEL_FLOAT_LEN);
+	cnv_i = iqconverter_int16_create(HB_KERNEL_INT16, HB_KERNEL_INT16_LEN);
+
+	test_generate_adc(adc, BUFFER_SAMPLES, SEED);
+	convert_samples_float(adc, ref_float, BUFFER_SAMPLES);
+	convert_samples_int16(adc, ref_int16, BUFFER_SAMPLES);
+
+	while (total < MIN_TIME)
+	{
+		/* The converters work in place, restore the input outside of the measurement */
+		if (is_float)
+		{
+			memcpy(buf_float, ref_float, BUFFER_SAMPLES * sizeof(float));
+			t0 = test_clock();
+			iqconverter_float_process(cnv_f, buf_float, BUFFER_SAMPLES);
+		}
+		else
+		{
+			memcpy(buf_int16, ref_int16, BUFFER_SAMPLES * sizeof(int16_t));
+			t0 = test_clock();
+			iqconverter_int16_process(cnv_i, buf_int16, BUFFER_SAMPLES);
+		}
+		total += test_clock() - t0;
+		samples += BUFFER_SAMPLES;
+	}
+
+	msps = samples / total / 1e6;
+	printf("iqconverter_%s: %.1f MSPS (minimum %.1f)\n", argv[1], msps, min_msps);
+
+	iqconverter_float_free(cnv_f);
+	iqconverter_int16_free(cnv_i);
+	free(adc);
+	free(ref_float);
+	free(buf_float);
+	free(ref_int16);
+	free(buf_int16);
+
+	if (msps < min_msps)
+		TEST_FAIL("iqconverter_%s is too slow", argv[1]);
+
+	return 0;
+}